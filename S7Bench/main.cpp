@@ -0,0 +1,674 @@
+/*
+ * S7 Simulation Micro-Benchmarks
+ *
+ * Measures the cost per tag of the building blocks in the S7SimCore library so
+ * that performance work has a baseline:
+ * - Encoding:  SetReal / SetDWord / SetInt / SetBool and GetReal
+ * - Parsing:   ParseCSVLine + ParseTag on in-memory lines, LoadCSVConfig on a file
+ * - Creation:  CreateDataBlocksFromCSV + InitializeTagStates
+ * - Updating:  UpdateTagValues with every tag due (with and without lag recording),
+ *              with no tag due (scan cost), and 1000 steps due per tag (time warp)
+ * - Derived:   graph build and incremental recompute for chains of derived tags
+ * - Timers:    one 1 ms tick of TON/TOF/TP timers in a full 64 KB T area
+ *
+ * --scaling runs the suite on configurations written by the S7ConfigGen
+ * generator (mixed types and cycletimes) and reports load time, start-up
+ * time, memory and update-cycle cost side by side for each size.
+ *
+ * --generated (builds with S7SIM_GENERATED_ENGINE) runs the generic and the
+ * generated update engine on the tag table the engine was generated for,
+ * through the same simulated 100 ms passes, and checks that both produce
+ * identical process images.
+ *
+ * Usage: S7Bench [tagCount ...]              (default: 1000 100000 1000000)
+ *        S7Bench --scaling [tagCount ...]    (default: 1000 10000 100000 1000000)
+ *        S7Bench --generated [passes]        (default: 3000)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include "TagEngine.h"
+#include "DerivedTags.h"
+#include "TimerEngine.h"
+#include "SchedulerStats.h"
+#include "GeneratedEngine.h"
+#include "../S7ConfigGen/ConfigGenerator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+// Tags per generated Data Block (4 bytes each -> 1000 byte DBs)
+const int TAGS_PER_DB = 250;
+
+// Depth of each chain of derived tags in the derived benchmark
+const int DERIVED_CHAIN_DEPTH = 32;
+
+// Keeps the optimiser from discarding benchmarked work
+volatile uint32_t BenchSink = 0;
+
+typedef std::chrono::steady_clock BenchClock;
+
+double ElapsedNs(BenchClock::time_point start) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        BenchClock::now() - start).count());
+}
+
+// Print one result row: benchmark name, tag count, ns per tag
+void Report(const std::string& name, size_t tags, double totalNs, size_t operations) {
+    std::cout << std::left << std::setw(34) << name << std::right << std::setw(10) << tags
+              << std::setw(14) << std::fixed << std::setprecision(2) << (totalNs / operations) << std::endl;
+}
+
+// Generate a synthetic CSV line for tag index i: types cycle REAL, DWORD, INT, BOOL
+std::string MakeCSVLine(size_t i) {
+    int dbNumber = 1 + static_cast<int>(i / TAGS_PER_DB);
+    int offset = static_cast<int>(i % TAGS_PER_DB) * 4;
+    std::ostringstream line;
+    switch (i % 4) {
+        case 0: line << "\"DB" << dbNumber << ",REAL" << offset << "\",0,1800,0.5,0"; break;
+        case 1: line << "\"DB" << dbNumber << ",DWORD" << offset << "\",0,100000,1,0"; break;
+        case 2: line << "\"DB" << dbNumber << ",INT" << offset << "\",0,1000,1,0"; break;
+        default: line << "\"DB" << dbNumber << ",X" << offset << ".0\",0,1,1,0"; break;
+    }
+    return line.str();
+}
+
+void BenchEncoding(size_t tags) {
+    std::vector<byte> buffer(tags * 4 + 4);
+    byte* data = buffer.data();
+    const int iterations = tags < 100000 ? 100 : 10;
+
+    auto start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < tags; i++) {
+            SetReal(data, static_cast<int>(i * 4), static_cast<float>(i) * 0.5f);
+        }
+    }
+    Report("encode SetReal", tags, ElapsedNs(start), tags * iterations);
+
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < tags; i++) {
+            SetDWord(data, static_cast<int>(i * 4), static_cast<uint32_t>(i));
+        }
+    }
+    Report("encode SetDWord", tags, ElapsedNs(start), tags * iterations);
+
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < tags; i++) {
+            SetInt(data, static_cast<int>(i * 4), static_cast<int16_t>(i));
+        }
+    }
+    Report("encode SetInt", tags, ElapsedNs(start), tags * iterations);
+
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < tags; i++) {
+            SetBool(data, static_cast<int>(i * 4), static_cast<int>(i & 7), (i & 1) != 0);
+        }
+    }
+    Report("encode SetBool", tags, ElapsedNs(start), tags * iterations);
+
+    float sum = 0.0f;
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < tags; i++) {
+            sum += GetReal(data, static_cast<int>(i * 4));
+        }
+    }
+    Report("decode GetReal", tags, ElapsedNs(start), tags * iterations);
+    BenchSink = BenchSink + static_cast<uint32_t>(sum);
+}
+
+void BenchParsing(const std::vector<std::string>& lines) {
+    size_t tags = lines.size();
+
+    auto start = BenchClock::now();
+    for (const auto& line : lines) {
+        std::vector<std::string> fields = ParseCSVLine(line);
+        AreaType areaType;
+        DataType dataType;
+        int dbNumber, offset, bitPosition;
+        if (ParseTag(fields[0], areaType, dbNumber, offset, bitPosition, dataType)) {
+            BenchSink = BenchSink + static_cast<uint32_t>(offset);
+        }
+    }
+    Report("parse ParseCSVLine+ParseTag", tags, ElapsedNs(start), tags);
+
+    // LoadCSVConfig includes file I/O and value conversion
+    const std::string path = "s7bench_tags.csv";
+    {
+        std::ofstream file(path);
+        file << "tag,min,max,echelon,cycletime\n";
+        for (const auto& line : lines) {
+            file << line << '\n';
+        }
+    }
+    std::streambuf* saved = std::cout.rdbuf(nullptr);  // Silence the "Loaded N entries" line
+    start = BenchClock::now();
+    std::vector<CSVConfigEntry> entries = LoadCSVConfig(path);
+    double ns = ElapsedNs(start);
+    std::cout.rdbuf(saved);
+    std::remove(path.c_str());
+    Report("parse LoadCSVConfig (file)", tags, ns, tags);
+}
+
+void BenchUpdate(const std::vector<std::string>& lines) {
+    size_t tags = lines.size();
+
+    // Build the configuration in memory (same parse path as LoadCSVConfig)
+    std::vector<CSVConfigEntry> entries;
+    entries.reserve(tags);
+    for (const auto& line : lines) {
+        std::vector<std::string> fields = ParseCSVLine(line);
+        CSVConfigEntry entry;
+        ParseTag(fields[0], entry.areaType, entry.dbNumber, entry.offset, entry.bitPosition, entry.dataType);
+        entry.minValue = std::stod(fields[1]);
+        entry.maxValue = std::stod(fields[2]);
+        entry.echelon = std::stod(fields[3]);
+        entry.cycletime = std::stoi(fields[4]);
+        entries.push_back(entry);
+    }
+
+    ServerOptions options;
+    options.verbose = false;
+    ProcessImage image;
+
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    auto start = BenchClock::now();
+    CreateDataBlocksFromCSV(entries, options, image);
+    std::vector<TagState> tagStates = InitializeTagStates(entries, image);
+    std::vector<DataBlock>& dataBlocks = image.dataBlocks;
+    double ns = ElapsedNs(start);
+    std::cout.rdbuf(saved);
+    Report("create DBs + tag states", tags, ns, tags);
+
+    // Every tag due (cycletime 0): full sawtooth step and encode per tag
+    const int iterations = tags < 100000 ? 200 : 20;
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        UpdateTagValues(0, tagStates, dataBlocks, options);
+    }
+    Report("update all tags due", tags, ElapsedNs(start), tags * iterations);
+
+    // Same with the scheduler recording the lag of every written tag
+    SchedulerStats stats;
+    InitializeSchedulerStats(tagStates, std::chrono::milliseconds(100), stats);
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        UpdateTagValues(0, tagStates, dataBlocks, options, nullptr, &stats);
+    }
+    Report("update all tags due + lag stats", tags, ElapsedNs(start), tags * iterations);
+
+    // No tag due: the cost of scanning the tag list every cycle
+    for (auto& tag : tagStates) {
+        tag.cycletime = 3600000;
+    }
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        UpdateTagValues(0, tagStates, dataBlocks, options);
+    }
+    Report("update scan (no tag due)", tags, ElapsedNs(start), tags * iterations);
+
+    // Time warp: every pass each tag is 1000 cycletimes behind and catches up in closed form
+    auto simulatedNow = BenchClock::now();
+    for (auto& tag : tagStates) {
+        tag.cycletime = 1;
+        tag.lastUpdateTime = simulatedNow;
+    }
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        simulatedNow += std::chrono::seconds(1);
+        UpdateTagValues(0, tagStates, dataBlocks, options, nullptr, nullptr, simulatedNow);
+    }
+    Report("update 1000 steps/tag (time warp)", tags, ElapsedNs(start), tags * iterations);
+
+    ReleaseProcessImage(image);
+}
+
+// Plant model: one REAL source per derived tag; derived tag j = source j + derived j-1,
+// in chains of DERIVED_CHAIN_DEPTH, so one changed source touches at most one chain
+void BenchDerived(size_t tags) {
+    size_t derivedCount = tags / 2;
+    std::vector<CSVConfigEntry> entries;
+    entries.reserve(derivedCount * 2);
+    auto address = [](int db, int offset) {
+        return "DB" + std::to_string(db) + ",REAL" + std::to_string(offset);
+    };
+    for (size_t j = 0; j < derivedCount; j++) {
+        CSVConfigEntry source;
+        source.areaType = AreaType::DB;
+        source.dbNumber = 1 + static_cast<int>(j / TAGS_PER_DB);
+        source.offset = static_cast<int>(j % TAGS_PER_DB) * 4;
+        source.bitPosition = -1;
+        source.dataType = DataType::REAL;
+        source.minValue = 0;
+        source.maxValue = 0;  // No clamping
+        source.echelon = 1;
+        source.cycletime = 0;
+        entries.push_back(source);
+    }
+    for (size_t j = 0; j < derivedCount; j++) {
+        CSVConfigEntry derived = entries[j];
+        derived.dbNumber += 30000;
+        derived.expression = "sum(" + address(entries[j].dbNumber, entries[j].offset);
+        if (j % DERIVED_CHAIN_DEPTH != 0) {
+            const CSVConfigEntry& previous = entries[derivedCount + j - 1];
+            derived.expression += ";" + address(previous.dbNumber, previous.offset);
+        }
+        derived.expression += ")";
+        entries.push_back(derived);
+    }
+
+    ServerOptions options;
+    options.verbose = false;
+    ProcessImage image;
+    DerivedTagGraph graph;
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    CreateDataBlocksFromCSV(entries, options, image);
+    std::vector<TagState> tagStates = InitializeTagStates(entries, image);
+    auto start = BenchClock::now();
+    BuildDerivedTagGraph(entries, tagStates, graph);
+    double ns = ElapsedNs(start);
+    std::cout.rdbuf(saved);
+    Report("derived build graph", derivedCount, ns, derivedCount);
+
+    // One source changes per cycle: cost should not grow with the model size
+    const int changes = 10000;
+    start = BenchClock::now();
+    for (int it = 0; it < changes; it++) {
+        size_t source = (static_cast<size_t>(it) * 7919) % derivedCount;
+        tagStates[source].currentValue += 1.0;
+        MarkTagChanged(graph, source);
+        RecomputeDerivedTags(graph, tagStates);
+    }
+    Report("derived recompute 1 source (op)", derivedCount, ElapsedNs(start), changes);
+
+    // Every source changes: each derived tag is evaluated once
+    const int iterations = tags < 100000 ? 50 : 5;
+    start = BenchClock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t source = 0; source < derivedCount; source++) {
+            tagStates[source].currentValue += 1.0;
+            MarkTagChanged(graph, source);
+        }
+        RecomputeDerivedTags(graph, tagStates);
+    }
+    Report("derived recompute all sources", derivedCount, ElapsedNs(start), derivedCount * iterations);
+
+    ReleaseProcessImage(image);
+}
+
+// Timers cycle TON/TOF/TP with inputs on M bits; a quarter of the inputs toggle every 50 ticks
+void BenchTimers(size_t tags) {
+    const size_t timerCount = std::min(tags, static_cast<size_t>(MAX_AREA_SIZE / TIMER_WORD_SIZE));
+    const char* types[] = {"TON", "TOF", "TP"};
+    std::vector<TimerConfigEntry> entries;
+    entries.reserve(timerCount);
+    for (size_t i = 0; i < timerCount; i++) {
+        TimerConfigEntry entry;
+        entry.type = types[i % 3];
+        entry.number = static_cast<int>(i);
+        entry.preset = 100 + static_cast<int>(i % 1000) * 10;
+        entry.input = "M" + std::to_string(i / 8) + "." + std::to_string(i % 8);
+        entries.push_back(entry);
+    }
+
+    ServerOptions options;
+    options.verbose = false;
+    options.areaSizes.timers = MAX_AREA_SIZE;
+    options.areaSizes.flags = MAX_AREA_SIZE / 8;
+    ProcessImage image;
+    TimerCounterEngine engine;
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    CreateDataBlocksFromCSV(std::vector<CSVConfigEntry>(), options, image);
+    InitializeTimers(entries, image, engine);
+    std::cout.rdbuf(saved);
+
+    const int ticks = 2000;
+    auto simulated = BenchClock::now();
+    TickTimersAndCounters(0, engine, simulated);
+    auto start = BenchClock::now();
+    for (int it = 0; it < ticks; it++) {
+        if (it % 50 == 0) {
+            for (size_t b = 0; b < timerCount / 8; b += 4) {
+                image.MArea[b] ^= 0xFF;
+            }
+        }
+        simulated += std::chrono::milliseconds(1);
+        TickTimersAndCounters(0, engine, simulated);
+    }
+    Report("timers tick (1 ms)", timerCount, ElapsedNs(start), timerCount * ticks);
+    BenchSink = BenchSink + engine.timers.word[timerCount / 2];
+
+    ReleaseProcessImage(image);
+}
+
+// Resident set size of this process in bytes (0 where unavailable)
+size_t ResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+#endif
+}
+
+// One generated configuration taken through load, start-up and 100 ms update passes
+void BenchScaling(size_t tags) {
+    GeneratorOptions generator;
+    generator.tagsPerDb = TAGS_PER_DB;
+    generator.dbCount = static_cast<int>((tags + TAGS_PER_DB - 1) / TAGS_PER_DB);
+    generator.tagLimit = tags;
+
+    const std::string path = "s7bench_scaling.csv";
+    {
+        std::ofstream file(path);
+        GenerateConfig(generator, file);
+    }
+
+    ServerOptions options;
+    options.verbose = false;
+    ProcessImage image;
+    size_t rssBefore = ResidentBytes();
+
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    auto start = BenchClock::now();
+    std::vector<CSVConfigEntry> entries = LoadCSVConfig(path);
+    double loadNs = ElapsedNs(start);
+
+    auto simulatedNow = BenchClock::now();
+    start = BenchClock::now();
+    CreateDataBlocksFromCSV(entries, options, image);
+    std::vector<TagState> tagStates = InitializeTagStates(entries, image, simulatedNow);
+    double startupNs = ElapsedNs(start);
+    std::cout.rdbuf(saved);
+    std::remove(path.c_str());
+    size_t rssDelta = ResidentBytes();
+    rssDelta = rssDelta > rssBefore ? rssDelta - rssBefore : 0;
+
+    // Simulated 100 ms passes: only the tags whose cycletime elapsed are written
+    const int passes = 100;
+    double totalCycleNs = 0, maxCycleNs = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        simulatedNow += std::chrono::milliseconds(100);
+        start = BenchClock::now();
+        UpdateTagValues(0, tagStates, image.dataBlocks, options, nullptr, nullptr, simulatedNow);
+        double ns = ElapsedNs(start);
+        totalCycleNs += ns;
+        maxCycleNs = std::max(maxCycleNs, ns);
+    }
+
+    // One pass after the longest cycletime: every tag is due
+    int longest = 0;
+    for (const auto& cycletime : generator.cycletimes) {
+        longest = std::max(longest, cycletime.first);
+    }
+    simulatedNow += std::chrono::milliseconds(longest);
+    start = BenchClock::now();
+    UpdateTagValues(0, tagStates, image.dataBlocks, options, nullptr, nullptr, simulatedNow);
+    double sweepNs = ElapsedNs(start);
+
+    size_t arenaBytes = image.arena.Used();
+    std::cout << std::right << std::setw(10) << entries.size() << std::setw(8) << image.dataBlocks.size()
+              << std::fixed << std::setprecision(1)
+              << std::setw(11) << loadNs / 1e6 << std::setw(12) << startupNs / 1e6
+              << std::setw(12) << arenaBytes / 1024.0 << std::setw(9) << (entries.empty() ? 0.0 : static_cast<double>(arenaBytes) / entries.size())
+              << std::setw(11) << rssDelta / 1024.0
+              << std::setw(12) << totalCycleNs / passes / 1e3 << std::setw(12) << maxCycleNs / 1e3
+              << std::setw(12) << sweepNs / 1e3 << std::endl;
+
+    ReleaseProcessImage(image);
+}
+
+#ifdef S7SIM_GENERATED_ENGINE
+// Process image and tag states of one engine under test
+struct EngineBench {
+    ProcessImage image;
+    std::vector<TagState> tagStates;
+    DerivedTagGraph derivedTags;
+};
+
+bool SetUpEngineBench(const std::vector<CSVConfigEntry>& entries, const ServerOptions& options,
+                      BenchClock::time_point start, EngineBench& bench) {
+    if (!CreateDataBlocksFromCSV(entries, options, bench.image)) {
+        return false;
+    }
+    bench.tagStates = InitializeTagStates(entries, bench.image, start);
+    BuildDerivedTagGraph(entries, bench.tagStates, bench.derivedTags);
+    return true;
+}
+
+// Time 'passes' simulated 100 ms update passes of one engine, in ns
+double RunEnginePasses(TagUpdateFunction update, const ServerOptions& options, BenchClock::time_point start,
+                       int passes, EngineBench& bench) {
+    auto simulatedNow = start;
+    double ns = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        simulatedNow += std::chrono::milliseconds(100);
+        auto begin = BenchClock::now();
+        update(0, bench.tagStates, bench.image.dataBlocks, options, &bench.derivedTags, nullptr, simulatedNow,
+               nullptr, nullptr);
+        ns += ElapsedNs(begin);
+    }
+    return ns;
+}
+
+// Tag updates the passes perform (each sawtooth tag whose cycletime elapsed)
+uint64_t CountTagUpdates(const std::vector<TagState>& tagStates, int passes) {
+    std::map<int, uint64_t> groups;  // Cycletime -> tags
+    for (const auto& tag : tagStates) {
+        if (!tag.derived) {
+            groups[tag.cycletime]++;
+        }
+    }
+    uint64_t updates = 0;
+    for (const auto& group : groups) {
+        int64_t last = 0;
+        for (int pass = 1; pass <= passes; pass++) {
+            int64_t now = static_cast<int64_t>(pass) * 100;
+            if (now - last >= group.first) {
+                updates += group.second;
+                last = group.first > 0 ? last + (now - last) / group.first * group.first : now;
+            }
+        }
+    }
+    return updates;
+}
+
+bool SameProcessImage(const ProcessImage& a, const ProcessImage& b) {
+    if (a.dataBlocks.size() != b.dataBlocks.size() ||
+        std::memcmp(a.IArea, b.IArea, a.sizes.inputs) != 0 ||
+        std::memcmp(a.QArea, b.QArea, a.sizes.outputs) != 0 ||
+        std::memcmp(a.MArea, b.MArea, a.sizes.flags) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < a.dataBlocks.size(); i++) {
+        if (a.dataBlocks[i].size != b.dataBlocks[i].size ||
+            std::memcmp(a.dataBlocks[i].data, b.dataBlocks[i].data, a.dataBlocks[i].size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Generic and generated engine side by side on the generated engine's tag table
+int BenchGeneratedEngine(int passes) {
+    ServerOptions options;
+    options.verbose = false;
+    EngineBench generic, generated;
+    auto start = BenchClock::now();
+
+    std::streambuf* saved = std::cout.rdbuf(nullptr);
+    std::vector<CSVConfigEntry> entries = LoadCSVConfig(GeneratedTagEngine.configFile);
+    bool ready = !entries.empty() && SetUpEngineBench(entries, options, start, generic) &&
+                 SetUpEngineBench(entries, options, start, generated);
+    std::cout.rdbuf(saved);
+    if (!ready) {
+        std::cerr << "ERROR: Could not load '" << GeneratedTagEngine.configFile << "'" << std::endl;
+        return 1;
+    }
+    if (TagTableFingerprint(generic.tagStates) != GeneratedTagEngine.fingerprint) {
+        std::cerr << "ERROR: '" << GeneratedTagEngine.configFile << "' changed since the engine was generated; rebuild" << std::endl;
+        return 1;
+    }
+
+    uint64_t updates = CountTagUpdates(generic.tagStates, passes);
+    double genericNs = RunEnginePasses(UpdateTagValues, options, start, passes, generic);
+    double generatedNs = RunEnginePasses(GeneratedTagEngine.update, options, start, passes, generated);
+    bool identical = SameProcessImage(generic.image, generated.image);
+
+    std::cout << "Tag table: " << GeneratedTagEngine.configFile << " (" << GeneratedTagEngine.tagCount << " tags, "
+              << GeneratedTagEngine.groupCount << " cycletime groups)" << std::endl;
+    std::cout << passes << " simulated 100 ms passes, " << updates << " tag updates" << std::endl;
+    std::cout << std::left << std::setw(12) << "Engine" << std::right << std::setw(14) << "us/pass"
+              << std::setw(14) << "ns/update" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(12) << "generic" << std::right << std::setw(14) << genericNs / passes / 1e3
+              << std::setw(14) << (updates ? genericNs / updates : 0.0) << std::endl;
+    std::cout << std::left << std::setw(12) << "generated" << std::right << std::setw(14) << generatedNs / passes / 1e3
+              << std::setw(14) << (updates ? generatedNs / updates : 0.0) << std::endl;
+    std::cout << "Speedup: " << (generatedNs > 0 ? genericNs / generatedNs : 0.0) << "x, process images "
+              << (identical ? "identical" : "DIFFER") << std::endl;
+
+    ReleaseProcessImage(generic.image);
+    ReleaseProcessImage(generated.image);
+    return identical ? 0 : 1;
+}
+#endif
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [tagCount ...]              (default: 1000 100000 1000000)" << std::endl;
+    std::cout << "       " << program << " --scaling [tagCount ...]    (default: 1000 10000 100000 1000000)" << std::endl;
+    std::cout << "       " << program << " --generated [passes]        (default: 3000)" << std::endl;
+}
+
+// Positive whole number, the whole argument
+bool ParseCount(const std::string& text, size_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    try {
+        value = static_cast<size_t>(std::stoull(text));
+    } catch (...) {
+        return false;
+    }
+    return value > 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    bool scaling = false;
+    bool generatedEngine = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--scaling") {
+            scaling = true;
+            continue;
+        }
+        if (arg == "--generated") {
+            generatedEngine = true;
+            continue;
+        }
+        size_t count;
+        if (!ParseCount(arg, count)) {
+            std::cerr << "ERROR: Invalid argument " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        sizes.push_back(count);
+    }
+    if (scaling && generatedEngine) {
+        std::cerr << "ERROR: --scaling and --generated cannot be combined" << std::endl;
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (generatedEngine && (sizes.size() > 1 || (!sizes.empty() && sizes[0] > 1000000000))) {
+        std::cerr << "ERROR: --generated takes one pass count up to 1000000000" << std::endl;
+        return 1;
+    }
+
+    if (generatedEngine) {
+#ifdef S7SIM_GENERATED_ENGINE
+        std::cout << "========================================" << std::endl;
+        std::cout << "S7 Generated Update Engine Benchmark" << std::endl;
+        std::cout << "========================================" << std::endl;
+        return BenchGeneratedEngine(sizes.empty() ? 3000 : static_cast<int>(sizes[0]));
+#else
+        std::cerr << "ERROR: Built without a generated engine; configure with -DS7SIM_GENERATED_ENGINE=ON" << std::endl;
+        return 1;
+#endif
+    }
+
+    if (scaling) {
+        if (sizes.empty()) {
+            sizes = {1000, 10000, 100000, 1000000};
+        }
+        std::cout << "========================================" << std::endl;
+        std::cout << "S7 Simulation Scaling Benchmark" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << "Generated configurations: " << TAGS_PER_DB << " tags/DB, default type mix and cycletimes" << std::endl;
+        std::cout << "Cycle: 100 simulated 100 ms update passes; sweep: one pass with every tag due" << std::endl;
+        std::cout << std::right << std::setw(10) << "Tags" << std::setw(8) << "DBs"
+                  << std::setw(11) << "Load ms" << std::setw(12) << "Startup ms"
+                  << std::setw(12) << "Arena KB" << std::setw(9) << "B/tag"
+                  << std::setw(11) << "RSS KB" << std::setw(12) << "Cycle us"
+                  << std::setw(12) << "Max us" << std::setw(12) << "Sweep us" << std::endl;
+        for (size_t tags : sizes) {
+            BenchScaling(tags);
+        }
+        return 0;
+    }
+
+    if (sizes.empty()) {
+        sizes = {1000, 100000, 1000000};
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "S7 Simulation Micro-Benchmarks" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::left << std::setw(34) << "Benchmark" << std::right << std::setw(10) << "Tags"
+              << std::setw(14) << "ns/tag" << std::endl;
+
+    for (size_t tags : sizes) {
+        std::vector<std::string> lines;
+        lines.reserve(tags);
+        for (size_t i = 0; i < tags; i++) {
+            lines.push_back(MakeCSVLine(i));
+        }
+
+        BenchEncoding(tags);
+        BenchParsing(lines);
+        BenchUpdate(lines);
+        BenchDerived(tags);
+        BenchTimers(tags);
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,301 @@
+/*
+* Bulk Block Decoder
+* Layout construction, scalar and SIMD kernels and run-time dispatch.
+*/
+
+#include "BulkDecode.h"
+#include "../S7Server/S7Codec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BULKDECODE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile each SIMD kernel for its own instruction set, so the
+// rest of the client keeps the baseline target; MSVC needs no flag for intrinsics
+#if defined(__GNUC__)
+#define DECODE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define DECODE_TARGET(isa)
+#endif
+
+namespace {
+
+// Kernels of one instruction set; 'out' may be float or integer storage
+struct KernelSet {
+    void (*swap32)(const byte* in, void* out, size_t count);       // 4-byte big-endian values
+    void (*swap16)(const byte* in, void* out, size_t count);       // 2-byte big-endian values
+    void (*unpackBits)(const byte* in, uint8_t* out, size_t bytes); // 8 bools per byte, bit 0 first
+};
+
+void Swap32Scalar(const byte* in, void* out, size_t count) {
+    byte* dst = static_cast<byte*>(out);
+    for (size_t i = 0; i < count; i++) {
+        const byte* src = in + i * 4;
+        uint32_t value = (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16) |
+                         (static_cast<uint32_t>(src[2]) << 8) | src[3];
+        std::memcpy(dst + i * 4, &value, 4);
+    }
+}
+
+void Swap16Scalar(const byte* in, void* out, size_t count) {
+    byte* dst = static_cast<byte*>(out);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t value = static_cast<uint16_t>((in[i * 2] << 8) | in[i * 2 + 1]);
+        std::memcpy(dst + i * 2, &value, 2);
+    }
+}
+
+void UnpackBitsScalar(const byte* in, uint8_t* out, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            out[i * 8 + bit] = (in[i] >> bit) & 1;
+        }
+    }
+}
+
+const KernelSet SCALAR_KERNELS = {Swap32Scalar, Swap16Scalar, UnpackBitsScalar};
+
+#ifdef BULKDECODE_X86
+DECODE_TARGET("ssse3") void Swap32SSSE3(const byte* in, void* out, size_t count) {
+    const __m128i order = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    byte* dst = static_cast<byte*>(out);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(value, order));
+    }
+    Swap32Scalar(in + i * 4, dst + i * 4, count - i);
+}
+
+DECODE_TARGET("ssse3") void Swap16SSSE3(const byte* in, void* out, size_t count) {
+    const __m128i order = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    byte* dst = static_cast<byte*>(out);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_shuffle_epi8(value, order));
+    }
+    Swap16Scalar(in + i * 2, dst + i * 2, count - i);
+}
+
+// Each shuffle spreads two input bytes over eight lanes each; the lanes keep one bit apiece
+DECODE_TARGET("ssse3") void UnpackBitsSSSE3(const byte* in, uint8_t* out, size_t bytes) {
+    const __m128i masks = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+        for (int pair = 0; pair < 8; pair++) {
+            __m128i bits = _mm_and_si128(_mm_shuffle_epi8(source, spread), masks);
+            __m128i set = _mm_and_si128(_mm_cmpeq_epi8(bits, masks), ones);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i + pair * 2) * 8), set);
+            spread = _mm_add_epi8(spread, two);
+        }
+    }
+    UnpackBitsScalar(in + i, out + i * 8, bytes - i);
+}
+
+const KernelSet SSSE3_KERNELS = {Swap32SSSE3, Swap16SSSE3, UnpackBitsSSSE3};
+
+DECODE_TARGET("avx2") void Swap32AVX2(const byte* in, void* out, size_t count) {
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    byte* dst = static_cast<byte*>(out);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_shuffle_epi8(value, order));
+    }
+    Swap32SSSE3(in + i * 4, dst + i * 4, count - i);
+}
+
+DECODE_TARGET("avx2") void Swap16AVX2(const byte* in, void* out, size_t count) {
+    const __m256i order = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                           1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    byte* dst = static_cast<byte*>(out);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), _mm256_shuffle_epi8(value, order));
+    }
+    Swap16SSSE3(in + i * 2, dst + i * 2, count - i);
+}
+
+// Four input bytes are broadcast to both lanes and spread over eight lanes each
+DECODE_TARGET("avx2") void UnpackBitsAVX2(const byte* in, uint8_t* out, size_t bytes) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i masks = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                           1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i ones = _mm256_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 4 <= bytes; i += 4) {
+        int32_t quad;
+        std::memcpy(&quad, in + i, 4);
+        __m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(_mm256_set1_epi32(quad), spread), masks);
+        __m256i set = _mm256_and_si256(_mm256_cmpeq_epi8(bits, masks), ones);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 8), set);
+    }
+    UnpackBitsScalar(in + i, out + i * 8, bytes - i);
+}
+
+const KernelSet AVX2_KERNELS = {Swap32AVX2, Swap16AVX2, UnpackBitsAVX2};
+
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool avx2 = false;
+};
+
+CpuFeatures DetectCpu() {
+    CpuFeatures cpu;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    cpu.ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        cpu.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    cpu.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    cpu.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return cpu;
+}
+#endif
+
+const KernelSet& KernelsOf(DecodeKernel kernel) {
+#ifdef BULKDECODE_X86
+    switch (kernel) {
+        case DecodeKernel::AVX2: return AVX2_KERNELS;
+        case DecodeKernel::SSSE3: return SSSE3_KERNELS;
+        default: break;
+    }
+#else
+    (void)kernel;
+#endif
+    return SCALAR_KERNELS;
+}
+
+// Unpack 'count' bits starting at bit 'bitPosition' of 'in'; whole bytes go through the kernel
+void DecodeBoolRun(const KernelSet& kernels, const byte* in, int bitPosition, size_t count, uint8_t* out) {
+    size_t done = 0;
+    if (bitPosition != 0) {
+        for (int bit = bitPosition; bit < 8 && done < count; bit++) {
+            out[done++] = (in[0] >> bit) & 1;
+        }
+        in++;
+    }
+    size_t bytes = (count - done) / 8;
+    kernels.unpackBits(in, out + done, bytes);
+    done += bytes * 8;
+    in += bytes;
+    for (int bit = 0; done < count; bit++) {
+        out[done++] = (in[0] >> bit) & 1;
+    }
+}
+
+} // namespace
+
+void AddDecodeRun(BlockLayout& layout, DataType dataType, int offset, int bitPosition, size_t count) {
+    DecodeRun run = {dataType, offset, dataType == DataType::BOOL ? bitPosition : 0, count, 0};
+    size_t end = 0;
+    switch (dataType) {
+        case DataType::REAL: run.column = layout.reals; layout.reals += count; end = offset + count * 4; break;
+        case DataType::DWORD: run.column = layout.dwords; layout.dwords += count; end = offset + count * 4; break;
+        case DataType::INT: run.column = layout.ints; layout.ints += count; end = offset + count * 2; break;
+        case DataType::BOOL:
+            run.column = layout.bools;
+            layout.bools += count;
+            end = (static_cast<size_t>(offset) * 8 + run.bitPosition + count + 7) / 8;
+            break;
+        default: return;
+    }
+    layout.runs.push_back(run);
+    layout.size = std::max(layout.size, end);
+}
+
+bool DecodeKernelSupported(DecodeKernel kernel) {
+#ifdef BULKDECODE_X86
+    static const CpuFeatures cpu = DetectCpu();
+    switch (kernel) {
+        case DecodeKernel::AVX2: return cpu.avx2;
+        case DecodeKernel::SSSE3: return cpu.ssse3;
+        default: return true;
+    }
+#else
+    return kernel == DecodeKernel::Scalar;
+#endif
+}
+
+DecodeKernel BestDecodeKernel() {
+    static const DecodeKernel best = DecodeKernelSupported(DecodeKernel::AVX2) ? DecodeKernel::AVX2
+                                   : DecodeKernelSupported(DecodeKernel::SSSE3) ? DecodeKernel::SSSE3
+                                   : DecodeKernel::Scalar;
+    return best;
+}
+
+const char* DecodeKernelName(DecodeKernel kernel) {
+    switch (kernel) {
+        case DecodeKernel::AVX2: return "avx2";
+        case DecodeKernel::SSSE3: return "ssse3";
+        default: return "scalar";
+    }
+}
+
+void DecodeBlockColumns(const byte* block, const BlockLayout& layout, DecodedColumns& columns) {
+    DecodeBlockColumns(block, layout, columns, BestDecodeKernel());
+}
+
+void DecodeBlockColumns(const byte* block, const BlockLayout& layout, DecodedColumns& columns, DecodeKernel kernel) {
+    const KernelSet& kernels = KernelsOf(kernel);
+    columns.reals.resize(layout.reals);
+    columns.dwords.resize(layout.dwords);
+    columns.ints.resize(layout.ints);
+    columns.bools.resize(layout.bools);
+    for (const auto& run : layout.runs) {
+        const byte* in = block + run.offset;
+        switch (run.dataType) {
+            case DataType::REAL: kernels.swap32(in, columns.reals.data() + run.column, run.count); break;
+            case DataType::DWORD: kernels.swap32(in, columns.dwords.data() + run.column, run.count); break;
+            case DataType::INT: kernels.swap16(in, columns.ints.data() + run.column, run.count); break;
+            case DataType::BOOL: DecodeBoolRun(kernels, in, run.bitPosition, run.count, columns.bools.data() + run.column); break;
+            default: break;
+        }
+    }
+}
+
+void DecodeBlockColumnsPerValue(const byte* block, const BlockLayout& layout, DecodedColumns& columns) {
+    columns.reals.resize(layout.reals);
+    columns.dwords.resize(layout.dwords);
+    columns.ints.resize(layout.ints);
+    columns.bools.resize(layout.bools);
+    byte* buffer = const_cast<byte*>(block);
+    for (const auto& run : layout.runs) {
+        for (size_t i = 0; i < run.count; i++) {
+            switch (run.dataType) {
+                case DataType::REAL: columns.reals[run.column + i] = GetReal(buffer, run.offset + static_cast<int>(i) * 4); break;
+                case DataType::DWORD: columns.dwords[run.column + i] = GetDWord(buffer, run.offset + static_cast<int>(i) * 4); break;
+                case DataType::INT: columns.ints[run.column + i] = GetInt(buffer, run.offset + static_cast<int>(i) * 2); break;
+                case DataType::BOOL: {
+                    int bit = run.bitPosition + static_cast<int>(i);
+                    columns.bools[run.column + i] = GetBool(buffer, run.offset + bit / 8, bit % 8) ? 1 : 0;
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+* Bulk Block Decoder
+*
+* Decodes a raw block read (big-endian S7 data) into typed column arrays in
+* one call instead of one GetReal/GetDWord/GetInt/GetBool per value. The
+* caller describes the block with a layout: runs of values of one type
+* packed back to back (REAL and DWORD every 4 bytes, INT every 2 bytes, BOOL
+* every bit). Each run lands in the column of its type (REAL as float, DWORD
+* as uint32, INT as int16, BOOL unpacked to one 0/1 byte per bit), in the
+* order the runs were added.
+*
+* The byte swapping and bit unpacking run in SIMD kernels (SSSE3 and AVX2
+* byte shuffles on x86) picked at run time from what the CPU supports, with
+* a portable scalar kernel everywhere else. All kernels produce identical
+* columns.
+*/
+
+#ifndef BULKDECODE_H
+#define BULKDECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../S7Server/TagConfig.h"
+#include "snap7.h"
+
+// One run of values of one type packed back to back in a block
+struct DecodeRun {
+    DataType dataType;
+    int offset;                // First byte in the block
+    int bitPosition;           // First bit in that byte (BOOL runs)
+    size_t count;              // Values
+    size_t column;             // Index of the first value in its column
+};
+
+struct BlockLayout {
+    std::vector<DecodeRun> runs;
+    size_t size = 0;           // Bytes of block the runs cover (from offset 0)
+    size_t reals = 0;          // Column lengths
+    size_t dwords = 0;
+    size_t ints = 0;
+    size_t bools = 0;
+};
+
+struct DecodedColumns {
+    std::vector<float> reals;
+    std::vector<uint32_t> dwords;
+    std::vector<int16_t> ints;
+    std::vector<uint8_t> bools;  // 0 or 1
+};
+
+enum class DecodeKernel {
+    Scalar,
+    SSSE3,                     // 16 bytes per shuffle
+    AVX2                       // 32 bytes per shuffle
+};
+
+// Append a run of 'count' values at 'offset' (and 'bitPosition' for BOOL)
+void AddDecodeRun(BlockLayout& layout, DataType dataType, int offset, int bitPosition, size_t count);
+
+// Fastest kernel the CPU supports (detected once)
+DecodeKernel BestDecodeKernel();
+bool DecodeKernelSupported(DecodeKernel kernel);
+const char* DecodeKernelName(DecodeKernel kernel);
+
+// Decode 'block' (at least layout.size bytes) into 'columns', sized to the layout,
+// with the best kernel or a given one (which must be supported)
+void DecodeBlockColumns(const byte* block, const BlockLayout& layout, DecodedColumns& columns);
+void DecodeBlockColumns(const byte* block, const BlockLayout& layout, DecodedColumns& columns, DecodeKernel kernel);
+
+// Reference decode with the per-value S7Codec helpers
+void DecodeBlockColumnsPerValue(const byte* block, const BlockLayout& layout, DecodedColumns& columns);
+
+#endif // BULKDECODE_H
@@ -0,0 +1,659 @@
+/*
+* Multi-PLC Polling Engine
+* Read plan construction, scheduler, worker pool and statistics.
+*/
+
+#include "PollingEngine.h"
+#include "../S7Server/S7Codec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// S7 PDU overheads of a ReadMultiVars request and its response
+const int REQUEST_HEADER_SIZE = 12;   // Header + function + item count
+const int REQUEST_ITEM_SIZE = 12;     // Variable specification per item
+const int RESPONSE_HEADER_SIZE = 14;  // Ack header + function + item count
+const int RESPONSE_ITEM_SIZE = 4;     // Return code, transport size, length per item
+
+// TCP (low word) and ISO (0x000F0000) errors: the connection is gone
+const int LINK_ERROR_MASK = 0x000FFFFF;
+
+typedef std::pair<PollClock::time_point, size_t> TimerEntry;
+
+double ElapsedMs(PollClock::time_point from, PollClock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Rebuild a plan for the PLC's new PDU length. The plan is built aside and swapped in
+// under the engine mutex (the statistics read it). Blocks whose range did not change
+// keep their adaptive interval, last read and data; new blocks start at the plan's rate.
+void RepackPlan(PollingEngine& engine, const PollPlc& plc, PollPlan& plan) {
+    PollPlan rebuilt;
+    rebuilt.cycletime = plan.cycletime;
+    BuildReadPlan(plc.tags, plan.tags, plc.pduLength, rebuilt);
+
+    std::map<std::tuple<int, int, int, int>, const PollBlock*> oldBlocks;
+    for (const auto& block : plan.blocks) {
+        oldBlocks[std::make_tuple(block.area, block.dbNumber, block.start, block.size)] = &block;
+    }
+    size_t backedOff = 0;
+    for (auto& block : rebuilt.blocks) {
+        auto it = oldBlocks.find(std::make_tuple(block.area, block.dbNumber, block.start, block.size));
+        if (it == oldBlocks.end()) {
+            continue;
+        }
+        const PollBlock& old = *it->second;
+        block.interval = old.interval;
+        block.lastRead = old.lastRead;
+        std::memcpy(rebuilt.previous.data() + block.bufferOffset, plan.previous.data() + old.bufferOffset, block.size);
+        std::memcpy(rebuilt.buffer.data() + block.bufferOffset, plan.buffer.data() + old.bufferOffset, block.size);
+        backedOff += block.interval > plan.cycletime ? 1 : 0;
+    }
+
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    plan.blocks.swap(rebuilt.blocks);
+    plan.requests.swap(rebuilt.requests);
+    plan.buffer.swap(rebuilt.buffer);
+    plan.previous.swap(rebuilt.previous);
+    plan.backedOff = backedOff;
+}
+
+// Connect (or reconnect) a PLC unless the last attempt was too recent.
+// Repacks the plans when the negotiated PDU differs from the one they were built for.
+bool EnsureConnected(PollingEngine& engine, PollPlc& plc, PollClock::time_point now, bool& attempted) {
+    attempted = false;
+    if (plc.connected) {
+        return true;
+    }
+    if (now < plc.nextConnectAttempt) {
+        return false;
+    }
+    attempted = true;
+    plc.nextConnectAttempt = now + std::chrono::milliseconds(POLL_RECONNECT_MS);
+    if (!plc.client) {
+        plc.client = Cli_Create();
+        int pduRequest = POLL_PDU_REQUEST;
+        Cli_SetParam(plc.client, p_u16_RemotePort, &plc.port);
+        Cli_SetParam(plc.client, p_i32_PDURequest, &pduRequest);
+    }
+    if (Cli_ConnectTo(plc.client, plc.address.c_str(), plc.rack, plc.slot) != 0) {
+        return false;
+    }
+    plc.connected = true;
+
+    int requested = 0, negotiated = 0;
+    Cli_GetPduLength(plc.client, &requested, &negotiated);
+    if (negotiated > 0 && negotiated != plc.pduLength) {
+        plc.pduLength = negotiated;
+        for (size_t planIndex : plc.plans) {
+            RepackPlan(engine, plc, *engine.plans[planIndex]);
+        }
+    }
+    return true;
+}
+
+// Pack the blocks 'indexes' (in this order) into requests within MaxVars and the PDU
+// in both directions; each request is (first position in 'indexes', count)
+void PackBlocks(const std::vector<PollBlock>& blocks, const std::vector<size_t>& indexes, int pduLength,
+                std::vector<std::pair<size_t, size_t>>& requests) {
+    requests.clear();
+    size_t first = 0;
+    int requestBytes = REQUEST_HEADER_SIZE;
+    int responseBytes = RESPONSE_HEADER_SIZE;
+    for (size_t i = 0; i < indexes.size(); i++) {
+        const PollBlock& block = blocks[indexes[i]];
+        int itemResponse = RESPONSE_ITEM_SIZE + block.size + (block.size & 1);
+        size_t count = i - first;
+        if (count > 0 && (count == static_cast<size_t>(MaxVars) ||
+                          requestBytes + REQUEST_ITEM_SIZE > pduLength ||
+                          responseBytes + itemResponse > pduLength)) {
+            requests.push_back(std::make_pair(first, count));
+            first = i;
+            requestBytes = REQUEST_HEADER_SIZE;
+            responseBytes = RESPONSE_HEADER_SIZE;
+        }
+        requestBytes += REQUEST_ITEM_SIZE;
+        responseBytes += itemResponse;
+    }
+    if (first < indexes.size()) {
+        requests.push_back(std::make_pair(first, indexes.size() - first));
+    }
+}
+
+// Adaptive polling outcome of one poll, added to the plan statistics by the worker
+struct AdaptiveReads {
+    bool issued = false;       // Connected, so the plan's reads were sent (or skipped as not due)
+    uint64_t requests = 0;
+    uint64_t changes = 0;
+    uint64_t changesAtRate = 0;
+    double totalWindowMs = 0.0;
+    double maxWindowMs = 0.0;
+    size_t backedOff = 0;
+};
+
+// Select the blocks due in the current slot and pack them (every block without adaptive polling)
+void SelectDueBlocks(const PollingEngine& engine, const PollPlc& plc, PollPlan& plan) {
+    plan.dueBlocks.clear();
+    for (size_t i = 0; i < plan.blocks.size(); i++) {
+        const PollBlock& block = plan.blocks[i];
+        if (engine.adaptiveMaxMs == 0 || block.interval == 0 ||
+            block.lastRead + std::chrono::milliseconds(block.interval) <= plan.due) {
+            plan.dueBlocks.push_back(i);
+        }
+    }
+    if (plan.dueBlocks.size() == plan.blocks.size()) {
+        plan.dueRequests = plan.requests;
+    } else {
+        PackBlocks(plan.blocks, plan.dueBlocks, plc.pduLength, plan.dueRequests);
+    }
+}
+
+// After a successful read: back the block off if its data did not change, otherwise
+// return it to the plan's rate, and remember its data for the next comparison
+void AdaptBlock(const PollingEngine& engine, PollPlan& plan, PollBlock& block, AdaptiveReads& reads) {
+    byte* data = plan.buffer.data() + block.bufferOffset;
+    byte* previous = plan.previous.data() + block.bufferOffset;
+    bool changed = std::memcmp(data, previous, block.size) != 0;
+    if (block.interval == 0) {
+        block.interval = plan.cycletime;
+    } else if (changed) {
+        double windowMs = ElapsedMs(block.lastRead, plan.due);
+        reads.changes++;
+        reads.changesAtRate += block.interval <= plan.cycletime ? 1 : 0;
+        reads.totalWindowMs += windowMs;
+        reads.maxWindowMs = std::max(reads.maxWindowMs, windowMs);
+        block.interval = plan.cycletime;
+    } else {
+        block.interval = std::min(block.interval * POLL_BACKOFF_FACTOR, std::max(engine.adaptiveMaxMs, plan.cycletime));
+    }
+    block.lastRead = plan.due;
+    if (changed) {
+        std::memcpy(previous, data, block.size);
+    }
+}
+
+// Store the values of every tag of a block that was read successfully
+void DecodeBlock(PollPlc& plc, const PollBlock& block, byte* buffer) {
+    for (size_t tagIndex : block.tags) {
+        PolledTag& tag = plc.tags[tagIndex];
+        int position = static_cast<int>(block.bufferOffset) + tag.offset - block.start;
+        switch (tag.dataType) {
+            case DataType::REAL: tag.value = GetReal(buffer, position); break;
+            case DataType::DWORD: tag.value = GetDWord(buffer, position); break;
+            case DataType::INT: tag.value = GetInt(buffer, position); break;
+            case DataType::BOOL: tag.value = GetBool(buffer, position, tag.bitPosition) ? 1.0 : 0.0; break;
+            default: break;
+        }
+        tag.valid = true;
+    }
+}
+
+// Run the requests of a plan's due blocks on the PLC owned by the calling worker.
+// Returns the number of failed requests and items.
+int ExecutePlan(PollingEngine& engine, PollPlc& plc, PollPlan& plan, bool& attempted, bool& connectedNow,
+                AdaptiveReads& reads) {
+    connectedNow = false;
+    bool wasConnected = plc.connected;
+    if (!EnsureConnected(engine, plc, PollClock::now(), attempted)) {
+        return 1;
+    }
+    connectedNow = !wasConnected;
+    reads.issued = true;
+
+    SelectDueBlocks(engine, plc, plan);
+    int errors = 0;
+    TS7DataItem items[MaxVars];
+    for (const auto& request : plan.dueRequests) {
+        for (size_t i = 0; i < request.second; i++) {
+            const PollBlock& block = plan.blocks[plan.dueBlocks[request.first + i]];
+            items[i].Area = block.area;
+            items[i].WordLen = S7WLByte;
+            items[i].Result = 0;
+            items[i].DBNumber = block.dbNumber;
+            items[i].Start = block.start;
+            items[i].Amount = block.size;
+            items[i].pdata = plan.buffer.data() + block.bufferOffset;
+        }
+        int result = Cli_ReadMultiVars(plc.client, items, static_cast<int>(request.second));
+        reads.requests++;
+        if (result != 0) {
+            errors++;
+            int connected = 0;
+            Cli_GetConnected(plc.client, &connected);
+            if ((result & LINK_ERROR_MASK) != 0 || !connected) {
+                // Drop the link; the next poll of this PLC reconnects
+                Cli_Disconnect(plc.client);
+                plc.connected = false;
+                break;
+            }
+            continue;
+        }
+        for (size_t i = 0; i < request.second; i++) {
+            PollBlock& block = plan.blocks[plan.dueBlocks[request.first + i]];
+            if (items[i].Result == 0) {
+                DecodeBlock(plc, block, plan.buffer.data());
+                if (engine.adaptiveMaxMs > 0) {
+                    AdaptBlock(engine, plan, block, reads);
+                }
+            } else {
+                errors++;
+            }
+        }
+    }
+    for (const auto& block : plan.blocks) {
+        reads.backedOff += block.interval > plan.cycletime ? 1 : 0;
+    }
+    return errors;
+}
+
+void SchedulerThread(PollingEngine& engine) {
+    std::unique_lock<std::mutex> lock(engine.mutex);
+    while (engine.running) {
+        if (engine.timerHeap.empty()) {
+            engine.schedulerWake.wait(lock);
+            continue;
+        }
+        TimerEntry next = engine.timerHeap.front();
+        auto now = PollClock::now();
+        if (next.first > now) {
+            engine.schedulerWake.wait_until(lock, next.first);
+            continue;
+        }
+        std::pop_heap(engine.timerHeap.begin(), engine.timerHeap.end(), std::greater<TimerEntry>());
+        engine.timerHeap.pop_back();
+
+        PollPlan& plan = *engine.plans[next.second];
+        if (plan.queued) {
+            // Previous poll of this plan still waiting or running: drop this slot
+            plan.skipped++;
+        } else {
+            plan.queued = true;
+            plan.due = next.first;
+            PollPlc& plc = *engine.plcs[plan.plc];
+            plc.pending.push_back(next.second);
+            if (!plc.busy) {
+                plc.busy = true;
+                engine.readyPlcs.push_back(plan.plc);
+                engine.workAvailable.notify_one();
+            }
+        }
+
+        // Stay on the plan's grid; slots that already passed are skipped
+        auto period = std::chrono::milliseconds(plan.cycletime);
+        auto due = next.first + period;
+        if (due <= now) {
+            auto behind = (now - next.first) / period;
+            plan.skipped += static_cast<uint64_t>(behind);
+            due = next.first + (behind + 1) * period;
+        }
+        engine.timerHeap.push_back(TimerEntry(due, next.second));
+        std::push_heap(engine.timerHeap.begin(), engine.timerHeap.end(), std::greater<TimerEntry>());
+    }
+}
+
+void WorkerThread(PollingEngine& engine) {
+    std::unique_lock<std::mutex> lock(engine.mutex);
+    while (true) {
+        engine.workAvailable.wait(lock, [&engine] { return !engine.running || !engine.readyPlcs.empty(); });
+        if (!engine.running) {
+            break;
+        }
+        size_t plcIndex = engine.readyPlcs.front();
+        engine.readyPlcs.pop_front();
+        PollPlc& plc = *engine.plcs[plcIndex];
+
+        // This worker owns the PLC until its pending plans are done
+        while (!plc.pending.empty() && engine.running) {
+            PollPlan& plan = *engine.plans[plc.pending.front()];
+            plc.pending.pop_front();
+            auto due = plan.due;
+
+            lock.unlock();
+            auto start = PollClock::now();
+            bool attempted = false, connectedNow = false;
+            AdaptiveReads reads;
+            int errors = ExecutePlan(engine, plc, plan, attempted, connectedNow, reads);
+            auto end = PollClock::now();
+            lock.lock();
+
+            double lagMs = ElapsedMs(due, start);
+            double readMs = ElapsedMs(start, end);
+            plan.polls++;
+            plan.errors += errors;
+            plan.requestsSent += reads.requests;
+            if (reads.issued) {
+                // A poll that could not connect sent nothing with either packing
+                plan.fixedRequests += plan.requests.size();
+            }
+            plan.changes += reads.changes;
+            plan.changesAtRate += reads.changesAtRate;
+            plan.totalWindowMs += reads.totalWindowMs;
+            plan.maxWindowMs = std::max(plan.maxWindowMs, reads.maxWindowMs);
+            plan.backedOff = reads.backedOff;
+            if (lagMs > plan.cycletime * POLL_LATE_FRACTION) {
+                plan.late++;
+            }
+            plan.maxStartLagMs = std::max(plan.maxStartLagMs, lagMs);
+            plan.totalReadMs += readMs;
+            plan.maxReadMs = std::max(plan.maxReadMs, readMs);
+            if (connectedNow) {
+                plc.reconnects++;
+            } else if (attempted) {
+                plc.connectFailures++;
+            }
+            plan.queued = false;
+        }
+        plc.busy = false;
+        plc.pending.clear();
+    }
+}
+
+} // namespace
+
+int S7AreaCode(AreaType areaType) {
+    switch (areaType) {
+        case AreaType::INPUT: return S7AreaPE;
+        case AreaType::OUTPUT: return S7AreaPA;
+        case AreaType::MERKER: return S7AreaMK;
+        default: return S7AreaDB;
+    }
+}
+
+void BuildReadPlan(const std::vector<PolledTag>& tags, const std::vector<size_t>& tagIndexes,
+                   int pduLength, PollPlan& plan) {
+    std::vector<size_t> sorted(tagIndexes);
+    std::sort(sorted.begin(), sorted.end(), [&tags](size_t a, size_t b) {
+        const PolledTag& x = tags[a];
+        const PolledTag& y = tags[b];
+        int areaX = S7AreaCode(x.areaType), areaY = S7AreaCode(y.areaType);
+        if (areaX != areaY) return areaX < areaY;
+        if (x.dbNumber != y.dbNumber) return x.dbNumber < y.dbNumber;
+        return x.offset < y.offset;
+    });
+
+    // Merge neighbouring tags into blocks no larger than one response item can carry
+    const int maxBlockSize = std::max(4, pduLength - RESPONSE_HEADER_SIZE - RESPONSE_ITEM_SIZE);
+    plan.blocks.clear();
+    for (size_t tagIndex : sorted) {
+        const PolledTag& tag = tags[tagIndex];
+        int area = S7AreaCode(tag.areaType);
+        int dbNumber = tag.areaType == AreaType::DB ? tag.dbNumber : 0;
+        int end = tag.offset + GetTypeSize(tag.dataType);
+        if (!plan.blocks.empty()) {
+            PollBlock& last = plan.blocks.back();
+            int lastEnd = last.start + last.size;
+            if (last.area == area && last.dbNumber == dbNumber && tag.offset <= lastEnd + POLL_MERGE_GAP &&
+                std::max(end, lastEnd) - last.start <= maxBlockSize) {
+                last.size = std::max(end, lastEnd) - last.start;
+                last.tags.push_back(tagIndex);
+                continue;
+            }
+        }
+        PollBlock block;
+        block.area = area;
+        block.dbNumber = dbNumber;
+        block.start = tag.offset;
+        block.size = end - tag.offset;
+        block.bufferOffset = 0;
+        block.tags.push_back(tagIndex);
+        plan.blocks.push_back(block);
+    }
+
+    size_t bufferSize = 0;
+    std::vector<size_t> all(plan.blocks.size());
+    for (size_t i = 0; i < plan.blocks.size(); i++) {
+        plan.blocks[i].bufferOffset = bufferSize;
+        bufferSize += plan.blocks[i].size;
+        all[i] = i;
+    }
+    PackBlocks(plan.blocks, all, pduLength, plan.requests);
+    plan.buffer.assign(bufferSize, 0);
+    plan.previous.assign(bufferSize, 0);
+}
+
+bool LoadPollConfig(const std::string& filename, PollingEngine& engine) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open poll configuration '" << filename << "'" << std::endl;
+        return false;
+    }
+
+    std::map<std::string, size_t> plcIndex;
+    std::string line;
+    int lineNumber = 0;
+    size_t tagCount = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || (lineNumber == 1 && line.compare(0, 3, "plc") == 0)) {
+            continue;
+        }
+        std::vector<std::string> fields = ParseCSVLine(line);
+        PolledTag tag;
+        std::string address;
+        int port = 102, rack = 0, slot = 1;
+        bool valid = fields.size() >= 5;
+        if (valid) {
+            address = fields[0];
+            size_t colon = address.find(':');
+            try {
+                if (colon != std::string::npos) {
+                    port = std::stoi(address.substr(colon + 1));
+                    address = address.substr(0, colon);
+                }
+                rack = std::stoi(fields[1]);
+                slot = std::stoi(fields[2]);
+                tag.cycletime = std::stoi(fields[4]);
+            } catch (...) {
+                valid = false;
+            }
+            tag.name = fields[3];
+            valid = valid && !address.empty() && tag.cycletime > 0 && port > 0 && port <= 65535 &&
+                    ParseTag(fields[3], tag.areaType, tag.dbNumber, tag.offset, tag.bitPosition, tag.dataType);
+        }
+        if (!valid) {
+            std::cerr << "WARNING: Skipping invalid poll entry at line " << lineNumber << ": " << line << std::endl;
+            continue;
+        }
+
+        std::string key = address + ":" + std::to_string(port) + "/" + std::to_string(rack) + "/" + std::to_string(slot);
+        auto found = plcIndex.find(key);
+        if (found == plcIndex.end()) {
+            std::unique_ptr<PollPlc> plc(new PollPlc());
+            plc->address = address;
+            plc->port = port;
+            plc->rack = rack;
+            plc->slot = slot;
+            plc->pduLength = POLL_PDU_REQUEST;
+            found = plcIndex.insert(std::make_pair(key, engine.plcs.size())).first;
+            engine.plcs.push_back(std::move(plc));
+        }
+        engine.plcs[found->second]->tags.push_back(tag);
+        tagCount++;
+    }
+
+    // One plan per PLC and interval
+    for (size_t p = 0; p < engine.plcs.size(); p++) {
+        PollPlc& plc = *engine.plcs[p];
+        std::map<int, std::vector<size_t>> byRate;
+        for (size_t t = 0; t < plc.tags.size(); t++) {
+            byRate[plc.tags[t].cycletime].push_back(t);
+        }
+        for (const auto& rate : byRate) {
+            std::unique_ptr<PollPlan> plan(new PollPlan());
+            plan->plc = p;
+            plan->cycletime = rate.first;
+            plan->tags = rate.second;
+            BuildReadPlan(plc.tags, plan->tags, plc.pduLength, *plan);
+            plc.plans.push_back(engine.plans.size());
+            engine.plans.push_back(std::move(plan));
+        }
+    }
+
+    if (tagCount == 0) {
+        std::cerr << "ERROR: No valid tags in poll configuration '" << filename << "'" << std::endl;
+        return false;
+    }
+    size_t requests = 0;
+    for (const auto& plan : engine.plans) {
+        requests += plan->requests.size();
+    }
+    std::cout << "Loaded " << tagCount << " tags for " << engine.plcs.size() << " PLCs into "
+              << engine.plans.size() << " read plans (" << requests << " requests per full round)" << std::endl;
+    return true;
+}
+
+void StartPolling(PollingEngine& engine, int threads) {
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    engine.running = true;
+    engine.startTime = PollClock::now();
+
+    // Spread the first polls of plans sharing an interval evenly over that interval
+    std::map<int, int> rateCount, rateSeen;
+    for (const auto& plan : engine.plans) {
+        rateCount[plan->cycletime]++;
+    }
+    engine.timerHeap.clear();
+    for (size_t i = 0; i < engine.plans.size(); i++) {
+        int cycletime = engine.plans[i]->cycletime;
+        auto offset = std::chrono::microseconds(
+            static_cast<int64_t>(cycletime) * 1000 * rateSeen[cycletime]++ / rateCount[cycletime]);
+        engine.timerHeap.push_back(TimerEntry(engine.startTime + offset, i));
+    }
+    std::make_heap(engine.timerHeap.begin(), engine.timerHeap.end(), std::greater<TimerEntry>());
+
+    engine.scheduler = std::thread(SchedulerThread, std::ref(engine));
+    for (int i = 0; i < threads; i++) {
+        engine.workers.push_back(std::thread(WorkerThread, std::ref(engine)));
+    }
+}
+
+void StopPolling(PollingEngine& engine) {
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        engine.running = false;
+    }
+    engine.schedulerWake.notify_all();
+    engine.workAvailable.notify_all();
+    if (engine.scheduler.joinable()) {
+        engine.scheduler.join();
+    }
+    for (auto& worker : engine.workers) {
+        worker.join();
+    }
+    engine.workers.clear();
+
+    for (auto& plc : engine.plcs) {
+        if (plc->client) {
+            Cli_Disconnect(plc->client);
+            Cli_Destroy(&plc->client);
+            plc->client = 0;
+        }
+        plc->connected = false;
+    }
+}
+
+namespace {
+
+// Requests sent against polling every block at its plan's rate, and how long the
+// changes that were found could have gone unseen (engine mutex held)
+void DisplayAdaptiveStats(const PollingEngine& engine) {
+    std::cout << "Adaptive polling (unchanged blocks back off to " << engine.adaptiveMaxMs << " ms):" << std::endl;
+    std::cout << std::left << std::setw(24) << "PLC" << std::right << std::setw(9) << "Rate(ms)"
+              << std::setw(8) << "Blocks" << std::setw(11) << "Backed off" << std::setw(9) << "Sent"
+              << std::setw(9) << "Fixed" << std::setw(8) << "Saved" << std::setw(9) << "Changes"
+              << std::setw(9) << "At rate" << std::setw(12) << "Avg window" << std::setw(12) << "Max window"
+              << std::endl;
+
+    uint64_t sentTotal = 0, fixedTotal = 0, changesTotal = 0, atRateTotal = 0;
+    for (const auto& plc : engine.plcs) {
+        std::string name = plc->address + ":" + std::to_string(plc->port);
+        for (size_t planIndex : plc->plans) {
+            const PollPlan& plan = *engine.plans[planIndex];
+            std::cout << std::left << std::setw(24) << name << std::right << std::setw(9) << plan.cycletime
+                      << std::setw(8) << plan.blocks.size() << std::setw(11) << plan.backedOff
+                      << std::setw(9) << plan.requestsSent << std::setw(9) << plan.fixedRequests
+                      << std::setprecision(1) << std::setw(7)
+                      << (plan.fixedRequests ? 100.0 * (plan.fixedRequests - plan.requestsSent) / plan.fixedRequests : 0.0)
+                      << "%" << std::setw(9) << plan.changes << std::setw(8)
+                      << (plan.changes ? 100.0 * plan.changesAtRate / plan.changes : 100.0) << "%"
+                      << std::setw(12) << (plan.changes ? plan.totalWindowMs / plan.changes : 0.0)
+                      << std::setw(12) << plan.maxWindowMs << std::endl;
+            sentTotal += plan.requestsSent;
+            fixedTotal += plan.fixedRequests;
+            changesTotal += plan.changes;
+            atRateTotal += plan.changesAtRate;
+        }
+    }
+    std::cout << "----------------------------------------" << std::endl;
+    std::cout << "Total: " << sentTotal << " requests instead of " << fixedTotal << " ("
+              << (fixedTotal ? 100.0 * (fixedTotal - sentTotal) / fixedTotal : 0.0) << "% saved), "
+              << changesTotal << " changes, "
+              << (changesTotal ? 100.0 * atRateTotal / changesTotal : 100.0) << "% found at the plan's rate" << std::endl;
+    std::cout << "Window = time since the previous read of a block that was found changed; at the plan's rate\n"
+              << "it is one interval, as with fixed-rate polling\n" << std::endl;
+}
+
+} // namespace
+
+void DisplayPollStats(PollingEngine& engine) {
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    double elapsedSec = ElapsedMs(engine.startTime, PollClock::now()) / 1000.0;
+    if (elapsedSec <= 0.0) {
+        return;
+    }
+
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "Polling Statistics (" << std::fixed << std::setprecision(1) << elapsedSec << " s)" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::left << std::setw(24) << "PLC" << std::right << std::setw(9) << "Rate(ms)"
+              << std::setw(7) << "Tags" << std::setw(6) << "Reqs" << std::setw(10) << "Target/s"
+              << std::setw(10) << "Actual/s" << std::setw(8) << "Late" << std::setw(9) << "Skipped"
+              << std::setw(8) << "Errors" << std::setw(9) << "Avg ms" << std::setw(9) << "Max ms"
+              << std::setw(10) << "Max lag" << std::endl;
+
+    double targetTotal = 0.0, actualTotal = 0.0;
+    uint64_t lateTotal = 0, skippedTotal = 0, errorTotal = 0;
+    for (const auto& plc : engine.plcs) {
+        std::string name = plc->address + ":" + std::to_string(plc->port);
+        for (size_t planIndex : plc->plans) {
+            const PollPlan& plan = *engine.plans[planIndex];
+            double target = 1000.0 / plan.cycletime;
+            double actual = plan.polls / elapsedSec;
+            std::cout << std::left << std::setw(24) << name << std::right << std::setw(9) << plan.cycletime
+                      << std::setw(7) << plan.tags.size() << std::setw(6) << plan.requests.size()
+                      << std::setprecision(2) << std::setw(10) << target << std::setw(10) << actual
+                      << std::setw(8) << plan.late << std::setw(9) << plan.skipped << std::setw(8) << plan.errors
+                      << std::setw(9) << (plan.polls ? plan.totalReadMs / plan.polls : 0.0)
+                      << std::setw(9) << plan.maxReadMs << std::setw(10) << plan.maxStartLagMs << std::endl;
+            targetTotal += target;
+            actualTotal += actual;
+            lateTotal += plan.late;
+            skippedTotal += plan.skipped;
+            errorTotal += plan.errors;
+        }
+        if (plc->connectFailures > 0 || plc->reconnects > 1) {
+            std::cout << "  " << name << ": " << plc->reconnects << " connects, "
+                      << plc->connectFailures << " failed connection attempts" << std::endl;
+        }
+    }
+    std::cout << "----------------------------------------" << std::endl;
+    std::cout << std::setprecision(1) << "Total: " << actualTotal << "/" << targetTotal << " polls/s ("
+              << (targetTotal > 0 ? 100.0 * actualTotal / targetTotal : 0.0) << "%), late: " << lateTotal
+              << ", skipped: " << skippedTotal << ", errors: " << errorTotal << std::endl;
+    std::cout << "Late = started more than " << static_cast<int>(POLL_LATE_FRACTION * 100)
+              << "% of the interval after its slot; Skipped = slots dropped while the previous poll was still due\n"
+              << std::endl;
+    if (engine.adaptiveMaxMs > 0) {
+        DisplayAdaptiveStats(engine);
+    }
+}
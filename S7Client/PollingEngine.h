@@ -0,0 +1,175 @@
+/*
+* Multi-PLC Polling Engine
+*
+* Polls many PLCs at per-tag rates from a bounded pool of worker threads.
+* Tags are grouped by PLC and poll rate into read plans: neighbouring
+* addresses are merged into block reads and the blocks are packed into
+* Cli_ReadMultiVars requests that fit the negotiated PDU. One scheduler
+* thread keeps every plan on its own time grid and hands due plans to the
+* workers. A PLC is only ever served by one worker at a time, so a single
+* connection per PLC suffices and no thread is tied to a PLC.
+*
+* Adaptive polling (PollingEngine::adaptiveMaxMs) reads each block only as
+* often as it changes: a block whose bytes were the same as in its last read
+* has its interval doubled, up to the maximum; the first read that sees a
+* change puts it back on the plan's rate. Each poll packs only the blocks
+* that are due into requests, so static regions stop taking PDU slots.
+*
+* Poll configuration (CSV): plc,rack,slot,tag,cycletime
+*   plc        Address of the PLC, optionally with ":port" (default 102)
+*   tag        Address in address.csv syntax, e.g. "DB1,REAL0" or "M0.1"
+*   cycletime  Poll interval of the tag in ms
+*/
+
+#ifndef POLLINGENGINE_H
+#define POLLINGENGINE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../S7Server/TagConfig.h"
+#include "snap7.h"
+
+// PDU size requested from every PLC
+const int POLL_PDU_REQUEST = 960;
+
+// Tags closer than this many bytes are read in one block (the gap is read too)
+const int POLL_MERGE_GAP = 16;
+
+// A poll starting later than this fraction of its interval counts as late
+const double POLL_LATE_FRACTION = 0.1;
+
+// Minimum time between two connection attempts to an unreachable PLC
+const int POLL_RECONNECT_MS = 2000;
+
+// Adaptive polling: interval growth per unchanged read
+const int POLL_BACKOFF_FACTOR = 2;
+
+typedef std::chrono::steady_clock PollClock;
+
+// One configured tag and its last polled value
+struct PolledTag {
+    std::string name;          // Address as written in the configuration
+    AreaType areaType;
+    int dbNumber;
+    int offset;
+    int bitPosition;
+    DataType dataType;
+    int cycletime;             // ms
+    double value = 0.0;
+    bool valid = false;        // False until the first successful read
+};
+
+// One contiguous byte range read in every poll of a plan
+struct PollBlock {
+    int area;                  // S7AreaDB, S7AreaPE, S7AreaPA or S7AreaMK
+    int dbNumber;
+    int start;                 // First byte
+    int size;                  // Bytes
+    size_t bufferOffset;       // Position of the block in the plan buffer
+    std::vector<size_t> tags;  // Indexes into PollPlc::tags
+
+    // Adaptive polling (owned by the worker serving the PLC)
+    int interval = 0;                      // Current read interval in ms (0: never read)
+    PollClock::time_point lastRead;        // Slot of the last successful read
+};
+
+// All tags of one PLC sharing a poll interval
+struct PollPlan {
+    size_t plc;                            // Index into PollingEngine::plcs
+    int cycletime;                         // ms
+    std::vector<size_t> tags;              // Indexes into PollPlc::tags
+    std::vector<PollBlock> blocks;
+    std::vector<std::pair<size_t, size_t>> requests;  // First block, block count per ReadMultiVars
+    std::vector<byte> buffer;
+    std::vector<byte> previous;            // Data of the last read of every block (adaptive polling)
+    std::vector<size_t> dueBlocks;         // Blocks read by the current poll
+    std::vector<std::pair<size_t, size_t>> dueRequests;  // Their packing: first, count in dueBlocks
+    PollClock::time_point due;             // Slot of the poll queued or in progress
+    bool queued = false;
+
+    // Statistics (guarded by the engine mutex)
+    uint64_t polls = 0;
+    uint64_t late = 0;
+    uint64_t skipped = 0;                  // Slots dropped because the previous poll had not finished
+    uint64_t errors = 0;
+    double totalReadMs = 0.0;
+    double maxReadMs = 0.0;
+    double maxStartLagMs = 0.0;
+
+    // Adaptive polling statistics (guarded by the engine mutex)
+    uint64_t requestsSent = 0;             // ReadMultiVars calls made
+    uint64_t fixedRequests = 0;            // Calls polling every block at the plan's rate would have made
+    uint64_t changes = 0;                  // Reads that found a block changed
+    uint64_t changesAtRate = 0;            // ... whose previous read was one plan interval earlier
+    double totalWindowMs = 0.0;            // Time since the previous read, summed over changes
+    double maxWindowMs = 0.0;
+    size_t backedOff = 0;                  // Blocks currently read less often than the plan's rate
+};
+
+// One PLC connection; owned by at most one worker at a time
+struct PollPlc {
+    std::string address;
+    int port = 102;
+    int rack = 0;
+    int slot = 1;
+    S7Object client = 0;
+    bool connected = false;
+    int pduLength = 0;                     // Size the plans are packed for
+    PollClock::time_point nextConnectAttempt;
+    std::vector<PolledTag> tags;
+    std::vector<size_t> plans;             // Indexes into PollingEngine::plans
+
+    // Guarded by the engine mutex
+    bool busy = false;                     // Queued for or owned by a worker
+    std::deque<size_t> pending;            // Due plans waiting for this PLC
+    uint64_t reconnects = 0;
+    uint64_t connectFailures = 0;
+};
+
+struct PollingEngine {
+    std::vector<std::unique_ptr<PollPlc>> plcs;
+    std::vector<std::unique_ptr<PollPlan>> plans;
+
+    std::mutex mutex;
+    std::condition_variable schedulerWake;
+    std::condition_variable workAvailable;
+    std::deque<size_t> readyPlcs;          // PLCs with pending plans and no worker
+    std::vector<std::pair<PollClock::time_point, size_t>> timerHeap;  // Min-heap of (due, plan)
+    bool running = false;
+    PollClock::time_point startTime;
+    int adaptiveMaxMs = 0;                 // Longest interval of an unchanged block (0: adaptive polling off)
+
+    std::thread scheduler;
+    std::vector<std::thread> workers;
+};
+
+// Snap7 area code (S7AreaDB, S7AreaPE, ...) of an address.csv area
+int S7AreaCode(AreaType areaType);
+
+// Load the poll configuration and build the read plans.
+// Returns false if the file cannot be read or holds no valid tag.
+bool LoadPollConfig(const std::string& filename, PollingEngine& engine);
+
+// Group the tags of one PLC and interval into merged blocks and pack them into
+// ReadMultiVars requests whose request and response fit 'pduLength'
+void BuildReadPlan(const std::vector<PolledTag>& tags, const std::vector<size_t>& tagIndexes,
+                   int pduLength, PollPlan& plan);
+
+// Start the scheduler and 'threads' workers
+void StartPolling(PollingEngine& engine, int threads);
+
+// Stop all threads and disconnect every PLC
+void StopPolling(PollingEngine& engine);
+
+// Print achieved rate, late and skipped polls, errors and read time per PLC and interval,
+// and with adaptive polling the requests saved and how fresh the changes were caught
+void DisplayPollStats(PollingEngine& engine);
+
+#endif // POLLINGENGINE_H
@@ -0,0 +1,292 @@
+/*
+* Write Batcher
+* Write coalescing, WriteMultiVars job packing and the per-tag baseline.
+*/
+
+#include "WriteBatcher.h"
+#include "PollingEngine.h"
+#include "../S7Server/S7Codec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// S7 PDU overheads of a WriteMultiVars request and its response
+const int REQUEST_HEADER_SIZE = 12;   // Header + function + item count
+const int REQUEST_ITEM_SIZE = 12;     // Variable specification per item
+const int DATA_HEADER_SIZE = 4;       // Return code, transport size, length in front of each item's data
+const int RESPONSE_HEADER_SIZE = 14;  // Ack header + function + item count
+const int RESPONSE_ITEM_SIZE = 1;     // Return code per item
+
+// Contiguous bytes of one area covered by at least one non-BOOL write
+struct ByteRun {
+    int area;
+    int dbNumber;
+    int start;
+    int end;
+    size_t bufferOffset;
+};
+
+int WriteDbNumber(const TagWrite& write) {
+    return write.areaType == AreaType::DB ? write.dbNumber : 0;
+}
+
+void EncodeWrite(byte* buffer, int position, const TagWrite& write) {
+    switch (write.dataType) {
+        case DataType::REAL: SetReal(buffer, position, static_cast<float>(write.value)); break;
+        case DataType::DWORD: SetDWord(buffer, position, static_cast<uint32_t>(write.value)); break;
+        case DataType::INT: SetInt(buffer, position, static_cast<int16_t>(write.value)); break;
+        case DataType::BOOL: SetBool(buffer, position, write.bitPosition, write.value != 0); break;
+        default: break;
+    }
+}
+
+// Run holding byte 'offset' of the area, or nullptr
+const ByteRun* FindRun(const std::vector<ByteRun>& runs, int area, int dbNumber, int offset) {
+    auto after = std::upper_bound(runs.begin(), runs.end(), std::make_tuple(area, dbNumber, offset),
+                                  [](const std::tuple<int, int, int>& key, const ByteRun& run) {
+                                      return key < std::make_tuple(run.area, run.dbNumber, run.start);
+                                  });
+    if (after == runs.begin()) {
+        return nullptr;
+    }
+    const ByteRun& run = *(after - 1);
+    return run.area == area && run.dbNumber == dbNumber && offset < run.end ? &run : nullptr;
+}
+
+void FillDataItem(TS7DataItem& item, const WriteItem& write, byte* data) {
+    item.Area = write.area;
+    item.WordLen = write.wordLen;
+    item.Result = 0;
+    item.DBNumber = write.dbNumber;
+    item.Start = write.start;
+    item.Amount = write.size;
+    item.pdata = data;
+}
+
+} // namespace
+
+bool QueueTagWrite(std::vector<TagWrite>& writes, const std::string& tag, double value) {
+    TagWrite write;
+    if (!ParseTag(tag, write.areaType, write.dbNumber, write.offset, write.bitPosition, write.dataType)) {
+        return false;
+    }
+    if (!FitsDataType(write.dataType, value)) {
+        return false;
+    }
+    write.name = tag;
+    write.value = value;
+    writes.push_back(write);
+    return true;
+}
+
+void BuildWritePlan(const std::vector<TagWrite>& writes, int pduLength, WritePlan& plan) {
+    std::vector<size_t> sorted;
+    for (size_t i = 0; i < writes.size(); i++) {
+        if (writes[i].dataType != DataType::BOOL) {
+            sorted.push_back(i);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [&writes](size_t a, size_t b) {
+        const TagWrite& x = writes[a];
+        const TagWrite& y = writes[b];
+        return std::make_tuple(S7AreaCode(x.areaType), WriteDbNumber(x), x.offset) <
+               std::make_tuple(S7AreaCode(y.areaType), WriteDbNumber(y), y.offset);
+    });
+
+    // Coalesce adjacent and overlapping byte ranges (no gaps: those bytes are not ours to write)
+    std::vector<ByteRun> runs;
+    for (size_t index : sorted) {
+        const TagWrite& write = writes[index];
+        int area = S7AreaCode(write.areaType);
+        int dbNumber = WriteDbNumber(write);
+        int end = write.offset + GetTypeSize(write.dataType);
+        if (!runs.empty()) {
+            ByteRun& last = runs.back();
+            if (last.area == area && last.dbNumber == dbNumber && write.offset <= last.end) {
+                last.end = std::max(last.end, end);
+                continue;
+            }
+        }
+        ByteRun run = {area, dbNumber, write.offset, end, 0};
+        runs.push_back(run);
+    }
+    size_t bufferSize = 0;
+    for (auto& run : runs) {
+        run.bufferOffset = bufferSize;
+        bufferSize += run.end - run.start;
+    }
+
+    // Encode in queue order so the last write to a byte wins. A BOOL inside a run
+    // is folded into the run; the others become single-bit items.
+    plan.buffer.assign(bufferSize, 0);
+    std::map<std::tuple<int, int, int, int>, size_t> bits;  // (area, DB, byte, bit) -> last write
+    for (size_t i = 0; i < writes.size(); i++) {
+        const TagWrite& write = writes[i];
+        int area = S7AreaCode(write.areaType);
+        int dbNumber = WriteDbNumber(write);
+        const ByteRun* run = FindRun(runs, area, dbNumber, write.offset);
+        if (run) {
+            EncodeWrite(plan.buffer.data(), static_cast<int>(run->bufferOffset) + write.offset - run->start, write);
+        } else {
+            bits[std::make_tuple(area, dbNumber, write.offset, write.bitPosition)] = i;
+        }
+    }
+
+    // Runs longer than one item can carry are split
+    const int maxItemSize = std::max(1, pduLength - REQUEST_HEADER_SIZE - REQUEST_ITEM_SIZE - DATA_HEADER_SIZE);
+    plan.items.clear();
+    for (const auto& run : runs) {
+        for (int start = run.start; start < run.end; start += maxItemSize) {
+            WriteItem item;
+            item.area = run.area;
+            item.dbNumber = run.dbNumber;
+            item.wordLen = S7WLByte;
+            item.start = start;
+            item.size = std::min(maxItemSize, run.end - start);
+            item.bufferOffset = run.bufferOffset + (start - run.start);
+            plan.items.push_back(item);
+        }
+    }
+    for (const auto& bit : bits) {
+        WriteItem item;
+        item.area = std::get<0>(bit.first);
+        item.dbNumber = std::get<1>(bit.first);
+        item.wordLen = S7WLBit;
+        item.start = std::get<2>(bit.first) * 8 + std::get<3>(bit.first);
+        item.size = 1;
+        item.bufferOffset = plan.buffer.size();
+        plan.buffer.push_back(writes[bit.second].value != 0 ? 1 : 0);
+        plan.items.push_back(item);
+    }
+
+    // Pack consecutive items into jobs within MaxVars and the PDU in both directions.
+    // Item data of odd length is padded to an even length unless it is the last of the job.
+    plan.jobs.clear();
+    size_t first = 0;
+    int requestBytes = REQUEST_HEADER_SIZE;
+    int responseBytes = RESPONSE_HEADER_SIZE;
+    for (size_t i = 0; i < plan.items.size(); i++) {
+        int itemRequest = REQUEST_ITEM_SIZE + DATA_HEADER_SIZE + plan.items[i].size;
+        size_t count = i - first;
+        int pad = count > 0 ? (plan.items[i - 1].size & 1) : 0;
+        if (count > 0 && (count == static_cast<size_t>(MaxVars) ||
+                          requestBytes + pad + itemRequest > pduLength ||
+                          responseBytes + RESPONSE_ITEM_SIZE > pduLength)) {
+            plan.jobs.push_back(std::make_pair(first, count));
+            first = i;
+            requestBytes = REQUEST_HEADER_SIZE;
+            responseBytes = RESPONSE_HEADER_SIZE;
+            pad = 0;
+        }
+        requestBytes += pad + itemRequest;
+        responseBytes += RESPONSE_ITEM_SIZE;
+    }
+    if (first < plan.items.size()) {
+        plan.jobs.push_back(std::make_pair(first, plan.items.size() - first));
+    }
+}
+
+int ExecuteWritePlan(S7Object client, WritePlan& plan) {
+    int failed = 0;
+    TS7DataItem items[MaxVars];
+    for (const auto& job : plan.jobs) {
+        for (size_t i = 0; i < job.second; i++) {
+            const WriteItem& item = plan.items[job.first + i];
+            FillDataItem(items[i], item, plan.buffer.data() + item.bufferOffset);
+        }
+        if (Cli_WriteMultiVars(client, items, static_cast<int>(job.second)) != 0) {
+            failed += static_cast<int>(job.second);
+            continue;
+        }
+        for (size_t i = 0; i < job.second; i++) {
+            failed += items[i].Result != 0 ? 1 : 0;
+        }
+    }
+    return failed;
+}
+
+int WriteEachTag(S7Object client, const std::vector<TagWrite>& writes) {
+    int failed = 0;
+    for (const auto& write : writes) {
+        byte data[4] = {0, 0, 0, 0};
+        int result;
+        if (write.dataType == DataType::BOOL) {
+            data[0] = write.value != 0 ? 1 : 0;
+            result = Cli_WriteArea(client, S7AreaCode(write.areaType), WriteDbNumber(write),
+                                   write.offset * 8 + write.bitPosition, 1, S7WLBit, data);
+        } else {
+            EncodeWrite(data, 0, write);
+            result = Cli_WriteArea(client, S7AreaCode(write.areaType), WriteDbNumber(write),
+                                   write.offset, GetTypeSize(write.dataType), S7WLByte, data);
+        }
+        failed += result != 0 ? 1 : 0;
+    }
+    return failed;
+}
+
+int VerifyWritePlan(S7Object client, const WritePlan& plan) {
+    // A read response of the same items is smaller than the write request, so the jobs fit
+    std::vector<byte> readBack(plan.buffer.size(), 0);
+    int mismatches = 0;
+    TS7DataItem items[MaxVars];
+    for (const auto& job : plan.jobs) {
+        for (size_t i = 0; i < job.second; i++) {
+            const WriteItem& item = plan.items[job.first + i];
+            FillDataItem(items[i], item, readBack.data() + item.bufferOffset);
+        }
+        bool requestFailed = Cli_ReadMultiVars(client, items, static_cast<int>(job.second)) != 0;
+        for (size_t i = 0; i < job.second; i++) {
+            const WriteItem& item = plan.items[job.first + i];
+            if (requestFailed || items[i].Result != 0 ||
+                std::memcmp(readBack.data() + item.bufferOffset, plan.buffer.data() + item.bufferOffset, item.size) != 0) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+bool LoadRecipe(const std::string& filename, std::vector<TagWrite>& writes) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open recipe '" << filename << "'" << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || (lineNumber == 1 && line.compare(0, 3, "tag") == 0)) {
+            continue;
+        }
+        std::vector<std::string> fields = ParseCSVLine(line);
+        bool valid = fields.size() >= 2;
+        double value = 0.0;
+        if (valid) {
+            try {
+                value = std::stod(fields[1]);
+            } catch (...) {
+                valid = false;
+            }
+        }
+        if (!valid || !QueueTagWrite(writes, fields[0], value)) {
+            std::cerr << "WARNING: Skipping invalid recipe entry (bad address, or a value its data type cannot hold) at line "
+                      << lineNumber << ": " << line << std::endl;
+        }
+    }
+
+    if (writes.empty()) {
+        std::cerr << "ERROR: No valid values in recipe '" << filename << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+/*
+* Write Batcher
+*
+* Collects typed writes (setpoints, recipes) and sends them in as few
+* requests as possible. Values are encoded big-endian with the server's
+* S7Codec helpers. Writes to adjacent or overlapping bytes of the same
+* area are coalesced into one block item, and the items are packed into
+* Cli_WriteMultiVars jobs. Each job holds at most MaxVars items and fits
+* the negotiated PDU. Writes are applied in the order they were queued,
+* so a later write to the same address wins.
+*
+* Recipe file (CSV): tag,value
+*   tag    Address in address.csv syntax, e.g. "DB1,REAL0" or "M0.1"
+*   value  Number the tag's data type can hold; BOOL tags are set for any value other than 0
+*/
+
+#ifndef WRITEBATCHER_H
+#define WRITEBATCHER_H
+
+#include <string>
+#include <vector>
+#include "../S7Server/TagConfig.h"
+#include "snap7.h"
+
+// One queued write
+struct TagWrite {
+    std::string name;          // Address as given by the caller
+    AreaType areaType;
+    int dbNumber;
+    int offset;
+    int bitPosition;
+    DataType dataType;
+    double value;
+};
+
+// One item of a WriteMultiVars job: a byte block or a single bit
+struct WriteItem {
+    int area;                  // S7AreaDB, S7AreaPE, S7AreaPA or S7AreaMK
+    int dbNumber;
+    int wordLen;               // S7WLByte for blocks, S7WLBit for bits
+    int start;                 // First byte (bit address byte * 8 + bit for S7WLBit)
+    int size;                  // Bytes of data in the buffer
+    size_t bufferOffset;       // Position of the encoded data in the plan buffer
+    std::vector<size_t> writes;  // Indexes into the queued writes
+};
+
+struct WritePlan {
+    std::vector<WriteItem> items;
+    std::vector<std::pair<size_t, size_t>> jobs;  // First item, item count per WriteMultiVars
+    std::vector<byte> buffer;                     // Encoded values of every item
+};
+
+// Parse 'tag' and queue a write of 'value'. Returns false for an invalid address or a
+// value the tag's data type cannot hold (REAL beyond +/-FLT_MAX, DWORD outside
+// 0..4294967295, INT outside -32768..32767, NaN for any of them).
+bool QueueTagWrite(std::vector<TagWrite>& writes, const std::string& tag, double value);
+
+// Coalesce the writes into items, encode them and pack the items into
+// WriteMultiVars jobs whose request and response fit 'pduLength'
+void BuildWritePlan(const std::vector<TagWrite>& writes, int pduLength, WritePlan& plan);
+
+// Send every job of the plan. Returns the number of items that failed
+// (all items of a job the PLC rejected as a whole).
+int ExecuteWritePlan(S7Object client, WritePlan& plan);
+
+// Baseline: one Cli_WriteArea per write. Returns the number of failed writes.
+int WriteEachTag(S7Object client, const std::vector<TagWrite>& writes);
+
+// Read every item of the plan back and count the items whose bytes differ
+int VerifyWritePlan(S7Object client, const WritePlan& plan);
+
+// Load a recipe (tag,value rows). Returns false if the file cannot be read or holds no valid row.
+bool LoadRecipe(const std::string& filename, std::vector<TagWrite>& writes);
+
+#endif // WRITEBATCHER_H
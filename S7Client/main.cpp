@@ -4,18 +4,44 @@
  * 
  * This client tests reading multiple variables from the S7 Server
  * to verify if there's a 20 variable limit when using Snap7.
+ *
+ * It also runs a data-age benchmark (--data-age), a fixed-duration read load
+ * (--load), a connection-storm benchmark (--connect-storm), a multi-PLC
+ * polling engine with per-tag rates (--poll), a recipe download comparing
+ * batched against per-tag writes (--recipe) and an offline benchmark of the
+ * bulk block decoder (--decode-bench).
  */
 
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include <cstring>
+#include <cstdint>
 #include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <random>
 #include "../S7Server/snap7/snap7.h"
+#include "../S7Server/S7Codec.h"
+#include "BulkDecode.h"
+#include "PollingEngine.h"
+#include "WriteBatcher.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
 
 // Constants
-const int REAL_SIZE = 4;  // S7 REAL data type size in bytes
+const int DATA_AGE_HEADER_SIZE = 12;  // Cycle counter + 64-bit microsecond timestamp (see S7Server --data-age-header)
 
 // Structure to hold a variable read request
 struct S7Variable {
@@ -25,16 +51,582 @@ struct S7Variable {
     bool readSuccess;
 };
 
-// Helper function to convert S7 REAL format (big-endian IEEE 754) to float
-float GetReal(byte* buffer, int offset) {
-    // S7 uses big-endian byte order, convert to little-endian (Windows x86/x64)
-    byte floatBytes[4];
-    floatBytes[0] = buffer[offset + 3];  // Least significant byte
- floatBytes[1] = buffer[offset + 2];
-    floatBytes[2] = buffer[offset + 1];
-    floatBytes[3] = buffer[offset + 0];  // Most significant byte
-    
-    return *reinterpret_cast<float*>(floatBytes);
+// Data-age benchmark configuration (--data-age)
+struct DataAgeOptions {
+    bool enabled = false;
+    int dbNumber = 101;
+    int offset = 0;
+    int durationSec = 10;
+    std::vector<int> pollRatesMs{50, 100, 200, 500, 1000};
+};
+
+// Value at percentile p (0-100) of an already sorted sample set
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Polls the data-age header of one DB at each configured rate and reports the
+// distribution of data age, cycles missed between polls and duplicate reads
+// (polls that saw the same cycle counter as the previous poll).
+void RunDataAgeBenchmark(S7Object client, const DataAgeOptions& options) {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Data-Age Benchmark: DB" << options.dbNumber << " header at offset " << options.offset << std::endl;
+    std::cout << "Duration per poll rate: " << options.durationSec << " s" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::left << std::setw(10) << "Poll(ms)" << std::setw(8) << "Reads"
+              << std::setw(9) << "Errors" << std::setw(10) << "Age p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "max" << std::setw(9) << "Missed"
+              << "Duplicates" << std::endl;
+
+    for (int pollMs : options.pollRatesMs) {
+        std::vector<double> agesMs;
+        uint64_t missedCycles = 0;
+        uint64_t duplicateReads = 0;
+        int errors = 0;
+        bool havePrevious = false;
+        uint32_t previousCounter = 0;
+
+        auto nextPoll = std::chrono::steady_clock::now();
+        auto endTime = nextPoll + std::chrono::seconds(options.durationSec);
+        while (std::chrono::steady_clock::now() < endTime) {
+            byte header[DATA_AGE_HEADER_SIZE];
+            int result = Cli_DBRead(client, options.dbNumber, options.offset, DATA_AGE_HEADER_SIZE, header);
+            int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            if (result == 0) {
+                uint32_t counter = GetDWord(header, 0);
+                uint64_t producedUs = (static_cast<uint64_t>(GetDWord(header, 4)) << 32) | GetDWord(header, 8);
+                if (producedUs == 0) {
+                    std::cerr << "ERROR: DB" << options.dbNumber << " has no data-age header. "
+                              << "Start the server with --data-age-header." << std::endl;
+                    return;
+                }
+                agesMs.push_back((nowUs - static_cast<int64_t>(producedUs)) / 1000.0);
+
+                if (havePrevious) {
+                    uint32_t delta = counter - previousCounter;  // Wraps correctly
+                    if (delta == 0) {
+                        duplicateReads++;
+                    } else if (delta > 1) {
+                        missedCycles += delta - 1;
+                    }
+                }
+                previousCounter = counter;
+                havePrevious = true;
+            } else {
+                errors++;
+            }
+
+            nextPoll += std::chrono::milliseconds(pollMs);
+            std::this_thread::sleep_until(nextPoll);
+        }
+
+        std::sort(agesMs.begin(), agesMs.end());
+        std::cout << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(10) << pollMs << std::setw(8) << agesMs.size() << std::setw(9) << errors
+                  << std::setw(10) << Percentile(agesMs, 50) << std::setw(10) << Percentile(agesMs, 90)
+                  << std::setw(10) << Percentile(agesMs, 99)
+                  << std::setw(10) << (agesMs.empty() ? 0.0 : agesMs.back())
+                  << std::setw(9) << missedCycles << duplicateReads << std::endl;
+    }
+    std::cout << "========================================" << std::endl;
+    std::cout << "Age = client receive time - server production time (ms); requires synchronised clocks" << std::endl;
+    std::cout << "Missed = server cycles never observed; Duplicates = polls that saw no new cycle\n" << std::endl;
+}
+
+// Load test configuration (--load)
+struct LoadOptions {
+    bool enabled = false;
+    int durationSec = 10;
+    int threads = 4;       // Concurrent client connections
+    int firstDb = 1;       // Reads cycle through DB<firstDb> .. DB<firstDb + dbCount - 1>
+    int dbCount = 100;
+    int blockSize = 200;   // Bytes per DB read (starting at offset 0)
+};
+
+// Runs a fixed-duration read load with one connection per thread and reports
+// throughput and latency. The final LOAD_RESULT line is meant for scripts.
+int RunLoadTest(const std::string& serverIP, int rack, int slot, int port, const LoadOptions& options) {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Load Test: " << options.threads << " connections, " << options.durationSec << " s" << std::endl;
+    std::cout << "Reading " << options.blockSize << " bytes from DB" << options.firstDb
+              << "..DB" << (options.firstDb + options.dbCount - 1) << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    std::mutex resultMutex;
+    std::vector<double> latenciesMs;
+    uint64_t totalErrors = 0;
+    int connectFailures = 0;
+
+    auto endTime = std::chrono::steady_clock::now() + std::chrono::seconds(options.durationSec);
+    auto worker = [&](int threadIndex) {
+        S7Object client = Cli_Create();
+        int remotePort = port;
+        int pduSize = 960;
+        if (remotePort != 102) {
+            Cli_SetParam(client, p_u16_RemotePort, &remotePort);
+        }
+        Cli_SetParam(client, p_i32_PDURequest, &pduSize);
+        if (Cli_ConnectTo(client, serverIP.c_str(), rack, slot) != 0) {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            connectFailures++;
+            Cli_Destroy(&client);
+            return;
+        }
+
+        std::vector<double> latencies;
+        uint64_t errors = 0;
+        std::vector<byte> buffer(options.blockSize);
+        int dbIndex = threadIndex % options.dbCount;
+        while (std::chrono::steady_clock::now() < endTime) {
+            auto start = std::chrono::steady_clock::now();
+            int result = Cli_DBRead(client, options.firstDb + dbIndex, 0, options.blockSize, buffer.data());
+            auto end = std::chrono::steady_clock::now();
+            if (result == 0) {
+                latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            } else {
+                errors++;
+            }
+            dbIndex = (dbIndex + 1) % options.dbCount;
+        }
+
+        Cli_Disconnect(client);
+        Cli_Destroy(&client);
+        std::lock_guard<std::mutex> lock(resultMutex);
+        latenciesMs.insert(latenciesMs.end(), latencies.begin(), latencies.end());
+        totalErrors += errors;
+    };
+
+    auto testStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.threads; i++) {
+        workers.push_back(std::thread(worker, i));
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - testStart).count();
+
+    std::sort(latenciesMs.begin(), latenciesMs.end());
+    double readsPerSec = latenciesMs.size() / elapsedSec;
+    double p50 = Percentile(latenciesMs, 50);
+    double p99 = Percentile(latenciesMs, 99);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Connect failures: " << connectFailures << "/" << options.threads << std::endl;
+    std::cout << "Successful reads: " << latenciesMs.size() << " (errors: " << totalErrors << ")" << std::endl;
+    std::cout << "Throughput: " << readsPerSec << " reads/s, "
+              << (readsPerSec * options.blockSize / 1024.0) << " KiB/s" << std::endl;
+    std::cout << "Latency p50: " << p50 << " ms, p99: " << p99 << " ms, max: "
+              << (latenciesMs.empty() ? 0.0 : latenciesMs.back()) << " ms" << std::endl;
+    std::cout << "LOAD_RESULT reads_per_sec=" << readsPerSec << " p50_ms=" << p50 << " p99_ms=" << p99
+              << " errors=" << totalErrors << " connect_failures=" << connectFailures << std::endl;
+
+    return (latenciesMs.empty() || connectFailures > 0) ? 1 : 0;
+}
+
+// Connection-storm benchmark configuration (--connect-storm)
+struct StormOptions {
+    bool enabled = false;
+    int stepSec = 10;         // Duration of each rate step
+    std::vector<int> rates{100, 200, 500, 1000, 2000, 5000};  // Target connections/s per step
+    int threads = 32;         // Connecting threads
+    int dbNumber = 101;       // DB of the first read after each connect
+    int idleConnections = 500;  // Held open for the memory measurement (0 = skip)
+    int serverPid = 0;        // Server process whose memory is sampled (0 = client only)
+};
+
+// A rate step is sustained when this fraction of its scheduled connections succeeded...
+const double STORM_SUSTAINED_FRACTION = 0.95;
+// ...and no more than this fraction failed
+const double STORM_MAX_FAILURE_FRACTION = 0.01;
+
+// Resident set size of a process in bytes (0 = this process; 0 where unavailable)
+size_t ResidentBytes(int pid) {
+#ifdef _WIN32
+    HANDLE process = pid ? OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid) : GetCurrentProcess();
+    if (!process) {
+        return 0;
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    size_t resident = K32GetProcessMemoryInfo(process, &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+    if (pid) {
+        CloseHandle(process);
+    }
+    return resident;
+#else
+    std::ifstream statm(pid ? "/proc/" + std::to_string(pid) + "/statm" : std::string("/proc/self/statm"));
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+#endif
+}
+
+// Opens and closes connections at each target rate and reports connect
+// (TCP + COTP + PDU negotiation) and first-read latency. Connection starts are
+// scheduled open-loop on a fixed grid shared by all threads, so a server that
+// accepts too slowly shows up as start lag and a missed rate, not as a lower
+// offered load. Stops at the first rate that is not sustained, then measures
+// the memory held per idle connection. The final STORM_RESULT line is meant for scripts.
+int RunConnectStorm(const std::string& serverIP, int rack, int slot, int port, const StormOptions& options) {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Connection Storm: " << options.threads << " threads, " << options.stepSec << " s per rate" << std::endl;
+    std::cout << "Each connection: connect + PDU negotiation, read 4 bytes of DB" << options.dbNumber
+              << ", disconnect" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << std::left << std::setw(10) << "Target/s" << std::setw(11) << "Actual/s" << std::setw(8) << "OK"
+              << std::setw(8) << "Failed" << std::setw(12) << "Connect p50" << std::setw(9) << "p99"
+              << std::setw(9) << "max" << std::setw(10) << "Read p50" << std::setw(9) << "p99"
+              << "Lag p99" << std::endl;
+
+    int sustainedRate = 0;
+    double sustainedConnectP99 = 0.0;
+    for (int rate : options.rates) {
+        std::mutex resultMutex;
+        std::vector<double> connectMs, readMs, lagMs;
+        uint64_t failures = 0;
+        std::atomic<uint64_t> nextSlot(0);
+
+        auto stepStart = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        auto stepEnd = stepStart + std::chrono::seconds(options.stepSec);
+        auto worker = [&]() {
+            S7Object client = Cli_Create();
+            int remotePort = port;
+            int pduSize = 960;
+            if (remotePort != 102) {
+                Cli_SetParam(client, p_u16_RemotePort, &remotePort);
+            }
+            Cli_SetParam(client, p_i32_PDURequest, &pduSize);
+
+            std::vector<double> connects, reads, lags;
+            uint64_t failed = 0;
+            while (true) {
+                uint64_t index = nextSlot++;
+                auto due = stepStart + std::chrono::microseconds(static_cast<int64_t>(index * 1000000 / rate));
+                if (due >= stepEnd) {
+                    break;
+                }
+                std::this_thread::sleep_until(due);
+                auto start = std::chrono::steady_clock::now();
+                if (start >= stepEnd) {
+                    break;  // Backlog left at the end of the step counts as not achieved
+                }
+                if (Cli_ConnectTo(client, serverIP.c_str(), rack, slot) != 0) {
+                    failed++;
+                    Cli_Disconnect(client);
+                    continue;
+                }
+                auto connected = std::chrono::steady_clock::now();
+                byte data[4];
+                int result = Cli_DBRead(client, options.dbNumber, 0, sizeof(data), data);
+                auto read = std::chrono::steady_clock::now();
+                Cli_Disconnect(client);
+                if (result != 0) {
+                    failed++;
+                    continue;
+                }
+                connects.push_back(std::chrono::duration<double, std::milli>(connected - start).count());
+                reads.push_back(std::chrono::duration<double, std::milli>(read - connected).count());
+                lags.push_back(std::chrono::duration<double, std::milli>(start - due).count());
+            }
+            Cli_Destroy(&client);
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            connectMs.insert(connectMs.end(), connects.begin(), connects.end());
+            readMs.insert(readMs.end(), reads.begin(), reads.end());
+            lagMs.insert(lagMs.end(), lags.begin(), lags.end());
+            failures += failed;
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 0; i < options.threads; i++) {
+            workers.push_back(std::thread(worker));
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+
+        std::sort(connectMs.begin(), connectMs.end());
+        std::sort(readMs.begin(), readMs.end());
+        std::sort(lagMs.begin(), lagMs.end());
+        double scheduled = static_cast<double>(rate) * options.stepSec;
+        double actual = connectMs.size() / static_cast<double>(options.stepSec);
+        bool sustained = connectMs.size() >= scheduled * STORM_SUSTAINED_FRACTION &&
+                         failures <= scheduled * STORM_MAX_FAILURE_FRACTION;
+        std::cout << std::left << std::fixed << std::setprecision(2)
+                  << std::setw(10) << rate << std::setw(11) << actual << std::setw(8) << connectMs.size()
+                  << std::setw(8) << failures << std::setw(12) << Percentile(connectMs, 50)
+                  << std::setw(9) << Percentile(connectMs, 99)
+                  << std::setw(9) << (connectMs.empty() ? 0.0 : connectMs.back())
+                  << std::setw(10) << Percentile(readMs, 50) << std::setw(9) << Percentile(readMs, 99)
+                  << Percentile(lagMs, 99) << (sustained ? "" : "  (not sustained)") << std::endl;
+        if (!sustained) {
+            break;
+        }
+        sustainedRate = rate;
+        sustainedConnectP99 = Percentile(connectMs, 99);
+    }
+    std::cout << "========================================" << std::endl;
+    std::cout << "Maximum sustained rate: " << sustainedRate << " connections/s" << std::endl;
+
+    // Memory held per idle connection: open them all, let the server settle, sample RSS
+    double clientBytesPerConnection = 0.0, serverBytesPerConnection = 0.0;
+    int idle = 0;
+    if (options.idleConnections > 0) {
+        size_t clientBefore = ResidentBytes(0);
+        size_t serverBefore = options.serverPid ? ResidentBytes(options.serverPid) : 0;
+        std::vector<S7Object> clients;
+        for (int i = 0; i < options.idleConnections; i++) {
+            S7Object client = Cli_Create();
+            int remotePort = port;
+            if (remotePort != 102) {
+                Cli_SetParam(client, p_u16_RemotePort, &remotePort);
+            }
+            clients.push_back(client);
+            if (Cli_ConnectTo(client, serverIP.c_str(), rack, slot) == 0) {
+                idle++;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        size_t clientAfter = ResidentBytes(0);
+        size_t serverAfter = options.serverPid ? ResidentBytes(options.serverPid) : 0;
+        for (auto& client : clients) {
+            Cli_Disconnect(client);
+            Cli_Destroy(&client);
+        }
+
+        if (idle > 0) {
+            clientBytesPerConnection = (static_cast<double>(clientAfter) - clientBefore) / idle;
+            serverBytesPerConnection = (static_cast<double>(serverAfter) - serverBefore) / idle;
+        }
+        std::cout << "Idle connections: " << idle << "/" << options.idleConnections << " open" << std::endl;
+        std::cout << "Client memory: " << (clientBytesPerConnection / 1024.0) << " KiB per connection" << std::endl;
+        if (options.serverPid && serverBefore > 0) {
+            std::cout << "Server memory: " << (serverBytesPerConnection / 1024.0) << " KiB per connection (pid "
+                      << options.serverPid << ")" << std::endl;
+        } else {
+            std::cout << "Server memory: not sampled (pass --server-pid <pid> of a server on this host)" << std::endl;
+        }
+    }
+    std::cout << "Lag = connection start after its scheduled slot (all threads busy); Actual counts successful connections\n"
+              << std::endl;
+    std::cout << "STORM_RESULT max_rate=" << sustainedRate << " connect_p99_ms=" << sustainedConnectP99
+              << " idle_connections=" << idle << " server_kib_per_connection=" << (serverBytesPerConnection / 1024.0)
+              << " client_kib_per_connection=" << (clientBytesPerConnection / 1024.0) << std::endl;
+    return sustainedRate > 0 ? 0 : 1;
+}
+
+// Multi-PLC polling configuration (--poll)
+struct PollOptions {
+    bool enabled = false;
+    std::string configFile;
+    int threads = 4;          // Worker threads shared by all PLCs
+    int durationSec = 60;
+    int reportSec = 10;       // Statistics interval
+    int adaptiveMaxMs = 0;    // Back-off limit of unchanged blocks (0: fixed rates)
+};
+
+// Polls every PLC of the poll configuration for the given duration and prints
+// per-PLC statistics every reporting interval. Returns non-zero if nothing was read.
+int RunPollingEngine(const PollOptions& options) {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Polling Engine: " << options.configFile << ", " << options.threads << " worker threads, "
+              << options.durationSec << " s" << std::endl;
+    if (options.adaptiveMaxMs > 0) {
+        std::cout << "Adaptive polling: unchanged blocks back off to " << options.adaptiveMaxMs << " ms" << std::endl;
+    }
+    std::cout << "========================================" << std::endl;
+
+    PollingEngine engine;
+    if (!LoadPollConfig(options.configFile, engine)) {
+        return 1;
+    }
+    engine.adaptiveMaxMs = options.adaptiveMaxMs;
+    StartPolling(engine, options.threads);
+
+    auto endTime = std::chrono::steady_clock::now() + std::chrono::seconds(options.durationSec);
+    auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(options.reportSec);
+    while (std::chrono::steady_clock::now() < endTime) {
+        std::this_thread::sleep_until(std::min(nextReport, endTime));
+        if (std::chrono::steady_clock::now() >= nextReport && nextReport < endTime) {
+            DisplayPollStats(engine);
+            nextReport += std::chrono::seconds(options.reportSec);
+        }
+    }
+    StopPolling(engine);
+    DisplayPollStats(engine);
+
+    size_t validTags = 0;
+    for (const auto& plc : engine.plcs) {
+        for (const auto& tag : plc->tags) {
+            validTags += tag.valid ? 1 : 0;
+        }
+    }
+    return validTags > 0 ? 0 : 1;
+}
+
+// Recipe download benchmark configuration (--recipe)
+struct RecipeOptions {
+    bool enabled = false;
+    std::string file;
+    int repeat = 10;          // Downloads per method
+};
+
+// Downloads the recipe 'repeat' times with one Cli_WriteArea per value, then
+// 'repeat' times through the write batcher (plan built for every download, as a
+// tool collecting fresh setpoints would), and reads the batched values back.
+int RunRecipeBenchmark(S7Object client, const RecipeOptions& options) {
+    std::vector<TagWrite> writes;
+    if (!LoadRecipe(options.file, writes)) {
+        return 1;
+    }
+    int requestedPdu = 0, pduLength = 0;
+    Cli_GetPduLength(client, &requestedPdu, &pduLength);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Recipe Download: " << options.file << ", " << writes.size() << " values, "
+              << options.repeat << " downloads per method" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    int perTagErrors = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.repeat; i++) {
+        perTagErrors += WriteEachTag(client, writes);
+    }
+    double perTagMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      / options.repeat;
+
+    WritePlan plan;
+    int batchedErrors = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.repeat; i++) {
+        BuildWritePlan(writes, pduLength, plan);
+        batchedErrors += ExecuteWritePlan(client, plan);
+    }
+    double batchedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                       / options.repeat;
+    int mismatches = VerifyWritePlan(client, plan);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Per-tag writes: " << writes.size() << " requests, " << perTagMs << " ms per download, "
+              << perTagErrors << " errors" << std::endl;
+    std::cout << "Batched writes: " << plan.jobs.size() << " requests (" << plan.items.size() << " items, PDU "
+              << pduLength << "), " << batchedMs << " ms per download, " << batchedErrors << " failed items"
+              << std::endl;
+    std::cout << "Speedup: " << (batchedMs > 0 ? perTagMs / batchedMs : 0.0) << "x" << std::endl;
+    std::cout << "Read-back: " << (plan.items.size() - mismatches) << "/" << plan.items.size()
+              << " items match\n" << std::endl;
+    return (perTagErrors > 0 || batchedErrors > 0 || mismatches > 0) ? 1 : 0;
+}
+
+// Bulk decode benchmark configuration (--decode-bench)
+struct DecodeBenchOptions {
+    bool enabled = false;
+    int blockKb = 64;          // Size of the decoded block
+};
+
+// Layout of a block like a large DB: repeating sections of 256 REALs, 64 DWORDs,
+// 128 INTs and 256 BOOLs, then short runs of 37 REALs, 13 DWORDs, 29 INTs and 61
+// BOOLs from bit 3, whose lengths are no multiple of a SIMD register and leave
+// the kernels a scalar tail (1840 bytes), filling 'size' bytes
+BlockLayout BenchBlockLayout(size_t size) {
+    BlockLayout layout;
+    for (size_t offset = 0; offset + 1840 <= size; offset += 1840) {
+        int base = static_cast<int>(offset);
+        AddDecodeRun(layout, DataType::REAL, base, 0, 256);
+        AddDecodeRun(layout, DataType::DWORD, base + 1024, 0, 64);
+        AddDecodeRun(layout, DataType::INT, base + 1280, 0, 128);
+        AddDecodeRun(layout, DataType::BOOL, base + 1536, 0, 256);
+        AddDecodeRun(layout, DataType::REAL, base + 1568, 0, 37);
+        AddDecodeRun(layout, DataType::DWORD, base + 1716, 0, 13);
+        AddDecodeRun(layout, DataType::INT, base + 1768, 0, 29);
+        AddDecodeRun(layout, DataType::BOOL, base + 1826, 3, 61);
+    }
+    return layout;
+}
+
+bool SameColumns(const DecodedColumns& a, const DecodedColumns& b) {
+    // Bitwise, so NaN patterns in the random block compare equal
+    return a.reals.size() == b.reals.size() &&
+           (a.reals.empty() || std::memcmp(a.reals.data(), b.reals.data(), a.reals.size() * sizeof(float)) == 0) &&
+           a.dwords == b.dwords && a.ints == b.ints && a.bools == b.bools;
+}
+
+// Decodes a random block with the per-value S7Codec helpers and with every kernel
+// the CPU supports, and reports throughput in GB/s of block data
+int RunDecodeBenchmark(const DecodeBenchOptions& options) {
+    BlockLayout layout = BenchBlockLayout(static_cast<size_t>(options.blockKb) * 1024);
+    std::vector<byte> block(layout.size);
+    std::mt19937 random(1);
+    for (auto& value : block) {
+        value = static_cast<byte>(random());
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Bulk Decode: " << layout.size << " byte block, " << layout.reals << " REAL, " << layout.dwords
+              << " DWORD, " << layout.ints << " INT, " << layout.bools << " BOOL" << std::endl;
+    std::cout << "Best kernel on this CPU: " << DecodeKernelName(BestDecodeKernel()) << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    // Decode repeatedly for about half a second per method
+    auto measure = [&](const std::function<void(DecodedColumns&)>& decode, DecodedColumns& columns) {
+        size_t rounds = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0.0;
+        do {
+            decode(columns);
+            rounds++;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < 0.5);
+        return static_cast<double>(layout.size) * rounds / seconds / 1e9;
+    };
+
+    DecodedColumns reference;
+    double helperGbs = measure([&](DecodedColumns& columns) {
+        DecodeBlockColumnsPerValue(block.data(), layout, columns);
+    }, reference);
+    std::cout << std::left << std::setw(18) << "Method" << std::setw(10) << "GB/s" << "Speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::setw(18) << "per-value helper" << std::setw(10) << helperGbs << "1.00x" << std::endl;
+
+    bool identical = true;
+    const DecodeKernel kernels[] = {DecodeKernel::Scalar, DecodeKernel::SSSE3, DecodeKernel::AVX2};
+    for (DecodeKernel kernel : kernels) {
+        if (!DecodeKernelSupported(kernel)) {
+            continue;
+        }
+        DecodedColumns columns;
+        double gbs = measure([&](DecodedColumns& out) {
+            DecodeBlockColumns(block.data(), layout, out, kernel);
+        }, columns);
+        bool same = SameColumns(columns, reference);
+        identical = identical && same;
+        std::cout << std::setw(18) << (std::string("bulk ") + DecodeKernelName(kernel)) << std::setw(10) << gbs
+                  << (helperGbs > 0 ? gbs / helperGbs : 0.0) << "x" << (same ? "" : "  MISMATCH") << std::endl;
+    }
+    std::cout << (identical ? "All kernels match the per-value helpers" : "ERROR: Decoded columns differ")
+              << "\n" << std::endl;
+    return identical ? 0 : 1;
+}
+
+// Parse a comma separated list of integers, e.g. "50,100,1000"
+std::vector<int> ParseIntList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoi(item));
+        }
+    }
+    return values;
 }
 
 // Test reading a single variable using Cli_ReadArea
@@ -118,29 +710,140 @@ int main(int argc, char* argv[]) {
     std::cout << "Testing Variable Read Limits" << std::endl;
   std::cout << "========================================\n" << std::endl;
 
-    // Parse command line arguments
+    // Parse command line arguments: positional <IP> <Rack> <Slot> <Port>, then options
     std::string serverIP = "127.0.0.1";
     int rack = 0;
     int slot = 0;
     int port = 102;
+    DataAgeOptions dataAge;
+    LoadOptions load;
+    PollOptions poll;
+    RecipeOptions recipe;
+    StormOptions storm;
+    DecodeBenchOptions decodeBench;
     
-    if (argc >= 2) {
-        serverIP = argv[1];
-    }
-    if (argc >= 3) {
-    rack = std::stoi(argv[2]);
+    std::vector<std::string> positional;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--data-age") {
+                dataAge.enabled = true;
+            } else if (arg == "--db" && i + 1 < argc) {
+                dataAge.dbNumber = std::stoi(argv[++i]);
+            } else if (arg == "--header-offset" && i + 1 < argc) {
+                dataAge.offset = std::stoi(argv[++i]);
+            } else if (arg == "--duration" && i + 1 < argc) {
+                dataAge.durationSec = std::stoi(argv[++i]);
+            } else if (arg == "--poll-rates" && i + 1 < argc) {
+                dataAge.pollRatesMs = ParseIntList(argv[++i]);
+            } else if (arg == "--load" && i + 1 < argc) {
+                load.enabled = true;
+                load.durationSec = std::stoi(argv[++i]);
+            } else if (arg == "--threads" && i + 1 < argc) {
+                load.threads = std::stoi(argv[++i]);
+            } else if (arg == "--first-db" && i + 1 < argc) {
+                load.firstDb = std::stoi(argv[++i]);
+            } else if (arg == "--db-count" && i + 1 < argc) {
+                load.dbCount = std::stoi(argv[++i]);
+            } else if (arg == "--block-size" && i + 1 < argc) {
+                load.blockSize = std::stoi(argv[++i]);
+            } else if (arg == "--connect-storm" && i + 1 < argc) {
+                storm.enabled = true;
+                storm.stepSec = std::stoi(argv[++i]);
+            } else if (arg == "--storm-rates" && i + 1 < argc) {
+                storm.rates = ParseIntList(argv[++i]);
+            } else if (arg == "--storm-threads" && i + 1 < argc) {
+                storm.threads = std::stoi(argv[++i]);
+            } else if (arg == "--storm-db" && i + 1 < argc) {
+                storm.dbNumber = std::stoi(argv[++i]);
+            } else if (arg == "--idle-connections" && i + 1 < argc) {
+                storm.idleConnections = std::stoi(argv[++i]);
+            } else if (arg == "--server-pid" && i + 1 < argc) {
+                storm.serverPid = std::stoi(argv[++i]);
+            } else if (arg == "--poll" && i + 1 < argc) {
+                poll.enabled = true;
+                poll.configFile = argv[++i];
+            } else if (arg == "--poll-threads" && i + 1 < argc) {
+                poll.threads = std::stoi(argv[++i]);
+            } else if (arg == "--poll-duration" && i + 1 < argc) {
+                poll.durationSec = std::stoi(argv[++i]);
+            } else if (arg == "--report-interval" && i + 1 < argc) {
+                poll.reportSec = std::stoi(argv[++i]);
+            } else if (arg == "--adaptive" && i + 1 < argc) {
+                poll.adaptiveMaxMs = std::stoi(argv[++i]);
+            } else if (arg == "--recipe" && i + 1 < argc) {
+                recipe.enabled = true;
+                recipe.file = argv[++i];
+            } else if (arg == "--recipe-repeat" && i + 1 < argc) {
+                recipe.repeat = std::stoi(argv[++i]);
+            } else if (arg == "--decode-bench" && i + 1 < argc) {
+                decodeBench.enabled = true;
+                decodeBench.blockKb = std::stoi(argv[++i]);
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "ERROR: Unknown or incomplete option " << arg << std::endl;
+                return 1;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+    
+        if (positional.size() >= 1) {
+            serverIP = positional[0];
+        }
+        if (positional.size() >= 2) {
+            rack = std::stoi(positional[1]);
+        }
+        if (positional.size() >= 3) {
+            slot = std::stoi(positional[2]);
+        }
+        if (positional.size() >= 4) {
+            port = std::stoi(positional[3]);
+        }
+    } catch (...) {
+        std::cerr << "ERROR: Invalid numeric argument" << std::endl;
+        return 1;
     }
-    if (argc >= 4) {
-        slot = std::stoi(argv[3]);
+    
+    if (decodeBench.enabled) {
+        if (decodeBench.blockKb < 2) {
+            std::cerr << "ERROR: --decode-bench needs a block of at least 2 KB" << std::endl;
+            return 1;
+        }
+        return RunDecodeBenchmark(decodeBench);
     }
-    if (argc >= 5) {
-        port = std::stoi(argv[4]);
+    if (poll.enabled) {
+        if (poll.threads < 1 || poll.durationSec < 1 || poll.reportSec < 1 || poll.adaptiveMaxMs < 0) {
+            std::cerr << "ERROR: --poll-threads, --poll-duration, --report-interval and --adaptive must be positive" << std::endl;
+            return 1;
+        }
+        return RunPollingEngine(poll);
     }
-    
+
     std::cout << "Target Server: " << serverIP << std::endl;
     std::cout << "Rack: " << rack << ", Slot: " << slot << std::endl;
     std::cout << "Port: " << port << "\n" << std::endl;
 
+    if (load.enabled) {
+        if (load.threads < 1 || load.dbCount < 1 || load.blockSize < 1) {
+            std::cerr << "ERROR: --threads, --db-count and --block-size must be positive" << std::endl;
+            return 1;
+        }
+        return RunLoadTest(serverIP, rack, slot, port, load);
+    }
+    if (storm.enabled) {
+        bool ratesValid = !storm.rates.empty() &&
+                          std::all_of(storm.rates.begin(), storm.rates.end(), [](int rate) { return rate > 0; });
+        if (storm.stepSec < 1 || storm.threads < 1 || storm.idleConnections < 0 || !ratesValid) {
+            std::cerr << "ERROR: --connect-storm, --storm-threads and --storm-rates must be positive" << std::endl;
+            return 1;
+        }
+        return RunConnectStorm(serverIP, rack, slot, port, storm);
+    }
+    if (recipe.enabled && recipe.repeat < 1) {
+        std::cerr << "ERROR: --recipe-repeat must be positive" << std::endl;
+        return 1;
+    }
+
     // Create client instance
     S7Object client = Cli_Create();
     if (!client) {
@@ -174,6 +877,19 @@ int main(int argc, char* argv[]) {
     std::cout << "Connected successfully!\n" << std::endl;
     DisplayConnectionInfo(client);
 
+    if (dataAge.enabled) {
+        RunDataAgeBenchmark(client, dataAge);
+        Cli_Disconnect(client);
+        Cli_Destroy(&client);
+        return 0;
+    }
+    if (recipe.enabled) {
+        int status = RunRecipeBenchmark(client, recipe);
+        Cli_Disconnect(client);
+        Cli_Destroy(&client);
+        return status;
+    }
+
     // Test 1: Read variables individually (to establish baseline)
     std::cout << "========================================" << std::endl;
     std::cout << "Test 1: Reading 5 variables individually" << std::endl;
@@ -0,0 +1,154 @@
+/*
+* Synthetic Tag Configuration Generator
+* Type and cycletime sampling, address layout and CSV output.
+*/
+
+#include "ConfigGenerator.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const char* TYPE_NAMES[4] = {"REAL", "DWORD", "INT", "X"};
+const int TYPE_SIZES[4] = {4, 4, 2, 1};
+
+// Split "a,b,c" into its comma-separated parts
+std::vector<std::string> SplitList(const std::string& value) {
+    std::vector<std::string> parts;
+    std::stringstream stream(value);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+} // namespace
+
+bool ParseTypeMix(const std::string& value, GeneratorOptions& options) {
+    double weights[4] = {0, 0, 0, 0};
+    for (const auto& part : SplitList(value)) {
+        size_t eq = part.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = part.substr(0, eq);
+        int type = -1;
+        if (name == "real") type = 0;
+        else if (name == "dword") type = 1;
+        else if (name == "int") type = 2;
+        else if (name == "bool") type = 3;
+        if (type < 0) {
+            return false;
+        }
+        try {
+            weights[type] = std::stod(part.substr(eq + 1));
+        } catch (...) {
+            return false;
+        }
+    }
+    double total = 0;
+    for (double weight : weights) {
+        if (weight < 0) {
+            return false;
+        }
+        total += weight;
+    }
+    if (total <= 0) {
+        return false;
+    }
+    std::copy(weights, weights + 4, options.typeWeights);
+    return true;
+}
+
+bool ParseCycletimes(const std::string& value, GeneratorOptions& options) {
+    std::vector<std::pair<int, double>> cycletimes;
+    for (const auto& part : SplitList(value)) {
+        size_t colon = part.find(':');
+        try {
+            int cycletime = std::stoi(part.substr(0, colon));
+            double weight = colon == std::string::npos ? 1.0 : std::stod(part.substr(colon + 1));
+            if (cycletime < 0 || weight < 0) {
+                return false;
+            }
+            cycletimes.push_back(std::make_pair(cycletime, weight));
+        } catch (...) {
+            return false;
+        }
+    }
+    if (cycletimes.empty()) {
+        return false;
+    }
+    options.cycletimes = cycletimes;
+    return true;
+}
+
+size_t GenerateConfig(const GeneratorOptions& options, std::ostream& out) {
+    std::mt19937 rng(options.seed);
+    std::discrete_distribution<int> pickType(options.typeWeights, options.typeWeights + 4);
+    std::vector<double> cycleWeights;
+    for (const auto& cycletime : options.cycletimes) {
+        cycleWeights.push_back(cycletime.second);
+    }
+    std::discrete_distribution<size_t> pickCycletime(cycleWeights.begin(), cycleWeights.end());
+    std::bernoulli_distribution pickOverlap(std::min(1.0, std::max(0.0, options.overlap)));
+
+    out << "tag,min,max,echelon,cycletime\n";
+    size_t rows = 0;
+    for (int d = 0; d < options.dbCount; d++) {
+        const int db = options.firstDb + d;
+        int next = 0;              // First free byte
+        int boolByte = -1;         // Byte currently filled with BOOLs
+        int boolBit = 8;
+        int lastOffset = -1;       // Previous tag, target of overlapping placements
+        int lastSize = 0;
+
+        for (int t = 0; t < options.tagsPerDb; t++) {
+            if (options.tagLimit > 0 && rows >= options.tagLimit) {
+                return rows;
+            }
+            const int type = pickType(rng);
+            const int size = TYPE_SIZES[type];
+            int offset;
+            int bit = 0;
+
+            if (lastOffset >= 0 && lastSize >= 2 && pickOverlap(rng)) {
+                // Start inside the previous tag's bytes
+                offset = lastOffset + lastSize / 2;
+                next = std::max(next, offset + size);
+            } else if (type == 3) {
+                // BOOLs share a byte, eight per byte
+                if (boolBit == 8) {
+                    boolByte = next++;
+                    boolBit = 0;
+                }
+                offset = boolByte;
+                bit = boolBit++;
+            } else {
+                // Word aligned, as S7 lays out elementary types
+                offset = (next + 1) & ~1;
+                next = offset + size;
+            }
+            lastOffset = offset;
+            lastSize = size;
+
+            out << "\"DB" << db << "," << TYPE_NAMES[type] << offset;
+            if (type == 3) {
+                out << "." << bit;
+            }
+            out << "\",";
+            switch (type) {
+                case 0: out << "0,1000,0.5,"; break;
+                case 1: out << "0,100000,1,"; break;
+                case 2: out << "-1000,1000,1,"; break;
+                default: out << "0,1,1,"; break;
+            }
+            out << options.cycletimes[pickCycletime(rng)].first << "\n";
+            rows++;
+        }
+    }
+    return rows;
+}
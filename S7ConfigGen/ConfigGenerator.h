@@ -0,0 +1,42 @@
+/*
+* Synthetic Tag Configuration Generator
+*
+* Writes address.csv-compatible configurations of any size for scaling
+* tests: DB count, tags per DB, data type mix, cycletime distribution
+* and a share of tags whose addresses overlap their predecessor. Output
+* is reproducible for a given seed. Overlapping configurations are for
+* negative tests: the server's address check refuses to start on them.
+*/
+
+#ifndef CONFIGGENERATOR_H
+#define CONFIGGENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Generator parameters (command line of S7ConfigGen, fixed presets in S7Bench --scaling)
+struct GeneratorOptions {
+    int dbCount = 10;
+    int tagsPerDb = 100;
+    size_t tagLimit = 0;   // Stop after this many tags (0: dbCount * tagsPerDb)
+    int firstDb = 1;
+    double typeWeights[4] = {40, 20, 20, 20};  // REAL, DWORD, INT, BOOL
+    std::vector<std::pair<int, double>> cycletimes = {{100, 10}, {1000, 60}, {30000, 30}};  // ms, weight
+    double overlap = 0.0;  // Share of tags placed inside the previous tag's bytes (rejected by S7Server)
+    uint32_t seed = 1;
+};
+
+// Parse a type mix such as "real=40,dword=20,int=20,bool=20"
+bool ParseTypeMix(const std::string& value, GeneratorOptions& options);
+
+// Parse a cycletime distribution such as "100:10,1000:60,30000:30" (ms:weight)
+bool ParseCycletimes(const std::string& value, GeneratorOptions& options);
+
+// Write the configuration (header plus dbCount * tagsPerDb rows, at most tagLimit).
+// Returns the row count.
+size_t GenerateConfig(const GeneratorOptions& options, std::ostream& out);
+
+#endif // CONFIGGENERATOR_H
@@ -0,0 +1,97 @@
+/*
+ * S7 Synthetic Configuration Generator
+ *
+ * Emits address.csv-compatible tag configurations of any size so that the
+ * server, the client and the benchmarks can be exercised far beyond the
+ * 186 rows of the shipped configuration.
+ *
+ * Usage: S7ConfigGen [--tags <n>] [--dbs <n>] [--tags-per-db <n>] [--first-db <n>]
+ *                    [--types real=40,dword=20,int=20,bool=20]
+ *                    [--cycletimes 100:10,1000:60,30000:30] [--overlap <0-1>]
+ *                    [--seed <n>] [--output <file>]
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "ConfigGenerator.h"
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --tags <n>                Total tags; DBs are added as needed (default dbs * tags-per-db)" << std::endl;
+    std::cout << "  --dbs <n>                 Number of Data Blocks (default 10)" << std::endl;
+    std::cout << "  --tags-per-db <n>         Tags per Data Block (default 100)" << std::endl;
+    std::cout << "  --first-db <n>            Number of the first DB (default 1)" << std::endl;
+    std::cout << "  --types <mix>             Type weights, e.g. real=40,dword=20,int=20,bool=20 (default)" << std::endl;
+    std::cout << "  --cycletimes <dist>       Cycletime weights in ms, e.g. 100:10,1000:60,30000:30 (default)" << std::endl;
+    std::cout << "  --overlap <fraction>      Share of tags placed inside the previous tag's bytes (default 0);" << std::endl;
+    std::cout << "                            S7Server rejects such configurations (for negative tests)" << std::endl;
+    std::cout << "  --seed <n>                Random seed; equal seeds give equal files (default 1)" << std::endl;
+    std::cout << "  --output <file>           Write to a file instead of stdout" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    std::string output;
+    long long totalTags = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            PrintUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        bool valid = true;
+        try {
+            if (arg == "--tags") totalTags = std::stoll(value);
+            else if (arg == "--dbs") options.dbCount = std::stoi(value);
+            else if (arg == "--tags-per-db") options.tagsPerDb = std::stoi(value);
+            else if (arg == "--first-db") options.firstDb = std::stoi(value);
+            else if (arg == "--types") valid = ParseTypeMix(value, options);
+            else if (arg == "--cycletimes") valid = ParseCycletimes(value, options);
+            else if (arg == "--overlap") options.overlap = std::stod(value);
+            else if (arg == "--seed") options.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--output") output = value;
+            else {
+                std::cerr << "ERROR: Unknown option " << arg << std::endl;
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } catch (...) {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "ERROR: Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.tagsPerDb <= 0 || options.dbCount <= 0 || options.firstDb < 1 || totalTags < 0 ||
+        options.overlap < 0 || options.overlap > 1) {
+        std::cerr << "ERROR: Counts must be positive, --first-db at least 1 and --overlap between 0 and 1" << std::endl;
+        return 1;
+    }
+    if (totalTags > 0) {
+        options.tagLimit = static_cast<size_t>(totalTags);
+        options.dbCount = static_cast<int>((totalTags + options.tagsPerDb - 1) / options.tagsPerDb);
+    }
+    if (options.firstDb + options.dbCount - 1 > 65535) {
+        std::cerr << "ERROR: DB numbers would exceed 65535; raise --tags-per-db" << std::endl;
+        return 1;
+    }
+
+    size_t rows;
+    if (output.empty()) {
+        rows = GenerateConfig(options, std::cout);
+    } else {
+        std::ofstream file(output);
+        if (!file.is_open()) {
+            std::cerr << "ERROR: Could not open '" << output << "' for writing" << std::endl;
+            return 1;
+        }
+        rows = GenerateConfig(options, file);
+        std::cerr << "Wrote " << rows << " tags in " << options.dbCount << " DBs to '" << output << "'" << std::endl;
+    }
+    return rows > 0 ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+/*
+* Update Engine Generator
+* Cycletime grouping and emission of the specialised engine source.
+*/
+
+#include "EngineGenerator.h"
+#include "../S7Server/GeneratedEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+// Tags of one cycletime, in table order
+struct CycletimeGroup {
+    int cycletime;
+    std::vector<uint32_t> tags;
+};
+
+// Exact C++ literal of a double (17 significant digits round-trip)
+std::string DoubleLiteral(double value) {
+    std::ostringstream text;
+    text << std::setprecision(17) << value;
+    std::string literal = text.str();
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return literal;
+}
+
+// Quoted C++ string literal
+std::string StringLiteral(const std::string& value) {
+    std::string literal = "\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            literal += '\\';
+        }
+        literal += c;
+    }
+    return literal + "\"";
+}
+
+// Key of the DB or area a tag lives in (tags with the same key share a base pointer)
+std::pair<int, int> AreaKey(const CSVConfigEntry& entry) {
+    return std::make_pair(static_cast<int>(entry.areaType), entry.areaType == AreaType::DB ? entry.dbNumber : 0);
+}
+
+std::string AreaName(const CSVConfigEntry& entry) {
+    switch (entry.areaType) {
+        case AreaType::DB: return "DB" + std::to_string(entry.dbNumber);
+        case AreaType::INPUT: return "I";
+        case AreaType::OUTPUT: return "Q";
+        case AreaType::MERKER: return "M";
+        default: return "?";
+    }
+}
+
+// Encoder of a data type (see GeneratedEngine.h) and its name in comments
+std::string EncoderName(DataType dataType) {
+    switch (dataType) {
+        case DataType::REAL: return "EncodeFixedReal";
+        case DataType::DWORD: return "EncodeFixedDWord";
+        case DataType::INT: return "EncodeFixedInt";
+        case DataType::BOOL: return "EncodeFixedBool";
+        default: return "";
+    }
+}
+
+std::string TypeName(DataType dataType) {
+    switch (dataType) {
+        case DataType::REAL: return "REAL";
+        case DataType::DWORD: return "DWORD";
+        case DataType::INT: return "INT";
+        case DataType::BOOL: return "BOOL";
+        default: return "?";
+    }
+}
+
+// Tag states as the server builds them, for the fingerprint
+std::vector<TagState> FingerprintStates(const std::vector<CSVConfigEntry>& entries) {
+    std::vector<TagState> states(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        const CSVConfigEntry& entry = entries[i];
+        TagState& state = states[i];
+        state.areaType = entry.areaType;
+        state.dbNumber = entry.dbNumber;
+        state.offset = entry.offset;
+        state.bitPosition = entry.bitPosition;
+        state.dataType = entry.dataType;
+        state.minValue = entry.minValue;
+        state.maxValue = entry.maxValue;
+        state.echelon = entry.echelon;
+        state.cycletime = entry.cycletime;
+        state.derived = !entry.expression.empty();
+    }
+    return states;
+}
+
+// Tags of a group in one DB or area with one data type, in table order
+struct TagRun {
+    std::pair<int, int> area;
+    DataType dataType;
+    std::vector<uint32_t> tags;
+};
+
+std::vector<TagRun> SplitIntoRuns(const std::vector<CSVConfigEntry>& entries, const CycletimeGroup& group) {
+    std::map<std::pair<std::pair<int, int>, int>, TagRun> byKey;
+    for (uint32_t index : group.tags) {
+        const CSVConfigEntry& entry = entries[index];
+        TagRun& run = byKey[std::make_pair(AreaKey(entry), static_cast<int>(entry.dataType))];
+        run.area = AreaKey(entry);
+        run.dataType = entry.dataType;
+        run.tags.push_back(index);
+    }
+    std::vector<TagRun> runs;
+    for (auto& run : byKey) {
+        runs.push_back(run.second);
+    }
+    return runs;
+}
+
+// Constant tables of a group's runs and the function walking them
+void EmitGroup(const std::vector<CSVConfigEntry>& entries, const CycletimeGroup& group, size_t groupIndex,
+               const std::map<std::pair<int, int>, uint32_t>& areaTags, std::ostream& out) {
+    std::vector<TagRun> runs = SplitIntoRuns(entries, group);
+    for (size_t r = 0; r < runs.size(); r++) {
+        const TagRun& run = runs[r];
+        out << "// Cycletime " << group.cycletime << " ms: " << AreaName(entries[run.tags[0]]) << " "
+            << TypeName(run.dataType) << ", " << run.tags.size() << " tags\n";
+        out << "const FixedTag GROUP" << groupIndex << "_RUN" << r << "[] = {\n";
+        for (uint32_t index : run.tags) {
+            const CSVConfigEntry& entry = entries[index];
+            out << "    {" << index << ", " << entry.offset << ", " << entry.bitPosition << ", "
+                << DoubleLiteral(entry.echelon) << ", " << DoubleLiteral(entry.minValue) << ", "
+                << DoubleLiteral(entry.maxValue) << "},\n";
+        }
+        out << "};\n\n";
+    }
+
+    out << "void UpdateGroup" << groupIndex << "(TagState* t, const GroupPass& pass) {\n";
+    for (size_t r = 0; r < runs.size(); r++) {
+        const TagRun& run = runs[r];
+        out << "    UpdateFixedTags<" << EncoderName(run.dataType) << ">(t, t[" << areaTags.at(run.area)
+            << "].dataPtr, GROUP" << groupIndex << "_RUN" << r << ", " << run.tags.size() << ", pass);\n";
+    }
+    out << "}\n\n";
+}
+
+} // namespace
+
+bool GenerateEngineSource(const std::vector<CSVConfigEntry>& entries, const std::string& configFile,
+                          std::ostream& out) {
+    // Group the sawtooth tags by cycletime; remember one tag per DB or area for its base pointer
+    std::map<int, CycletimeGroup> byCycletime;
+    std::map<std::pair<int, int>, uint32_t> areaTags;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const CSVConfigEntry& entry = entries[i];
+        areaTags.insert(std::make_pair(AreaKey(entry), static_cast<uint32_t>(i)));
+        if (!entry.expression.empty()) {
+            continue;
+        }
+        if (!std::isfinite(entry.minValue) || !std::isfinite(entry.maxValue) || !std::isfinite(entry.echelon)) {
+            std::cerr << "ERROR: Tag " << FormatTagAddress(entry.areaType, entry.dbNumber, entry.offset,
+                                                           entry.bitPosition, entry.dataType)
+                      << " has a value that is not a finite number" << std::endl;
+            return false;
+        }
+        CycletimeGroup& group = byCycletime[entry.cycletime];
+        group.cycletime = entry.cycletime;
+        group.tags.push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<CycletimeGroup> groups;
+    for (auto& group : byCycletime) {
+        groups.push_back(group.second);
+    }
+    uint64_t fingerprint = TagTableFingerprint(FingerprintStates(entries));
+
+    out << "// Update engine generated by S7EngineGen from " << configFile << " -- do not edit.\n";
+    out << "// " << entries.size() << " tags, " << groups.size() << " cycletime groups.\n\n";
+    out << "#include \"GeneratedEngine.h\"\n\n";
+    out << "namespace {\n\n";
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        EmitGroup(entries, groups[g], g, areaTags, out);
+    }
+
+    out << "void UpdateTagValuesGenerated(S7Object server, std::vector<TagState>& tagStates,\n"
+        << "                               std::vector<DataBlock>& dataBlocks, const ServerOptions& options,\n"
+        << "                               DerivedTagGraph* derivedTags, SchedulerStats* schedulerStats,\n"
+        << "                               std::chrono::steady_clock::time_point now, DirtyTracker* dirty,\n"
+        << "                               ValueExporter* exporter) {\n";
+    out << "    auto producedAt = std::chrono::system_clock::now();\n";
+    out << "    TagState* t = tagStates.data();\n";
+    out << "    GroupPass pass;\n";
+    out << "    pass.derivedTags = derivedTags;\n";
+    out << "    pass.schedulerStats = schedulerStats;\n";
+    out << "    pass.dirty = dirty;\n";
+    out << "    pass.exporter = exporter;\n";
+    for (size_t g = 0; g < groups.size(); g++) {
+        const CycletimeGroup& group = groups[g];
+        out << "\n    // Cycletime " << group.cycletime << " ms, " << group.tags.size() << " tags\n";
+        out << "    if (GroupDue(" << group.cycletime << ", t[" << group.tags[0] << "].lastUpdateTime, now, pass)) {\n";
+        out << "        UpdateGroup" << g << "(t, pass);\n";
+        out << "    }\n";
+    }
+    out << "\n    FinishTagUpdatePass(server, tagStates, dataBlocks, options, derivedTags, producedAt, dirty, exporter);\n";
+    out << "}\n\n";
+    out << "} // namespace\n\n";
+
+    out << "const GeneratedEngineInfo GeneratedTagEngine = {\n";
+    out << "    " << StringLiteral(configFile) << ",\n";
+    out << "    " << entries.size() << ",\n";
+    out << "    " << groups.size() << ",\n";
+    out << "    0x" << std::hex << fingerprint << std::dec << "ULL,\n";
+    out << "    UpdateTagValuesGenerated\n";
+    out << "};\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,25 @@
+/*
+* Update Engine Generator
+*
+* Turns a fixed tag table into the C++ source of a specialised update
+* engine (see S7Server/GeneratedEngine.h): tags are grouped by cycletime,
+* each group is split into runs of one DB or area and one data type, and
+* every run becomes a constant table of offsets, ranges and steps encoded
+* with the codec of its type. Derived tags are left to the derived-tag
+* graph, as in UpdateTagValues.
+*/
+
+#ifndef ENGINEGENERATOR_H
+#define ENGINEGENERATOR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../S7Server/TagConfig.h"
+
+// Write the engine source for 'entries' (loaded from 'configFile', which is recorded
+// in the engine). Returns false if a value cannot be written as a C++ constant.
+bool GenerateEngineSource(const std::vector<CSVConfigEntry>& entries, const std::string& configFile,
+                          std::ostream& out);
+
+#endif // ENGINEGENERATOR_H
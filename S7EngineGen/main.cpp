@@ -0,0 +1,60 @@
+/*
+ * S7 Update Engine Generator
+ *
+ * Build-time tool behind the CMake option S7SIM_GENERATED_ENGINE: reads a
+ * tag table in address.csv format and writes the C++ source of an update
+ * engine specialised for it (see S7Server/GeneratedEngine.h).
+ *
+ * Usage: S7EngineGen [--config <file>] [--output <file>]
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "EngineGenerator.h"
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --config <file>   Tag table in address.csv format (default address.csv)" << std::endl;
+    std::cout << "  --output <file>   Generated source (default GeneratedEngine.cpp)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string config = "address.csv";
+    std::string output = "GeneratedEngine.cpp";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            PrintUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--config") config = value;
+        else if (arg == "--output") output = value;
+        else {
+            std::cerr << "ERROR: Unknown option " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<CSVConfigEntry> entries = LoadCSVConfig(config);
+    if (entries.empty()) {
+        std::cerr << "ERROR: No tags in '" << config << "'" << std::endl;
+        return 1;
+    }
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open '" << output << "' for writing" << std::endl;
+        return 1;
+    }
+    if (!GenerateEngineSource(entries, config, file)) {
+        file.close();
+        std::remove(output.c_str());
+        return 1;
+    }
+    std::cout << "Wrote the update engine for " << entries.size() << " tags to '" << output << "'" << std::endl;
+    return 0;
+}
@@ -0,0 +1,538 @@
+/*
+ * S7 Proxy (Connection Multiplexer with Shared Read Cache)
+ * Using Snap7 Library
+ *
+ * Accepts many downstream S7 connections (Node-RED, SCADA, S7Client) and
+ * serves them from a single upstream connection to a real PLC or to the
+ * S7Server simulator.
+ *
+ * Features:
+ * - Shared read cache keyed by (area, DB, start, size, wordlen), bounded
+ *   and evicting blocks nobody asked for recently
+ * - Configurable freshness TTL for cached block reads
+ * - Blocks consumers keep reading are refreshed by an upstream thread, so
+ *   they are served from the cache without waiting for the PLC
+ * - Write pass-through with invalidation of overlapping cache entries
+ * - Automatic upstream reconnection, rate-limited, from the refresh thread
+ *
+ * Snap7 calls the RW area callback for one request at a time, so anything
+ * the callback waits for stalls every downstream client. It only touches
+ * the PLC for a block that is not cached yet (or went stale because the
+ * refresh fell behind) and for writes, and never dials: while the upstream
+ * link is down those requests fail immediately.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cstring>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include "../S7Server/snap7/snap7.h"
+
+bool ProxyRunning = true;
+
+// Proxy configuration (command line)
+struct ProxyOptions {
+    std::string upstreamIP = "127.0.0.1";
+    int rack = 0;
+    int slot = 0;
+    int upstreamPort = 102;
+    int listenPort = 102;
+    int cacheTtlMs = 100;     // Maximum age of a cached block served downstream
+    int pduSize = 960;        // PDU requested upstream and offered downstream
+};
+
+// Upstream reconnect attempts are at least this far apart
+const int PROXY_RECONNECT_MS = 2000;
+
+// Blocks not read downstream for this long are no longer refreshed and are evicted
+const int PROXY_IDLE_EVICT_MS = 10000;
+
+// Most blocks cached at once; reads of further blocks are served uncached
+const size_t PROXY_CACHE_MAX_ENTRIES = 4096;
+
+// Key identifying an upstream read: S7 area code, DB number, start, size, word length
+typedef std::tuple<int, int, int, int, int> CacheKey;
+
+// One cached upstream block read
+struct CacheEntry {
+    std::vector<byte> data;
+    std::chrono::steady_clock::time_point fetchedAt;
+    std::chrono::steady_clock::time_point requestedAt;  // Last downstream read
+    std::chrono::steady_clock::time_point invalidatedAt;  // Last overlapping write
+    bool valid = false;       // data holds a successful upstream read
+};
+
+// Proxy counters, printed with the periodic status
+struct ProxyStats {
+    std::atomic<uint64_t> downstreamReads{0};
+    std::atomic<uint64_t> cacheHits{0};
+    std::atomic<uint64_t> upstreamReads{0};  // Reads of uncached or stale blocks, in the callback
+    std::atomic<uint64_t> refreshes{0};      // Reads of the refresh thread
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> uncachedReads{0};  // Served while the cache was full
+    std::atomic<uint64_t> upstreamErrors{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> reconnects{0};
+};
+
+// Single upstream connection shared by all downstream clients.
+// Snap7 client objects are not thread safe, so every request is serialised.
+// Transfers never dial: only MaintainConnection (refresh thread) reconnects.
+class UpstreamLink {
+public:
+    explicit UpstreamLink(const ProxyOptions& options) : options_(options) {
+        client_ = Cli_Create();
+        Cli_SetParam(client_, p_u16_RemotePort, &options_.upstreamPort);
+        Cli_SetParam(client_, p_i32_PDURequest, &options_.pduSize);
+    }
+
+    ~UpstreamLink() {
+        Cli_Disconnect(client_);
+        Cli_Destroy(&client_);
+    }
+
+    int Connect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ConnectLocked();
+    }
+
+    // Reconnect a dropped link, at most once every PROXY_RECONNECT_MS
+    void MaintainConnection() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (connected_ || now < nextConnectAttempt_) {
+            return;
+        }
+        if (ConnectLocked() == 0) {
+            if (reconnectCounter) (*reconnectCounter)++;
+        } else {
+            nextConnectAttempt_ = now + std::chrono::milliseconds(PROXY_RECONNECT_MS);
+        }
+    }
+
+    int Read(int area, int dbNumber, int start, int amount, int wordLen, void* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Transfer(false, area, dbNumber, start, amount, wordLen, buffer);
+    }
+
+    int Write(int area, int dbNumber, int start, int amount, int wordLen, void* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Transfer(true, area, dbNumber, start, amount, wordLen, buffer);
+    }
+
+    int NegotiatedPdu() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int requested = 0, negotiated = 0;
+        Cli_GetPduLength(client_, &requested, &negotiated);
+        return negotiated;
+    }
+
+    std::atomic<uint64_t>* reconnectCounter = nullptr;
+
+private:
+    int ConnectLocked() {
+        int result = Cli_ConnectTo(client_, options_.upstreamIP.c_str(), options_.rack, options_.slot);
+        connected_ = (result == 0);
+        return result;
+    }
+
+    // Performs one upstream transfer; fails at once while the link is down
+    int Transfer(bool write, int area, int dbNumber, int start, int amount, int wordLen, void* buffer) {
+        if (!connected_) {
+            return errLibInvalidObject;
+        }
+        int result = write
+            ? Cli_WriteArea(client_, area, dbNumber, start, amount, wordLen, buffer)
+            : Cli_ReadArea(client_, area, dbNumber, start, amount, wordLen, buffer);
+
+        // Only TCP/ISO level errors (low word is zero) mean the link is gone;
+        // S7 level errors (e.g. address out of range) are passed through.
+        if (result != 0 && (result & 0xFFFF) == 0) {
+            Cli_Disconnect(client_);
+            connected_ = false;
+        }
+        return result;
+    }
+
+    ProxyOptions options_;
+    S7Object client_ = 0;
+    bool connected_ = false;
+    std::chrono::steady_clock::time_point nextConnectAttempt_;
+    std::mutex mutex_;
+};
+
+// Shared proxy state handed to the Snap7 callback
+struct ProxyContext {
+    ProxyOptions options;
+    UpstreamLink* upstream = nullptr;
+    std::map<CacheKey, CacheEntry> cache;
+    std::mutex cacheMutex;
+    ProxyStats stats;
+};
+
+// Signal handler for graceful shutdown
+void SignalHandler(int /*signal*/) {
+    std::cout << "\nShutdown signal received. Stopping proxy..." << std::endl;
+    ProxyRunning = false;
+}
+
+// Translates a downstream tag into the word length and amount used upstream.
+// PTag->Size is always in bytes; counters and timers are 2 bytes per element.
+void UpstreamAmount(const TS7Tag& tag, int& wordLen, int& amount) {
+    if (tag.WordLen == S7WLBit) {
+        wordLen = S7WLBit;
+        amount = 1;
+    } else if (tag.Area == S7AreaCT || tag.Area == S7AreaTM) {
+        wordLen = (tag.Area == S7AreaCT) ? S7WLCounter : S7WLTimer;
+        amount = tag.Size / 2;
+    } else {
+        wordLen = S7WLByte;
+        amount = tag.Size;
+    }
+}
+
+// Marks every cached entry overlapping a written range as stale
+void InvalidateOverlapping(ProxyContext& ctx, const TS7Tag& tag) {
+    std::lock_guard<std::mutex> lock(ctx.cacheMutex);
+    for (auto& pair : ctx.cache) {
+        int area, dbNumber, start, size, wordLen;
+        std::tie(area, dbNumber, start, size, wordLen) = pair.first;
+        if (area != tag.Area || dbNumber != tag.DBNumber) {
+            continue;
+        }
+        // Bit addresses are expressed in bits; compare everything in bits
+        int entryFirst = (wordLen == S7WLBit) ? start : start * 8;
+        int entryLast = (wordLen == S7WLBit) ? start : (start + size) * 8 - 1;
+        int writeFirst = (tag.WordLen == S7WLBit) ? tag.Start : tag.Start * 8;
+        int writeLast = (tag.WordLen == S7WLBit) ? tag.Start : (tag.Start + tag.Size) * 8 - 1;
+        if (entryFirst <= writeLast && writeFirst <= entryLast) {
+            pair.second.valid = false;
+            pair.second.invalidatedAt = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+// Reads the block of 'key' upstream into 'buffer' (sized to the block)
+int ReadUpstream(ProxyContext& ctx, const CacheKey& key, std::vector<byte>& buffer) {
+    TS7Tag tag;
+    std::tie(tag.Area, tag.DBNumber, tag.Start, tag.Size, tag.WordLen) = key;
+    int wordLen, amount;
+    UpstreamAmount(tag, wordLen, amount);
+    int result = ctx.upstream->Read(tag.Area, tag.DBNumber, tag.Start, amount, wordLen, buffer.data());
+    if (result != 0) {
+        ctx.stats.upstreamErrors++;
+    }
+    return result;
+}
+
+// Stores an upstream read started at 'started' unless a write invalidated the
+// block since (the read may predate the write); caller holds cacheMutex
+void StoreRead(CacheEntry& entry, std::vector<byte>& buffer, std::chrono::steady_clock::time_point started) {
+    if (entry.invalidatedAt >= started) {
+        return;
+    }
+    entry.data.swap(buffer);
+    entry.fetchedAt = started;
+    entry.valid = true;
+}
+
+// Serves a downstream read from the cache; only a block that is not cached
+// (or no longer fresh) is read upstream here, everything else is kept fresh
+// by the refresh thread
+int ServeRead(ProxyContext& ctx, const TS7Tag& tag, void* pUsrData) {
+    ctx.stats.downstreamReads++;
+    CacheKey key(tag.Area, tag.DBNumber, tag.Start, tag.Size, tag.WordLen);
+    const auto ttl = std::chrono::milliseconds(ctx.options.cacheTtlMs);
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(ctx.cacheMutex);
+    auto it = ctx.cache.find(key);
+    if (it == ctx.cache.end() && ctx.cache.size() < PROXY_CACHE_MAX_ENTRIES) {
+        it = ctx.cache.emplace(key, CacheEntry()).first;
+    }
+    if (it != ctx.cache.end()) {
+        CacheEntry& entry = it->second;  // std::map references stay valid
+        entry.requestedAt = now;
+        if (entry.valid && now - entry.fetchedAt < ttl) {
+            memcpy(pUsrData, entry.data.data(), tag.Size);
+            ctx.stats.cacheHits++;
+            return 0;
+        }
+    } else {
+        ctx.stats.uncachedReads++;
+    }
+    lock.unlock();
+
+    std::vector<byte> buffer(tag.Size);
+    int result = ReadUpstream(ctx, key, buffer);
+    ctx.stats.upstreamReads++;
+    if (result != 0) {
+        return result;
+    }
+    memcpy(pUsrData, buffer.data(), tag.Size);
+
+    lock.lock();
+    it = ctx.cache.find(key);  // The refresh thread may have evicted it meanwhile
+    if (it != ctx.cache.end()) {
+        StoreRead(it->second, buffer, now);
+    }
+    return 0;
+}
+
+// Refresh thread: keeps the blocks consumers read fresh (re-read once they are
+// half a TTL old), evicts blocks nobody read for PROXY_IDLE_EVICT_MS and
+// reconnects a dropped upstream link
+void RefreshLoop(ProxyContext* ctx) {
+    const auto ttl = std::chrono::milliseconds(ctx->options.cacheTtlMs);
+    const auto interval = std::max(std::chrono::milliseconds(10), ttl / 4);
+    const auto idle = std::chrono::milliseconds(PROXY_IDLE_EVICT_MS);
+    std::vector<CacheKey> due;
+    while (ProxyRunning) {
+        ctx->upstream->MaintainConnection();
+
+        auto now = std::chrono::steady_clock::now();
+        due.clear();
+        {
+            std::lock_guard<std::mutex> lock(ctx->cacheMutex);
+            for (auto it = ctx->cache.begin(); it != ctx->cache.end();) {
+                if (now - it->second.requestedAt >= idle) {
+                    it = ctx->cache.erase(it);
+                    ctx->stats.evictions++;
+                    continue;
+                }
+                if (!it->second.valid || now - it->second.fetchedAt >= ttl / 2) {
+                    due.push_back(it->first);
+                }
+                ++it;
+            }
+        }
+
+        for (const auto& key : due) {
+            if (!ProxyRunning) {
+                break;
+            }
+            std::vector<byte> buffer(static_cast<size_t>(std::get<3>(key)));
+            auto started = std::chrono::steady_clock::now();
+            int result = ReadUpstream(*ctx, key, buffer);
+            ctx->stats.refreshes++;
+            if (result != 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(ctx->cacheMutex);
+            auto it = ctx->cache.find(key);
+            if (it != ctx->cache.end()) {
+                StoreRead(it->second, buffer, started);
+            }
+        }
+
+        std::this_thread::sleep_until(now + interval);
+    }
+}
+
+// Read/Write area callback: with this callback registered Snap7 runs "resourceless"
+// and delegates every downstream read and write to the proxy.
+int S7API ProxyRWAreaCallback(void* usrPtr, int /*Sender*/, int Operation, PS7Tag PTag, void* pUsrData) {
+    ProxyContext& ctx = *static_cast<ProxyContext*>(usrPtr);
+
+    if (Operation == OperationRead) {
+        return ServeRead(ctx, *PTag, pUsrData);
+    }
+
+    // Writes go straight upstream, then overlapping cache entries are invalidated
+    int wordLen, amount;
+    UpstreamAmount(*PTag, wordLen, amount);
+    int result = ctx.upstream->Write(PTag->Area, PTag->DBNumber, PTag->Start, amount, wordLen, pUsrData);
+    ctx.stats.writes++;
+    if (result != 0) {
+        ctx.stats.upstreamErrors++;
+    }
+    InvalidateOverlapping(ctx, *PTag);
+    return result;
+}
+
+// Event callback: only connection level events are logged
+void S7API ProxyEventCallback(void* /*usrPtr*/, PSrvEvent PEvent, int /*Size*/) {
+    switch (PEvent->EvtCode) {
+        case evcServerStarted:
+            std::cout << "[EVENT] Proxy listener started" << std::endl;
+            break;
+        case evcServerStopped:
+            std::cout << "[EVENT] Proxy listener stopped" << std::endl;
+            break;
+        case evcClientAdded:
+            std::cout << "[EVENT] Downstream client connected" << std::endl;
+            break;
+        case evcClientDisconnected:
+            std::cout << "[EVENT] Downstream client disconnected" << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+// Display proxy status and cache statistics
+void DisplayStatus(S7Object Server, ProxyContext& ctx) {
+    int ServerStatus, CpuStatus, ClientsCount;
+    if (Srv_GetStatus(Server, &ServerStatus, &CpuStatus, &ClientsCount) == 0) {
+        std::cout << "Proxy Status: " << (ServerStatus == 1 ? "RUNNING" : "STOPPED")
+                  << ", Downstream Clients: " << ClientsCount << std::endl;
+    }
+
+    size_t entries;
+    {
+        std::lock_guard<std::mutex> lock(ctx.cacheMutex);
+        entries = ctx.cache.size();
+    }
+    uint64_t reads = ctx.stats.downstreamReads;
+    uint64_t upstream = ctx.stats.upstreamReads + ctx.stats.refreshes;
+    std::cout << "  Downstream reads: " << reads
+              << ", cache hits: " << ctx.stats.cacheHits
+              << ", upstream reads: " << ctx.stats.upstreamReads
+              << ", refreshes: " << ctx.stats.refreshes << std::endl;
+    std::cout << "  Writes: " << ctx.stats.writes
+              << ", upstream errors: " << ctx.stats.upstreamErrors
+              << ", reconnects: " << ctx.stats.reconnects
+              << ", cache entries: " << entries << " (max " << PROXY_CACHE_MAX_ENTRIES << ")"
+              << ", evictions: " << ctx.stats.evictions
+              << ", uncached reads: " << ctx.stats.uncachedReads << std::endl;
+    if (reads > 0) {
+        std::cout << "  Upstream load factor: " << (100.0 * upstream / reads) << "% of downstream reads" << std::endl;
+    }
+}
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --upstream <ip>       Upstream PLC or simulator address (default 127.0.0.1)" << std::endl;
+    std::cout << "  --rack <n>            Upstream rack (default 0)" << std::endl;
+    std::cout << "  --slot <n>            Upstream slot (default 0)" << std::endl;
+    std::cout << "  --upstream-port <n>   Upstream port (default 102)" << std::endl;
+    std::cout << "  --port <n>            Local listening port (default 102)" << std::endl;
+    std::cout << "  --ttl <ms>            Cache freshness TTL in milliseconds (default 100)" << std::endl;
+    std::cout << "  --pdu <bytes>         PDU size requested upstream/offered downstream (default 960)" << std::endl;
+}
+
+// Parse command line options; returns false on invalid input
+bool ParseCommandLine(int argc, char* argv[], ProxyOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "ERROR: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--upstream") options.upstreamIP = value;
+            else if (arg == "--rack") options.rack = std::stoi(value);
+            else if (arg == "--slot") options.slot = std::stoi(value);
+            else if (arg == "--upstream-port") options.upstreamPort = std::stoi(value);
+            else if (arg == "--port") options.listenPort = std::stoi(value);
+            else if (arg == "--ttl") options.cacheTtlMs = std::stoi(value);
+            else if (arg == "--pdu") options.pduSize = std::stoi(value);
+            else {
+                std::cerr << "ERROR: Unknown option " << arg << std::endl;
+                return false;
+            }
+        } catch (...) {
+            std::cerr << "ERROR: Invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "========================================" << std::endl;
+    std::cout << "S7 Proxy (Snap7)" << std::endl;
+    std::cout << "Connection Multiplexer with Shared Read Cache" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+
+    ProxyContext ctx;
+    if (!ParseCommandLine(argc, argv, ctx.options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, SignalHandler);
+    signal(SIGTERM, SignalHandler);
+
+    std::cout << "Upstream: " << ctx.options.upstreamIP << ":" << ctx.options.upstreamPort
+              << " (Rack " << ctx.options.rack << ", Slot " << ctx.options.slot << ")" << std::endl;
+    std::cout << "Cache TTL: " << ctx.options.cacheTtlMs << " ms" << std::endl;
+
+    // Connect upstream first so configuration errors show up immediately
+    UpstreamLink upstream(ctx.options);
+    upstream.reconnectCounter = &ctx.stats.reconnects;
+    ctx.upstream = &upstream;
+    int result = upstream.Connect();
+    if (result != 0) {
+        char errorText[256];
+        Cli_ErrorText(result, errorText, 256);
+        std::cerr << "WARNING: Upstream not reachable yet (" << errorText << "). Retrying every "
+                  << PROXY_RECONNECT_MS << " ms." << std::endl;
+    } else {
+        std::cout << "Upstream connected, PDU negotiated: " << upstream.NegotiatedPdu() << " bytes" << std::endl;
+    }
+
+    S7Object server = Srv_Create();
+    if (!server) {
+        std::cerr << "ERROR: Failed to create server instance!" << std::endl;
+        return 1;
+    }
+
+    if (ctx.options.listenPort != 102) {
+        Srv_SetParam(server, p_u16_LocalPort, &ctx.options.listenPort);
+    }
+    Srv_SetParam(server, p_i32_PDURequest, &ctx.options.pduSize);
+
+    // No areas are registered: the RW callback makes the server resourceless
+    Srv_SetRWAreaCallback(server, ProxyRWAreaCallback, &ctx);
+    Srv_SetEventsCallback(server, ProxyEventCallback, &ctx);
+    Srv_SetMask(server, mkEvent, evcServerStarted | evcServerStopped | evcClientAdded | evcClientDisconnected);
+    Srv_SetMask(server, mkLog, 0x00000000);
+
+    std::cout << "Starting proxy on port " << ctx.options.listenPort << "..." << std::endl;
+    result = Srv_Start(server);
+    if (result != 0) {
+        char errorText[256];
+        Srv_ErrorText(result, errorText, 256);
+        std::cerr << "ERROR: Failed to start proxy: " << errorText << std::endl;
+        Srv_Destroy(&server);
+        return 1;
+    }
+
+    std::thread refresher(RefreshLoop, &ctx);
+
+    std::cout << "\n*** Proxy started successfully! ***" << std::endl;
+    std::cout << "Press Ctrl+C to stop.\n" << std::endl;
+
+    auto lastStatusTime = std::chrono::steady_clock::now();
+    const auto statusInterval = std::chrono::seconds(30);
+    while (ProxyRunning) {
+        auto currentTime = std::chrono::steady_clock::now();
+        if (currentTime - lastStatusTime >= statusInterval) {
+            DisplayStatus(server, ctx);
+            lastStatusTime = currentTime;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    std::cout << "\nStopping proxy..." << std::endl;
+    DisplayStatus(server, ctx);
+    Srv_Stop(server);
+    refresher.join();
+    Srv_Destroy(&server);
+
+    std::cout << "Proxy stopped successfully. Goodbye!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+* Address Index
+* Interval trees per area and DB, lookups and tag overlap validation.
+*/
+
+#include "AddressIndex.h"
+#include "TagEngine.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+namespace {
+
+uint64_t AreaKey(int areaCode, int dbNumber) {
+    return (static_cast<uint64_t>(areaCode) << 32) | static_cast<uint32_t>(areaCode == EVENT_AREA_DB ? dbNumber : 0);
+}
+
+int BuildTree(AddressTree& tree, size_t lo, size_t hi) {
+    if (lo >= hi) {
+        return INT_MIN;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    tree.maxEnd[mid] = std::max(tree.ranges[mid].end, std::max(BuildTree(tree, lo, mid), BuildTree(tree, mid + 1, hi)));
+    return tree.maxEnd[mid];
+}
+
+void QueryTree(const AddressTree& tree, size_t lo, size_t hi, int start, int end,
+               std::vector<const AddressRange*>& ranges) {
+    if (lo >= hi) {
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    if (tree.maxEnd[mid] <= start) {
+        return;  // Everything in this subtree ends before the query
+    }
+    QueryTree(tree, lo, mid, start, end, ranges);
+    const AddressRange& range = tree.ranges[mid];
+    if (range.start >= end) {
+        return;  // This range and the right subtree start after the query
+    }
+    if (range.end > start) {
+        ranges.push_back(&range);
+    }
+    QueryTree(tree, mid + 1, hi, start, end, ranges);
+}
+
+// Size of the area a tag lives in (DBs are sized to their tags, up to the 16-bit address limit)
+int AreaLimit(AreaType areaType, const AreaSizes& sizes) {
+    switch (areaType) {
+        case AreaType::INPUT: return sizes.inputs;
+        case AreaType::OUTPUT: return sizes.outputs;
+        case AreaType::MERKER: return sizes.flags;
+        default: return MAX_AREA_SIZE;
+    }
+}
+
+std::string EntryAddress(const CSVConfigEntry& entry) {
+    return FormatTagAddress(entry.areaType, entry.dbNumber, entry.offset, entry.bitPosition, entry.dataType);
+}
+
+} // namespace
+
+int EventAreaCode(AreaType areaType) {
+    switch (areaType) {
+        case AreaType::INPUT: return EVENT_AREA_INPUT;
+        case AreaType::OUTPUT: return EVENT_AREA_OUTPUT;
+        case AreaType::MERKER: return EVENT_AREA_MERKER;
+        default: return EVENT_AREA_DB;
+    }
+}
+
+void AddAddressRange(AddressIndex& index, int areaCode, int dbNumber, int start, int size, int bitPosition, size_t id) {
+    AddressRange range;
+    range.start = start;
+    range.end = start + size;
+    range.bitPosition = bitPosition;
+    range.id = id;
+    index.trees[AreaKey(areaCode, dbNumber)].ranges.push_back(range);
+    index.rangeCount++;
+}
+
+void FinalizeAddressIndex(AddressIndex& index) {
+    for (auto& area : index.trees) {
+        AddressTree& tree = area.second;
+        std::sort(tree.ranges.begin(), tree.ranges.end(), [](const AddressRange& a, const AddressRange& b) {
+            if (a.start != b.start) return a.start < b.start;
+            if (a.end != b.end) return a.end < b.end;
+            return a.id < b.id;
+        });
+        tree.maxEnd.assign(tree.ranges.size(), INT_MIN);
+        BuildTree(tree, 0, tree.ranges.size());
+    }
+}
+
+void FindAddressRanges(const AddressIndex& index, int areaCode, int dbNumber, int start, int size,
+                       std::vector<const AddressRange*>& ranges) {
+    auto area = index.trees.find(AreaKey(areaCode, dbNumber));
+    if (area == index.trees.end() || size <= 0) {
+        return;
+    }
+    QueryTree(area->second, 0, area->second.ranges.size(), start, start + size, ranges);
+}
+
+bool BuildTagAddressIndex(const std::vector<CSVConfigEntry>& entries, const AreaSizes& sizes, AddressIndex& index) {
+    index = AddressIndex();
+    size_t conflicts = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const CSVConfigEntry& entry = entries[i];
+        int size = GetTypeSize(entry.dataType);
+        int limit = AreaLimit(entry.areaType, sizes);
+        if (entry.offset < 0 || entry.offset + size > limit) {
+            if (++conflicts <= ADDRESS_CONFLICT_REPORT_LIMIT) {
+                std::cerr << "ERROR: Tag " << EntryAddress(entry) << " lies outside its " << limit
+                          << " byte area" << std::endl;
+            }
+            continue;
+        }
+        AddAddressRange(index, EventAreaCode(entry.areaType), entry.dbNumber, entry.offset, size,
+                        entry.dataType == DataType::BOOL ? entry.bitPosition : -1, i);
+    }
+    FinalizeAddressIndex(index);
+
+    // Ranges are sorted, so every overlap is found by looking ahead from its first tag
+    for (const auto& area : index.trees) {
+        const std::vector<AddressRange>& ranges = area.second.ranges;
+        for (size_t a = 0; a < ranges.size(); a++) {
+            for (size_t b = a + 1; b < ranges.size() && ranges[b].start < ranges[a].end; b++) {
+                bool distinctBits = ranges[a].bitPosition >= 0 && ranges[b].bitPosition >= 0 &&
+                                    ranges[a].bitPosition != ranges[b].bitPosition;
+                if (distinctBits) {
+                    continue;
+                }
+                if (++conflicts <= ADDRESS_CONFLICT_REPORT_LIMIT) {
+                    std::cerr << "ERROR: Tags " << EntryAddress(entries[ranges[a].id]) << " and "
+                              << EntryAddress(entries[ranges[b].id]) << " overlap" << std::endl;
+                }
+            }
+        }
+    }
+    if (conflicts > ADDRESS_CONFLICT_REPORT_LIMIT) {
+        std::cerr << "ERROR: ... and " << (conflicts - ADDRESS_CONFLICT_REPORT_LIMIT) << " more address conflicts"
+                  << std::endl;
+    }
+    return conflicts == 0;
+}
@@ -0,0 +1,74 @@
+/*
+* Address Index
+*
+* Maps a request range (area, DB, start, size) back to the tags or other
+* configured addresses it covers, for request logging and write reactions.
+* Ranges are grouped per area and DB into a static interval tree: sorted by
+* start and laid out as an implicit balanced tree that stores the largest
+* end of every subtree, so a lookup costs O(log n + k). The index is built
+* once at start-up and only read afterwards, so the Snap7 threads may query
+* it concurrently.
+*
+* Building the tag index also validates the configuration: tags that share a
+* byte (other than BOOLs on different bits of it) and tags outside their area
+* would silently corrupt each other and are rejected.
+*/
+
+#ifndef ADDRESSINDEX_H
+#define ADDRESSINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "TagConfig.h"
+
+struct AreaSizes;
+
+// S7 area codes reported in server events (EvtParam1)
+const int EVENT_AREA_INPUT = 0x81;
+const int EVENT_AREA_OUTPUT = 0x82;
+const int EVENT_AREA_MERKER = 0x83;
+const int EVENT_AREA_DB = 0x84;
+
+// Conflicts reported in full before the rest are only counted
+const size_t ADDRESS_CONFLICT_REPORT_LIMIT = 20;
+
+// Bytes [start, end) of one area occupied by an indexed item
+struct AddressRange {
+    int start;
+    int end;
+    int bitPosition;  // BOOL bit (0-7), -1 for whole bytes
+    size_t id;        // Caller's index of the item
+};
+
+// Ranges of one area or DB: sorted by start, maxEnd[i] is the largest end in the
+// subtree rooted at i (the middle of its slice)
+struct AddressTree {
+    std::vector<AddressRange> ranges;
+    std::vector<int> maxEnd;
+};
+
+struct AddressIndex {
+    std::unordered_map<uint64_t, AddressTree> trees;  // (area code, DB) -> ranges
+    size_t rangeCount = 0;
+};
+
+// Event area code of an address.csv area (EVENT_AREA_DB for DBs)
+int EventAreaCode(AreaType areaType);
+
+// Add bytes [start, start + size) of an area under 'id'; call FinalizeAddressIndex when done
+void AddAddressRange(AddressIndex& index, int areaCode, int dbNumber, int start, int size, int bitPosition, size_t id);
+
+// Sort the ranges and build the trees
+void FinalizeAddressIndex(AddressIndex& index);
+
+// Append the ranges sharing a byte with [start, start + size) to 'ranges', in address order
+void FindAddressRanges(const AddressIndex& index, int areaCode, int dbNumber, int start, int size,
+                       std::vector<const AddressRange*>& ranges);
+
+// Index every configuration entry under its position in 'entries'. Overlapping tags
+// and tags outside their area (I/Q/M sizes, 64 KB for DBs) are reported as errors;
+// returns false if there were any.
+bool BuildTagAddressIndex(const std::vector<CSVConfigEntry>& entries, const AreaSizes& sizes, AddressIndex& index);
+
+#endif // ADDRESSINDEX_H
@@ -0,0 +1,207 @@
+/*
+* Client Admission Control
+* Token buckets per client address and the connection monitor.
+*/
+
+#include "ClientLimits.h"
+#include "SocketUtil.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Clients listed in full by DisplayClientLimitStats
+const size_t CLIENT_REPORT_LIMIT = 20;
+
+typedef std::tuple<SocketHandle, uint32_t, int> ConnectionKey;  // Socket, peer address, peer port
+
+ConnectionKey KeyOf(const AcceptedConnection& connection) {
+    return std::make_tuple(connection.socket, connection.peerAddress, connection.peerPort);
+}
+
+void RefillBuckets(const ClientLimiter& limiter, ClientState& client, std::chrono::steady_clock::time_point now) {
+    const double requestBurst = std::max(limiter.requestRate, 1.0);
+    const double byteBurst = std::max(limiter.byteRate, 1.0);
+    if (client.refilledAt == std::chrono::steady_clock::time_point()) {
+        client.requestTokens = requestBurst;
+        client.byteTokens = byteBurst;
+    } else {
+        double seconds = std::chrono::duration<double>(now - client.refilledAt).count();
+        client.requestTokens = std::min(requestBurst, client.requestTokens + seconds * limiter.requestRate);
+        client.byteTokens = std::min(byteBurst, client.byteTokens + seconds * limiter.byteRate);
+    }
+    client.refilledAt = now;
+}
+
+// Drop the connections beyond the per-client cap (newest first) and the idle ones.
+// 'known' holds the connections of the previous scan, 'dropped' those already shut down.
+void CheckConnections(ClientLimiter& limiter, std::set<ConnectionKey>& known, std::set<ConnectionKey>& dropped) {
+    std::vector<AcceptedConnection> connections = AcceptedConnections(limiter.serverPort);
+    std::set<ConnectionKey> current;
+    for (const auto& connection : connections) {
+        current.insert(KeyOf(connection));
+    }
+    for (auto it = dropped.begin(); it != dropped.end();) {
+        it = current.count(*it) ? std::next(it) : dropped.erase(it);
+    }
+
+    // Connections already seen sort before new ones, so the cap keeps the established clients
+    std::stable_sort(connections.begin(), connections.end(),
+                     [&known](const AcceptedConnection& a, const AcceptedConnection& b) {
+                         return a.peerAddress < b.peerAddress ||
+                                (a.peerAddress == b.peerAddress && known.count(KeyOf(a)) > known.count(KeyOf(b)));
+                     });
+    std::vector<std::pair<uint32_t, bool>> drops;  // Client, idle (otherwise over the cap)
+    int perClient = 0;
+    uint32_t lastClient = 0;
+    for (const auto& connection : connections) {
+        if (dropped.count(KeyOf(connection))) {
+            continue;
+        }
+        perClient = (perClient > 0 && connection.peerAddress == lastClient) ? perClient + 1 : 1;
+        lastClient = connection.peerAddress;
+        bool overCap = limiter.maxConnections > 0 && perClient > limiter.maxConnections;
+        int64_t idleMs = limiter.idleTimeoutMs > 0 ? ReceiveIdleMilliseconds(connection.socket) : -1;
+        bool idle = idleMs >= limiter.idleTimeoutMs && idleMs >= 0;
+        if ((overCap || idle) && ShutdownConnection(connection.socket)) {
+            dropped.insert(KeyOf(connection));
+            drops.push_back(std::make_pair(connection.peerAddress, !overCap));
+            perClient--;
+        }
+    }
+    known.swap(current);
+
+    if (drops.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(limiter.mutex);
+    for (const auto& drop : drops) {
+        ClientState& client = limiter.clients[drop.first];
+        if (drop.second) {
+            client.evicted++;
+            std::cout << "[LIMIT] Dropped idle connection of " << FormatIPv4(drop.first) << std::endl;
+        } else {
+            client.refused++;
+            std::cout << "[LIMIT] Dropped connection of " << FormatIPv4(drop.first) << " (more than "
+                      << limiter.maxConnections << " per client)" << std::endl;
+        }
+    }
+}
+
+void MonitorLoop(ClientLimiter* limiter) {
+    std::set<ConnectionKey> known, dropped;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(limiter->wakeMutex);
+            limiter->wake.wait_for(lock, std::chrono::milliseconds(CLIENT_MONITOR_INTERVAL_MS),
+                                   [limiter] { return !limiter->running || limiter->checkPending; });
+            if (!limiter->running) {
+                return;
+            }
+            limiter->checkPending = false;
+        }
+        CheckConnections(*limiter, known, dropped);
+    }
+}
+
+} // namespace
+
+void StartClientLimits(const ServerOptions& options, ClientLimiter& limiter) {
+    limiter.requestRate = options.clientRequestRate;
+    limiter.byteRate = options.clientByteRate;
+    limiter.maxConnections = options.maxClientsPerIp;
+    limiter.idleTimeoutMs = options.idleTimeoutSec * 1000;
+    limiter.serverPort = options.port;
+
+    if (limiter.maxConnections == 0 && limiter.idleTimeoutMs == 0) {
+        return;
+    }
+#ifdef __linux__
+    limiter.running = true;
+    limiter.monitor = std::thread(MonitorLoop, &limiter);
+#else
+    std::cout << "NOTE: --max-clients-per-ip and --idle-timeout are only enforced on Linux." << std::endl;
+#endif
+}
+
+bool AdmitClientRequest(ClientLimiter& limiter, uint32_t clientAddress, int bytes) {
+    std::lock_guard<std::mutex> lock(limiter.mutex);
+    ClientState& client = limiter.clients[clientAddress];
+    RefillBuckets(limiter, client, std::chrono::steady_clock::now());
+    if ((limiter.requestRate > 0 && client.requestTokens < 1.0) || (limiter.byteRate > 0 && client.byteTokens <= 0.0)) {
+        client.throttled++;
+        return false;
+    }
+    if (limiter.requestRate > 0) {
+        client.requestTokens -= 1.0;
+    }
+    if (limiter.byteRate > 0) {
+        client.byteTokens -= bytes;
+    }
+    client.requests++;
+    client.bytes += static_cast<uint64_t>(std::max(bytes, 0));
+    return true;
+}
+
+void NoteClientConnected(ClientLimiter& limiter, uint32_t clientAddress) {
+    {
+        std::lock_guard<std::mutex> lock(limiter.mutex);
+        ClientState& client = limiter.clients[clientAddress];
+        client.connections++;
+        client.connects++;
+    }
+    if (limiter.running && limiter.maxConnections > 0) {
+        std::lock_guard<std::mutex> lock(limiter.wakeMutex);
+        limiter.checkPending = true;
+        limiter.wake.notify_one();
+    }
+}
+
+void NoteClientDisconnected(ClientLimiter& limiter, uint32_t clientAddress) {
+    std::lock_guard<std::mutex> lock(limiter.mutex);
+    auto it = limiter.clients.find(clientAddress);
+    if (it != limiter.clients.end() && it->second.connections > 0) {
+        it->second.connections--;
+    }
+}
+
+void StopClientLimits(ClientLimiter& limiter) {
+    if (!limiter.running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(limiter.wakeMutex);
+        limiter.running = false;
+    }
+    limiter.wake.notify_one();
+    if (limiter.monitor.joinable()) {
+        limiter.monitor.join();
+    }
+}
+
+void DisplayClientLimitStats(ClientLimiter& limiter) {
+    std::vector<std::pair<uint32_t, ClientState>> clients;
+    {
+        std::lock_guard<std::mutex> lock(limiter.mutex);
+        clients.assign(limiter.clients.begin(), limiter.clients.end());
+    }
+    // Busiest clients first
+    std::sort(clients.begin(), clients.end(), [](const std::pair<uint32_t, ClientState>& a,
+                                                 const std::pair<uint32_t, ClientState>& b) {
+        return a.second.requests + a.second.throttled > b.second.requests + b.second.throttled;
+    });
+    std::cout << "Client Limits: " << clients.size() << " clients" << std::endl;
+    for (size_t i = 0; i < clients.size() && i < CLIENT_REPORT_LIMIT; i++) {
+        const ClientState& client = clients[i].second;
+        std::cout << "  " << FormatIPv4(clients[i].first) << ": " << client.connections << " connected ("
+                  << client.connects << " total), " << client.requests << " requests, " << client.bytes
+                  << " bytes, " << client.throttled << " throttled, " << client.refused << " refused, "
+                  << client.evicted << " evicted idle" << std::endl;
+    }
+    if (clients.size() > CLIENT_REPORT_LIMIT) {
+        std::cout << "  ... and " << (clients.size() - CLIENT_REPORT_LIMIT) << " more clients" << std::endl;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+* Client Admission Control
+*
+* Keeps one misbehaving client from starving the others. Per client IP
+* address the server enforces:
+* - a request rate and a byte rate, each a token bucket holding one second
+*   of its rate (--client-rate, --client-bandwidth). A read or write item
+*   takes one request token and its data size in byte tokens; a large item
+*   may overdraw the byte bucket, which then has to refill first;
+* - a connection cap (--max-clients-per-ip) on top of the global one
+*   (--max-clients);
+* - an idle timeout (--idle-timeout): connections that sent nothing for
+*   that long are dropped.
+*
+* Rates are checked in the Snap7 read/write hook (see FaultInjection.h).
+* Snap7 calls the hook for one request at a time across all clients, so
+* an over-limit request is rejected at once (evrCannotHandlePDU) instead of
+* being delayed, which would hold up every other client. Connection caps
+* and idle timeouts are enforced by a monitor thread that inspects the
+* server's sockets; it needs the POSIX fd table and TCP_INFO and is only
+* available on Linux.
+*/
+
+#ifndef CLIENTLIMITS_H
+#define CLIENTLIMITS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "TagEngine.h"
+
+// How often the monitor checks connection counts and idle times
+const int CLIENT_MONITOR_INTERVAL_MS = 1000;
+
+// Limits and counters of one client address
+struct ClientState {
+    double requestTokens = 0.0;
+    double byteTokens = 0.0;
+    std::chrono::steady_clock::time_point refilledAt;
+    int connections = 0;          // Open connections (from server events)
+    uint64_t connects = 0;
+    uint64_t requests = 0;        // Admitted read/write items
+    uint64_t bytes = 0;           // Admitted data bytes
+    uint64_t throttled = 0;       // Items rejected by the request or byte rate
+    uint64_t refused = 0;         // Connections dropped by the per-IP cap
+    uint64_t evicted = 0;         // Connections dropped for being idle
+};
+
+struct ClientLimiter {
+    double requestRate = 0.0;     // Items per second per client (0: unlimited)
+    double byteRate = 0.0;        // Bytes per second per client (0: unlimited)
+    int maxConnections = 0;       // Connections per client (0: unlimited)
+    int idleTimeoutMs = 0;        // Drop connections idle this long (0: never)
+    int serverPort = 102;
+
+    std::mutex mutex;             // Guards clients
+    std::unordered_map<uint32_t, ClientState> clients;  // By IPv4 address, network byte order
+
+    std::mutex wakeMutex;
+    std::condition_variable wake; // A client connected: check the caps now
+    bool checkPending = false;
+    std::atomic<bool> running{false};
+    std::thread monitor;
+};
+
+// True if any request or byte rate is configured (the read/write hook is needed)
+inline bool ClientRatesLimited(const ServerOptions& options) {
+    return options.clientRequestRate > 0 || options.clientByteRate > 0;
+}
+
+// Take the limits from the options and start the monitor thread if a per-IP
+// cap or an idle timeout is configured (and the platform supports it)
+void StartClientLimits(const ServerOptions& options, ClientLimiter& limiter);
+
+// Read/write hook: charge one item of 'bytes' to the client. False if the
+// client is over its request or byte rate and the item must be rejected.
+bool AdmitClientRequest(ClientLimiter& limiter, uint32_t clientAddress, int bytes);
+
+// Server events: a client connected or disconnected (EvtSender)
+void NoteClientConnected(ClientLimiter& limiter, uint32_t clientAddress);
+void NoteClientDisconnected(ClientLimiter& limiter, uint32_t clientAddress);
+
+void StopClientLimits(ClientLimiter& limiter);
+
+// Print the counters of every client seen
+void DisplayClientLimitStats(ClientLimiter& limiter);
+
+#endif // CLIENTLIMITS_H
@@ -0,0 +1,521 @@
+/*
+* Control API
+* Command parsing and validation, the batch ring and the control socket with
+* one thread per connection.
+*/
+
+#include "ControlApi.h"
+#include "SocketUtil.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <sstream>
+
+namespace {
+
+const size_t DUMP_BYTES_PER_LINE = 32;
+
+std::string ToUpper(std::string text) {
+    for (auto& c : text) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// Whole-string number parsing (no trailing garbage)
+bool ParseNumber(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end && *end == '\0' && std::isfinite(value);
+}
+
+bool ParseInteger(const std::string& text, int& value) {
+    double number;
+    if (!ParseNumber(text, number) || number != std::floor(number) || number < 0 || number > 2147483647.0) {
+        return false;
+    }
+    value = static_cast<int>(number);
+    return true;
+}
+
+// Parsing state of one line: parameters changed by earlier commands of the same line
+struct BatchParser {
+    ControlApi& api;
+    std::map<uint32_t, ControlTagParams> staged;
+
+    explicit BatchParser(ControlApi& api) : api(api) {}
+
+    const ControlTagParams& Params(uint32_t tag) {
+        auto it = staged.find(tag);
+        return it != staged.end() ? it->second : api.params[tag];
+    }
+
+    // Tag index of a sawtooth tag, or an error
+    bool FindTag(const std::string& address, uint32_t& tag, std::string& error) {
+        AreaType areaType;
+        int dbNumber, offset, bitPosition;
+        DataType dataType;
+        if (address.empty() || !ParseTag(address, areaType, dbNumber, offset, bitPosition, dataType)) {
+            error = "invalid tag address '" + address + "'";
+            return false;
+        }
+        auto it = api.tagIndex.find(std::make_tuple(static_cast<int>(areaType), dbNumber, offset, bitPosition));
+        if (it == api.tagIndex.end()) {
+            error = address + " is not a simulated tag";
+            return false;
+        }
+        if (api.params[it->second].derived) {
+            error = address + " is derived from other tags";
+            return false;
+        }
+        tag = it->second;
+        return true;
+    }
+
+    bool FindDB(const std::string& text, int& dbNumber, std::string& error) {
+        std::string number = ToUpper(text).compare(0, 2, "DB") == 0 ? text.substr(2) : text;
+        if (!ParseInteger(number, dbNumber) || api.dbSizes.find(dbNumber) == api.dbSizes.end()) {
+            error = "no data block '" + text + "'";
+            return false;
+        }
+        return true;
+    }
+
+    // One command of a batch
+    bool Parse(const std::string& text, ControlCommand& command, std::string& error) {
+        std::istringstream in(text);
+        std::string word, target;
+        in >> word >> target;
+        word = ToUpper(word);
+        std::vector<std::string> args;
+        for (std::string arg; in >> arg;) {
+            args.push_back(arg);
+        }
+
+        if (word == "SET" || word == "FREEZE" || word == "UNFREEZE" || word == "PARAM") {
+            if (!FindTag(target, command.tag, error)) {
+                return false;
+            }
+            const ControlTagParams& params = Params(command.tag);
+            if (word == "SET") {
+                if (args.size() != 1 || !ParseNumber(args[0], command.value) ||
+                    !FitsDataType(params.dataType, command.value)) {
+                    error = "SET " + target + " needs one value its data type can hold";
+                    return false;
+                }
+                if (params.dataType == DataType::BOOL) {
+                    command.value = command.value != 0.0 ? 1.0 : 0.0;
+                }
+                command.op = ControlOp::SET;
+            } else if (word == "PARAM") {
+                ControlTagParams changed = params;
+                for (const auto& arg : args) {
+                    size_t eq = arg.find('=');
+                    std::string key = ToUpper(arg.substr(0, eq));
+                    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+                    bool valid = false;
+                    if (key == "MIN") valid = ParseNumber(value, changed.minValue);
+                    else if (key == "MAX") valid = ParseNumber(value, changed.maxValue);
+                    else if (key == "ECHELON") valid = ParseNumber(value, changed.echelon) && changed.echelon >= 0.0;
+                    else if (key == "CYCLETIME") valid = ParseInteger(value, changed.cycletime);
+                    if (!valid) {
+                        error = "invalid parameter '" + arg + "' (min=, max=, echelon= >= 0, cycletime= >= 0)";
+                        return false;
+                    }
+                }
+                if (args.empty() || changed.minValue > changed.maxValue ||
+                    !FitsDataType(changed.dataType, changed.minValue) || !FitsDataType(changed.dataType, changed.maxValue)) {
+                    error = "PARAM " + target + " needs a min <= max its data type can hold";
+                    return false;
+                }
+                command.op = ControlOp::PARAM;
+                command.minValue = changed.minValue;
+                command.maxValue = changed.maxValue;
+                command.echelon = changed.echelon;
+                command.cycletime = changed.cycletime;
+                staged[command.tag] = changed;
+            } else {
+                if (!args.empty()) {
+                    error = word + " takes only a tag";
+                    return false;
+                }
+                command.op = word == "FREEZE" ? ControlOp::FREEZE : ControlOp::UNFREEZE;
+            }
+            return true;
+        }
+
+        if (word == "PAUSE" || word == "RESUME" || word == "DUMP") {
+            if (!FindDB(target, command.dbNumber, error)) {
+                return false;
+            }
+            if (word != "DUMP") {
+                if (!args.empty()) {
+                    error = word + " takes only a data block";
+                    return false;
+                }
+                command.op = word == "PAUSE" ? ControlOp::PAUSE : ControlOp::RESUME;
+                return true;
+            }
+            int dbSize = api.dbSizes[command.dbNumber];
+            command.op = ControlOp::DUMP;
+            command.offset = 0;
+            if (args.size() > 2 || (args.size() >= 1 && !ParseInteger(args[0], command.offset)) ||
+                command.offset > dbSize) {
+                error = "invalid DUMP offset";
+                return false;
+            }
+            command.size = dbSize - command.offset;
+            if (args.size() == 2 && (!ParseInteger(args[1], command.size) || command.size > dbSize - command.offset)) {
+                error = "invalid DUMP size (DB" + std::to_string(command.dbNumber) + " has " +
+                        std::to_string(dbSize) + " bytes)";
+                return false;
+            }
+            return true;
+        }
+
+        error = "unknown command '" + word + "' (SET, FREEZE, UNFREEZE, PARAM, PAUSE, RESUME, DUMP, STATS)";
+        return false;
+    }
+};
+
+std::string Stats(ControlApi& api) {
+    std::ostringstream out;
+    out << "lines " << api.lines << "\n"
+        << "commands " << api.commands << "\n"
+        << "rejected " << api.rejected << "\n"
+        << "busy " << api.busy << "\n"
+        << "apply_us " << api.applyUs << "\n"
+        << "END\n";
+    return out.str();
+}
+
+// Validate a line, queue it and wait until the simulation thread applied it
+std::string HandleLine(ControlApi& api, const std::string& line) {
+    std::istringstream check(line);
+    std::string first;
+    check >> first;
+    if (ToUpper(first) == "STATS" && line.find(';') == std::string::npos) {
+        return Stats(api);
+    }
+
+    ControlReply reply;
+    std::vector<ControlCommand> batch;
+    std::string error;
+    // Parsing sees the parameters of every batch published before, and the ring one producer
+    std::unique_lock<std::mutex> producer(api.producerMutex);
+    BatchParser parser(api);
+    size_t start = 0;
+    while (start <= line.size()) {
+        size_t end = line.find(';', start);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        std::string text = line.substr(start, end - start);
+        start = end + 1;
+        if (text.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        ControlCommand command;
+        if (!parser.Parse(text, command, error)) {
+            api.rejected++;
+            return "ERROR " + error + "\n";
+        }
+        command.reply = &reply;
+        batch.push_back(command);
+    }
+    if (batch.empty()) {
+        api.rejected++;
+        return "ERROR empty command line\n";
+    }
+    if (batch.size() > CONTROL_QUEUE_CAPACITY) {
+        api.rejected++;
+        return "ERROR more than " + std::to_string(CONTROL_QUEUE_CAPACITY) + " commands in one line\n";
+    }
+    batch.back().endOfBatch = true;
+    if (!api.queue.TryPushBatch(batch)) {
+        api.busy++;
+        return "ERROR busy, try again\n";
+    }
+    for (const auto& staged : parser.staged) {
+        api.params[staged.first] = staged.second;
+    }
+    producer.unlock();
+    if (api.wake) {
+        api.wake->Wake();
+    }
+
+    std::unique_lock<std::mutex> lock(reply.mutex);
+    while (!reply.complete) {
+        if (!api.running) {
+            return "ERROR server stopping\n";  // The simulation loop has ended and never touches 'reply' again
+        }
+        reply.done.wait_for(lock, std::chrono::milliseconds(200));
+    }
+    return reply.text + "OK " + std::to_string(batch.size()) + "\n";
+}
+
+// One control connection: its lines are answered in order, one at a time
+struct ControlConnection {
+    std::thread thread;
+    std::atomic<bool> finished{false};
+};
+
+void ServeConnection(ControlApi* api, SocketHandle s, ControlConnection* connection) {
+    std::string pending, line;
+    while (api->running) {
+        if (pending.find('\n') == std::string::npos) {
+            int ready = WaitReadable(s, 200);
+            if (ready == 0) {
+                continue;
+            }
+            if (ready < 0) {
+                break;
+            }
+        }
+        if (!RecvLine(s, line, pending, CONTROL_MAX_LINE) || !SendText(s, HandleLine(*api, line))) {
+            break;
+        }
+    }
+    CloseSocket(s);
+    connection->finished = true;
+}
+
+void ControlLoop(ControlApi* api, SocketHandle listener) {
+    std::list<ControlConnection> connections;
+    while (api->running) {
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->finished) {
+                it->thread.join();
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (WaitReadable(listener, 200) <= 0) {
+            continue;
+        }
+        SocketHandle s = AcceptConnection(listener);
+        if (s == NO_SOCKET) {
+            continue;
+        }
+        if (connections.size() >= CONTROL_MAX_CONNECTIONS) {
+            SendText(s, "ERROR more than " + std::to_string(CONTROL_MAX_CONNECTIONS) + " control connections\n");
+            CloseSocket(s);
+            continue;
+        }
+        connections.emplace_back();
+        ControlConnection& connection = connections.back();
+        connection.thread = std::thread(ServeConnection, api, s, &connection);
+    }
+    // Every connection thread sees 'running' cleared within one wait
+    for (auto& connection : connections) {
+        connection.thread.join();
+    }
+    CloseSocket(listener);
+}
+
+// Write a tag's value with its area locked against concurrent client access and
+// publish it like an update
+void PublishTag(S7Object server, std::vector<TagState>& tagStates, uint32_t index, DerivedTagGraph* derivedTags,
+                DirtyTracker* dirty, ValueExporter* exporter) {
+    TagState& tag = tagStates[index];
+    int area = SrvAreaIndex(tag.areaType);
+    if (server) Srv_LockArea(server, area, tag.dbNumber);
+    WriteTagValue(tag);
+    if (server) Srv_UnlockArea(server, area, tag.dbNumber);
+    MarkTagDirty(dirty, tag);
+    if (exporter) {
+        ExportOutOfPassValue(exporter, index, ReadTagValue(tag));
+    }
+    if (derivedTags) {
+        MarkTagChanged(*derivedTags, index);
+    }
+}
+
+void DumpDB(S7Object server, const std::vector<DataBlock>& dataBlocks, const ControlCommand& command,
+            std::string& text) {
+    for (const auto& db : dataBlocks) {
+        if (db.number != command.dbNumber) {
+            continue;
+        }
+        std::vector<byte> copy(static_cast<size_t>(command.size));
+        if (server) Srv_LockArea(server, srvAreaDB, db.number);
+        if (!copy.empty()) {
+            std::memcpy(copy.data(), db.data + command.offset, copy.size());
+        }
+        if (server) Srv_UnlockArea(server, srvAreaDB, db.number);
+
+        char hex[3];
+        for (size_t i = 0; i < copy.size(); i += DUMP_BYTES_PER_LINE) {
+            text += "DB" + std::to_string(db.number) + " " + std::to_string(command.offset + i) + " ";
+            for (size_t j = i; j < copy.size() && j < i + DUMP_BYTES_PER_LINE; j++) {
+                std::snprintf(hex, sizeof(hex), "%02x", copy[j]);
+                text += hex;
+            }
+            text += "\n";
+        }
+        return;
+    }
+}
+
+} // namespace
+
+ControlQueue::ControlQueue() : slots(new ControlCommand[CONTROL_QUEUE_CAPACITY]) {
+}
+
+bool ControlQueue::TryPushBatch(const std::vector<ControlCommand>& batch) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    if (batch.size() > CONTROL_QUEUE_CAPACITY - (position - head.load(std::memory_order_acquire))) {
+        return false;
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+        slots[(position + i) % CONTROL_QUEUE_CAPACITY] = batch[i];
+    }
+    tail.store(position + batch.size(), std::memory_order_release);
+    return true;
+}
+
+bool ControlQueue::TryPop(ControlCommand& command) {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    command = slots[position % CONTROL_QUEUE_CAPACITY];
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool StartControlApi(const std::vector<TagState>& tagStates, const std::vector<DataBlock>& dataBlocks,
+                     const std::string& socketPath, WriteEventQueue* wake, ControlApi& api) {
+    if (!InitializeSockets()) {
+        std::cerr << "ERROR: Failed to initialize sockets for the control socket" << std::endl;
+        return false;
+    }
+    SocketHandle listener = ListenUnix(socketPath);
+    if (listener == NO_SOCKET) {
+        std::cerr << "ERROR: Cannot create the control socket '" << socketPath << "'" << std::endl;
+        return false;
+    }
+
+    api.tagIndex.clear();
+    api.params.resize(tagStates.size());
+    for (size_t i = 0; i < tagStates.size(); i++) {
+        const TagState& tag = tagStates[i];
+        api.tagIndex[std::make_tuple(static_cast<int>(tag.areaType), tag.dbNumber, tag.offset, tag.bitPosition)] =
+            static_cast<uint32_t>(i);
+        api.params[i] = {tag.dataType, tag.minValue, tag.maxValue, tag.echelon, tag.cycletime, tag.derived};
+    }
+    api.dbSizes.clear();
+    for (const auto& db : dataBlocks) {
+        api.dbSizes[db.number] = db.size;
+    }
+    api.socketPath = socketPath;
+    api.wake = wake;
+    api.running = true;
+    api.server = std::thread(ControlLoop, &api, listener);
+
+    std::cout << "Control API: " << tagStates.size() << " tags, " << dataBlocks.size()
+              << " DBs, commands on '" << socketPath << "'" << std::endl;
+    return true;
+}
+
+bool ApplyControlCommands(S7Object server, ControlApi& api, std::vector<TagState>& tagStates,
+                          std::vector<DataBlock>& dataBlocks, DerivedTagGraph* derivedTags,
+                          std::chrono::steady_clock::time_point now, DirtyTracker* dirty, ValueExporter* exporter) {
+    ControlCommand command;
+    if (!api.running || !api.queue.TryPop(command)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool tableChanged = false;
+    uint64_t applied = 0;
+    do {
+        applied++;
+        switch (command.op) {
+            case ControlOp::SET: {
+                tagStates[command.tag].currentValue = command.value;
+                PublishTag(server, tagStates, command.tag, derivedTags, dirty, exporter);
+                break;
+            }
+            case ControlOp::FREEZE:
+                tagStates[command.tag].frozen = true;
+                tableChanged = true;
+                break;
+            case ControlOp::UNFREEZE: {
+                TagState& tag = tagStates[command.tag];
+                tag.frozen = false;
+                tag.lastUpdateTime = now;  // Continue from the held value, without catching up
+                tableChanged = true;
+                break;
+            }
+            case ControlOp::PARAM: {
+                TagState& tag = tagStates[command.tag];
+                tag.minValue = command.minValue;
+                tag.maxValue = command.maxValue;
+                tag.echelon = command.echelon;
+                if (tag.cycletime != command.cycletime) {
+                    tag.cycletime = command.cycletime;
+                    tag.lastUpdateTime = now;
+                }
+                double clamped = std::min(std::max(tag.currentValue, tag.minValue), tag.maxValue);
+                if (clamped != tag.currentValue) {
+                    tag.currentValue = clamped;
+                    PublishTag(server, tagStates, command.tag, derivedTags, dirty, exporter);
+                }
+                tableChanged = true;
+                break;
+            }
+            case ControlOp::PAUSE:
+            case ControlOp::RESUME: {
+                bool pause = command.op == ControlOp::PAUSE;
+                for (auto& tag : tagStates) {
+                    if (tag.areaType == AreaType::DB && tag.dbNumber == command.dbNumber && tag.paused != pause) {
+                        tag.paused = pause;
+                        if (!pause) {
+                            tag.lastUpdateTime = now;
+                        }
+                    }
+                }
+                tableChanged = true;
+                break;
+            }
+            case ControlOp::DUMP:
+                DumpDB(server, dataBlocks, command, command.reply->text);
+                break;
+        }
+        if (command.endOfBatch) {
+            // Notify under the lock: the control thread frees the reply as soon as it sees it complete
+            std::lock_guard<std::mutex> lock(command.reply->mutex);
+            command.reply->complete = true;
+            command.reply->done.notify_one();
+            api.lines++;
+        }
+    } while (api.queue.TryPop(command));
+
+    api.commands += applied;
+    api.applyUs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    return tableChanged;
+}
+
+void StopControlApi(ControlApi& api) {
+    if (!api.running) {
+        return;
+    }
+    api.running = false;
+    if (api.server.joinable()) {
+        api.server.join();
+    }
+    std::remove(api.socketPath.c_str());
+}
+
+void DisplayControlStats(ControlApi& api) {
+    std::cout << "Control API: " << api.lines << " command lines (" << api.commands << " commands) applied, "
+              << api.rejected << " rejected, " << api.busy << " refused while busy, "
+              << (api.applyUs / 1000) << " ms spent applying" << std::endl;
+}
@@ -0,0 +1,157 @@
+/*
+* Control API
+*
+* Runtime control of the simulated tags for test automation, without
+* restarting the server (--control-socket). A control thread accepts up to
+* CONTROL_MAX_CONNECTIONS connections on a local UNIX socket and serves each
+* on its own thread with a line protocol:
+*   SET <tag> <value>                 Write a value; the sawtooth continues from it
+*   FREEZE <tag> / UNFREEZE <tag>     Hold a tag at its value / let it run again
+*   PARAM <tag> [min=<v>] [max=<v>] [echelon=<v>] [cycletime=<ms>]
+*   PAUSE <db> / RESUME <db>          Hold / release every sawtooth tag of a DB
+*   DUMP <db> [offset [size]]         "DB<n> <offset> <hex>" lines, 32 bytes each
+*   STATS                             "<key> <value>" lines, then "END"
+* Several commands can be sent on one line separated by ';'. Such a batch is
+* validated as a whole (nothing of it is applied if one command is invalid)
+* and applied in one go between two update passes; the line is answered
+* "OK <commands>" once it has been applied, after the output of its DUMPs.
+* Errors are answered "ERROR <text>". Tags are addresses as in the CSV
+* ("DB1,REAL0", "M3.7"), DBs "DB5" or "5". Derived tags follow their
+* sources and cannot be set, frozen or reparameterised.
+*
+* A connection thread parses and validates the commands and publishes a batch
+* with one release store into a single-producer/single-consumer ring (the
+* connection threads take turns producing) and wakes the simulation thread,
+* which drains the ring at the start of its next loop pass. Neither the
+* update loop nor the Snap7 threads ever wait for the control API. Only SET
+* and DUMP take the area lock, as client writes do.
+*/
+
+#ifndef CONTROLAPI_H
+#define CONTROLAPI_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "TagEngine.h"
+#include "DerivedTags.h"
+#include "ValueExport.h"
+#include "WriteReactions.h"
+
+// Commands the ring holds (a batch must fit in it)
+const size_t CONTROL_QUEUE_CAPACITY = 4096;
+
+// Longest command line accepted (a batch is one line)
+const size_t CONTROL_MAX_LINE = 256 * 1024;
+
+// Connections served at once; further ones are answered "ERROR" and closed
+const size_t CONTROL_MAX_CONNECTIONS = 16;
+
+enum class ControlOp {
+    SET,
+    FREEZE,
+    UNFREEZE,
+    PARAM,
+    PAUSE,
+    RESUME,
+    DUMP
+};
+
+// Answer to one command line, completed by the simulation thread
+struct ControlReply {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::string text;          // DUMP output
+    bool complete = false;
+};
+
+// One validated command
+struct ControlCommand {
+    ControlOp op = ControlOp::SET;
+    uint32_t tag = 0;          // SET, FREEZE, UNFREEZE, PARAM
+    int dbNumber = 0;          // PAUSE, RESUME, DUMP
+    double value = 0.0;        // SET
+    double minValue = 0.0;     // PARAM: the tag's complete new parameters
+    double maxValue = 0.0;
+    double echelon = 0.0;
+    int cycletime = 0;
+    int offset = 0;            // DUMP
+    int size = 0;
+    ControlReply* reply = nullptr;
+    bool endOfBatch = false;   // Last command of its line: completes the reply
+};
+
+// Single-producer (one connection thread at a time), single-consumer (simulation thread) ring
+class ControlQueue {
+public:
+    ControlQueue();
+
+    // Publish a whole batch at once; false (nothing published) if it does not fit
+    bool TryPushBatch(const std::vector<ControlCommand>& batch);
+    bool TryPop(ControlCommand& command);
+
+private:
+    std::unique_ptr<ControlCommand[]> slots;
+    alignas(64) std::atomic<size_t> head{0};   // Next slot to pop
+    alignas(64) std::atomic<size_t> tail{0};   // Next slot to push
+};
+
+// Parameters of a tag as the control thread last set them
+struct ControlTagParams {
+    DataType dataType;
+    double minValue;
+    double maxValue;
+    double echelon;
+    int cycletime;
+    bool derived;
+};
+
+struct ControlApi {
+    // Connection threads (fixed at start-up, parameters updated by PARAM under producerMutex)
+    std::map<std::tuple<int, int, int, int>, uint32_t> tagIndex;  // (area, DB, offset, bit) -> tag
+    std::vector<ControlTagParams> params;
+    std::map<int, int> dbSizes;                 // DB number -> size
+
+    std::mutex producerMutex;                   // Held to validate and publish a batch
+    ControlQueue queue;
+    WriteEventQueue* wake = nullptr;            // Woken once a batch is published (the main loop's wait)
+
+    std::string socketPath;
+    std::atomic<bool> running{false};
+    std::thread server;
+    std::atomic<uint64_t> lines{0};             // Command lines applied
+    std::atomic<uint64_t> commands{0};
+    std::atomic<uint64_t> rejected{0};          // Lines answered ERROR
+    std::atomic<uint64_t> busy{0};              // Lines refused because the ring was full
+    std::atomic<uint64_t> applyUs{0};           // Simulation thread time spent applying
+};
+
+// Index the tags and DBs and start the control thread on 'socketPath'. Published
+// batches wake the simulation thread's WaitUntil() on 'wake' (nullptr: the batch
+// waits for the next loop pass). Returns false if the socket cannot be created.
+bool StartControlApi(const std::vector<TagState>& tagStates, const std::vector<DataBlock>& dataBlocks,
+                     const std::string& socketPath, WriteEventQueue* wake, ControlApi& api);
+
+// Simulation thread, once per loop pass: apply every queued command at simulated time 'now'.
+// Written values are marked dirty, exported and propagated to derived tags like updates.
+// Returns true if a tag was frozen, paused or reparameterised, which an update engine
+// generated for the original table (GeneratedEngine.h) does not know about.
+bool ApplyControlCommands(S7Object server, ControlApi& api, std::vector<TagState>& tagStates,
+                          std::vector<DataBlock>& dataBlocks, DerivedTagGraph* derivedTags,
+                          std::chrono::steady_clock::time_point now, DirtyTracker* dirty = nullptr,
+                          ValueExporter* exporter = nullptr);
+
+void StopControlApi(ControlApi& api);
+
+// Print lines, commands, rejected and refused lines and the time spent applying
+void DisplayControlStats(ControlApi& api);
+
+#endif // CONTROLAPI_H
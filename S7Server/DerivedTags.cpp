@@ -0,0 +1,254 @@
+/*
+* Derived Tags
+* Expression parsing, DAG construction and incremental recomputation.
+*/
+
+#include "DerivedTags.h"
+
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+// Key identifying a tag by its address and type
+uint64_t TagKey(AreaType areaType, int dbNumber, int offset, int bitPosition, DataType dataType) {
+    return (static_cast<uint64_t>(areaType) << 60) | (static_cast<uint64_t>(dataType) << 56)
+         | (static_cast<uint64_t>(dbNumber & 0xFFFFFF) << 32)
+         | (static_cast<uint64_t>(offset & 0xFFFFFFF) << 4) | static_cast<uint64_t>(bitPosition + 1);
+}
+
+// Clamp to the tag's range (when it has one) and round to what its data type can hold
+double QuantizeValue(const TagState& tag, double value) {
+    if (tag.maxValue > tag.minValue) {
+        value = std::max(tag.minValue, std::min(tag.maxValue, value));
+    }
+    switch (tag.dataType) {
+        case DataType::REAL:  return static_cast<float>(value);
+        case DataType::DWORD: return static_cast<uint32_t>(std::max(0.0, value));
+        case DataType::INT:   return static_cast<int16_t>(value);
+        case DataType::BOOL:  return value != 0.0 ? 1.0 : 0.0;
+        default:              return value;
+    }
+}
+
+double Evaluate(const DerivedNode& node, const std::vector<TagState>& tagStates) {
+    double first = tagStates[node.inputs[0]].currentValue;
+    switch (node.op) {
+        case DerivedOp::SCALE:   return first * node.param1 + node.param2;
+        case DerivedOp::GREATER: return first > node.param1 ? 1.0 : 0.0;
+        case DerivedOp::LESS:    return first < node.param1 ? 1.0 : 0.0;
+        default: break;
+    }
+    double result = first;
+    for (size_t i = 1; i < node.inputs.size(); i++) {
+        double value = tagStates[node.inputs[i]].currentValue;
+        if (node.op == DerivedOp::MIN) result = std::min(result, value);
+        else if (node.op == DerivedOp::MAX) result = std::max(result, value);
+        else result += value;
+    }
+    if (node.op == DerivedOp::AVG) {
+        result /= static_cast<double>(node.inputs.size());
+    }
+    return result;
+}
+
+} // namespace
+
+// Parse an expression such as "scale(DB1,REAL0;0.5;10)" into its operation and arguments
+bool ParseDerivedExpression(const std::string& expression, DerivedOp& op, std::vector<std::string>& args) {
+    size_t open = expression.find('(');
+    size_t close = expression.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return false;
+    }
+    
+    std::string name = expression.substr(0, open);
+    name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+    if (name == "sum") op = DerivedOp::SUM;
+    else if (name == "avg") op = DerivedOp::AVG;
+    else if (name == "min") op = DerivedOp::MIN;
+    else if (name == "max") op = DerivedOp::MAX;
+    else if (name == "scale") op = DerivedOp::SCALE;
+    else if (name == "gt") op = DerivedOp::GREATER;
+    else if (name == "lt") op = DerivedOp::LESS;
+    else return false;
+    
+    args.clear();
+    std::string inner = expression.substr(open + 1, close - open - 1);
+    size_t start = 0;
+    while (start <= inner.size()) {
+        size_t end = inner.find(';', start);
+        if (end == std::string::npos) end = inner.size();
+        std::string arg = inner.substr(start, end - start);
+        arg.erase(std::remove(arg.begin(), arg.end(), ' '), arg.end());
+        if (arg.empty()) {
+            return false;
+        }
+        args.push_back(arg);
+        start = end + 1;
+    }
+    
+    // scale takes a tag, gain and bias; gt/lt a tag and a limit; the rest one or more tags
+    if (op == DerivedOp::SCALE) return args.size() == 3;
+    if (op == DerivedOp::GREATER || op == DerivedOp::LESS) return args.size() == 2;
+    return !args.empty();
+}
+
+// Build the graph from the CSV entries that carry an expression
+void BuildDerivedTagGraph(const std::vector<CSVConfigEntry>& entries, std::vector<TagState>& tagStates,
+                          DerivedTagGraph& graph) {
+    graph = DerivedTagGraph();
+    
+    bool anyDerived = false;
+    for (const auto& entry : entries) {
+        if (!entry.expression.empty()) {
+            anyDerived = true;
+            break;
+        }
+    }
+    if (!anyDerived) {
+        return;
+    }
+    
+    // Address lookup for expression references
+    std::unordered_map<uint64_t, uint32_t> tagIndex;
+    tagIndex.reserve(tagStates.size());
+    for (size_t i = 0; i < tagStates.size(); i++) {
+        const TagState& tag = tagStates[i];
+        tagIndex[TagKey(tag.areaType, tag.dbNumber, tag.offset, tag.bitPosition, tag.dataType)] = static_cast<uint32_t>(i);
+    }
+    
+    // First pass: one node per valid expression
+    std::vector<DerivedNode> nodes;
+    std::unordered_map<uint32_t, uint32_t> nodeOfTag;  // Tag index -> node index
+    for (const auto& entry : entries) {
+        if (entry.expression.empty()) {
+            continue;
+        }
+        auto self = tagIndex.find(TagKey(entry.areaType, entry.dbNumber, entry.offset, entry.bitPosition, entry.dataType));
+        if (self == tagIndex.end()) {
+            continue;  // Tag state was skipped during initialization (already warned)
+        }
+        
+        DerivedNode node;
+        node.tagIndex = self->second;
+        std::vector<std::string> args;
+        bool valid = ParseDerivedExpression(entry.expression, node.op, args);
+        for (size_t i = 0; valid && i < args.size(); i++) {
+            bool tagArgument = (i == 0) || (node.op != DerivedOp::SCALE && node.op != DerivedOp::GREATER
+                                            && node.op != DerivedOp::LESS);
+            if (!tagArgument) {
+                try {
+                    (i == 1 ? node.param1 : node.param2) = std::stod(args[i]);
+                } catch (...) {
+                    valid = false;
+                }
+                continue;
+            }
+            CSVConfigEntry ref;
+            auto it = tagIndex.end();
+            if (ParseTag(args[i], ref.areaType, ref.dbNumber, ref.offset, ref.bitPosition, ref.dataType)) {
+                it = tagIndex.find(TagKey(ref.areaType, ref.dbNumber, ref.offset, ref.bitPosition, ref.dataType));
+            }
+            if (it == tagIndex.end()) {
+                std::cerr << "WARNING: Derived tag expression '" << entry.expression
+                          << "' references unknown tag " << args[i] << std::endl;
+                valid = false;
+            } else {
+                node.inputs.push_back(it->second);
+            }
+        }
+        if (!valid) {
+            std::cerr << "WARNING: Invalid derived tag expression '" << entry.expression << "', tag keeps its start value" << std::endl;
+        }
+        
+        // Invalid expressions still freeze the tag instead of silently turning it into a sawtooth
+        tagStates[node.tagIndex].derived = true;
+        if (valid) {
+            nodeOfTag[node.tagIndex] = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node);
+        }
+    }
+    
+    // Topological order (Kahn): count inputs that are themselves derived
+    std::vector<uint32_t> indegree(nodes.size(), 0);
+    std::vector<std::vector<uint32_t>> readers(nodes.size());
+    for (uint32_t n = 0; n < nodes.size(); n++) {
+        for (uint32_t input : nodes[n].inputs) {
+            auto it = nodeOfTag.find(input);
+            if (it != nodeOfTag.end()) {
+                readers[it->second].push_back(n);
+                indegree[n]++;
+            }
+        }
+    }
+    std::vector<uint32_t> order;
+    order.reserve(nodes.size());
+    for (uint32_t n = 0; n < nodes.size(); n++) {
+        if (indegree[n] == 0) order.push_back(n);
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (uint32_t reader : readers[order[i]]) {
+            if (--indegree[reader] == 0) order.push_back(reader);
+        }
+    }
+    if (order.size() < nodes.size()) {
+        std::cerr << "WARNING: " << (nodes.size() - order.size())
+                  << " derived tag(s) are part of or depend on a cycle and keep their start value" << std::endl;
+    }
+    graph.nodes.reserve(order.size());
+    for (uint32_t n : order) {
+        graph.nodes.push_back(nodes[n]);
+    }
+    
+    // Reverse edges in compressed form: tag index -> nodes reading it
+    graph.dependentStart.assign(tagStates.size() + 1, 0);
+    for (const auto& node : graph.nodes) {
+        for (uint32_t input : node.inputs) graph.dependentStart[input + 1]++;
+    }
+    for (size_t i = 1; i < graph.dependentStart.size(); i++) {
+        graph.dependentStart[i] += graph.dependentStart[i - 1];
+    }
+    graph.dependentNodes.resize(graph.dependentStart.back());
+    std::vector<uint32_t> fill(graph.dependentStart.begin(), graph.dependentStart.end() - 1);
+    for (uint32_t n = 0; n < graph.nodes.size(); n++) {
+        for (uint32_t input : graph.nodes[n].inputs) graph.dependentNodes[fill[input]++] = n;
+    }
+    graph.queued.assign(graph.nodes.size(), 0);
+    
+    // Initial values: every node once
+    for (uint32_t n = 0; n < graph.nodes.size(); n++) {
+        graph.queued[n] = 1;
+        graph.pending.push_back(n);  // Ascending order is already a valid min-heap
+    }
+    RecomputeDerivedTags(graph, tagStates);
+    
+    std::cout << "Derived tags: " << graph.nodes.size() << " in dependency order" << std::endl;
+}
+
+// Recompute queued derived tags in topological order
+size_t RecomputeDerivedTags(DerivedTagGraph& graph, std::vector<TagState>& tagStates, DirtyTracker* dirty,
+                            ValueExporter* exporter) {
+    size_t evaluated = 0;
+    while (!graph.pending.empty()) {
+        std::pop_heap(graph.pending.begin(), graph.pending.end(), std::greater<uint32_t>());
+        uint32_t n = graph.pending.back();
+        graph.pending.pop_back();
+        graph.queued[n] = 0;
+        evaluated++;
+        
+        const DerivedNode& node = graph.nodes[n];
+        TagState& tag = tagStates[node.tagIndex];
+        double value = QuantizeValue(tag, Evaluate(node, tagStates));
+        if (value == tag.currentValue) {
+            continue;  // Unchanged: nothing downstream needs to run
+        }
+        tag.currentValue = value;
+        WriteTagValue(tag);
+        MarkTagDirty(dirty, tag);
+        ExportTagValue(exporter, node.tagIndex, tag.currentValue);
+        MarkTagChanged(graph, node.tagIndex);
+    }
+    graph.recomputed += evaluated;
+    return evaluated;
+}
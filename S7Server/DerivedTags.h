@@ -0,0 +1,84 @@
+/*
+* Derived Tags
+*
+* Tags computed from other tags instead of following the sawtooth, declared
+* with the optional 'expression' column of address.csv:
+*   "DB400,REAL0",0,5000,0,0,"sum(DB101,REAL14;DB102,REAL14)"
+*
+* Derived tags form a DAG over the tag states. When a source tag changes only
+* the nodes downstream of it are recomputed, in topological order, so the cost
+* of an update cycle follows what changed rather than the size of the model.
+*/
+
+#ifndef DERIVEDTAGS_H
+#define DERIVEDTAGS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "TagEngine.h"
+
+// Operations available in derived tag expressions
+enum class DerivedOp {
+    SUM,      // sum(a;b;...)        a + b + ...
+    AVG,      // avg(a;b;...)        mean of the inputs
+    MIN,      // min(a;b;...)        smallest input
+    MAX,      // max(a;b;...)        largest input
+    SCALE,    // scale(a;gain;bias)  a * gain + bias
+    GREATER,  // gt(a;limit)         1 if a > limit, else 0
+    LESS      // lt(a;limit)         1 if a < limit, else 0
+};
+
+// One derived tag: the tag state it writes and the tag states it reads
+struct DerivedNode {
+    uint32_t tagIndex;
+    DerivedOp op;
+    std::vector<uint32_t> inputs;
+    double param1 = 0.0;  // SCALE gain, GREATER/LESS limit
+    double param2 = 0.0;  // SCALE bias
+};
+
+// Dependency graph of all derived tags
+struct DerivedTagGraph {
+    std::vector<DerivedNode> nodes;          // Topological order: a node comes after every node it reads
+    std::vector<uint32_t> dependentStart;    // Tag index -> first entry in dependentNodes (size tags + 1)
+    std::vector<uint32_t> dependentNodes;    // Nodes reading each tag, grouped by tag index
+    std::vector<uint32_t> pending;           // Min-heap of node indices waiting for recomputation
+    std::vector<char> queued;                // Node index -> already in 'pending'
+    uint64_t recomputed = 0;                 // Nodes evaluated since start
+};
+
+// Parse an expression such as "scale(DB1,REAL0;0.5;10)" into its operation and
+// arguments (tag addresses or numbers, separated by ';')
+bool ParseDerivedExpression(const std::string& expression, DerivedOp& op, std::vector<std::string>& args);
+
+// Build the graph from the CSV entries that carry an expression. Derived tag states
+// are flagged so the sawtooth skips them; expressions with unknown references or
+// cycles are rejected with a warning. Every derived tag is computed once.
+void BuildDerivedTagGraph(const std::vector<CSVConfigEntry>& entries, std::vector<TagState>& tagStates,
+                          DerivedTagGraph& graph);
+
+// Queue the derived tags reading tag state 'tagIndex' for recomputation
+inline void MarkTagChanged(DerivedTagGraph& graph, size_t tagIndex) {
+    if (graph.dependentStart.empty()) {
+        return;
+    }
+    for (uint32_t i = graph.dependentStart[tagIndex]; i < graph.dependentStart[tagIndex + 1]; i++) {
+        uint32_t node = graph.dependentNodes[i];
+        if (!graph.queued[node]) {
+            graph.queued[node] = 1;
+            graph.pending.push_back(node);
+            std::push_heap(graph.pending.begin(), graph.pending.end(), std::greater<uint32_t>());
+        }
+    }
+}
+
+// Recompute queued derived tags in topological order; a tag whose value changes
+// queues the tags reading it. Changed tags are marked in 'dirty' and handed to
+// the exporter when given. Returns the number of nodes evaluated.
+size_t RecomputeDerivedTags(DerivedTagGraph& graph, std::vector<TagState>& tagStates,
+                            DirtyTracker* dirty = nullptr, ValueExporter* exporter = nullptr);
+
+#endif // DERIVEDTAGS_H
@@ -0,0 +1,133 @@
+/*
+* Dirty Range Tracking
+* Region table, client write marking and range collection.
+*/
+
+#include "DirtyTracker.h"
+#include "TagEngine.h"
+#include <algorithm>
+
+namespace {
+
+uint64_t RegionKey(int srvArea, int number) {
+    return (static_cast<uint64_t>(srvArea) << 32) | static_cast<uint32_t>(srvArea == srvAreaDB ? number : 0);
+}
+
+// Append [begin, end) (byte offsets from the tracker base) split at region boundaries
+void AppendRun(const DirtyTracker& dirty, size_t begin, size_t end, std::vector<DirtyRange>& ranges) {
+    const byte* address = dirty.base + begin;
+    auto it = std::upper_bound(dirty.regions.begin(), dirty.regions.end(), address,
+                               [](const byte* a, const AreaRegion& r) { return a < r.data; });
+    size_t r = it == dirty.regions.begin() ? 0 : static_cast<size_t>(it - dirty.regions.begin()) - 1;
+    for (; r < dirty.regions.size(); r++) {
+        const AreaRegion& region = dirty.regions[r];
+        size_t regionBegin = static_cast<size_t>(region.data - dirty.base);
+        size_t regionEnd = regionBegin + region.size;
+        if (regionBegin >= end) {
+            break;
+        }
+        size_t from = std::max(begin, regionBegin);
+        size_t to = std::min(end, regionEnd);
+        if (from < to) {
+            DirtyRange range;
+            range.region = r;
+            range.start = static_cast<int>(from - regionBegin);
+            range.length = static_cast<int>(to - from);
+            ranges.push_back(range);
+        }
+    }
+}
+
+} // namespace
+
+void InitializeDirtyTracker(const ProcessImage& image, DirtyTracker& dirty) {
+    dirty.regions.clear();
+    dirty.regionIndex.clear();
+    auto add = [&dirty](int srvArea, int number, byte* data, int size) {
+        if (data && size > 0) {
+            AreaRegion region = {srvArea, number, data, size};
+            dirty.regions.push_back(region);
+        }
+    };
+    add(srvAreaPE, 0, image.IArea, image.sizes.inputs);
+    add(srvAreaPA, 0, image.QArea, image.sizes.outputs);
+    add(srvAreaMK, 0, image.MArea, image.sizes.flags);
+    add(srvAreaTM, 0, image.TArea, image.sizes.timers);
+    add(srvAreaCT, 0, image.CArea, image.sizes.counters);
+    for (const auto& db : image.dataBlocks) {
+        add(srvAreaDB, db.number, db.data, db.size);
+    }
+    std::sort(dirty.regions.begin(), dirty.regions.end(),
+              [](const AreaRegion& a, const AreaRegion& b) { return a.data < b.data; });
+    for (size_t r = 0; r < dirty.regions.size(); r++) {
+        dirty.regionIndex[RegionKey(dirty.regions[r].srvArea, dirty.regions[r].number)] = r;
+    }
+
+    dirty.base = dirty.regions.empty() ? nullptr : dirty.regions.front().data;
+    size_t span = 0;
+    for (const auto& region : dirty.regions) {
+        span = std::max(span, static_cast<size_t>(region.data + region.size - dirty.base));
+    }
+    dirty.chunks = (span + DIRTY_CHUNK_SIZE - 1) >> DIRTY_CHUNK_SHIFT;
+    dirty.bits.assign((dirty.chunks + 63) / 64, 0);
+}
+
+const AreaRegion* FindRegion(const DirtyTracker& dirty, int srvArea, int number) {
+    auto it = dirty.regionIndex.find(RegionKey(srvArea, number));
+    return it == dirty.regionIndex.end() ? nullptr : &dirty.regions[it->second];
+}
+
+void MarkAllDirty(DirtyTracker& dirty) {
+    for (const auto& region : dirty.regions) {
+        MarkDirty(&dirty, region.data, region.size);
+    }
+}
+
+void MarkClientWrite(DirtyTracker& dirty, int s7Area, int dbNumber, int start, int size) {
+    int srvArea = SrvAreaIndex(s7Area);
+    const AreaRegion* region = srvArea < 0 ? nullptr : FindRegion(dirty, srvArea, dbNumber);
+    if (!region || start < 0 || size <= 0) {
+        return;
+    }
+    // Timers and counters are addressed by element (2 bytes)
+    if (srvArea == srvAreaTM || srvArea == srvAreaCT) {
+        start *= 2;
+        size *= 2;
+    }
+    // A single-byte write may be a bit access reported as a bit address; mark both readings
+    if (size == 1 && start / 8 < region->size) {
+        MarkDirty(&dirty, region->data + start / 8, 1);
+    }
+    if (start < region->size) {
+        MarkDirty(&dirty, region->data + start, std::min(size, region->size - start));
+    }
+}
+
+void CollectDirtyRanges(DirtyTracker& dirty, std::vector<DirtyRange>& ranges) {
+    size_t runStart = 0;
+    bool inRun = false;
+    for (size_t w = 0; w < dirty.bits.size(); w++) {
+        uint64_t word = dirty.bits[w];
+        if (!inRun && word == 0) {
+            continue;  // Clean stretch: skip 64 chunks at once
+        }
+        dirty.bits[w] = 0;
+        if (inRun && word == ~uint64_t(0)) {
+            continue;  // Run continues through all 64 chunks
+        }
+        for (int b = 0; b < 64; b++) {
+            bool set = ((word >> b) & 1) != 0;
+            size_t chunk = w * 64 + b;
+            if (set && !inRun) {
+                runStart = chunk;
+                inRun = true;
+            } else if (!set && inRun) {
+                AppendRun(dirty, runStart << DIRTY_CHUNK_SHIFT, chunk << DIRTY_CHUNK_SHIFT, ranges);
+                inRun = false;
+            }
+        }
+    }
+    if (inRun) {
+        AppendRun(dirty, runStart << DIRTY_CHUNK_SHIFT, dirty.chunks << DIRTY_CHUNK_SHIFT, ranges);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+* Dirty Range Tracking
+*
+* Records which bytes of the process image changed since the last
+* replication pass. Every registered area is carved from one arena, so a
+* single bitmap with one bit per 8-byte chunk covers all of them: marking a
+* write is a shift and an OR, with no lookup of the area. Areas start on
+* cache lines, so a chunk never spans two areas. Collecting turns the set
+* bits back into byte ranges per registered area.
+*
+* Marking is single-threaded (the simulation thread); client writes reach
+* the tracker through the write event queue (see Replication.h).
+*/
+
+#ifndef DIRTYTRACKER_H
+#define DIRTYTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "snap7.h"
+
+// Bytes covered by one bit of the dirty bitmap
+const int DIRTY_CHUNK_SHIFT = 3;
+const int DIRTY_CHUNK_SIZE = 1 << DIRTY_CHUNK_SHIFT;
+
+struct ProcessImage;
+
+// One registered area of the process image
+struct AreaRegion {
+    int srvArea;   // srvAreaPE, srvAreaPA, srvAreaMK, srvAreaCT, srvAreaTM or srvAreaDB
+    int number;    // DB number (0 for the other areas)
+    byte* data;
+    int size;
+};
+
+// Changed byte range of one region
+struct DirtyRange {
+    size_t region;  // Index into DirtyTracker::regions
+    int start;
+    int length;
+};
+
+struct DirtyTracker {
+    byte* base = nullptr;               // Lowest address of any region
+    size_t chunks = 0;
+    std::vector<uint64_t> bits;         // One bit per chunk
+    std::vector<AreaRegion> regions;    // Sorted by address
+    std::unordered_map<uint64_t, size_t> regionIndex;  // (srvArea, number) -> region
+};
+
+// Mark 'size' bytes at 'address' (inside a registered area) as changed; no-op without a tracker
+inline void MarkDirty(DirtyTracker* dirty, const byte* address, int size) {
+    if (!dirty || size <= 0) {
+        return;
+    }
+    size_t first = static_cast<size_t>(address - dirty->base) >> DIRTY_CHUNK_SHIFT;
+    size_t last = static_cast<size_t>(address + size - 1 - dirty->base) >> DIRTY_CHUNK_SHIFT;
+    for (size_t chunk = first; chunk <= last; chunk++) {
+        dirty->bits[chunk >> 6] |= uint64_t(1) << (chunk & 63);
+    }
+}
+
+// Build the region table and an empty bitmap over every area of the image
+void InitializeDirtyTracker(const ProcessImage& image, DirtyTracker& dirty);
+
+// Region registered as (srvArea, number), nullptr if there is none
+const AreaRegion* FindRegion(const DirtyTracker& dirty, int srvArea, int number);
+
+// Mark every byte of every region (full resynchronisation)
+void MarkAllDirty(DirtyTracker& dirty);
+
+// Mark a client write reported by the server event stream (S7 area code, DB, start, size)
+void MarkClientWrite(DirtyTracker& dirty, int s7Area, int dbNumber, int start, int size);
+
+// Append the changed ranges (at chunk granularity, clipped to their region) and clear the bitmap
+void CollectDirtyRanges(DirtyTracker& dirty, std::vector<DirtyRange>& ranges);
+
+#endif // DIRTYTRACKER_H
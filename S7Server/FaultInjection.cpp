@@ -0,0 +1,317 @@
+/*
+* Response-Time and Fault Injection
+* Policy lookup, latency sampling and the resourceless data transfer.
+*/
+
+#include "FaultInjection.h"
+#include "SocketUtil.h"
+#include "ClientLimits.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// Most specific policy for a request: DB<n>, then DB* or the area, then *
+FaultPolicy* PolicyFor(const FaultInjector& injector, int srvArea, int dbNumber) {
+    if (srvArea == srvAreaDB) {
+        auto it = injector.dbPolicies.find(dbNumber);
+        if (it != injector.dbPolicies.end()) {
+            return it->second;
+        }
+        if (injector.dbDefaultPolicy) {
+            return injector.dbDefaultPolicy;
+        }
+    } else if (injector.areaPolicies[srvArea]) {
+        return injector.areaPolicies[srvArea];
+    }
+    return injector.defaultPolicy;
+}
+
+// Delay in microseconds drawn from the policy's distribution
+int64_t SampleLatencyUs(FaultInjector& injector, const FaultConfigEntry& config) {
+    double ms = config.latencyMs;
+    if (config.distribution == LatencyDistribution::UNIFORM) {
+        std::uniform_real_distribution<double> uniform(config.latencyMs - config.spreadMs,
+                                                       config.latencyMs + config.spreadMs);
+        ms = uniform(injector.rng);
+    } else if (config.distribution == LatencyDistribution::NORMAL) {
+        std::normal_distribution<double> normal(config.latencyMs, config.spreadMs);
+        ms = normal(injector.rng);
+    }
+    return static_cast<int64_t>(std::max(0.0, ms) * 1000.0);
+}
+
+// Time until the next boundary of the virtual scan cycle, where the PLC would answer
+int64_t ScanCycleWaitUs(int scanCycleMs, std::chrono::steady_clock::time_point at) {
+    if (scanCycleMs <= 0) {
+        return 0;
+    }
+    const int64_t cycleUs = static_cast<int64_t>(scanCycleMs) * 1000;
+    int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(at.time_since_epoch()).count();
+    return cycleUs - nowUs % cycleUs;
+}
+
+// Drop the connection of the client at 'clientAddress' (IPv4, network byte order).
+// Snap7 only tells the address, so the drop is done only if exactly one connection
+// comes from it; with several (gateways or test clients on one host) any guess could
+// hit a bystander. Returns false if nothing was dropped.
+bool DropClientConnection(uint32_t clientAddress, int serverPort) {
+    SocketHandle match = NO_SOCKET;
+    for (const auto& connection : AcceptedConnections(serverPort)) {
+        if (connection.peerAddress == clientAddress) {
+            if (match != NO_SOCKET) {
+                return false;
+            }
+            match = connection.socket;
+        }
+    }
+    return match != NO_SOCKET && ShutdownConnection(match);
+}
+
+// Copy between the client buffer and the process image under the area lock
+int TransferData(FaultInjector& injector, int srvArea, const TS7Tag& tag, int operation, void* pUsrData) {
+    ProcessImage& image = *injector.image;
+    byte* base = nullptr;
+    int areaSize = 0;
+    int lockIndex = 0;
+    switch (srvArea) {
+        case srvAreaPE: base = image.IArea; areaSize = image.sizes.inputs; break;
+        case srvAreaPA: base = image.QArea; areaSize = image.sizes.outputs; break;
+        case srvAreaMK: base = image.MArea; areaSize = image.sizes.flags; break;
+        case srvAreaCT: base = image.CArea; areaSize = image.sizes.counters; break;
+        case srvAreaTM: base = image.TArea; areaSize = image.sizes.timers; break;
+        case srvAreaDB: {
+            auto it = injector.dbIndex.find(tag.DBNumber);
+            if (it != injector.dbIndex.end()) {
+                const DataBlock& db = image.dataBlocks[it->second];
+                base = db.data;
+                areaSize = db.size;
+                lockIndex = db.number;
+            }
+            break;
+        }
+        default: break;
+    }
+    if (!base) {
+        injector.transferErrors++;
+        return evrErrAreaNotFound;
+    }
+
+    // Bit access addresses bits; timers and counters are addressed by element (2 bytes)
+    bool bitAccess = (tag.WordLen == S7WLBit);
+    int offset = bitAccess ? tag.Start / 8 : tag.Start * ((srvArea == srvAreaCT || srvArea == srvAreaTM) ? 2 : 1);
+    int size = bitAccess ? 1 : tag.Size;
+    if (tag.Start < 0 || size < 0 || offset + size > areaSize) {
+        injector.transferErrors++;
+        return evrErrOutOfRange;
+    }
+
+    byte* data = static_cast<byte*>(pUsrData);
+    Srv_LockArea(injector.server, srvArea, static_cast<word>(lockIndex));
+    if (bitAccess) {
+        byte mask = static_cast<byte>(1 << (tag.Start % 8));
+        if (operation == OperationRead) {
+            data[0] = (base[offset] & mask) ? 1 : 0;
+        } else if (data[0]) {
+            base[offset] |= mask;
+        } else {
+            base[offset] &= static_cast<byte>(~mask);
+        }
+    } else if (operation == OperationRead) {
+        memcpy(data, base + offset, size);
+    } else {
+        memcpy(base + offset, data, size);
+    }
+    Srv_UnlockArea(injector.server, srvArea, static_cast<word>(lockIndex));
+    injector.transfers++;
+    return 0;
+}
+
+} // namespace
+
+// Load the faults CSV (target,distribution,latency_ms,spread_ms,scan_cycle_ms,reject_rate,disconnect_rate)
+std::vector<FaultConfigEntry> LoadFaultConfig(const std::string& filename) {
+    std::vector<FaultConfigEntry> entries;
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+        std::cerr << "WARNING: Could not open faults file '" << filename << "'. No faults will be injected." << std::endl;
+        return entries;
+    }
+
+    std::string line;
+    bool firstLine = true;
+    while (std::getline(file, line)) {
+        // Skip header line
+        if (firstLine) {
+            firstLine = false;
+            continue;
+        }
+
+        // Skip empty lines
+        if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
+            continue;
+        }
+
+        std::vector<std::string> fields = ParseCSVLine(line);
+        if (fields.size() < 7) {
+            std::cerr << "WARNING: Fault policy line needs 7 fields: " << line << std::endl;
+            continue;
+        }
+
+        FaultConfigEntry entry;
+        entry.target = fields[0];
+        if (fields[1] == "fixed") entry.distribution = LatencyDistribution::FIXED;
+        else if (fields[1] == "uniform") entry.distribution = LatencyDistribution::UNIFORM;
+        else if (fields[1] == "normal") entry.distribution = LatencyDistribution::NORMAL;
+        else {
+            std::cerr << "WARNING: Unknown latency distribution '" << fields[1] << "' for " << fields[0] << std::endl;
+            continue;
+        }
+        try {
+            entry.latencyMs = std::stod(fields[2]);
+            entry.spreadMs = std::stod(fields[3]);
+            entry.scanCycleMs = std::stoi(fields[4]);
+            entry.rejectRate = std::stod(fields[5]);
+            entry.disconnectRate = std::stod(fields[6]);
+        } catch (...) {
+            std::cerr << "WARNING: Failed to parse values for fault policy: " << fields[0] << std::endl;
+            continue;
+        }
+        if (entry.latencyMs < 0 || entry.spreadMs < 0 || entry.scanCycleMs < 0 ||
+            entry.rejectRate < 0 || entry.rejectRate > 1 || entry.disconnectRate < 0 || entry.disconnectRate > 1) {
+            std::cerr << "WARNING: Fault policy values out of range (rates must be 0-1): " << fields[0] << std::endl;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+
+    std::cout << "Loaded " << entries.size() << " fault policies from '" << filename << "'." << std::endl;
+    return entries;
+}
+
+// Bind the policies to the process image and the server
+size_t InitializeFaultInjection(const std::vector<FaultConfigEntry>& entries, ProcessImage& image,
+                                S7Object server, int serverPort, FaultInjector& injector) {
+    injector.server = server;
+    injector.image = &image;
+    injector.serverPort = serverPort;
+    injector.rng.seed(std::random_device()());
+    for (size_t i = 0; i < image.dataBlocks.size(); i++) {
+        injector.dbIndex[image.dataBlocks[i].number] = i;
+    }
+
+    for (const auto& entry : entries) {
+        std::string target = entry.target;
+        std::transform(target.begin(), target.end(), target.begin(), ::toupper);
+        std::unique_ptr<FaultPolicy> policy(new FaultPolicy());
+        policy->config = entry;
+        FaultPolicy** slot = nullptr;
+
+        if (target == "*") slot = &injector.defaultPolicy;
+        else if (target == "DB*") slot = &injector.dbDefaultPolicy;
+        else if (target == "I" || target == "E") slot = &injector.areaPolicies[srvAreaPE];
+        else if (target == "Q" || target == "A") slot = &injector.areaPolicies[srvAreaPA];
+        else if (target == "M") slot = &injector.areaPolicies[srvAreaMK];
+        else if (target == "T") slot = &injector.areaPolicies[srvAreaTM];
+        else if (target == "C" || target == "Z") slot = &injector.areaPolicies[srvAreaCT];
+        else if (target.compare(0, 2, "DB") == 0) {
+            int dbNumber = 0;
+            try {
+                dbNumber = std::stoi(target.substr(2));
+            } catch (...) {
+                dbNumber = -1;
+            }
+            if (injector.dbIndex.find(dbNumber) == injector.dbIndex.end()) {
+                std::cerr << "WARNING: Fault policy for unknown DB '" << entry.target << "' skipped" << std::endl;
+                continue;
+            }
+            slot = &injector.dbPolicies[dbNumber];
+        }
+        if (!slot) {
+            std::cerr << "WARNING: Unknown fault policy target '" << entry.target << "' skipped" << std::endl;
+            continue;
+        }
+        if (*slot) {
+            std::cerr << "WARNING: Duplicate fault policy for '" << entry.target << "'; the last one wins" << std::endl;
+        }
+        *slot = policy.get();
+        injector.policies.push_back(std::move(policy));
+    }
+#ifdef _WIN32
+    for (const auto& policy : injector.policies) {
+        if (policy->config.disconnectRate > 0) {
+            std::cout << "NOTE: Forced disconnects are not available on Windows; they are counted as not injected." << std::endl;
+            break;
+        }
+    }
+#endif
+    return injector.policies.size();
+}
+
+// Snap7 read/write hook: checks the client's rates, applies the policy of the
+// addressed area, then transfers the data
+int S7API FaultInjectionCallback(void* usrPtr, int Sender, int Operation, PS7Tag PTag, void* pUsrData) {
+    FaultInjector& injector = *static_cast<FaultInjector*>(usrPtr);
+    if (injector.limiter && !AdmitClientRequest(*injector.limiter, static_cast<uint32_t>(Sender),
+                                                PTag->WordLen == S7WLBit ? 1 : PTag->Size)) {
+        return evrCannotHandlePDU;
+    }
+    auto received = std::chrono::steady_clock::now();
+    int srvArea = SrvAreaIndex(PTag->Area);
+    FaultPolicy* policy = srvArea >= 0 ? PolicyFor(injector, srvArea, PTag->DBNumber) : nullptr;
+
+    if (policy) {
+        const FaultConfigEntry& config = policy->config;
+        policy->requests++;
+        int64_t delayUs;
+        bool reject, disconnect;
+        {
+            std::lock_guard<std::mutex> lock(injector.rngMutex);
+            std::uniform_real_distribution<double> roll(0.0, 1.0);
+            disconnect = config.disconnectRate > 0 && roll(injector.rng) < config.disconnectRate;
+            reject = config.rejectRate > 0 && roll(injector.rng) < config.rejectRate;
+            delayUs = SampleLatencyUs(injector, config);
+        }
+
+        if (disconnect) {
+            if (DropClientConnection(static_cast<uint32_t>(Sender), injector.serverPort)) {
+                policy->disconnects++;
+                return evrErrException;
+            }
+            policy->disconnectsSkipped++;  // Not one connection from that address: answer normally
+        }
+
+        delayUs += ScanCycleWaitUs(config.scanCycleMs, received + std::chrono::microseconds(delayUs));
+        if (delayUs > 0) {
+            std::this_thread::sleep_until(received + std::chrono::microseconds(delayUs));
+            policy->delayedUs += static_cast<uint64_t>(delayUs);
+        }
+        if (reject) {
+            policy->rejected++;
+            return evrCannotHandlePDU;
+        }
+    }
+
+    return TransferData(injector, srvArea, *PTag, Operation, pUsrData);
+}
+
+void DisplayFaultStats(const FaultInjector& injector) {
+    std::cout << "Fault Injection: " << injector.transfers << " transfers, "
+              << injector.transferErrors << " address errors" << std::endl;
+    for (const auto& policy : injector.policies) {
+        uint64_t requests = policy->requests;
+        std::cout << "  " << policy->config.target << ": " << requests << " requests, avg delay "
+                  << (requests ? policy->delayedUs / requests / 1000.0 : 0.0) << " ms, "
+                  << policy->rejected << " rejected, " << policy->disconnects << " disconnects";
+        if (policy->disconnectsSkipped > 0) {
+            std::cout << " (" << policy->disconnectsSkipped << " not injected: client address not unique)";
+        }
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,94 @@
+/*
+* Response-Time and Fault Injection
+*
+* Makes the simulator answer like a loaded PLC instead of instantly. Per
+* area or per DB policies (--faults <file>) add a fixed or distributed
+* latency, wait for the next boundary of a virtual scan cycle, reject a
+* share of the requests and drop a share of the connections.
+*
+* With policies configured the server runs Snap7 "resourceless": every
+* client read and write is handed to FaultInjectionCallback, which applies
+* the matching policy and then copies the data from or to the process
+* image under the area lock. Snap7 calls the hook for one request at a
+* time, so injected delays queue behind each other much like requests
+* waiting for a PLC's communication phase. The same hook enforces the
+* per-client rates of ClientLimits.h, with or without fault policies.
+*/
+
+#ifndef FAULTINJECTION_H
+#define FAULTINJECTION_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "snap7.h"
+#include "TagEngine.h"
+
+struct ClientLimiter;
+
+enum class LatencyDistribution {
+    FIXED,    // Always latency_ms
+    UNIFORM,  // latency_ms +/- spread_ms
+    NORMAL    // Mean latency_ms, standard deviation spread_ms
+};
+
+// One line of the faults CSV
+struct FaultConfigEntry {
+    std::string target;      // "*", "DB*", "DB<n>", "I", "Q", "M", "T" or "C"
+    LatencyDistribution distribution;
+    double latencyMs;
+    double spreadMs;
+    int scanCycleMs;         // Answer on the next boundary of this virtual cycle (0: off)
+    double rejectRate;       // Share of requests answered with an error (0-1)
+    double disconnectRate;   // Share of requests whose connection is dropped (0-1)
+};
+
+// Policy with its counters (updated from Snap7 worker threads)
+struct FaultPolicy {
+    FaultConfigEntry config;
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> delayedUs{0};     // Total injected delay
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> disconnectsSkipped{0};  // Drawn but not injected (no single connection to drop)
+};
+
+// Policies bound to the process image, handed to the callback as usrPtr
+struct FaultInjector {
+    S7Object server = 0;
+    ProcessImage* image = nullptr;
+    int serverPort = 102;
+    std::vector<std::unique_ptr<FaultPolicy>> policies;
+    FaultPolicy* defaultPolicy = nullptr;          // "*"
+    FaultPolicy* dbDefaultPolicy = nullptr;        // "DB*"
+    FaultPolicy* areaPolicies[6] = {nullptr};      // By srvArea index (DB entry unused)
+    std::unordered_map<int, FaultPolicy*> dbPolicies;
+    std::unordered_map<int, size_t> dbIndex;       // DB number -> image->dataBlocks index
+    std::mutex rngMutex;
+    std::mt19937 rng;
+    std::atomic<uint64_t> transfers{0};            // Reads and writes served by the callback
+    std::atomic<uint64_t> transferErrors{0};       // Unknown area or out of range
+    ClientLimiter* limiter = nullptr;              // Per-client rates checked before any policy (optional)
+};
+
+// Load the faults CSV (target,distribution,latency_ms,spread_ms,scan_cycle_ms,reject_rate,disconnect_rate)
+std::vector<FaultConfigEntry> LoadFaultConfig(const std::string& filename);
+
+// Bind the policies to the process image and the server. Entries for unknown DBs
+// or areas are skipped with a warning. Returns the number of active policies.
+size_t InitializeFaultInjection(const std::vector<FaultConfigEntry>& entries, ProcessImage& image,
+                                S7Object server, int serverPort, FaultInjector& injector);
+
+// Snap7 read/write hook: checks the client's rates, applies the policy of the
+// addressed area, then transfers the data
+int S7API FaultInjectionCallback(void* usrPtr, int Sender, int Operation, PS7Tag PTag, void* pUsrData);
+
+// Print what was injected per policy
+void DisplayFaultStats(const FaultInjector& injector);
+
+#endif // FAULTINJECTION_H
@@ -0,0 +1,61 @@
+/*
+* Generated Update Engine
+* Table fingerprint and the group schedule of generated engines.
+*/
+
+#include "GeneratedEngine.h"
+
+namespace {
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+void HashBytes(uint64_t& hash, const void* data, size_t size) {
+    const byte* bytes = static_cast<const byte*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+}
+
+template <typename T>
+void HashValue(uint64_t& hash, T value) {
+    HashBytes(hash, &value, sizeof(value));
+}
+
+} // namespace
+
+uint64_t TagTableFingerprint(const std::vector<TagState>& tagStates) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    HashValue(hash, static_cast<uint64_t>(tagStates.size()));
+    for (const auto& tag : tagStates) {
+        HashValue(hash, static_cast<int32_t>(tag.areaType));
+        HashValue(hash, static_cast<int32_t>(tag.dbNumber));
+        HashValue(hash, static_cast<int32_t>(tag.offset));
+        HashValue(hash, static_cast<int32_t>(tag.bitPosition));
+        HashValue(hash, static_cast<int32_t>(tag.dataType));
+        HashValue(hash, tag.minValue);
+        HashValue(hash, tag.maxValue);
+        HashValue(hash, tag.echelon);
+        HashValue(hash, static_cast<int32_t>(tag.cycletime));
+        HashValue(hash, static_cast<uint8_t>(tag.derived ? 1 : 0));
+    }
+    return hash;
+}
+
+bool GroupDue(int cycletime, std::chrono::steady_clock::time_point last,
+              std::chrono::steady_clock::time_point now, GroupPass& pass) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
+    if (elapsed < cycletime) {
+        return false;
+    }
+    pass.lagUs = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count() -
+                 static_cast<int64_t>(cycletime) * 1000;
+    if (cycletime <= 0) {
+        pass.steps = 1;
+        pass.due = now;
+        return true;
+    }
+    pass.steps = elapsed / cycletime;
+    pass.due = last + std::chrono::milliseconds(pass.steps * cycletime);
+    return true;
+}
@@ -0,0 +1,143 @@
+/*
+* Generated Update Engine
+*
+* Runtime side of the update engines generated at build time for a fixed tag
+* table (S7EngineGen, CMake option S7SIM_GENERATED_ENGINE). The generated
+* source has one update function per cycletime group. Its tags are split into
+* runs of one DB (or area) and one data type, each a constant table of
+* offsets, ranges and steps walked by a loop with the codec of that type: no
+* address, range or type is read from the tag states and no data type is
+* branched on. Tables rather than straight-line code per tag keep the
+* generated source cheap to compile for 100k tags and more; straight-line
+* code cost milliseconds of compile time per tag and was not faster.
+*
+* Tags of a group share their phase (they start together and advance on the
+* same cycletime grid), so whether a group is due is decided once for the
+* whole group.
+*
+* A generated engine keeps the tag states exactly as UpdateTagValues does
+* (value, direction, last update time) and has the same signature
+* (TagUpdateFunction), so derived tags, scheduler statistics, replication,
+* history and export work unchanged and the engines can be swapped at any
+* pass. It only fits the table it was generated from: it carries a
+* fingerprint of that table, and callers fall back to UpdateTagValues when
+* the loaded configuration differs.
+*/
+
+#ifndef GENERATEDENGINE_H
+#define GENERATEDENGINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "TagEngine.h"
+#include "DerivedTags.h"
+#include "S7Codec.h"
+#include "SchedulerStats.h"
+#include "ValueExport.h"
+
+struct GeneratedEngineInfo {
+    const char* configFile;    // Tag table the engine was generated from
+    size_t tagCount;           // Tags in the table (derived ones included)
+    size_t groupCount;         // Cycletime groups with at least one sawtooth tag
+    uint64_t fingerprint;      // TagTableFingerprint of the table
+    TagUpdateFunction update;
+};
+
+#ifdef S7SIM_GENERATED_ENGINE
+// Defined by the generated source
+extern const GeneratedEngineInfo GeneratedTagEngine;
+#endif
+
+// Constants of one tag in a generated run
+struct FixedTag {
+    uint32_t index;            // Into the tag states
+    int offset;                // Byte offset in the run's DB or area
+    int bitPosition;           // BOOL only
+    double echelon;
+    double minValue;
+    double maxValue;
+};
+
+// One pass of a due group, shared by its runs
+struct GroupPass {
+    int64_t steps = 0;                              // Steps due (usually one)
+    std::chrono::steady_clock::time_point due;      // New last update time of the group's tags
+    int64_t lagUs = 0;                              // How late the first step is
+    DerivedTagGraph* derivedTags = nullptr;         // Optional hooks, as in UpdateTagValues
+    SchedulerStats* schedulerStats = nullptr;
+    DirtyTracker* dirty = nullptr;
+    ValueExporter* exporter = nullptr;
+};
+
+// FNV-1a over everything a generated engine bakes in: per tag the address, type,
+// range, step, cycletime and whether it is derived
+uint64_t TagTableFingerprint(const std::vector<TagState>& tagStates);
+
+// One sawtooth step with the tag's constants passed in (folded by the compiler);
+// identical to the generic step
+inline void StepSawtoothFixed(TagState& tag, double echelon, double minValue, double maxValue) {
+    if (tag.increasing) {
+        tag.currentValue += echelon;
+        if (tag.currentValue >= maxValue) {
+            tag.currentValue = maxValue;
+            tag.increasing = false;
+        }
+    } else {
+        tag.currentValue -= echelon;
+        if (tag.currentValue <= minValue) {
+            tag.currentValue = minValue;
+            tag.increasing = true;
+        }
+    }
+}
+
+inline void EncodeFixedReal(byte* base, const FixedTag& tag, double value) {
+    SetReal(base, tag.offset, static_cast<float>(value));
+}
+
+inline void EncodeFixedDWord(byte* base, const FixedTag& tag, double value) {
+    SetDWord(base, tag.offset, static_cast<uint32_t>(value));
+}
+
+inline void EncodeFixedInt(byte* base, const FixedTag& tag, double value) {
+    SetInt(base, tag.offset, static_cast<int16_t>(value));
+}
+
+inline void EncodeFixedBool(byte* base, const FixedTag& tag, double value) {
+    SetBool(base, tag.offset, tag.bitPosition, static_cast<int>(value) != 0);
+}
+
+// Advance every tag of a run, encode it into 'base' (the data of the run's DB or
+// area) and do the per-tag work of UpdateTagValues for the hooks given
+template <void (*Encode)(byte*, const FixedTag&, double)>
+inline void UpdateFixedTags(TagState* tags, byte* base, const FixedTag* run, size_t count, const GroupPass& pass) {
+    for (size_t i = 0; i < count; i++) {
+        const FixedTag& fixed = run[i];
+        TagState& tag = tags[fixed.index];
+        if (pass.schedulerStats) {
+            RecordTagLag(*pass.schedulerStats, tag, pass.lagUs);
+        }
+        if (pass.steps == 1) {
+            StepSawtoothFixed(tag, fixed.echelon, fixed.minValue, fixed.maxValue);
+        } else {
+            AdvanceSawtooth(tag, pass.steps);
+        }
+        tag.lastUpdateTime = pass.due;
+        Encode(base, fixed, tag.currentValue);
+        MarkTagDirty(pass.dirty, tag);
+        if (pass.exporter) {
+            ExportTagValue(pass.exporter, fixed.index, ReadTagValue(tag));
+        }
+        if (pass.derivedTags) {
+            MarkTagChanged(*pass.derivedTags, fixed.index);
+        }
+    }
+}
+
+// True if a group last updated at 'last' is due at 'now'; fills in the
+// steps, new last update time and lag of 'pass'
+bool GroupDue(int cycletime, std::chrono::steady_clock::time_point last,
+              std::chrono::steady_clock::time_point now, GroupPass& pass);
+
+#endif // GENERATEDENGINE_H
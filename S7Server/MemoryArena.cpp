@@ -0,0 +1,121 @@
+/*
+* Memory Arena
+* Page-aligned backing store for the process image.
+*/
+
+#include "MemoryArena.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Round 'size' up to a multiple of 'granularity' (a power of two)
+size_t RoundUp(size_t size, size_t granularity) {
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+} // namespace
+
+MemoryArena::~MemoryArena() {
+    Release();
+}
+
+bool MemoryArena::Initialize(size_t requested, bool hugePages) {
+    Release();
+    if (requested == 0) {
+        requested = 1;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    void* block = nullptr;
+    if (hugePages) {
+        // Large pages need the "Lock pages in memory" privilege; fall back silently
+        size_t largePage = GetLargePageMinimum();
+        if (largePage != 0) {
+            size_t size = RoundUp(requested, largePage);
+            block = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (block) {
+                mappedSize = size;
+                hugePagesActive = true;
+            }
+        }
+    }
+    if (!block) {
+        size_t size = RoundUp(requested, info.dwPageSize);
+        block = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!block) {
+            return false;
+        }
+        mappedSize = size;
+    }
+#else
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t hugePageSize = 2 * 1024 * 1024;
+    void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (hugePages) {
+        // Explicit huge pages only work if the administrator reserved some (vm.nr_hugepages)
+        size_t size = RoundUp(requested, hugePageSize);
+        block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED) {
+            mappedSize = size;
+            hugePagesActive = true;
+        }
+    }
+#endif
+    if (block == MAP_FAILED) {
+        size_t size = RoundUp(requested, hugePages ? hugePageSize : pageSize);
+        block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            return false;
+        }
+        mappedSize = size;
+#ifdef MADV_HUGEPAGE
+        // Otherwise ask for transparent huge pages
+        if (hugePages && madvise(block, size, MADV_HUGEPAGE) == 0) {
+            hugePagesActive = true;
+        }
+#endif
+    }
+#endif
+
+    base = static_cast<unsigned char*>(block);
+    capacity = mappedSize;
+    used = 0;
+    return true;
+}
+
+void* MemoryArena::Allocate(size_t size, size_t alignment) {
+    if (!base) {
+        return nullptr;
+    }
+    size_t start = RoundUp(used, alignment);
+    if (start > capacity || size > capacity - start) {
+        return nullptr;
+    }
+    used = start + size;
+    return base + start;  // Fresh mappings are zero-filled by the OS
+}
+
+void MemoryArena::Release() {
+    if (!base) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, mappedSize);
+#endif
+    base = nullptr;
+    capacity = 0;
+    mappedSize = 0;
+    used = 0;
+    hugePagesActive = false;
+}
@@ -0,0 +1,54 @@
+/*
+* Memory Arena
+*
+* One page-aligned block from which the whole process image (every DB and the
+* I/Q/M/T/C areas) is carved. Blocks are handed out by bumping a pointer and
+* are never freed individually; Release() returns everything at once.
+*/
+
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include <cstddef>
+
+// Alignment of every block handed out by the arena (one cache line)
+const size_t CACHE_LINE_SIZE = 64;
+
+class MemoryArena {
+public:
+    MemoryArena() = default;
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    // Reserve and commit a zero-filled block of at least 'capacity' bytes.
+    // With hugePages the block is backed by huge/large pages when the OS allows it,
+    // otherwise ordinary pages are used. Returns false if no memory could be mapped.
+    bool Initialize(size_t capacity, bool hugePages);
+
+    // Carve 'size' zero-filled bytes aligned to 'alignment' (a power of two);
+    // returns nullptr when the arena is exhausted
+    void* Allocate(size_t size, size_t alignment = CACHE_LINE_SIZE);
+
+    // Free the whole block; every pointer handed out becomes invalid
+    void Release();
+
+    size_t Capacity() const { return capacity; }
+    size_t Used() const { return used; }
+    bool UsingHugePages() const { return hugePagesActive; }
+
+    // Bytes needed to carve a block of 'size' bytes at cache-line alignment
+    static size_t AlignedSize(size_t size) {
+        return (size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    }
+
+private:
+    unsigned char* base = nullptr;
+    size_t capacity = 0;
+    size_t mappedSize = 0;
+    size_t used = 0;
+    bool hugePagesActive = false;
+};
+
+#endif // MEMORYARENA_H
@@ -0,0 +1,202 @@
+/*
+* Real-Time Scan Cycle
+* Absolute-deadline pacing, thread placement and jitter statistics.
+*/
+
+#include "RealTime.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+uint64_t JitterHistogram::PercentileUs(double p) const {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count));
+    uint64_t seen = 0;
+    for (int i = 0; i < 32; i++) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) {
+            return 1ULL << i;
+        }
+    }
+    return 0;
+}
+
+bool ReserveSimulationCpu(int cpu) {
+    const int cpuCount = static_cast<int>(std::thread::hardware_concurrency());
+    if (cpu < 0 || (cpuCount > 0 && cpu >= cpuCount)) {
+        std::cerr << "WARNING: CPU " << cpu << " does not exist (" << cpuCount << " CPUs). Simulation thread not pinned." << std::endl;
+        return false;
+    }
+    if (cpuCount == 1) {
+        std::cerr << "WARNING: Only one CPU available; Snap7 worker threads share it with the simulation thread." << std::endl;
+        return false;
+    }
+#ifdef _WIN32
+    DWORD_PTR processMask = 0, systemMask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+    DWORD_PTR others = processMask & ~(static_cast<DWORD_PTR>(1) << cpu);
+    if (others == 0 || SetThreadAffinityMask(GetCurrentThread(), others) == 0) {
+        std::cerr << "WARNING: Could not keep Snap7 threads off CPU " << cpu << "." << std::endl;
+        return false;
+    }
+#else
+    cpu_set_t others;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(others), &others) != 0) {
+        CPU_ZERO(&others);
+        for (int i = 0; i < cpuCount; i++) {
+            CPU_SET(i, &others);
+        }
+    }
+    CPU_CLR(cpu, &others);
+    int rc = CPU_COUNT(&others) == 0 ? EINVAL : pthread_setaffinity_np(pthread_self(), sizeof(others), &others);
+    if (rc != 0) {
+        std::cerr << "WARNING: Could not keep Snap7 threads off CPU " << cpu << ": " << strerror(rc) << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool EnterRealTimeMode(const RealTimeOptions& options) {
+    bool ok = true;
+#ifdef _WIN32
+    // 1 ms system timer resolution for the waitable-timer fallback and Snap7 itself
+    timeBeginPeriod(1);
+    if (options.cpu >= 0 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << options.cpu) == 0) {
+        std::cerr << "WARNING: Could not pin the simulation thread to CPU " << options.cpu << "." << std::endl;
+        ok = false;
+    }
+    if (options.priority > 0 && !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        std::cerr << "WARNING: Could not raise the simulation thread priority." << std::endl;
+        ok = false;
+    }
+    if (options.lockMemory) {
+        std::cerr << "WARNING: --mlock is not supported on Windows; memory stays pageable." << std::endl;
+        ok = false;
+    }
+#else
+    if (options.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            std::cerr << "WARNING: Could not pin the simulation thread to CPU " << options.cpu << ": " << strerror(rc) << std::endl;
+            ok = false;
+        }
+    }
+    if (options.priority > 0) {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = options.priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            std::cerr << "WARNING: Could not switch the simulation thread to SCHED_FIFO " << options.priority
+                      << ": " << strerror(rc) << " (needs root or CAP_SYS_NICE)" << std::endl;
+            ok = false;
+        }
+    }
+    if (options.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "WARNING: mlockall failed: " << strerror(errno) << " (check ulimit -l)" << std::endl;
+        ok = false;
+    }
+#endif
+    return ok;
+}
+
+void StartScanCycle(ScanCycle& cycle, int cycleMs, std::chrono::steady_clock::time_point now) {
+    cycle = ScanCycle();
+    cycle.period = std::chrono::milliseconds(cycleMs);
+    cycle.deadline = now + cycle.period;
+    cycle.lastWake = now;
+}
+
+namespace {
+
+// Block until the absolute steady_clock time 'deadline'
+void SleepUntilDeadline(std::chrono::steady_clock::time_point deadline) {
+#ifdef _WIN32
+    // Waitable timers take relative due times in 100 ns units; the high-resolution
+    // variant (Windows 10 1803+) avoids the 1 ms timer granularity
+    static HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+        return;
+    }
+    if (!timer) {
+        std::this_thread::sleep_until(deadline);
+        return;
+    }
+    LARGE_INTEGER due;
+    due.QuadPart = -static_cast<LONGLONG>(remaining.count() / 100);
+    SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE);
+    WaitForSingleObject(timer, INFINITE);
+#else
+    // steady_clock is CLOCK_MONOTONIC, so its epoch count is a valid absolute deadline
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#endif
+}
+
+} // namespace
+
+void WaitForNextCycle(ScanCycle& cycle) {
+    SleepUntilDeadline(cycle.deadline);
+    auto wake = std::chrono::steady_clock::now();
+
+    int64_t lateUs = std::chrono::duration_cast<std::chrono::microseconds>(wake - cycle.deadline).count();
+    cycle.lateness.Add(static_cast<uint64_t>(std::max<int64_t>(lateUs, 0)));
+    int64_t periodUs = std::chrono::duration_cast<std::chrono::microseconds>(wake - cycle.lastWake).count();
+    if (cycle.cycles == 0 || periodUs < cycle.minPeriodUs) cycle.minPeriodUs = periodUs;
+    if (cycle.cycles == 0 || periodUs > cycle.maxPeriodUs) cycle.maxPeriodUs = periodUs;
+    cycle.totalPeriodUs += periodUs;
+    cycle.cycles++;
+    cycle.lastWake = wake;
+
+    // Next deadline stays on the original grid, skipping any the loop already missed
+    cycle.deadline += cycle.period;
+    if (wake >= cycle.deadline) {
+        auto missed = (wake - cycle.deadline) / cycle.period + 1;
+        cycle.missedCycles += static_cast<uint64_t>(missed);
+        cycle.deadline += cycle.period * missed;
+    }
+}
+
+void DisplayScanCycleStats(const ScanCycle& cycle) {
+    if (cycle.cycles == 0) {
+        return;
+    }
+    const double requestedMs = std::chrono::duration<double, std::milli>(cycle.period).count();
+    std::cout << "Scan Cycle: requested " << requestedMs << " ms, achieved avg "
+              << (cycle.totalPeriodUs / static_cast<double>(cycle.cycles) / 1000.0) << " ms (min "
+              << (cycle.minPeriodUs / 1000.0) << ", max " << (cycle.maxPeriodUs / 1000.0) << "), "
+              << cycle.cycles << " cycles, " << cycle.missedCycles << " missed" << std::endl;
+    const JitterHistogram& h = cycle.lateness;
+    std::cout << "Wake-up Jitter: avg " << (h.totalUs / h.count) << " us, p50 <= " << h.PercentileUs(50)
+              << " us, p99 <= " << h.PercentileUs(99) << " us, max " << h.maxUs << " us" << std::endl;
+    for (int i = 0; i < 32; i++) {
+        if (h.buckets[i] != 0) {
+            std::cout << "  < " << (1ULL << i) << " us: " << h.buckets[i]
+                      << " (" << (100.0 * h.buckets[i] / h.count) << "%)" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+* Real-Time Scan Cycle
+*
+* Opt-in real-time mode (--realtime <ms>): the simulation loop runs on
+* absolute deadlines of a fixed scan cycle instead of relative sleeps,
+* optionally with SCHED_FIFO priority, a dedicated CPU kept free of Snap7
+* worker threads and locked memory. Wake-up jitter and the achieved cycle
+* time are recorded in a histogram.
+*/
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <chrono>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Real-time settings (command line)
+struct RealTimeOptions {
+    int cycleMs = 0;     // Scan cycle in milliseconds (0: real-time mode off)
+    int priority = 0;    // SCHED_FIFO priority 1-99 (0: keep the default scheduler)
+    int cpu = -1;        // CPU the simulation thread is pinned to (-1: no pinning)
+    bool lockMemory = false;  // mlockall() current and future pages
+};
+
+// Log2 histogram of microsecond durations
+struct JitterHistogram {
+    uint64_t count = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+    uint64_t buckets[32] = {0};  // Bucket i: duration < 2^i microseconds
+
+    void Add(uint64_t us) {
+        // Bucket = number of significant bits, so the hot path needs no loop
+        int bucket = 0;
+        if (us != 0) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, us);
+            bucket = static_cast<int>(index) + 1;
+#else
+            bucket = 64 - __builtin_clzll(us);
+#endif
+            bucket = bucket < 31 ? bucket : 31;
+        }
+        buckets[bucket]++;
+        count++;
+        totalUs += us;
+        maxUs = us > maxUs ? us : maxUs;
+    }
+    uint64_t PercentileUs(double p) const;  // Upper bound of the bucket holding the percentile
+};
+
+// Fixed-period scan cycle driven by absolute deadlines (owned by the simulation thread)
+struct ScanCycle {
+    std::chrono::nanoseconds period{0};
+    std::chrono::steady_clock::time_point deadline;   // Next wake-up
+    std::chrono::steady_clock::time_point lastWake;
+    uint64_t cycles = 0;
+    uint64_t missedCycles = 0;      // Deadlines skipped because a cycle overran by a full period
+    int64_t minPeriodUs = 0;        // Achieved wake-to-wake period
+    int64_t maxPeriodUs = 0;
+    int64_t totalPeriodUs = 0;
+    JitterHistogram lateness;       // Wake-up time minus deadline
+};
+
+// Keep Snap7 worker threads off the simulation CPU. Threads inherit the affinity of
+// the thread that creates them, so call this before Srv_Start() from the thread that
+// starts the server. Returns false (with a warning) if the affinity cannot be set.
+bool ReserveSimulationCpu(int cpu);
+
+// Apply the real-time settings to the calling thread: CPU pinning, SCHED_FIFO
+// priority and memory locking. Each setting that fails (usually for lack of
+// privileges) is reported and skipped; returns false if any failed.
+bool EnterRealTimeMode(const RealTimeOptions& options);
+
+// Start the scan cycle; the first deadline is one period after 'now'
+void StartScanCycle(ScanCycle& cycle, int cycleMs, std::chrono::steady_clock::time_point now);
+
+// Sleep until the next absolute deadline and record the wake-up jitter. A cycle that
+// overran by whole periods skips the missed deadlines instead of running them back to back.
+void WaitForNextCycle(ScanCycle& cycle);
+
+// Print requested vs achieved cycle time and the wake-up jitter histogram
+void DisplayScanCycleStats(const ScanCycle& cycle);
+
+#endif // REALTIME_H
@@ -0,0 +1,426 @@
+/*
+* Hot-Standby Replication
+* Delta frame building, sender and receiver threads, and statistics.
+*/
+
+#include "Replication.h"
+#include "S7Codec.h"
+#include "SocketUtil.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const byte FRAME_MAGIC[4] = {'S', '7', 'R', 'P'};
+const byte ACK_MAGIC[4] = {'S', '7', 'R', 'A'};
+const int MAX_RECORD_LENGTH = 0xFFFF;
+const uint32_t MAX_PAYLOAD_BYTES = 256u * 1024u * 1024u;
+
+void SetWord16(byte* buffer, int offset, int value) {
+    buffer[offset] = static_cast<byte>((value >> 8) & 0xFF);
+    buffer[offset + 1] = static_cast<byte>(value & 0xFF);
+}
+
+int GetWord16(const byte* buffer, int offset) {
+    return (buffer[offset] << 8) | buffer[offset + 1];
+}
+
+uint64_t ElapsedUs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+// Read acknowledgements already waiting on the socket; false when the connection is gone
+bool DrainAcks(SocketHandle s, Replicator& replicator) {
+    byte ack[REPLICATION_ACK_SIZE];
+    while (true) {
+        int ready = WaitReadable(s, 0);
+        if (ready < 0) {
+            return false;
+        }
+        if (ready == 0) {
+            return true;
+        }
+        if (!RecvAll(s, ack, sizeof(ack)) || std::memcmp(ack, ACK_MAGIC, 4) != 0) {
+            return false;
+        }
+        uint32_t sequence = GetDWord(ack, 4);
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(replicator.mutex);
+        // Acks arrive in order; everything up to 'sequence' has been applied
+        while (!replicator.inFlight.empty() &&
+               static_cast<int32_t>(replicator.inFlight.front().first - sequence) <= 0) {
+            if (replicator.inFlight.front().first == sequence) {
+                replicator.lag.Add(ElapsedUs(replicator.inFlight.front().second, now));
+            }
+            replicator.inFlight.pop_front();
+        }
+    }
+}
+
+void SenderLoop(Replicator* replicator) {
+    SocketHandle s = NO_SOCKET;
+    std::deque<std::vector<byte>> batch;
+    while (replicator->running) {
+        if (s == NO_SOCKET) {
+            s = ConnectTcp(replicator->host, replicator->port);
+            if (s == NO_SOCKET) {
+                std::unique_lock<std::mutex> lock(replicator->mutex);
+                replicator->wake.wait_for(lock, std::chrono::seconds(1), [replicator] { return !replicator->running; });
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(replicator->mutex);
+                replicator->frames.clear();
+                replicator->inFlight.clear();
+                replicator->connects++;
+            }
+            // The standby may hold anything: start with the whole image
+            replicator->resyncRequested = true;
+            replicator->connected = true;
+            std::cout << "Replication: connected to standby " << replicator->host << ":" << replicator->port << std::endl;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(replicator->mutex);
+            replicator->wake.wait_for(lock, std::chrono::milliseconds(20),
+                                      [replicator] { return !replicator->running || !replicator->frames.empty(); });
+            batch.swap(replicator->frames);
+        }
+
+        bool ok = true;
+        for (const auto& frame : batch) {
+            if (!SendAll(s, frame.data(), frame.size())) {
+                ok = false;
+                break;
+            }
+            std::lock_guard<std::mutex> lock(replicator->mutex);
+            replicator->framesSent++;
+            replicator->bytesSent += frame.size();
+            replicator->recordsSent += GetDWord(const_cast<byte*>(frame.data()), 8);
+        }
+        batch.clear();
+        ok = ok && DrainAcks(s, *replicator);
+
+        if (!ok) {
+            std::cerr << "WARNING: Replication connection to " << replicator->host << ":" << replicator->port
+                      << " lost. Reconnecting." << std::endl;
+            replicator->connected = false;
+            CloseSocket(s);
+            s = NO_SOCKET;
+        }
+    }
+    if (s != NO_SOCKET) {
+        CloseSocket(s);
+    }
+    replicator->connected = false;
+}
+
+// Apply one frame payload; returns false if it is malformed
+bool ApplyFrame(StandbyReceiver& standby, const byte* payload, size_t size, uint32_t recordCount) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < recordCount; i++) {
+        if (offset + REPLICATION_RECORD_HEADER_SIZE > size) {
+            return false;
+        }
+        int srvArea = payload[offset];
+        int number = GetWord16(payload, static_cast<int>(offset) + 2);
+        int start = GetWord16(payload, static_cast<int>(offset) + 4);
+        int length = GetWord16(payload, static_cast<int>(offset) + 6);
+        offset += REPLICATION_RECORD_HEADER_SIZE;
+        if (offset + length > size) {
+            return false;
+        }
+        const AreaRegion* region = FindRegion(standby.regions, srvArea, number);
+        if (!region || start + length > region->size) {
+            standby.recordErrors++;
+        } else {
+            if (standby.server) {
+                Srv_LockArea(standby.server, region->srvArea, region->number);
+            }
+            std::memcpy(region->data + start, payload + offset, length);
+            if (standby.server) {
+                Srv_UnlockArea(standby.server, region->srvArea, region->number);
+            }
+            standby.recordsApplied++;
+            standby.bytesApplied += static_cast<uint64_t>(length);
+        }
+        offset += static_cast<size_t>(length);
+    }
+    return offset == size;
+}
+
+void ReceiveFrames(StandbyReceiver& standby, SocketHandle s) {
+    byte header[REPLICATION_FRAME_HEADER_SIZE];
+    std::vector<byte> payload;
+    while (standby.running) {
+        int ready = WaitReadable(s, 200);
+        if (ready == 0) {
+            continue;
+        }
+        if (ready < 0 || !RecvAll(s, header, sizeof(header))) {
+            return;
+        }
+        uint32_t payloadBytes = GetDWord(header, 12);
+        if (std::memcmp(header, FRAME_MAGIC, 4) != 0 || payloadBytes > MAX_PAYLOAD_BYTES) {
+            std::cerr << "ERROR: Standby received an invalid replication frame. Dropping the connection." << std::endl;
+            return;
+        }
+        payload.resize(payloadBytes);
+        if (payloadBytes > 0 && !RecvAll(s, payload.data(), payloadBytes)) {
+            return;
+        }
+        uint32_t sequence = GetDWord(header, 4);
+        if (!ApplyFrame(standby, payload.data(), payload.size(), GetDWord(header, 8))) {
+            std::cerr << "ERROR: Standby received a malformed replication frame (sequence " << sequence
+                      << "). Dropping the connection." << std::endl;
+            return;
+        }
+        standby.framesApplied++;
+        standby.lastSequence = sequence;
+
+        byte ack[REPLICATION_ACK_SIZE];
+        std::memcpy(ack, ACK_MAGIC, 4);
+        SetDWord(ack, 4, sequence);
+        if (!SendAll(s, ack, sizeof(ack))) {
+            return;
+        }
+    }
+}
+
+void ReceiverLoop(StandbyReceiver* standby, SocketHandle listener) {
+    while (standby->running) {
+        if (WaitReadable(listener, 200) <= 0) {
+            continue;
+        }
+        SocketHandle s = AcceptConnection(listener);
+        if (s == NO_SOCKET) {
+            continue;
+        }
+        standby->connects++;
+        standby->connected = true;
+        std::cout << "Standby: primary connected" << std::endl;
+        ReceiveFrames(*standby, s);
+        standby->connected = false;
+        CloseSocket(s);
+        if (standby->running) {
+            std::cerr << "WARNING: Standby lost the connection to the primary. Waiting for it to reconnect." << std::endl;
+        }
+    }
+    CloseSocket(listener);
+}
+
+} // namespace
+
+bool ParseEndpoint(const std::string& value, std::string& host, int& port) {
+    size_t colon = value.rfind(':');
+    std::string portText = colon == std::string::npos ? value : value.substr(colon + 1);
+    host = colon == std::string::npos || colon == 0 ? "127.0.0.1" : value.substr(0, colon);
+    if (portText.empty() || portText.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    port = std::atoi(portText.c_str());
+    return port > 0 && port <= 65535;
+}
+
+bool StartReplication(S7Object server, const ProcessImage& image, const std::string& host, int port,
+                      Replicator& replicator) {
+    if (!InitializeSockets()) {
+        std::cerr << "ERROR: Failed to initialize sockets for replication" << std::endl;
+        return false;
+    }
+    InitializeDirtyTracker(image, replicator.dirty);
+    for (const auto& region : replicator.dirty.regions) {
+        if (region.number > 0xFFFF) {
+            std::cerr << "ERROR: DB" << region.number << " cannot be replicated (DB numbers are limited to 65535)" << std::endl;
+            return false;
+        }
+    }
+    replicator.server = server;
+    replicator.host = host;
+    replicator.port = port;
+    replicator.resyncRequested = true;
+    replicator.lastReport = std::chrono::steady_clock::now();
+    replicator.running = true;
+    replicator.sender = std::thread(SenderLoop, &replicator);
+    std::cout << "Replication: shipping dirty ranges of " << replicator.dirty.regions.size() << " areas to "
+              << host << ":" << port << std::endl;
+    return true;
+}
+
+void ShipDirtyRanges(Replicator& replicator) {
+    DirtyTracker& dirty = replicator.dirty;
+    WriteEvent event;
+    if (!replicator.connected) {
+        // Nothing to ship to; the next connection starts with a full resync anyway
+        while (replicator.clientWrites.TryPop(event)) {
+        }
+        return;
+    }
+    uint64_t dropped = replicator.clientWrites.Dropped();
+    if (dropped != replicator.droppedSeen) {
+        // A client write was not recorded: only a full image is known to be correct
+        replicator.droppedSeen = dropped;
+        replicator.resyncRequested = true;
+    }
+    if (replicator.resyncRequested.exchange(false)) {
+        MarkAllDirty(dirty);
+        std::lock_guard<std::mutex> lock(replicator.mutex);
+        replicator.resyncs++;
+    }
+    while (replicator.clientWrites.TryPop(event)) {
+        MarkClientWrite(dirty, event.area, event.dbNumber, event.start, event.size);
+    }
+
+    replicator.ranges.clear();
+    CollectDirtyRanges(dirty, replicator.ranges);
+    if (replicator.ranges.empty()) {
+        return;
+    }
+
+    size_t payloadBytes = 0;
+    uint32_t recordCount = 0;
+    for (const auto& range : replicator.ranges) {
+        uint32_t records = static_cast<uint32_t>((range.length + MAX_RECORD_LENGTH - 1) / MAX_RECORD_LENGTH);
+        recordCount += records;
+        payloadBytes += records * REPLICATION_RECORD_HEADER_SIZE + static_cast<size_t>(range.length);
+    }
+    std::vector<byte> frame(REPLICATION_FRAME_HEADER_SIZE + payloadBytes);
+    uint32_t sequence = ++replicator.sequence;
+    std::memcpy(frame.data(), FRAME_MAGIC, 4);
+    SetDWord(frame.data(), 4, sequence);
+    SetDWord(frame.data(), 8, recordCount);
+    SetDWord(frame.data(), 12, static_cast<uint32_t>(payloadBytes));
+
+    // Ranges are sorted by address, so each region's ranges are adjacent: one lock per region
+    byte* out = frame.data() + REPLICATION_FRAME_HEADER_SIZE;
+    size_t i = 0;
+    while (i < replicator.ranges.size()) {
+        const AreaRegion& region = dirty.regions[replicator.ranges[i].region];
+        if (replicator.server) {
+            Srv_LockArea(replicator.server, region.srvArea, region.number);
+        }
+        for (; i < replicator.ranges.size() && &dirty.regions[replicator.ranges[i].region] == &region; i++) {
+            int start = replicator.ranges[i].start;
+            int remaining = replicator.ranges[i].length;
+            while (remaining > 0) {
+                int length = std::min(remaining, MAX_RECORD_LENGTH);
+                out[0] = static_cast<byte>(region.srvArea);
+                out[1] = 0;
+                SetWord16(out, 2, region.number);
+                SetWord16(out, 4, start);
+                SetWord16(out, 6, length);
+                std::memcpy(out + REPLICATION_RECORD_HEADER_SIZE, region.data + start, length);
+                out += REPLICATION_RECORD_HEADER_SIZE + length;
+                start += length;
+                remaining -= length;
+            }
+        }
+        if (replicator.server) {
+            Srv_UnlockArea(replicator.server, region.srvArea, region.number);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(replicator.mutex);
+        if (replicator.frames.size() >= REPLICATION_MAX_PENDING_FRAMES) {
+            // The standby cannot keep up: one full image replaces the backlog
+            replicator.frames.clear();
+            replicator.overflows++;
+            replicator.resyncRequested = true;
+            return;
+        }
+        replicator.frames.push_back(std::move(frame));
+        replicator.inFlight.push_back(std::make_pair(sequence, std::chrono::steady_clock::now()));
+    }
+    replicator.wake.notify_one();
+}
+
+void StopReplication(Replicator& replicator) {
+    {
+        std::lock_guard<std::mutex> lock(replicator.mutex);
+        replicator.running = false;
+    }
+    replicator.wake.notify_one();
+    if (replicator.sender.joinable()) {
+        replicator.sender.join();
+    }
+}
+
+void DisplayReplicationStats(Replicator& replicator) {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t framesSent, bytesSent, recordsSent, connects, resyncs, overflows;
+    JitterHistogram lag;
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(replicator.mutex);
+        framesSent = replicator.framesSent;
+        bytesSent = replicator.bytesSent;
+        recordsSent = replicator.recordsSent;
+        connects = replicator.connects;
+        resyncs = replicator.resyncs;
+        overflows = replicator.overflows;
+        lag = replicator.lag;
+        pending = replicator.frames.size();
+    }
+    double seconds = std::chrono::duration<double>(now - replicator.lastReport).count();
+    double rate = seconds > 0 ? (bytesSent - replicator.lastReportBytes) / 1024.0 / seconds : 0.0;
+    replicator.lastReport = now;
+    replicator.lastReportBytes = bytesSent;
+
+    std::cout << "Replication to " << replicator.host << ":" << replicator.port << ": "
+              << (replicator.connected ? "connected" : "disconnected") << ", " << framesSent << " frames, "
+              << recordsSent << " records, " << (bytesSent / 1024) << " KB sent (" << rate << " KB/s), "
+              << pending << " queued" << std::endl;
+    if (lag.count > 0) {
+        std::cout << "  Lag: avg " << (lag.totalUs / lag.count) << " us, p99 <= " << lag.PercentileUs(99)
+                  << " us, max " << lag.maxUs << " us" << std::endl;
+    }
+    std::cout << "  Connects: " << connects << ", full resyncs: " << resyncs << ", overflows: " << overflows
+              << ", dropped client write events: " << replicator.clientWrites.Dropped() << std::endl;
+}
+
+bool StartStandby(S7Object server, const ProcessImage& image, const std::string& host, int port,
+                  StandbyReceiver& standby) {
+    if (!InitializeSockets()) {
+        std::cerr << "ERROR: Failed to initialize sockets for the standby listener" << std::endl;
+        return false;
+    }
+    SocketHandle listener = ListenTcp(host, port);
+    if (listener == NO_SOCKET) {
+        std::cerr << "ERROR: Standby cannot listen on " << host << ":" << port << std::endl;
+        return false;
+    }
+    InitializeDirtyTracker(image, standby.regions);
+    standby.server = server;
+    standby.host = host;
+    standby.port = port;
+    standby.lastReport = std::chrono::steady_clock::now();
+    standby.running = true;
+    standby.receiver = std::thread(ReceiverLoop, &standby, listener);
+    std::cout << "Standby: waiting for the primary on " << host << ":" << port << std::endl;
+    return true;
+}
+
+void StopStandby(StandbyReceiver& standby) {
+    standby.running = false;
+    if (standby.receiver.joinable()) {
+        standby.receiver.join();
+    }
+}
+
+void DisplayStandbyStats(StandbyReceiver& standby) {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t bytes = standby.bytesApplied;
+    double seconds = std::chrono::duration<double>(now - standby.lastReport).count();
+    double rate = seconds > 0 ? (bytes - standby.lastReportBytes) / 1024.0 / seconds : 0.0;
+    standby.lastReport = now;
+    standby.lastReportBytes = bytes;
+
+    std::cout << "Standby on " << standby.host << ":" << standby.port << ": "
+              << (standby.connected ? "primary connected" : "no primary") << ", " << standby.framesApplied
+              << " frames, " << standby.recordsApplied << " records, " << (bytes / 1024) << " KB applied ("
+              << rate << " KB/s), last sequence " << standby.lastSequence << ", record errors: "
+              << standby.recordErrors << ", connects: " << standby.connects << std::endl;
+}
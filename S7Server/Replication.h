@@ -0,0 +1,126 @@
+/*
+* Hot-Standby Replication
+*
+* Mirrors the process image of a primary server onto a standby server byte
+* for byte. The primary (--replicate-to [host:]port) collects the dirty
+* ranges of every update pass (tag updates, derived tags, reactions, timers
+* and client writes), copies them under their area locks into one delta
+* frame and queues it for a sender thread, so the simulation loop never
+* waits on the network. The standby (--standby [host:]port) applies every
+* frame under its own area locks and acknowledges it; the primary measures
+* replication lag from frame creation to acknowledgement.
+*
+* A standby that (re)connects first receives every registered area in full,
+* and so does one that falls too far behind. Both servers must be started
+* with the same configuration and area sizes.
+*
+* Frame:  "S7RP" | sequence u32 | record count u32 | payload bytes u32
+* Record: srvArea u8 | 0 u8 | number u16 | start u16 | length u16 | bytes
+* Ack:    "S7RA" | sequence u32                (integers are big-endian)
+*/
+
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TagEngine.h"
+#include "DirtyTracker.h"
+#include "WriteReactions.h"
+
+const int REPLICATION_FRAME_HEADER_SIZE = 16;
+const int REPLICATION_RECORD_HEADER_SIZE = 8;
+const int REPLICATION_ACK_SIZE = 8;
+
+// Frames queued for the sender beyond this count are dropped in favour of a full resync
+const size_t REPLICATION_MAX_PENDING_FRAMES = 64;
+
+// Primary side: dirty tracking, frame building and the sender thread
+struct Replicator {
+    DirtyTracker dirty;                   // Simulation thread only
+    WriteEventQueue clientWrites{16384};  // Filled by the server event callback
+    std::vector<DirtyRange> ranges;       // Scratch buffer for each pass
+    S7Object server = 0;
+    std::string host;
+    int port = 0;
+    uint32_t sequence = 0;
+    uint64_t droppedSeen = 0;             // Client write events lost so far (forces a resync)
+
+    std::thread sender;
+    std::atomic<bool> running{false};
+    std::atomic<bool> connected{false};
+    std::atomic<bool> resyncRequested{true};
+
+    // Guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::vector<byte>> frames;  // Waiting for the sender
+    std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> inFlight;  // Sent, not acknowledged
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t recordsSent = 0;
+    uint64_t connects = 0;
+    uint64_t resyncs = 0;
+    uint64_t overflows = 0;               // Times the sender fell REPLICATION_MAX_PENDING_FRAMES behind
+    JitterHistogram lag;                  // Frame creation to acknowledgement
+
+    // Simulation thread only (throughput between status reports)
+    std::chrono::steady_clock::time_point lastReport;
+    uint64_t lastReportBytes = 0;
+};
+
+// Standby side: receiver thread applying frames to the local process image
+struct StandbyReceiver {
+    DirtyTracker regions;                 // Region lookup only; the bitmap is unused
+    S7Object server = 0;
+    std::string host;
+    int port = 0;
+
+    std::thread receiver;
+    std::atomic<bool> running{false};
+    std::atomic<bool> connected{false};
+    std::atomic<uint64_t> framesApplied{0};
+    std::atomic<uint64_t> bytesApplied{0};
+    std::atomic<uint64_t> recordsApplied{0};
+    std::atomic<uint64_t> recordErrors{0};   // Unknown area or range outside it
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint32_t> lastSequence{0};
+
+    // Status thread only
+    std::chrono::steady_clock::time_point lastReport;
+    uint64_t lastReportBytes = 0;
+};
+
+// Parse "host:port" or "port" (host defaults to 127.0.0.1)
+bool ParseEndpoint(const std::string& value, std::string& host, int& port);
+
+// Start replicating 'image' to the standby at host:port
+bool StartReplication(S7Object server, const ProcessImage& image, const std::string& host, int port,
+                      Replicator& replicator);
+
+// Simulation thread, once per pass after every writer ran: turn queued client writes
+// and the dirty bitmap into one delta frame and hand it to the sender
+void ShipDirtyRanges(Replicator& replicator);
+
+void StopReplication(Replicator& replicator);
+
+// Print frames, records, throughput since the last report and the replication lag
+void DisplayReplicationStats(Replicator& replicator);
+
+// Listen on host:port for a primary and apply its frames to 'image'
+bool StartStandby(S7Object server, const ProcessImage& image, const std::string& host, int port,
+                  StandbyReceiver& standby);
+
+void StopStandby(StandbyReceiver& standby);
+
+// Print applied frames, records, throughput since the last report and errors
+void DisplayStandbyStats(StandbyReceiver& standby);
+
+#endif // REPLICATION_H
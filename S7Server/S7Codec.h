@@ -0,0 +1,109 @@
+/*
+* S7 Data Type Codecs
+* 
+* Big-endian encode/decode helpers for the S7 REAL, DWORD, INT and BOOL data
+* types. Defined inline so the update loop and benchmarks pay no call overhead.
+*/
+
+#ifndef S7CODEC_H
+#define S7CODEC_H
+
+#include <cstdint>
+#include "snap7.h"
+
+// Helper function to convert float to S7 REAL format (big-endian IEEE 754)
+// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
+// The caller is responsible for ensuring the buffer has sufficient space (offset + 4 bytes).
+inline void SetReal(byte* buffer, int offset, float value) {
+    // Convert float to bytes
+    byte* floatBytes = reinterpret_cast<byte*>(&value);
+    
+    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
+    // We need to reverse the byte order
+    buffer[offset + 0] = floatBytes[3];  // Most significant byte
+    buffer[offset + 1] = floatBytes[2];
+    buffer[offset + 2] = floatBytes[1];
+    buffer[offset + 3] = floatBytes[0];  // Least significant byte
+}
+
+// Helper function to read float from S7 REAL format (big-endian IEEE 754)
+inline float GetReal(byte* buffer, int offset) {
+    // S7 uses big-endian byte order, convert to little-endian
+    byte floatBytes[4];
+    floatBytes[3] = buffer[offset + 0];  // Most significant byte
+    floatBytes[2] = buffer[offset + 1];
+    floatBytes[1] = buffer[offset + 2];
+    floatBytes[0] = buffer[offset + 3];  // Least significant byte
+    
+    return *reinterpret_cast<float*>(floatBytes);
+}
+
+// Helper function to convert uint32 to S7 DWORD format (big-endian)
+// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
+// The caller is responsible for ensuring the buffer has sufficient space (offset + 4 bytes).
+inline void SetDWord(byte* buffer, int offset, uint32_t value) {
+    // Convert uint32 to bytes
+    byte* dwordBytes = reinterpret_cast<byte*>(&value);
+    
+    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
+    // We need to reverse the byte order
+    buffer[offset + 0] = dwordBytes[3];  // Most significant byte
+    buffer[offset + 1] = dwordBytes[2];
+    buffer[offset + 2] = dwordBytes[1];
+    buffer[offset + 3] = dwordBytes[0];  // Least significant byte
+}
+
+// Helper function to read uint32 from S7 DWORD format (big-endian)
+inline uint32_t GetDWord(byte* buffer, int offset) {
+    // S7 uses big-endian byte order, convert to little-endian
+    byte dwordBytes[4];
+    dwordBytes[3] = buffer[offset + 0];  // Most significant byte
+    dwordBytes[2] = buffer[offset + 1];
+    dwordBytes[1] = buffer[offset + 2];
+    dwordBytes[0] = buffer[offset + 3];  // Least significant byte
+    
+    return *reinterpret_cast<uint32_t*>(dwordBytes);
+}
+
+// Helper function to convert int16 to S7 INT format (big-endian)
+// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
+// The caller is responsible for ensuring the buffer has sufficient space (offset + 2 bytes).
+inline void SetInt(byte* buffer, int offset, int16_t value) {
+    // Convert int16 to bytes
+    byte* intBytes = reinterpret_cast<byte*>(&value);
+    
+    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
+    // We need to reverse the byte order
+    buffer[offset + 0] = intBytes[1];  // Most significant byte
+    buffer[offset + 1] = intBytes[0];  // Least significant byte
+}
+
+// Helper function to read int16 from S7 INT format (big-endian)
+inline int16_t GetInt(byte* buffer, int offset) {
+    // S7 uses big-endian byte order, convert to little-endian
+    byte intBytes[2];
+    intBytes[1] = buffer[offset + 0];  // Most significant byte
+    intBytes[0] = buffer[offset + 1];  // Least significant byte
+    
+    return *reinterpret_cast<int16_t*>(intBytes);
+}
+
+// Helper function to set a single bit in S7 BOOL format
+// bitPosition: 0-7 (0 is LSB, 7 is MSB)
+inline void SetBool(byte* buffer, int offset, int bitPosition, bool value) {
+    if (value) {
+        // Set bit to 1
+        buffer[offset] |= (1 << bitPosition);
+    } else {
+        // Set bit to 0
+        buffer[offset] &= ~(1 << bitPosition);
+    }
+}
+
+// Helper function to read a single bit from S7 BOOL format
+// bitPosition: 0-7 (0 is LSB, 7 is MSB)
+inline bool GetBool(byte* buffer, int offset, int bitPosition) {
+    return (buffer[offset] & (1 << bitPosition)) != 0;
+}
+
+#endif // S7CODEC_H
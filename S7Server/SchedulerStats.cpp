@@ -0,0 +1,119 @@
+/*
+* Simulation Scheduler Instrumentation
+* Tag lag per cycletime group, loop duration and overruns.
+*/
+
+#include "SchedulerStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// Group the (non-derived) tags by cycletime and assign each tag its group
+void InitializeSchedulerStats(std::vector<TagState>& tagStates, std::chrono::microseconds interval,
+                              SchedulerStats& stats) {
+    stats = SchedulerStats();
+    stats.intervalUs = interval.count();
+
+    std::vector<int> cycletimes;
+    for (const auto& tag : tagStates) {
+        if (!tag.derived) {
+            cycletimes.push_back(tag.cycletime);
+        }
+    }
+    std::sort(cycletimes.begin(), cycletimes.end());
+    cycletimes.erase(std::unique(cycletimes.begin(), cycletimes.end()), cycletimes.end());
+
+    stats.groups.resize(cycletimes.size());
+    for (size_t i = 0; i < cycletimes.size(); i++) {
+        stats.groups[i].cycletime = cycletimes[i];
+    }
+    for (auto& tag : tagStates) {
+        if (tag.derived) {
+            continue;
+        }
+        tag.statsGroup = static_cast<int>(
+            std::lower_bound(cycletimes.begin(), cycletimes.end(), tag.cycletime) - cycletimes.begin());
+        stats.groups[tag.statsGroup].tags++;
+    }
+}
+
+void EndLoopPass(SchedulerStats& stats) {
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - stats.passStart).count();
+    stats.loops++;
+    stats.loopDuration.Add(static_cast<uint64_t>(us));
+    if (us > stats.intervalUs) {
+        stats.overruns++;
+    }
+}
+
+void DisplaySchedulerStats(const SchedulerStats& stats) {
+    if (stats.loops == 0) {
+        return;
+    }
+    const JitterHistogram& d = stats.loopDuration;
+    std::cout << "Simulation Loop: " << stats.loops << " passes, avg " << (d.totalUs / d.count)
+              << " us, p99 <= " << d.PercentileUs(99) << " us, max " << d.maxUs << " us, "
+              << stats.overruns << " overruns (> " << (stats.intervalUs / 1000.0) << " ms)" << std::endl;
+    for (const auto& group : stats.groups) {
+        if (group.lag.count == 0) {
+            continue;
+        }
+        std::cout << "  cycletime " << group.cycletime << " ms (" << group.tags << " tags): "
+                  << group.updates << " updates, lag avg " << (group.lag.totalUs / group.lag.count)
+                  << " us, p99 <= " << group.lag.PercentileUs(99) << " us, max " << group.lag.maxUs
+                  << " us" << std::endl;
+    }
+}
+
+namespace {
+
+// One histogram as a JSON object
+void WriteHistogram(std::ostream& out, const JitterHistogram& h) {
+    out << "{\"count\": " << h.count
+        << ", \"avg\": " << (h.count ? h.totalUs / h.count : 0)
+        << ", \"p50\": " << h.PercentileUs(50)
+        << ", \"p99\": " << h.PercentileUs(99)
+        << ", \"max\": " << h.maxUs << "}";
+}
+
+} // namespace
+
+bool WriteSchedulerStats(const SchedulerStats& stats, const std::string& filename) {
+    // Write a temporary file and rename it, so readers never see a partial dump
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary);
+        if (!out.is_open()) {
+            std::cerr << "WARNING: Could not write scheduler stats to '" << temporary << "'" << std::endl;
+            return false;
+        }
+        out << "{\n";
+        out << "  \"intervalUs\": " << stats.intervalUs << ",\n";
+        out << "  \"loops\": " << stats.loops << ",\n";
+        out << "  \"overruns\": " << stats.overruns << ",\n";
+        out << "  \"loopDurationUs\": ";
+        WriteHistogram(out, stats.loopDuration);
+        out << ",\n  \"groups\": [";
+        for (size_t i = 0; i < stats.groups.size(); i++) {
+            const TagGroupStats& group = stats.groups[i];
+            out << (i ? ",\n" : "\n") << "    {\"cycletimeMs\": " << group.cycletime
+                << ", \"tags\": " << group.tags << ", \"updates\": " << group.updates << ", \"lagUs\": ";
+            WriteHistogram(out, group.lag);
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+        if (!out.good()) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(filename.c_str());  // rename() does not replace an existing file on Windows
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::cerr << "WARNING: Could not replace scheduler stats file '" << filename << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+* Simulation Scheduler Instrumentation
+*
+* Lag between a tag's due time and the cycle that wrote it, per tag group
+* (tags sharing a cycletime), plus the duration of every simulation loop
+* pass and the passes that overran the update interval. The counters are
+* plain fields owned by the simulation thread, so recording costs no
+* atomics or locks; they are printed with the periodic status and can be
+* dumped as JSON (--stats-file).
+*/
+
+#ifndef SCHEDULERSTATS_H
+#define SCHEDULERSTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RealTime.h"
+#include "TagEngine.h"
+
+// Tags sharing one cycletime
+struct TagGroupStats {
+    int cycletime = 0;      // Milliseconds
+    size_t tags = 0;
+    uint64_t updates = 0;
+    JitterHistogram lag;    // Write cycle start minus due time (last update + cycletime)
+};
+
+// Scheduler counters (owned by the simulation thread)
+struct SchedulerStats {
+    std::vector<TagGroupStats> groups;   // Ascending cycletime; TagState::statsGroup indexes it
+    int64_t intervalUs = 0;              // Update interval a loop pass must fit into
+    uint64_t loops = 0;
+    uint64_t overruns = 0;               // Passes that took longer than the interval
+    JitterHistogram loopDuration;        // Work per loop pass (updates, reactions, timers)
+    std::chrono::steady_clock::time_point passStart;
+};
+
+// Group the (non-derived) tags by cycletime and assign each tag its group
+void InitializeSchedulerStats(std::vector<TagState>& tagStates, std::chrono::microseconds interval,
+                              SchedulerStats& stats);
+
+// Record that a due tag was written 'lagUs' after its due time
+inline void RecordTagLag(SchedulerStats& stats, const TagState& tag, int64_t lagUs) {
+    TagGroupStats& group = stats.groups[tag.statsGroup];
+    group.updates++;
+    group.lag.Add(static_cast<uint64_t>(lagUs > 0 ? lagUs : 0));
+}
+
+// Bracket the work of one simulation loop pass
+inline void BeginLoopPass(SchedulerStats& stats) {
+    stats.passStart = std::chrono::steady_clock::now();
+}
+
+void EndLoopPass(SchedulerStats& stats);
+
+// Print loop duration, overruns and the lag of every tag group
+void DisplaySchedulerStats(const SchedulerStats& stats);
+
+// Write the counters as JSON to 'filename' (replaced atomically). Returns false on I/O errors.
+bool WriteSchedulerStats(const SchedulerStats& stats, const std::string& filename);
+
+#endif // SCHEDULERSTATS_H
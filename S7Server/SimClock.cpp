@@ -0,0 +1,36 @@
+/*
+* Simulation Clock
+* Real-time, time-warped and deterministic stepping modes.
+*/
+
+#include "SimClock.h"
+
+SimClock::SimClock() {
+    realStart_ = simStart_ = stepTime_ = std::chrono::steady_clock::now();
+}
+
+void SimClock::Configure(double warp, bool deterministic) {
+    // Restart both time bases so simulated time continues from the current instant
+    stepTime_ = simStart_ = Now();
+    realStart_ = std::chrono::steady_clock::now();
+    warp_ = warp > 0.0 ? warp : 1.0;
+    deterministic_ = deterministic;
+}
+
+void SimClock::Advance(std::chrono::nanoseconds realInterval) {
+    if (deterministic_) {
+        stepTime_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::nano>(realInterval) * warp_);
+    }
+}
+
+SimClock::TimePoint SimClock::ToReal(TimePoint simTime) const {
+    if (deterministic_) {
+        return TimePoint::max();
+    }
+    if (warp_ == 1.0) {
+        return simTime;
+    }
+    return realStart_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::nano>(simTime - simStart_) / warp_);
+}
@@ -0,0 +1,59 @@
+/*
+* Simulation Clock
+*
+* Source of simulated process time for tag phases, derived tags and the
+* T/C areas. By default it is the steady clock. --time-warp <N> runs it N
+* times faster than real time; --deterministic <seed> advances it by
+* exactly one update interval per update pass, so the value sequence
+* does not depend on host load and runs can be reproduced.
+*
+* Client-facing timing (write reactions, injected response times, the
+* data-age timestamp) stays on real time.
+*/
+
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <chrono>
+
+class SimClock {
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    SimClock();
+
+    // Run 'warp' times faster than real time; with 'deterministic' time only moves in Advance()
+    void Configure(double warp, bool deterministic);
+
+    // Current simulated time
+    TimePoint Now() const {
+        if (deterministic_) {
+            return stepTime_;
+        }
+        auto realNow = std::chrono::steady_clock::now();
+        if (warp_ == 1.0) {
+            return realNow;
+        }
+        return simStart_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::nano>(realNow - realStart_) * warp_);
+    }
+
+    // Deterministic mode: advance by one update pass of 'realInterval' (scaled by the warp)
+    void Advance(std::chrono::nanoseconds realInterval);
+
+    // Real time at which the simulated time reaches 'simTime' (for sleeping until a
+    // simulated deadline); TimePoint::max() in deterministic mode
+    TimePoint ToReal(TimePoint simTime) const;
+
+    double Warp() const { return warp_; }
+    bool Deterministic() const { return deterministic_; }
+
+private:
+    double warp_ = 1.0;
+    bool deterministic_ = false;
+    TimePoint realStart_;
+    TimePoint simStart_;
+    TimePoint stepTime_;
+};
+
+#endif // SIMCLOCK_H
@@ -0,0 +1,263 @@
+/*
+* Socket Helpers
+* BSD sockets / Winsock implementation.
+*/
+
+#include "SocketUtil.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if !defined(_WIN32) && defined(MSG_NOSIGNAL)
+const int SEND_FLAGS = MSG_NOSIGNAL;  // A vanished peer must not raise SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+bool ResolveAddress(const std::string& host, int port, sockaddr_in& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1) {
+        return true;
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    address.sin_addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+void SetNoDelay(SocketHandle s) {
+    int noDelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+}
+
+} // namespace
+
+bool InitializeSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void CloseSocket(SocketHandle s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+bool SendAll(SocketHandle s, const byte* data, size_t size) {
+    while (size > 0) {
+        int sent = send(s, reinterpret_cast<const char*>(data), static_cast<int>(std::min<size_t>(size, 1 << 30)), SEND_FLAGS);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool RecvAll(SocketHandle s, byte* data, size_t size) {
+    while (size > 0) {
+        int received = recv(s, reinterpret_cast<char*>(data), static_cast<int>(std::min<size_t>(size, 1 << 30)), 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+bool RecvLine(SocketHandle s, std::string& line, std::string& pending, size_t maxLength) {
+    while (true) {
+        size_t newline = pending.find('\n');
+        if (newline != std::string::npos) {
+            line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        if (pending.size() > maxLength) {
+            return false;
+        }
+        char buffer[1024];
+        int received = recv(s, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return false;
+        }
+        pending.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+int WaitReadable(SocketHandle s, int timeoutMs) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(s, &readSet);
+    timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    int ready = select(static_cast<int>(s) + 1, &readSet, nullptr, nullptr, &timeout);
+    return ready < 0 ? -1 : (ready > 0 ? 1 : 0);
+}
+
+SocketHandle ConnectTcp(const std::string& host, int port) {
+    sockaddr_in address;
+    if (!ResolveAddress(host, port, address)) {
+        return NO_SOCKET;
+    }
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == NO_SOCKET) {
+        return NO_SOCKET;
+    }
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        CloseSocket(s);
+        return NO_SOCKET;
+    }
+    SetNoDelay(s);
+    return s;
+}
+
+SocketHandle ListenTcp(const std::string& host, int port) {
+    sockaddr_in address;
+    if (!ResolveAddress(host, port, address)) {
+        return NO_SOCKET;
+    }
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == NO_SOCKET) {
+        return NO_SOCKET;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(s, 4) != 0) {
+        CloseSocket(s);
+        return NO_SOCKET;
+    }
+    return s;
+}
+
+SocketHandle AcceptConnection(SocketHandle listener) {
+    sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    SocketHandle s = accept(listener, reinterpret_cast<sockaddr*>(&address), &length);
+    if (s != NO_SOCKET && address.ss_family == AF_INET) {
+        SetNoDelay(s);
+    }
+    return s;
+}
+
+SocketHandle ListenUnix(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return NO_SOCKET;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    SocketHandle s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) {
+        return NO_SOCKET;
+    }
+    std::remove(path.c_str());
+    if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(s, 4) != 0) {
+        CloseSocket(s);
+        return NO_SOCKET;
+    }
+    return s;
+}
+
+std::vector<AcceptedConnection> AcceptedConnections(int localPort) {
+    std::vector<AcceptedConnection> connections;
+#ifndef _WIN32
+    auto inspect = [&connections, localPort](int fd) {
+        sockaddr_in local, peer;
+        socklen_t length = sizeof(local);
+        if (getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length) != 0 ||
+            local.sin_family != AF_INET || ntohs(local.sin_port) != localPort) {
+            return;
+        }
+        length = sizeof(peer);
+        if (getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &length) == 0) {
+            AcceptedConnection connection = {fd, peer.sin_addr.s_addr, ntohs(peer.sin_port)};
+            connections.push_back(connection);
+        }
+    };
+    // The open descriptors are listed in /proc on Linux; elsewhere every possible one is tried
+    if (DIR* fds = opendir("/proc/self/fd")) {
+        while (dirent* entry = readdir(fds)) {
+            if (entry->d_name[0] >= '0' && entry->d_name[0] <= '9') {
+                inspect(std::atoi(entry->d_name));
+            }
+        }
+        closedir(fds);
+    } else {
+        long maxFd = std::min(sysconf(_SC_OPEN_MAX), 65536L);
+        for (int fd = 0; fd < maxFd; fd++) {
+            inspect(fd);
+        }
+    }
+#else
+    (void)localPort;
+#endif
+    return connections;
+}
+
+int64_t ReceiveIdleMilliseconds(SocketHandle s) {
+#if defined(__linux__) && defined(TCP_INFO)
+    tcp_info info;
+    socklen_t length = sizeof(info);
+    if (getsockopt(s, IPPROTO_TCP, TCP_INFO, &info, &length) == 0) {
+        return info.tcpi_last_data_recv;
+    }
+#else
+    (void)s;
+#endif
+    return -1;
+}
+
+bool ShutdownConnection(SocketHandle s) {
+#ifdef _WIN32
+    return shutdown(s, SD_BOTH) == 0;
+#else
+    return shutdown(s, SHUT_RDWR) == 0;
+#endif
+}
+
+std::string FormatIPv4(uint32_t address) {
+    const byte* octets = reinterpret_cast<const byte*>(&address);
+    char text[16];
+    std::snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return text;
+}
@@ -0,0 +1,91 @@
+/*
+* Socket Helpers
+*
+* Thin portable layer over BSD sockets and Winsock for the server's side
+* channels (replication link, local query socket). Blocking I/O with
+* select()-based timeouts; every function reports failure through its
+* return value.
+*
+* Snap7 does not expose the sockets of its client connections, so the
+* server finds them by local port (AcceptedConnections) when it has to
+* drop or inspect one. That needs a POSIX fd table and is not available on
+* Windows.
+*/
+
+#ifndef SOCKETUTIL_H
+#define SOCKETUTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Winsock must come before anything that pulls in windows.h
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include "snap7.h"
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+const SocketHandle NO_SOCKET = INVALID_SOCKET;
+#else
+typedef int SocketHandle;
+const SocketHandle NO_SOCKET = -1;
+#endif
+
+// Once per process before any other call (WSAStartup on Windows)
+bool InitializeSockets();
+
+void CloseSocket(SocketHandle s);
+
+// Send or receive exactly 'size' bytes; false once the connection is gone
+bool SendAll(SocketHandle s, const byte* data, size_t size);
+bool RecvAll(SocketHandle s, byte* data, size_t size);
+
+inline bool SendText(SocketHandle s, const std::string& text) {
+    return SendAll(s, reinterpret_cast<const byte*>(text.data()), text.size());
+}
+
+// Read one '\n'-terminated line (without the terminator, '\r' stripped). 'pending'
+// keeps bytes received past the line for the next call. False on disconnect or
+// when a line exceeds maxLength.
+bool RecvLine(SocketHandle s, std::string& line, std::string& pending, size_t maxLength = 4096);
+
+// Wait up to timeoutMs for 's' to become readable: 1 readable, 0 timeout, -1 error
+int WaitReadable(SocketHandle s, int timeoutMs);
+
+// TCP client and listener on an IPv4 host (name or dotted address); TCP_NODELAY is set
+SocketHandle ConnectTcp(const std::string& host, int port);
+SocketHandle ListenTcp(const std::string& host, int port);
+
+// Accept one connection (TCP_NODELAY set for TCP listeners)
+SocketHandle AcceptConnection(SocketHandle listener);
+
+// UNIX domain socket listener at 'path' (AF_UNIX, also on Windows 10 and later).
+// A stale socket file left by a previous run is removed first.
+SocketHandle ListenUnix(const std::string& path);
+
+// Connected TCP socket of this process and its peer
+struct AcceptedConnection {
+    SocketHandle socket;
+    uint32_t peerAddress;  // IPv4, network byte order
+    int peerPort;
+};
+
+// Every connected IPv4 socket of this process whose local port is 'localPort'
+// (always empty on Windows)
+std::vector<AcceptedConnection> AcceptedConnections(int localPort);
+
+// Milliseconds since data last arrived on 's'; -1 where the OS does not report it (Linux only)
+int64_t ReceiveIdleMilliseconds(SocketHandle s);
+
+// Shut down both directions without closing: the thread owning 's' sees the
+// stream end and closes it itself
+bool ShutdownConnection(SocketHandle s);
+
+// Dotted notation of an IPv4 address in network byte order
+std::string FormatIPv4(uint32_t address);
+
+#endif // SOCKETUTIL_H
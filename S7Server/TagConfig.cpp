@@ -0,0 +1,267 @@
+/*
+* CSV Tag Configuration
+* Tag address parsing and CSV loading.
+*/
+
+#include "TagConfig.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+// Size in bytes occupied by a data type (BOOL occupies at least 1 byte)
+int GetTypeSize(DataType dataType) {
+    switch (dataType) {
+        case DataType::REAL:
+            return REAL_SIZE;
+        case DataType::DWORD:
+            return DWORD_SIZE;
+        case DataType::INT:
+            return INT_SIZE;
+        case DataType::BOOL:
+            return 1;
+        default:
+            return REAL_SIZE;  // Default fallback
+    }
+}
+
+bool FitsDataType(DataType dataType, double value) {
+    switch (dataType) {
+        case DataType::REAL: return std::fabs(value) <= 3.4028234663852886e38;  // FLT_MAX
+        case DataType::DWORD: return value >= 0.0 && value <= 4294967295.0;
+        case DataType::INT: return value >= -32768.0 && value <= 32767.0;
+        default: return true;
+    }
+}
+
+// Parse CSV tag format "DB<number>,REAL<offset>", "DB<number>,DWORD<offset>", 
+// "DB<number>,INT<offset>", "DB<number>,X<offset>.<bit>"
+// or Input/Output/Flag bit format "E<offset>.<bit>", "A<offset>.<bit>", "M<offset>.<bit>" (or I/Q)
+bool ParseTag(const std::string& tag, AreaType& areaType, int& dbNumber, int& offset, int& bitPosition, DataType& dataType) {
+    // Remove quotes if present
+    std::string cleanTag = tag;
+    cleanTag.erase(std::remove(cleanTag.begin(), cleanTag.end(), '\"'), cleanTag.end());
+    
+    if (cleanTag.empty()) {
+        return false;
+    }
+    
+    // Check for Input/Output/Flag area format (E/I, A/Q or M prefix)
+    if (cleanTag[0] == 'E' || cleanTag[0] == 'I' || cleanTag[0] == 'A' || cleanTag[0] == 'Q' || cleanTag[0] == 'M') {
+        if (cleanTag[0] == 'E' || cleanTag[0] == 'I') {
+            areaType = AreaType::INPUT;
+        } else if (cleanTag[0] == 'M') {
+            areaType = AreaType::MERKER;
+        } else {
+            areaType = AreaType::OUTPUT;
+        }
+        dbNumber = 0;  // Not applicable for input/output/flag areas
+        dataType = DataType::BOOL;  // Input/output/flag addresses are always BOOL
+        
+        // Parse format: E<offset>.<bit>, A<offset>.<bit>, M<offset>.<bit> (or I/Q)
+        std::string remainder = cleanTag.substr(1);
+        
+        // Find the dot separator
+        size_t dotPos = remainder.find('.');
+        if (dotPos == std::string::npos) {
+            return false;  // Input/output/flag addresses must have bit position
+        }
+        
+        try {
+            std::string offsetStr = remainder.substr(0, dotPos);
+            std::string bitStr = remainder.substr(dotPos + 1);
+            
+            offset = std::stoi(offsetStr);
+            bitPosition = std::stoi(bitStr);
+            
+            // Validate bit position (0-7)
+            if (bitPosition < 0 || bitPosition > 7) {
+                return false;
+            }
+            
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+    
+    // Find DB position
+    size_t dbPos = cleanTag.find("DB");
+    if (dbPos == std::string::npos) {
+        return false;
+    }
+    
+    areaType = AreaType::DB;
+    
+    // Extract DB number (between "DB" and ",")
+    size_t commaPos = cleanTag.find(',');
+    if (commaPos == std::string::npos) {
+        return false;
+    }
+    
+    try {
+        std::string dbNumStr = cleanTag.substr(dbPos + 2, commaPos - dbPos - 2);
+        dbNumber = std::stoi(dbNumStr);
+        
+        // Get the part after the comma
+        std::string typeAndOffset = cleanTag.substr(commaPos + 1);
+        
+        // Check for data type and extract offset
+        size_t realPos = typeAndOffset.find("REAL");
+        size_t dwordPos = typeAndOffset.find("DWORD");
+        size_t intPos = typeAndOffset.find("INT");
+        size_t xPos = typeAndOffset.find("X");
+        
+        bitPosition = -1;  // Default: not a BOOL
+        
+        if (realPos == 0) {
+            // REAL data type
+            dataType = DataType::REAL;
+            std::string offsetStr = typeAndOffset.substr(4);
+            offset = std::stoi(offsetStr);
+            return true;
+        } else if (dwordPos == 0) {
+            // DWORD data type
+            dataType = DataType::DWORD;
+            std::string offsetStr = typeAndOffset.substr(5);
+            offset = std::stoi(offsetStr);
+            return true;
+        } else if (intPos == 0) {
+            // INT data type
+            dataType = DataType::INT;
+            std::string offsetStr = typeAndOffset.substr(3);
+            offset = std::stoi(offsetStr);
+            return true;
+        } else if (xPos == 0) {
+            // BOOL data type (X format: X<offset>.<bit>)
+            dataType = DataType::BOOL;
+            std::string remainder = typeAndOffset.substr(1);
+            
+            // Find the dot separator
+            size_t dotPos = remainder.find('.');
+            if (dotPos == std::string::npos) {
+                return false;  // BOOL must have bit position
+            }
+            
+            std::string offsetStr = remainder.substr(0, dotPos);
+            std::string bitStr = remainder.substr(dotPos + 1);
+            
+            offset = std::stoi(offsetStr);
+            bitPosition = std::stoi(bitStr);
+            
+            // Validate bit position (0-7)
+            if (bitPosition < 0 || bitPosition > 7) {
+                return false;
+            }
+            
+            return true;
+        } else {
+            // Unknown data type
+            dataType = DataType::UNKNOWN;
+            return false;
+        }
+    } catch (...) {
+        return false;
+    }
+}
+
+// Format an address the way ParseTag reads it
+std::string FormatTagAddress(AreaType areaType, int dbNumber, int offset, int bitPosition, DataType dataType) {
+    if (areaType != AreaType::DB) {
+        const char* prefix = areaType == AreaType::INPUT ? "E" : (areaType == AreaType::OUTPUT ? "A" : "M");
+        return prefix + std::to_string(offset) + "." + std::to_string(bitPosition);
+    }
+    std::string address = "DB" + std::to_string(dbNumber) + ",";
+    switch (dataType) {
+        case DataType::REAL: return address + "REAL" + std::to_string(offset);
+        case DataType::DWORD: return address + "DWORD" + std::to_string(offset);
+        case DataType::INT: return address + "INT" + std::to_string(offset);
+        default: return address + "X" + std::to_string(offset) + "." + std::to_string(bitPosition);
+    }
+}
+
+// Helper function to parse CSV line with quoted fields
+std::vector<std::string> ParseCSVLine(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool inQuotes = false;
+    
+    for (size_t i = 0; i < line.length(); ++i) {
+        char c = line[i];
+        
+        if (c == '\"') {
+            inQuotes = !inQuotes;
+        } else if (c == ',' && !inQuotes) {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    
+    // Add the last field
+    fields.push_back(field);
+    
+    return fields;
+}
+
+// Load CSV configuration file
+std::vector<CSVConfigEntry> LoadCSVConfig(const std::string& filename) {
+    std::vector<CSVConfigEntry> entries;
+    std::ifstream file(filename);
+    
+    if (!file.is_open()) {
+        std::cerr << "WARNING: Could not open CSV file '" << filename << "'. Using default configuration." << std::endl;
+        return entries;
+    }
+    
+    std::string line;
+    bool firstLine = true;
+    
+    while (std::getline(file, line)) {
+        // Skip header line
+        if (firstLine) {
+            firstLine = false;
+            continue;
+        }
+        
+        // Skip empty lines
+        if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
+            continue;
+        }
+        
+        // Parse CSV line with proper quote handling
+        std::vector<std::string> fields = ParseCSVLine(line);
+        
+        if (fields.size() >= 5) {
+            CSVConfigEntry entry;
+            
+            // Parse tag to get area type, DB number, offset, bit position, and data type
+            if (!ParseTag(fields[0], entry.areaType, entry.dbNumber, entry.offset, entry.bitPosition, entry.dataType)) {
+                std::cerr << "WARNING: Failed to parse tag: " << fields[0] << std::endl;
+                continue;
+            }
+            
+            try {
+                entry.minValue = std::stod(fields[1]);
+                entry.maxValue = std::stod(fields[2]);
+                entry.echelon = std::stod(fields[3]);
+                entry.cycletime = std::stoi(fields[4]);
+                if (fields.size() >= 6) {
+                    entry.expression = fields[5];
+                    entry.expression.erase(entry.expression.find_last_not_of(" \t\r") + 1);
+                }
+                
+                entries.push_back(entry);
+            } catch (...) {
+                std::cerr << "WARNING: Failed to parse values for tag: " << fields[0] << std::endl;
+                continue;
+            }
+        }
+    }
+    
+    file.close();
+    std::cout << "Loaded " << entries.size() << " entries from CSV configuration." << std::endl;
+    return entries;
+}
@@ -0,0 +1,74 @@
+/*
+* CSV Tag Configuration
+* 
+* Data types and parsers for the 'address.csv' tag configuration:
+* tag,min,max,echelon,cycletime[,expression]
+*/
+
+#ifndef TAGCONFIG_H
+#define TAGCONFIG_H
+
+#include <string>
+#include <vector>
+
+// Constants
+const int REAL_SIZE = 4;   // S7 REAL data type size in bytes
+const int DWORD_SIZE = 4;  // S7 DWORD data type size in bytes
+const int INT_SIZE = 2;    // S7 INT data type size in bytes
+const int BOOL_SIZE = 1;   // S7 BOOL data type size in bits (stored in 1 byte)
+
+// Enumeration for memory area types
+enum class AreaType {
+    DB,      // Data Block
+    INPUT,   // Input area (E/I)
+    OUTPUT,  // Output area (A/Q)
+    MERKER,  // Flag/Marker area (M)
+    UNKNOWN
+};
+
+// Enumeration for data types
+enum class DataType {
+    REAL,
+    DWORD,
+    INT,
+    BOOL,
+    UNKNOWN
+};
+
+// Structure to hold CSV configuration entry
+struct CSVConfigEntry {
+    AreaType areaType;  // Memory area type (DB, INPUT, etc.)
+    int dbNumber;       // DB number (only for DB area type)
+    int offset;
+    int bitPosition;  // For BOOL type (0-7), -1 for other types
+    DataType dataType;
+    double minValue;  // Using double to support both float and uint32 ranges
+    double maxValue;
+    double echelon;
+    int cycletime;
+    std::string expression;  // Derived tag expression (optional 6th column), empty for sawtooth tags
+};
+
+// Size in bytes occupied by a data type (BOOL occupies at least 1 byte)
+int GetTypeSize(DataType dataType);
+
+// True if the data type can hold 'value' without wrapping or overflowing when encoded:
+// REAL within +/-FLT_MAX, DWORD 0..4294967295, INT -32768..32767 (NaN fits none of
+// them); any value for BOOL (non-zero is set)
+bool FitsDataType(DataType dataType, double value);
+
+// Parse CSV tag format "DB<number>,REAL<offset>", "DB<number>,DWORD<offset>", 
+// "DB<number>,INT<offset>", "DB<number>,X<offset>.<bit>"
+// or Input/Output/Flag bit format "E<offset>.<bit>", "A<offset>.<bit>", "M<offset>.<bit>" (or I/Q)
+bool ParseTag(const std::string& tag, AreaType& areaType, int& dbNumber, int& offset, int& bitPosition, DataType& dataType);
+
+// Inverse of ParseTag: "DB1,REAL0", "DB1,X4.2", "E20.0", "A0.1", "M3.7"
+std::string FormatTagAddress(AreaType areaType, int dbNumber, int offset, int bitPosition, DataType dataType);
+
+// Helper function to parse CSV line with quoted fields
+std::vector<std::string> ParseCSVLine(const std::string& line);
+
+// Load CSV configuration file
+std::vector<CSVConfigEntry> LoadCSVConfig(const std::string& filename);
+
+#endif // TAGCONFIG_H
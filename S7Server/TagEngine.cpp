@@ -0,0 +1,501 @@
+/*
+* Tag Simulation Engine
+* Data Block creation, tag state initialization and cyclic value updates.
+*/
+
+#include "TagEngine.h"
+#include "DerivedTags.h"
+#include "SchedulerStats.h"
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Generator behind GenerateRandomValue (reseeded by SeedRandomValues)
+std::mt19937& RandomEngine() {
+    static std::mt19937 gen(std::random_device{}());
+    return gen;
+}
+
+// One sawtooth step: move by echelon, clamp at min/max and reverse there
+void StepSawtooth(TagState& tag) {
+    if (tag.increasing) {
+        tag.currentValue += tag.echelon;
+        
+        // Check if we've reached or exceeded the max value
+        if (tag.currentValue >= tag.maxValue) {
+            tag.currentValue = tag.maxValue;
+            tag.increasing = false;  // Switch to decreasing
+        }
+    } else {
+        tag.currentValue -= tag.echelon;
+        
+        // Check if we've reached or gone below the min value
+        if (tag.currentValue <= tag.minValue) {
+            tag.currentValue = tag.minValue;
+            tag.increasing = true;  // Switch to increasing
+        }
+    }
+}
+
+} // namespace
+
+// Advance the sawtooth by 'steps' steps in closed form, so a pass that covers many
+// cycletimes (time warp, a stalled loop) costs the same as one step. A full sweep from
+// one end to the other takes k = ceil((max - min) / echelon) steps, the last one clamped.
+void AdvanceSawtooth(TagState& tag, int64_t steps) {
+    const double range = tag.maxValue - tag.minValue;
+    if (steps <= 2 || tag.echelon <= 0.0 || range <= 0.0) {
+        // Degenerate ranges alternate between two states at most
+        int64_t n = steps <= 3 ? steps : 2 + steps % 2;
+        for (int64_t i = 0; i < n; i++) {
+            StepSawtooth(tag);
+        }
+        return;
+    }
+    
+    // Steps until the current direction reaches its end
+    const double direction = tag.increasing ? 1.0 : -1.0;
+    double distance = tag.increasing ? tag.maxValue - tag.currentValue : tag.currentValue - tag.minValue;
+    int64_t toEnd = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(distance / tag.echelon)));
+    if (steps < toEnd) {
+        tag.currentValue += direction * static_cast<double>(steps) * tag.echelon;
+        return;
+    }
+    
+    // At the end: the rest is periodic with 2k steps per full sawtooth
+    steps -= toEnd;
+    const double end = tag.increasing ? tag.maxValue : tag.minValue;
+    const double other = tag.increasing ? tag.minValue : tag.maxValue;
+    const int64_t k = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(range / tag.echelon)));
+    int64_t phase = steps % (2 * k);
+    if (phase < k) {
+        tag.currentValue = end - direction * static_cast<double>(phase) * tag.echelon;
+        tag.increasing = !tag.increasing;
+    } else if (phase == k) {
+        tag.currentValue = other;
+    } else {
+        tag.currentValue = other + direction * static_cast<double>(phase - k) * tag.echelon;
+    }
+}
+
+// Generate random float value within range
+float GenerateRandomValue(float minValue, float maxValue) {
+    std::uniform_real_distribution<float> dis(minValue, maxValue);
+    return dis(RandomEngine());
+}
+
+// Make GenerateRandomValue reproducible
+void SeedRandomValues(uint32_t seed) {
+    RandomEngine().seed(seed);
+}
+
+// Create and initialize Data Blocks from CSV configuration
+bool CreateDataBlocksFromCSV(const std::vector<CSVConfigEntry>& entries,
+                             const ServerOptions& options, ProcessImage& image) {
+    std::map<int, int> dbSizes; // DB number -> required size
+    std::map<int, bool> dbHeaderConflict; // DB number -> a tag overlaps the data-age header
+    std::vector<DataBlock>& dataBlocks = image.dataBlocks;
+    const int headerStart = options.dataAgeOffset;
+    const int headerEnd = options.dataAgeOffset + DATA_AGE_HEADER_SIZE;
+    
+    // First pass: determine required size for each DB (skip non-DB entries)
+    for (const auto& entry : entries) {
+        // Only process DB area entries for this function
+        if (entry.areaType != AreaType::DB) {
+            continue;
+        }
+        
+        int typeSize = GetTypeSize(entry.dataType);
+        int requiredSize = entry.offset + typeSize;
+        if (dbSizes.find(entry.dbNumber) == dbSizes.end()) {
+            dbSizes[entry.dbNumber] = requiredSize;
+        } else {
+            dbSizes[entry.dbNumber] = std::max(dbSizes[entry.dbNumber], requiredSize);
+        }
+        
+        if (options.dataAgeHeader && entry.offset < headerEnd && requiredSize > headerStart) {
+            dbHeaderConflict[entry.dbNumber] = true;
+        }
+    }
+    
+    // Second pass: size Data Blocks and reserve capacity to prevent reallocation
+    dataBlocks.clear();
+    dataBlocks.reserve(dbSizes.size());  // Reserve capacity to prevent pointer invalidation
+    for (const auto& pair : dbSizes) {
+        DataBlock db;
+        db.number = pair.first;
+        db.size = pair.second;
+        
+        // Reserve the data-age header unless a configured tag already lives there
+        if (options.dataAgeHeader) {
+            if (dbHeaderConflict[db.number]) {
+                std::cerr << "WARNING: DB" << db.number << " has tags in the data-age header region ("
+                          << headerStart << ".." << (headerEnd - 1) << "), header disabled for this DB" << std::endl;
+            } else {
+                db.hasDataAgeHeader = true;
+                db.size = std::max(db.size, headerEnd);
+            }
+        }
+        db.data = nullptr;
+        dataBlocks.push_back(db);
+    }
+    
+    // One arena for the whole process image: DBs first, then the standard areas
+    image.sizes = options.areaSizes;
+    size_t arenaSize = MemoryArena::AlignedSize(image.sizes.inputs) + MemoryArena::AlignedSize(image.sizes.outputs)
+                     + MemoryArena::AlignedSize(image.sizes.flags) + MemoryArena::AlignedSize(image.sizes.timers)
+                     + MemoryArena::AlignedSize(image.sizes.counters);
+    for (const auto& db : dataBlocks) {
+        arenaSize += MemoryArena::AlignedSize(db.size);
+    }
+    if (!image.arena.Initialize(arenaSize, options.hugePages)) {
+        std::cerr << "ERROR: Failed to allocate " << arenaSize << " bytes for the process image" << std::endl;
+        dataBlocks.clear();
+        return false;
+    }
+    for (auto& db : dataBlocks) {
+        db.data = static_cast<byte*>(image.arena.Allocate(db.size));
+        if (options.verbose) {
+            std::cout << "Allocated DB" << db.number << ": " << db.size << " bytes" << std::endl;
+        }
+    }
+    image.IArea = static_cast<byte*>(image.arena.Allocate(image.sizes.inputs));
+    image.QArea = static_cast<byte*>(image.arena.Allocate(image.sizes.outputs));
+    image.MArea = static_cast<byte*>(image.arena.Allocate(image.sizes.flags));
+    image.TArea = static_cast<byte*>(image.arena.Allocate(image.sizes.timers));
+    image.CArea = static_cast<byte*>(image.arena.Allocate(image.sizes.counters));
+    
+    // Build map for fast lookup (safe now that vector won't reallocate)
+    std::map<int, DataBlock*> dbMap;
+    for (auto& db : dataBlocks) {
+        dbMap[db.number] = &db;
+    }
+    
+    // Third pass: initialize values from CSV using map for fast lookup
+    // Start values at minimum to begin the increasing cycle
+    for (const auto& entry : entries) {
+        // Only process DB area entries for initialization
+        if (entry.areaType != AreaType::DB) {
+            continue;
+        }
+        
+        auto it = dbMap.find(entry.dbNumber);
+        if (it != dbMap.end()) {
+			DataBlock* db = it->second;
+            const bool log = options.verbose;
+
+            if (entry.dataType == DataType::REAL) {
+                float value = static_cast<float>(entry.minValue);  // Start at minimum value
+                SetReal(db->data, entry.offset, value);
+                if (log) std::cout << "  DB" << db->number << ".REAL" << entry.offset << " = " << value 
+                          << " (range: " << entry.minValue << " to " << entry.maxValue << ")" << std::endl;
+            } else if (entry.dataType == DataType::DWORD) {
+                uint32_t value = static_cast<uint32_t>(entry.minValue);  // Start at minimum value
+                SetDWord(db->data, entry.offset, value);
+                if (log) std::cout << "  DB" << db->number << ".DWORD" << entry.offset << " = " << value 
+                          << " (range: " << static_cast<uint32_t>(entry.minValue) 
+                          << " to " << static_cast<uint32_t>(entry.maxValue) << ")" << std::endl;
+            } else if (entry.dataType == DataType::INT) {
+                int16_t value = static_cast<int16_t>(entry.minValue);  // Start at minimum value
+                SetInt(db->data, entry.offset, value);
+                if (log) std::cout << "  DB" << db->number << ".INT" << entry.offset << " = " << value 
+                          << " (range: " << static_cast<int16_t>(entry.minValue) 
+                          << " to " << static_cast<int16_t>(entry.maxValue) << ")" << std::endl;
+            } else if (entry.dataType == DataType::BOOL) {
+                bool value = (entry.minValue != 0);  // Start at minimum value (0 or 1)
+                SetBool(db->data, entry.offset, entry.bitPosition, value);
+                if (log) std::cout << "  DB" << db->number << ".X" << entry.offset << "." << entry.bitPosition 
+                          << " = " << (value ? "true" : "false") 
+                          << " (range: " << static_cast<int>(entry.minValue) 
+                          << " to " << static_cast<int>(entry.maxValue) << ")" << std::endl;
+            }
+        }
+    }
+    
+    // Summary: Show all created Data Blocks
+    if (options.verbose) {
+        std::cout << "\nData Block Summary:" << std::endl;
+        std::cout << "===================" << std::endl;
+        for (const auto& db : dataBlocks) {
+            std::cout << "  DB" << db.number << ": " << db.size << " bytes" << std::endl;
+        }
+        std::cout << "Total Data Blocks: " << dataBlocks.size() << std::endl;
+        std::cout << "===================" << std::endl;
+    }
+    
+    return true;
+}
+
+// Bind a single address to the process image as a tag state
+bool BindTagAddress(const std::string& address, ProcessImage& image, TagState& tag) {
+    if (!ParseTag(address, tag.areaType, tag.dbNumber, tag.offset, tag.bitPosition, tag.dataType)) {
+        std::cerr << "WARNING: Failed to parse address: " << address << std::endl;
+        return false;
+    }
+    
+    int areaSize = 0;
+    tag.dataPtr = nullptr;
+    if (tag.areaType == AreaType::DB) {
+        for (const auto& db : image.dataBlocks) {
+            if (db.number == tag.dbNumber) {
+                tag.dataPtr = db.data;
+                areaSize = db.size;
+                break;
+            }
+        }
+    } else if (tag.areaType == AreaType::INPUT) {
+        tag.dataPtr = image.IArea;
+        areaSize = image.sizes.inputs;
+    } else if (tag.areaType == AreaType::OUTPUT) {
+        tag.dataPtr = image.QArea;
+        areaSize = image.sizes.outputs;
+    } else if (tag.areaType == AreaType::MERKER) {
+        tag.dataPtr = image.MArea;
+        areaSize = image.sizes.flags;
+    }
+    
+    if (!tag.dataPtr || tag.offset + GetTypeSize(tag.dataType) > areaSize) {
+        std::cerr << "WARNING: Address " << address << " is not inside a registered area" << std::endl;
+        return false;
+    }
+    tag.currentValue = ReadTagValue(tag);
+    tag.minValue = tag.maxValue = tag.echelon = 0.0;
+    tag.cycletime = 0;
+    tag.increasing = true;
+    tag.lastUpdateTime = std::chrono::steady_clock::now();
+    return true;
+}
+
+// Initialize tag states from CSV configuration, data blocks, and memory areas
+std::vector<TagState> InitializeTagStates(const std::vector<CSVConfigEntry>& entries, 
+                                          ProcessImage& image, std::chrono::steady_clock::time_point start) {
+    std::vector<TagState> tagStates;
+    byte* IArea = image.IArea;
+    
+    // Build map for fast DB lookup
+    std::map<int, const DataBlock*> dbMap;
+    for (const auto& db : image.dataBlocks) {
+        dbMap[db.number] = &db;
+    }
+    
+    // Create tag state for each CSV entry
+    for (const auto& entry : entries) {
+        TagState state;
+        state.areaType = entry.areaType;
+        state.dbNumber = entry.dbNumber;
+        state.offset = entry.offset;
+        state.bitPosition = entry.bitPosition;
+        state.dataType = entry.dataType;
+        state.currentValue = entry.minValue;  // Start at minimum
+        state.minValue = entry.minValue;
+        state.maxValue = entry.maxValue;
+        state.echelon = entry.echelon;
+        state.cycletime = entry.cycletime;
+        state.increasing = true;  // Start by increasing
+        state.lastUpdateTime = start;
+        
+        // Set data pointer based on area type
+        if (entry.areaType == AreaType::DB) {
+            auto it = dbMap.find(entry.dbNumber);
+            if (it != dbMap.end()) {
+                state.dataPtr = it->second->data;
+            } else {
+                std::cerr << "WARNING: DB" << entry.dbNumber << " not found for tag state" << std::endl;
+                continue;
+            }
+        } else if (entry.areaType == AreaType::INPUT) {
+            if (entry.offset + GetTypeSize(entry.dataType) > image.sizes.inputs) {
+                std::cerr << "WARNING: E" << entry.offset << " is outside the " << image.sizes.inputs
+                          << " byte Input area, tag skipped" << std::endl;
+                continue;
+            }
+            state.dataPtr = IArea;
+            // Initialize the input area value
+            if (entry.dataType == DataType::BOOL) {
+                bool value = (entry.minValue != 0);
+                SetBool(IArea, entry.offset, entry.bitPosition, value);
+                std::cout << "  E" << entry.offset << "." << entry.bitPosition 
+                          << " = " << (value ? "true" : "false")
+                          << " (range: " << static_cast<int>(entry.minValue)
+                          << " to " << static_cast<int>(entry.maxValue) << ")" << std::endl;
+            }
+        } else if (entry.areaType == AreaType::OUTPUT) {
+            if (entry.offset + GetTypeSize(entry.dataType) > image.sizes.outputs) {
+                std::cerr << "WARNING: A" << entry.offset << " is outside the " << image.sizes.outputs
+                          << " byte Output area, tag skipped" << std::endl;
+                continue;
+            }
+            state.dataPtr = image.QArea;
+        } else if (entry.areaType == AreaType::MERKER) {
+            if (entry.offset + GetTypeSize(entry.dataType) > image.sizes.flags) {
+                std::cerr << "WARNING: M" << entry.offset << " is outside the " << image.sizes.flags
+                          << " byte Flags area, tag skipped" << std::endl;
+                continue;
+            }
+            state.dataPtr = image.MArea;
+        } else {
+            std::cerr << "WARNING: Unknown area type for tag state" << std::endl;
+            continue;
+        }
+        
+        tagStates.push_back(state);
+    }
+    
+    std::cout << "\nInitialized " << tagStates.size() << " tag states for dynamic updates." << std::endl;
+    return tagStates;
+}
+
+// Write the data-age header of every DB that reserves one: the cycle counter is
+// incremented and the timestamp set to the time this update cycle produced its values.
+// The area lock keeps clients from reading a half-written header.
+void WriteDataAgeHeaders(S7Object server, std::vector<DataBlock>& dataBlocks, int headerOffset,
+                         std::chrono::system_clock::time_point producedAt, DirtyTracker* dirty) {
+    uint64_t timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        producedAt.time_since_epoch()).count();
+    
+    for (auto& db : dataBlocks) {
+        if (!db.hasDataAgeHeader) {
+            continue;
+        }
+        db.cycleCounter++;
+        Srv_LockArea(server, srvAreaDB, db.number);
+        SetDWord(db.data, headerOffset, db.cycleCounter);
+        SetDWord(db.data, headerOffset + 4, static_cast<uint32_t>(timestampUs >> 32));
+        SetDWord(db.data, headerOffset + 8, static_cast<uint32_t>(timestampUs & 0xFFFFFFFF));
+        Srv_UnlockArea(server, srvAreaDB, db.number);
+        MarkDirty(dirty, db.data + headerOffset, DATA_AGE_HEADER_SIZE);
+    }
+}
+
+// Encode the tag's current value into its memory area
+int SrvAreaIndex(AreaType areaType) {
+    switch (areaType) {
+        case AreaType::INPUT: return srvAreaPE;
+        case AreaType::OUTPUT: return srvAreaPA;
+        case AreaType::MERKER: return srvAreaMK;
+        default: return srvAreaDB;
+    }
+}
+
+int SrvAreaIndex(int s7Area) {
+    switch (s7Area) {
+        case S7AreaPE: return srvAreaPE;
+        case S7AreaPA: return srvAreaPA;
+        case S7AreaMK: return srvAreaMK;
+        case S7AreaCT: return srvAreaCT;
+        case S7AreaTM: return srvAreaTM;
+        case S7AreaDB: return srvAreaDB;
+        default: return -1;
+    }
+}
+
+void WriteTagValue(const TagState& tag) {
+    if (tag.dataType == DataType::REAL) {
+        SetReal(tag.dataPtr, tag.offset, static_cast<float>(tag.currentValue));
+    } else if (tag.dataType == DataType::DWORD) {
+        SetDWord(tag.dataPtr, tag.offset, static_cast<uint32_t>(tag.currentValue));
+    } else if (tag.dataType == DataType::INT) {
+        SetInt(tag.dataPtr, tag.offset, static_cast<int16_t>(tag.currentValue));
+    } else if (tag.dataType == DataType::BOOL) {
+        // For BOOL, toggle between 0 and 1
+        bool boolValue = (static_cast<int>(tag.currentValue) != 0);
+        SetBool(tag.dataPtr, tag.offset, tag.bitPosition, boolValue);
+    }
+}
+
+// Decode the value currently stored at the tag's address (e.g. after a client write)
+double ReadTagValue(const TagState& tag) {
+    if (tag.dataType == DataType::REAL) {
+        return GetReal(tag.dataPtr, tag.offset);
+    } else if (tag.dataType == DataType::DWORD) {
+        return GetDWord(tag.dataPtr, tag.offset);
+    } else if (tag.dataType == DataType::INT) {
+        return GetInt(tag.dataPtr, tag.offset);
+    } else if (tag.dataType == DataType::BOOL) {
+        return GetBool(tag.dataPtr, tag.offset, tag.bitPosition) ? 1.0 : 0.0;
+    }
+    return 0.0;
+}
+
+// Update tag values based on cycletime and echelon
+void UpdateTagValues(S7Object server, std::vector<TagState>& tagStates, std::vector<DataBlock>& dataBlocks,
+                     const ServerOptions& options, DerivedTagGraph* derivedTags,
+                     SchedulerStats* schedulerStats, std::chrono::steady_clock::time_point currentTime,
+                     DirtyTracker* dirty, ValueExporter* exporter) {
+    auto producedAt = std::chrono::system_clock::now();
+    
+    for (size_t i = 0; i < tagStates.size(); i++) {
+        TagState& tag = tagStates[i];
+        if (tag.derived) {
+            continue;  // Recomputed from its sources below
+        }
+        if (tag.frozen || tag.paused) {
+            continue;  // Held through the control API
+        }
+        
+        // Calculate elapsed time since last update in milliseconds
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            currentTime - tag.lastUpdateTime).count();
+        
+        // Check if it's time to update this tag based on cycletime
+        if (elapsed >= tag.cycletime) {
+            if (schedulerStats) {
+                int64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    currentTime - tag.lastUpdateTime).count();
+                RecordTagLag(*schedulerStats, tag, elapsedUs - static_cast<int64_t>(tag.cycletime) * 1000);
+            }
+            
+            // Apply every step that fell due since the last update (usually one) and keep
+            // the tag on its cycletime grid, so time warp and slow passes do not shift its phase
+            if (tag.cycletime > 0) {
+                int64_t steps = elapsed / tag.cycletime;
+                if (steps == 1) {
+                    StepSawtooth(tag);
+                } else {
+                    AdvanceSawtooth(tag, steps);
+                }
+                tag.lastUpdateTime += std::chrono::milliseconds(steps * tag.cycletime);
+            } else {
+                StepSawtooth(tag);
+                tag.lastUpdateTime = currentTime;
+            }
+            
+            // Write the new value to the data block based on data type
+            WriteTagValue(tag);
+            MarkTagDirty(dirty, tag);
+            ExportTagValue(exporter, i, ReadTagValue(tag));
+            if (derivedTags) {
+                MarkTagChanged(*derivedTags, i);
+            }
+        }
+    }
+    
+    FinishTagUpdatePass(server, tagStates, dataBlocks, options, derivedTags, producedAt, dirty, exporter);
+}
+
+// End of an update pass: derived tags, export hand-off and data-age headers
+void FinishTagUpdatePass(S7Object server, std::vector<TagState>& tagStates, std::vector<DataBlock>& dataBlocks,
+                         const ServerOptions& options, DerivedTagGraph* derivedTags,
+                         std::chrono::system_clock::time_point producedAt, DirtyTracker* dirty, ValueExporter* exporter) {
+    if (derivedTags) {
+        RecomputeDerivedTags(*derivedTags, tagStates, dirty, exporter);
+    }
+    FinishExportPass(exporter, std::chrono::duration_cast<std::chrono::microseconds>(
+        producedAt.time_since_epoch()).count());
+    
+    if (options.dataAgeHeader) {
+        WriteDataAgeHeaders(server, dataBlocks, options.dataAgeOffset, producedAt, dirty);
+    }
+}
+
+// Free the whole process image in one step; call only after the server stopped using it
+void ReleaseProcessImage(ProcessImage& image) {
+    image.dataBlocks.clear();
+    image.IArea = image.QArea = image.MArea = image.TArea = image.CArea = nullptr;
+    image.arena.Release();
+}
@@ -0,0 +1,197 @@
+/*
+* Tag Simulation Engine
+* 
+* Data Block creation, tag state initialization and the cyclic sawtooth
+* value update shared by the server and the benchmarks.
+*/
+
+#ifndef TAGENGINE_H
+#define TAGENGINE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "snap7.h"
+#include "S7Codec.h"
+#include "TagConfig.h"
+#include "MemoryArena.h"
+#include "RealTime.h"
+#include "DirtyTracker.h"
+#include "ValueExport.h"
+
+// Data-age header layout (opt-in with --data-age-header):
+//   +0  DWORD  cycle counter, incremented every update cycle
+//   +4  DWORD  timestamp high word (microseconds since Unix epoch)
+//   +8  DWORD  timestamp low word
+const int DATA_AGE_HEADER_SIZE = 12;
+
+// Largest area a 16-bit S7 byte address can reach
+const int MAX_AREA_SIZE = 65536;
+
+// Sizes of the standard memory areas in bytes (--area-size)
+struct AreaSizes {
+    int inputs = 256;    // I (E)
+    int outputs = 256;   // Q (A)
+    int flags = 256;     // M
+    int timers = 512;    // T
+    int counters = 512;  // C (Z)
+};
+
+// Structure to hold tag state for dynamic updates
+struct TagState {
+    AreaType areaType;  // Memory area type (DB, INPUT, etc.)
+    int dbNumber;       // DB number (only for DB area type)
+    int offset;
+    int bitPosition;  // For BOOL type (0-7), -1 for other types
+    DataType dataType;
+    double currentValue;  // Using double to support both float and uint32 ranges
+    double minValue;
+    double maxValue;
+    double echelon;
+    int cycletime;
+    bool increasing;  // true = increasing, false = decreasing
+    std::chrono::steady_clock::time_point lastUpdateTime;
+    byte* dataPtr;  // Pointer to the memory area
+    bool derived = false;  // Value computed from other tags (DerivedTags.h), not the sawtooth
+    int statsGroup = 0;    // Cycletime group in SchedulerStats
+    bool frozen = false;   // Held at its value (control API FREEZE)
+    bool paused = false;   // Its DB is held (control API PAUSE)
+};
+
+// Structure to hold Data Block information
+struct DataBlock {
+    int number;
+    int size;
+    byte* data;
+    bool hasDataAgeHeader = false;  // DB reserves the data-age header region
+    uint32_t cycleCounter = 0;      // Last cycle counter written to the header
+};
+
+// Server configuration (command line)
+struct ServerOptions {
+    std::string configFile = "address.csv";  // CSV tag configuration
+    int port = 102;              // ISO-on-TCP listening port
+    bool verbose = true;         // Print every allocated DB, initialized tag and request
+    bool dataAgeHeader = false;  // Write cycle counter + timestamp into every DB
+    int dataAgeOffset = 0;       // Byte offset of the data-age header in each DB
+    AreaSizes areaSizes;         // Sizes of the I/Q/M/T/C areas
+    bool hugePages = false;      // Back the process image with huge pages if available
+    std::string reactionsFile;   // Write reactions CSV (empty: client writes are not simulated)
+    std::string timersFile;      // Timers/counters CSV (empty: T and C areas stay static)
+    RealTimeOptions realTime;    // Fixed scan cycle on absolute deadlines (--realtime)
+    std::string statsFile;       // JSON dump of the scheduler counters (empty: none)
+    std::string faultsFile;      // Response-time/fault policies CSV (empty: answer instantly)
+    int maxClients = 0;          // Connection cap (0: Snap7 default)
+    int maxClientsPerIp = 0;     // Connection cap per client address (0: none)
+    double clientRequestRate = 0.0;  // Read/write items per second per client address (0: unlimited)
+    double clientByteRate = 0.0;     // Data bytes per second per client address (0: unlimited)
+    int idleTimeoutSec = 0;      // Drop connections that sent nothing for this long (0: never)
+    double timeWarp = 1.0;       // Simulated time runs this many times faster than real time
+    bool deterministic = false;  // Fixed time step per update pass and seeded randomness
+    uint32_t seed = 0;           // Seed used in deterministic mode
+    std::string replicateHost;   // Hot-standby to ship dirty ranges to (empty: no replication)
+    int replicatePort = 0;
+    std::string standbyHost;     // Listen here for a primary and mirror it (empty: normal server)
+    int standbyPort = 0;
+    int historyBytesPerTag = 0;  // Compressed history per tag (0: no history)
+    std::string historySocket = "s7server-history.sock";  // UNIX socket answering history queries
+    std::string controlSocket;   // UNIX socket of the control API (empty: no runtime control)
+    std::string exportFile;      // Columnar export of every value change (empty: no export)
+    bool genericEngine = false;  // Ignore a linked generated update engine
+};
+
+// Simulated PLC memory: every DB and the I/Q/M/T/C areas are carved from one
+// arena, so start-up is a single allocation and teardown a single release
+struct ProcessImage {
+    MemoryArena arena;
+    std::vector<DataBlock> dataBlocks;
+    byte* IArea = nullptr;
+    byte* QArea = nullptr;
+    byte* MArea = nullptr;
+    byte* TArea = nullptr;
+    byte* CArea = nullptr;
+    AreaSizes sizes;
+};
+
+struct DerivedTagGraph;
+struct SchedulerStats;
+
+// Generate random float value within range
+float GenerateRandomValue(float minValue, float maxValue);
+
+// Make GenerateRandomValue reproducible (--deterministic)
+void SeedRandomValues(uint32_t seed);
+
+// Create and initialize Data Blocks from CSV configuration. All DBs (each starting
+// on a cache line) and the standard areas are carved from the image's arena.
+// Returns false if the arena cannot be allocated.
+bool CreateDataBlocksFromCSV(const std::vector<CSVConfigEntry>& entries,
+                             const ServerOptions& options, ProcessImage& image);
+
+// Bind a single address ("DB1,REAL0", "A0.0", ...) to the process image as a tag state
+// holding the value currently stored there. Returns false (with a warning) if the
+// address cannot be parsed or lies outside its DB or area.
+bool BindTagAddress(const std::string& address, ProcessImage& image, TagState& tag);
+
+// Initialize tag states from CSV configuration, data blocks, and memory areas.
+// Tags outside their configured area are skipped with a warning. Every tag's
+// first cycletime starts at 'start' (simulated time, see SimClock.h).
+std::vector<TagState> InitializeTagStates(const std::vector<CSVConfigEntry>& entries, 
+                                          ProcessImage& image,
+                                          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+
+// Write the data-age header of every DB that reserves one: the cycle counter is
+// incremented and the timestamp set to the time this update cycle produced its values.
+// The area lock keeps clients from reading a half-written header.
+void WriteDataAgeHeaders(S7Object server, std::vector<DataBlock>& dataBlocks, int headerOffset,
+                         std::chrono::system_clock::time_point producedAt, DirtyTracker* dirty = nullptr);
+
+// Snap7 server area index (srvAreaPE, srvAreaPA, srvAreaMK, srvAreaDB, ...) for
+// Srv_LockArea and the like: of a tag's area, or of an S7 area code (S7AreaPE, ...;
+// -1 if unknown)
+int SrvAreaIndex(AreaType areaType);
+int SrvAreaIndex(int s7Area);
+
+// Encode the tag's current value into its memory area
+void WriteTagValue(const TagState& tag);
+
+// Mark the tag's bytes as changed for replication (no-op without a tracker)
+inline void MarkTagDirty(DirtyTracker* dirty, const TagState& tag) {
+    if (dirty) {
+        MarkDirty(dirty, tag.dataPtr + tag.offset, GetTypeSize(tag.dataType));
+    }
+}
+
+// Decode the value currently stored at the tag's address (e.g. after a client write)
+double ReadTagValue(const TagState& tag);
+
+// Advance the tag's sawtooth by 'steps' steps, in closed form when there are many
+void AdvanceSawtooth(TagState& tag, int64_t steps);
+
+// Update tag values based on cycletime and echelon at simulated time 'now'. Steps that
+// fell due since a tag's last update are applied in closed form. Derived tags reading a
+// changed tag are recomputed afterwards when a graph is given, the lag of every due
+// tag is recorded when scheduler stats are given, every written byte is marked
+// when a dirty tracker is given, and every changed value is handed to the exporter.
+void UpdateTagValues(S7Object server, std::vector<TagState>& tagStates, std::vector<DataBlock>& dataBlocks,
+                     const ServerOptions& options, DerivedTagGraph* derivedTags = nullptr,
+                     SchedulerStats* schedulerStats = nullptr,
+                     std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now(),
+                     DirtyTracker* dirty = nullptr, ValueExporter* exporter = nullptr);
+
+// Signature of UpdateTagValues, shared by the engines generated for a fixed tag table (GeneratedEngine.h)
+typedef void (*TagUpdateFunction)(S7Object server, std::vector<TagState>& tagStates, std::vector<DataBlock>& dataBlocks,
+                                  const ServerOptions& options, DerivedTagGraph* derivedTags,
+                                  SchedulerStats* schedulerStats, std::chrono::steady_clock::time_point now,
+                                  DirtyTracker* dirty, ValueExporter* exporter);
+
+// End of an update pass, common to all engines: recompute the derived tags, hand the
+// pass to the exporter and write the data-age headers
+void FinishTagUpdatePass(S7Object server, std::vector<TagState>& tagStates, std::vector<DataBlock>& dataBlocks,
+                         const ServerOptions& options, DerivedTagGraph* derivedTags,
+                         std::chrono::system_clock::time_point producedAt, DirtyTracker* dirty, ValueExporter* exporter);
+
+// Free the whole process image in one step; call only after the server stopped using it
+void ReleaseProcessImage(ProcessImage& image);
+
+#endif // TAGENGINE_H
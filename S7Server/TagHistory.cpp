@@ -0,0 +1,531 @@
+/*
+* Tag History
+* Gorilla encoder/decoder, recorder thread and the local query socket.
+*/
+
+#include "TagHistory.h"
+#include "SocketUtil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Worst case of one sample: '1111' + 32-bit delta-of-delta, '11' + 5 + 6 + 64 value bits
+const uint32_t MAX_SAMPLE_BITS = 4 + 32 + 2 + 5 + 6 + 64;
+
+int CountLeadingZeros(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - static_cast<int>(index);
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+int CountTrailingZeros(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+uint64_t DoubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double BitsDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Append the low 'count' bits of 'value' (MSB first) at bit 'pos'
+void WriteBits(uint64_t* words, uint32_t& pos, uint64_t value, int count) {
+    if (count == 0) {
+        return;
+    }
+    if (count < 64) {
+        value &= (uint64_t(1) << count) - 1;
+    }
+    size_t w = pos >> 6;
+    int free = 64 - static_cast<int>(pos & 63);
+    if (count <= free) {
+        words[w] |= value << (free - count);
+    } else {
+        words[w] |= value >> (count - free);
+        words[w + 1] |= value << (64 - (count - free));
+    }
+    pos += static_cast<uint32_t>(count);
+}
+
+uint64_t ReadBits(const uint64_t* words, uint32_t& pos, int count) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t w = pos >> 6;
+    int free = 64 - static_cast<int>(pos & 63);
+    uint64_t value;
+    if (count <= free) {
+        value = words[w] >> (free - count);
+    } else {
+        value = (words[w] << (count - free)) | (words[w + 1] >> (64 - (count - free)));
+    }
+    if (count < 64) {
+        value &= (uint64_t(1) << count) - 1;
+    }
+    pos += static_cast<uint32_t>(count);
+    return value;
+}
+
+uint64_t* SegmentWords(TagHistory& history, size_t tag, uint32_t segment) {
+    return history.words.data() + (tag * HISTORY_SEGMENTS + segment) * history.segmentWords;
+}
+
+// Begin the encoder's current segment with a raw timestamp and value
+void StartSegment(TagHistory& history, size_t tag, int64_t ms, uint64_t bits) {
+    HistoryEncoder& encoder = history.encoders[tag];
+    uint64_t* words = SegmentWords(history, tag, encoder.segment);
+    std::memset(words, 0, history.segmentWords * sizeof(uint64_t));
+    uint32_t pos = 0;
+    WriteBits(words, pos, static_cast<uint64_t>(ms), 64);
+    WriteBits(words, pos, bits, 64);
+
+    HistorySegment& segment = history.segments[tag * HISTORY_SEGMENTS + encoder.segment];
+    segment.firstMs = ms;
+    segment.lastMs = ms;
+    segment.count = 1;
+    segment.bits = pos;
+
+    encoder.lastMs = ms;
+    encoder.lastDeltaMs = 0;
+    encoder.lastBits = bits;
+    encoder.leading = -1;
+    encoder.trailing = 0;
+    encoder.hasValue = true;
+}
+
+void AppendSample(TagHistory& history, size_t tag, int64_t ms, uint64_t bits) {
+    HistoryEncoder& encoder = history.encoders[tag];
+    if (!encoder.hasValue) {
+        StartSegment(history, tag, ms, bits);
+        return;
+    }
+    HistorySegment& segment = history.segments[tag * HISTORY_SEGMENTS + encoder.segment];
+    int64_t delta = ms - encoder.lastMs;
+    int64_t dod = delta - encoder.lastDeltaMs;
+    if (delta < 0 || dod < INT32_MIN || dod > INT32_MAX ||
+        segment.bits + MAX_SAMPLE_BITS > history.segmentWords * 64) {
+        // Full (or the wall clock stepped back): continue in the oldest segment
+        encoder.segment = (encoder.segment + 1) % HISTORY_SEGMENTS;
+        StartSegment(history, tag, ms, bits);
+        return;
+    }
+
+    uint64_t* words = SegmentWords(history, tag, encoder.segment);
+    uint32_t pos = segment.bits;
+    if (dod == 0) {
+        WriteBits(words, pos, 0x0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        WriteBits(words, pos, 0x2, 2);
+        WriteBits(words, pos, static_cast<uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        WriteBits(words, pos, 0x6, 3);
+        WriteBits(words, pos, static_cast<uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        WriteBits(words, pos, 0xE, 4);
+        WriteBits(words, pos, static_cast<uint64_t>(dod + 2047), 12);
+    } else {
+        WriteBits(words, pos, 0xF, 4);
+        WriteBits(words, pos, static_cast<uint32_t>(static_cast<int32_t>(dod)), 32);
+    }
+
+    uint64_t x = bits ^ encoder.lastBits;
+    if (x == 0) {
+        WriteBits(words, pos, 0x0, 1);
+    } else {
+        int leading = std::min(CountLeadingZeros(x), 31);
+        int trailing = CountTrailingZeros(x);
+        if (encoder.leading >= 0 && leading >= encoder.leading && trailing >= encoder.trailing) {
+            // Fits the previous window: only the meaningful bits
+            WriteBits(words, pos, 0x2, 2);
+            WriteBits(words, pos, x >> encoder.trailing, 64 - encoder.leading - encoder.trailing);
+        } else {
+            int length = 64 - leading - trailing;
+            WriteBits(words, pos, 0x3, 2);
+            WriteBits(words, pos, static_cast<uint64_t>(leading), 5);
+            WriteBits(words, pos, static_cast<uint64_t>(length - 1), 6);
+            WriteBits(words, pos, x >> trailing, length);
+            encoder.leading = leading;
+            encoder.trailing = trailing;
+        }
+    }
+
+    segment.bits = pos;
+    segment.count++;
+    segment.lastMs = ms;
+    encoder.lastMs = ms;
+    encoder.lastDeltaMs = delta;
+    encoder.lastBits = bits;
+}
+
+// Decode one segment; samples before 'fromMs' only update 'before' (the value in effect at fromMs)
+void DecodeSegment(const uint64_t* words, const HistorySegment& segment, int64_t fromMs, int64_t toMs,
+                   HistorySample& before, bool& hasBefore, std::vector<HistorySample>& samples) {
+    uint32_t pos = 0;
+    int64_t ms = static_cast<int64_t>(ReadBits(words, pos, 64));
+    uint64_t bits = ReadBits(words, pos, 64);
+    int64_t delta = 0;
+    int leading = 0;
+    int trailing = 0;
+    for (uint32_t i = 0; i < segment.count; i++) {
+        if (i > 0) {
+            int64_t dod;
+            if (ReadBits(words, pos, 1) == 0) {
+                dod = 0;
+            } else if (ReadBits(words, pos, 1) == 0) {
+                dod = static_cast<int64_t>(ReadBits(words, pos, 7)) - 63;
+            } else if (ReadBits(words, pos, 1) == 0) {
+                dod = static_cast<int64_t>(ReadBits(words, pos, 9)) - 255;
+            } else if (ReadBits(words, pos, 1) == 0) {
+                dod = static_cast<int64_t>(ReadBits(words, pos, 12)) - 2047;
+            } else {
+                dod = static_cast<int32_t>(static_cast<uint32_t>(ReadBits(words, pos, 32)));
+            }
+            delta += dod;
+            ms += delta;
+
+            if (ReadBits(words, pos, 1) != 0) {
+                if (ReadBits(words, pos, 1) != 0) {
+                    leading = static_cast<int>(ReadBits(words, pos, 5));
+                    int length = static_cast<int>(ReadBits(words, pos, 6)) + 1;
+                    trailing = 64 - leading - length;
+                }
+                bits ^= ReadBits(words, pos, 64 - leading - trailing) << trailing;
+            }
+        }
+        if (ms > toMs) {
+            return;
+        }
+        HistorySample sample = {ms, BitsDouble(bits)};
+        if (ms < fromMs) {
+            before = sample;
+            hasBefore = true;
+        } else {
+            samples.push_back(sample);
+        }
+    }
+}
+
+void RecorderLoop(TagHistory* history) {
+    while (true) {
+        int64_t ms;
+        {
+            std::unique_lock<std::mutex> lock(history->handoffMutex);
+            history->handoff.wait(lock, [history] { return !history->running || history->pendingFull; });
+            if (!history->running) {
+                return;
+            }
+            history->working.swap(history->pending);
+            ms = history->pendingMs;
+            history->pendingFull = false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(history->mutex);
+            byte* image = history->working.data();
+            for (size_t i = 0; i < history->tagCount; i++) {
+                const HistoryTagRef& ref = history->refs[i];
+                double value;
+                switch (ref.dataType) {
+                    case DataType::REAL: value = GetReal(image, ref.offset); break;
+                    case DataType::DWORD: value = GetDWord(image, ref.offset); break;
+                    case DataType::INT: value = GetInt(image, ref.offset); break;
+                    case DataType::BOOL: value = GetBool(image, ref.offset, ref.bitPosition) ? 1.0 : 0.0; break;
+                    default: value = 0.0; break;
+                }
+                uint64_t bits = DoubleBits(value);
+                const HistoryEncoder& encoder = history->encoders[i];
+                if (encoder.hasValue && encoder.lastBits == bits) {
+                    continue;  // Unchanged: the last sample still holds
+                }
+                AppendSample(*history, i, ms, bits);
+                history->samples++;
+            }
+        }
+        history->recordUs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+int64_t ParseTime(const std::string& text, int64_t now) {
+    int64_t value = std::stoll(text);
+    return value <= 0 ? now + value : value;
+}
+
+std::string HandleQuery(TagHistory& history, const std::string& line) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+    for (auto& c : command) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+    std::ostringstream out;
+
+    if (command == "STATS") {
+        uint64_t samples, bits = 0, stored = 0;
+        {
+            std::lock_guard<std::mutex> lock(history.mutex);
+            samples = history.samples;
+            for (const auto& segment : history.segments) {
+                bits += segment.bits;
+                stored += segment.count;
+            }
+        }
+        out << "tags " << history.tagCount << "\n"
+            << "bytes " << history.words.size() * sizeof(uint64_t) << "\n"
+            << "samples " << samples << "\n"
+            << "stored " << stored << "\n"
+            << "bits_per_sample " << (stored > 0 ? static_cast<double>(bits) / stored : 0.0) << "\n"
+            << "snapshots " << history.snapshots << "\n"
+            << "skipped " << history.skipped << "\n"
+            << "END\n";
+        return out.str();
+    }
+
+    if (command == "QUERY") {
+        std::string tag, fromText, toText;
+        in >> tag >> fromText >> toText;
+        AreaType areaType;
+        int dbNumber, offset, bitPosition;
+        DataType dataType;
+        if (tag.empty() || !ParseTag(tag, areaType, dbNumber, offset, bitPosition, dataType)) {
+            return "ERROR invalid tag address '" + tag + "'\n";
+        }
+        auto it = history.tagIndex.find(std::make_tuple(static_cast<int>(areaType), dbNumber, offset, bitPosition));
+        if (it == history.tagIndex.end()) {
+            return "ERROR " + tag + " is not a simulated tag\n";
+        }
+        int64_t now = NowMs();
+        int64_t fromMs = INT64_MIN;
+        int64_t toMs = now;
+        try {
+            if (!fromText.empty()) fromMs = ParseTime(fromText, now);
+            if (!toText.empty()) toMs = ParseTime(toText, now);
+        } catch (...) {
+            return "ERROR invalid time range\n";
+        }
+        std::vector<HistorySample> samples = QueryTagHistory(history, it->second, fromMs, toMs);
+        out.precision(10);
+        for (const auto& sample : samples) {
+            out << sample.timestampMs << " " << sample.value << "\n";
+        }
+        out << "END " << samples.size() << "\n";
+        return out.str();
+    }
+
+    return "ERROR unknown command (QUERY <tag> [from [to]] or STATS)\n";
+}
+
+void QueryLoop(TagHistory* history, SocketHandle listener) {
+    while (history->running) {
+        if (WaitReadable(listener, 200) <= 0) {
+            continue;
+        }
+        SocketHandle s = AcceptConnection(listener);
+        if (s == NO_SOCKET) {
+            continue;
+        }
+        std::string pending, line;
+        while (history->running) {
+            if (pending.find('\n') == std::string::npos) {
+                int ready = WaitReadable(s, 200);
+                if (ready == 0) {
+                    continue;
+                }
+                if (ready < 0) {
+                    break;
+                }
+            }
+            if (!RecvLine(s, line, pending) || !SendText(s, HandleQuery(*history, line))) {
+                break;
+            }
+        }
+        CloseSocket(s);
+    }
+    CloseSocket(listener);
+}
+
+} // namespace
+
+void InitializeTagHistory(const std::vector<TagState>& tagStates, int bytesPerTag, TagHistory& history) {
+    history.tagCount = tagStates.size();
+    history.segmentWords = static_cast<size_t>(bytesPerTag) / HISTORY_SEGMENTS / sizeof(uint64_t);
+    history.words.assign(history.tagCount * HISTORY_SEGMENTS * history.segmentWords, 0);
+    history.segments.assign(history.tagCount * HISTORY_SEGMENTS, HistorySegment());
+    history.encoders.assign(history.tagCount, HistoryEncoder());
+    history.tagIndex.clear();
+    const byte* first = nullptr;
+    const byte* last = nullptr;
+    for (size_t i = 0; i < tagStates.size(); i++) {
+        const TagState& tag = tagStates[i];
+        history.tagIndex[std::make_tuple(static_cast<int>(tag.areaType), tag.dbNumber, tag.offset, tag.bitPosition)] = i;
+        const byte* begin = tag.dataPtr + tag.offset;
+        const byte* end = begin + GetTypeSize(tag.dataType);
+        first = !first || begin < first ? begin : first;
+        last = !last || end > last ? end : last;
+    }
+    // Every area comes from one arena, so the tags span one contiguous block
+    history.imageBase = first;
+    history.imageSize = static_cast<size_t>(last - first);
+    history.refs.resize(history.tagCount);
+    for (size_t i = 0; i < tagStates.size(); i++) {
+        const TagState& tag = tagStates[i];
+        HistoryTagRef& ref = history.refs[i];
+        ref.offset = static_cast<uint32_t>(tag.dataPtr + tag.offset - first);
+        ref.dataType = tag.dataType;
+        ref.bitPosition = tag.bitPosition;
+    }
+    history.snapshot.resize(history.imageSize);
+    history.pending.resize(history.imageSize);
+    history.working.resize(history.imageSize);
+}
+
+bool StartTagHistory(const std::vector<TagState>& tagStates, int bytesPerTag, const std::string& socketPath,
+                     TagHistory& history) {
+    if (!InitializeSockets()) {
+        std::cerr << "ERROR: Failed to initialize sockets for the history query socket" << std::endl;
+        return false;
+    }
+    SocketHandle listener = ListenUnix(socketPath);
+    if (listener == NO_SOCKET) {
+        std::cerr << "ERROR: Cannot create the history query socket '" << socketPath << "'" << std::endl;
+        return false;
+    }
+
+    InitializeTagHistory(tagStates, bytesPerTag, history);
+    history.socketPath = socketPath;
+    history.running = true;
+    history.recorder = std::thread(RecorderLoop, &history);
+    history.queryServer = std::thread(QueryLoop, &history, listener);
+
+    std::cout << "Tag history: " << history.tagCount << " tags, "
+              << (history.words.size() * sizeof(uint64_t) / 1024) << " KB, queries on '" << socketPath << "'"
+              << std::endl;
+    return true;
+}
+
+void RecordTagHistory(TagHistory& history) {
+    if (!history.running) {
+        return;
+    }
+    std::memcpy(history.snapshot.data(), history.imageBase, history.imageSize);
+    int64_t ms = NowMs();
+    {
+        std::lock_guard<std::mutex> lock(history.handoffMutex);
+        if (history.pendingFull) {
+            history.skipped++;
+            return;
+        }
+        history.pending.swap(history.snapshot);
+        history.pendingMs = ms;
+        history.pendingFull = true;
+    }
+    history.snapshots++;
+    history.handoff.notify_one();
+}
+
+void StopTagHistory(TagHistory& history) {
+    if (!history.running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(history.handoffMutex);
+        history.running = false;
+    }
+    history.handoff.notify_one();
+    if (history.recorder.joinable()) {
+        history.recorder.join();
+    }
+    if (history.queryServer.joinable()) {
+        history.queryServer.join();
+    }
+    std::remove(history.socketPath.c_str());
+}
+
+void AppendTagHistorySample(TagHistory& history, size_t index, int64_t ms, double value) {
+    std::lock_guard<std::mutex> lock(history.mutex);
+    AppendSample(history, index, ms, DoubleBits(value));
+    history.samples++;
+}
+
+std::vector<HistorySample> QueryTagHistory(TagHistory& history, size_t index, int64_t fromMs, int64_t toMs) {
+    std::vector<HistorySample> samples;
+    if (index >= history.tagCount) {
+        return samples;
+    }
+    // Copy the tag's ring under the lock and decode outside it, so the recorder is not held up
+    std::vector<uint64_t> words(HISTORY_SEGMENTS * history.segmentWords);
+    HistorySegment segments[HISTORY_SEGMENTS];
+    uint32_t current;
+    {
+        std::lock_guard<std::mutex> lock(history.mutex);
+        std::memcpy(words.data(), SegmentWords(history, index, 0), words.size() * sizeof(uint64_t));
+        for (int s = 0; s < HISTORY_SEGMENTS; s++) {
+            segments[s] = history.segments[index * HISTORY_SEGMENTS + s];
+        }
+        current = history.encoders[index].segment;
+    }
+
+    HistorySample before = {0, 0.0};
+    bool hasBefore = false;
+    for (int n = 1; n <= HISTORY_SEGMENTS; n++) {
+        uint32_t s = (current + n) % HISTORY_SEGMENTS;  // Oldest first, the current segment last
+        const HistorySegment& segment = segments[s];
+        if (segment.count == 0 || segment.firstMs > toMs) {
+            continue;
+        }
+        DecodeSegment(words.data() + s * history.segmentWords, segment, fromMs, toMs, before, hasBefore, samples);
+    }
+    if (hasBefore) {
+        samples.insert(samples.begin(), before);
+    }
+    return samples;
+}
+
+void DisplayTagHistoryStats(TagHistory& history) {
+    uint64_t samples, bits = 0, stored = 0;
+    {
+        std::lock_guard<std::mutex> lock(history.mutex);
+        samples = history.samples;
+        for (const auto& segment : history.segments) {
+            bits += segment.bits;
+            stored += segment.count;
+        }
+    }
+    uint64_t snapshots = history.snapshots;
+    std::cout << "Tag history: " << samples << " samples recorded, " << stored << " held ("
+              << (stored > 0 ? static_cast<double>(bits) / stored : 0.0) << " bits/sample), "
+              << (history.words.size() * sizeof(uint64_t) / 1024) << " KB, " << snapshots << " snapshots, "
+              << history.skipped << " skipped, encode avg "
+              << (snapshots > 0 ? history.recordUs / snapshots : 0) << " us" << std::endl;
+}
@@ -0,0 +1,135 @@
+/*
+* Tag History
+*
+* Rolling, compressed history of the value every simulated tag published,
+* for checking what a client should have seen at a given moment (--history).
+*
+* Once per update cycle the simulation thread copies the span of the process
+* image holding the tags (one memcpy) and hands it to a recorder thread; it
+* never waits for the recorder (a snapshot still pending is counted as
+* skipped). The recorder decodes every tag from the copy and appends a
+* sample for every tag whose value changed, Gorilla
+* style: delta-of-delta timestamps (milliseconds since the Unix epoch) and
+* XOR-compressed IEEE doubles, packed into a fixed ring of segments per tag.
+* When the current segment is full the oldest one is overwritten, so memory
+* is bounded by tags x --history bytes and allocated once at start-up.
+*
+* A query thread answers a line protocol on a local UNIX socket:
+*   QUERY <tag> [from [to]]  ->  "<epoch ms> <value>" lines, then "END <n>"
+*   STATS                    ->  "<key> <value>" lines, then "END"
+* Times are milliseconds since the Unix epoch; values <= 0 are relative to
+* now (0 = now, -60000 = one minute ago). Errors are answered "ERROR <text>".
+*/
+
+#ifndef TAGHISTORY_H
+#define TAGHISTORY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "TagEngine.h"
+
+// Segments in each tag's ring (the oldest is overwritten when the newest fills up)
+const int HISTORY_SEGMENTS = 4;
+
+// Limits of --history (bytes of compressed history per tag)
+const int HISTORY_MIN_BYTES_PER_TAG = 128;
+const int HISTORY_MAX_BYTES_PER_TAG = 1 << 20;
+
+// One decoded sample
+struct HistorySample {
+    int64_t timestampMs;
+    double value;
+};
+
+// Fill level and first/last sample time of one segment
+struct HistorySegment {
+    int64_t firstMs = 0;
+    int64_t lastMs = 0;
+    uint32_t count = 0;
+    uint32_t bits = 0;
+};
+
+// Where a tag lives in the snapshot
+struct HistoryTagRef {
+    uint32_t offset;     // From TagHistory::imageBase
+    DataType dataType;
+    int bitPosition;
+};
+
+// Encoder state of one tag (recorder thread, guarded by TagHistory::mutex)
+struct HistoryEncoder {
+    uint32_t segment = 0;      // Segment being filled
+    int64_t lastMs = 0;
+    int64_t lastDeltaMs = 0;
+    uint64_t lastBits = 0;     // Last value as IEEE double bits
+    int leading = -1;          // XOR window of the last '11' value (-1: none yet)
+    int trailing = 0;
+    bool hasValue = false;
+};
+
+struct TagHistory {
+    // Fixed at start-up
+    size_t tagCount = 0;
+    size_t segmentWords = 0;    // 64-bit words per segment
+    const byte* imageBase = nullptr;        // Span of the process image holding every tag
+    size_t imageSize = 0;
+    std::vector<HistoryTagRef> refs;
+    std::map<std::tuple<int, int, int, int>, size_t> tagIndex;  // (area, DB, offset, bit) -> tag
+
+    // Guarded by mutex (recorder writes, queries read)
+    std::mutex mutex;
+    std::vector<uint64_t> words;            // tagCount x HISTORY_SEGMENTS x segmentWords
+    std::vector<HistorySegment> segments;   // tagCount x HISTORY_SEGMENTS
+    std::vector<HistoryEncoder> encoders;   // tagCount
+    uint64_t samples = 0;
+
+    // Snapshot hand-off from the simulation thread to the recorder
+    std::mutex handoffMutex;
+    std::condition_variable handoff;
+    std::vector<byte> snapshot;             // Simulation thread only
+    std::vector<byte> pending;              // Guarded by handoffMutex
+    int64_t pendingMs = 0;
+    bool pendingFull = false;
+    std::vector<byte> working;              // Recorder thread only
+    std::atomic<uint64_t> snapshots{0};
+    std::atomic<uint64_t> skipped{0};       // Snapshots dropped because the recorder was busy
+    std::atomic<uint64_t> recordUs{0};      // Time the recorder spent encoding
+
+    std::string socketPath;
+    std::atomic<bool> running{false};
+    std::thread recorder;
+    std::thread queryServer;
+};
+
+// Allocate 'bytesPerTag' of history for every tag and start the recorder and the
+// query socket at 'socketPath'. Returns false if the socket cannot be created.
+bool StartTagHistory(const std::vector<TagState>& tagStates, int bytesPerTag, const std::string& socketPath,
+                     TagHistory& history);
+
+// Allocate the rings and index the tags, without threads or socket (StartTagHistory
+// does this first; tests use it to drive the encoder directly)
+void InitializeTagHistory(const std::vector<TagState>& tagStates, int bytesPerTag, TagHistory& history);
+
+// Append one sample of tag 'index' as the recorder does, without its check for an
+// unchanged value
+void AppendTagHistorySample(TagHistory& history, size_t index, int64_t ms, double value);
+
+// Simulation thread, once per update cycle: snapshot every tag's published value
+void RecordTagHistory(TagHistory& history);
+
+void StopTagHistory(TagHistory& history);
+
+// Samples of tag 'index' with from <= timestamp <= to, oldest first
+std::vector<HistorySample> QueryTagHistory(TagHistory& history, size_t index, int64_t fromMs, int64_t toMs);
+
+// Print memory, sample count, bits per sample and skipped snapshots
+void DisplayTagHistoryStats(TagHistory& history);
+
+#endif // TAGHISTORY_H
@@ -0,0 +1,332 @@
+/*
+* Timers and Counters
+* Configuration, binding and the per-millisecond tick.
+*/
+
+#include "TimerEngine.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Bind a bit address; an empty address means "not connected"
+bool BindBit(const std::string& address, ProcessImage& image, BitRef& bit) {
+    bit.byteAddr = nullptr;
+    bit.mask = 0;
+    if (address.empty()) {
+        return true;
+    }
+    TagState tag;
+    if (!BindTagAddress(address, image, tag)) {
+        return false;
+    }
+    if (tag.dataType != DataType::BOOL) {
+        std::cerr << "WARNING: Timer/counter address " << address << " is not a bit address" << std::endl;
+        return false;
+    }
+    bit.byteAddr = tag.dataPtr + tag.offset;
+    bit.mask = static_cast<uint8_t>(1 << tag.bitPosition);
+    return true;
+}
+
+inline int32_t ReadBit(const BitRef& bit) {
+    return bit.byteAddr ? ((*bit.byteAddr & bit.mask) != 0) : 0;
+}
+
+// Only changed bits are written, so client writes to other bits of the byte are not undone
+inline void WriteBit(const BitRef& bit, int32_t value, DirtyTracker* dirty) {
+    if (bit.byteAddr && ReadBit(bit) != value) {
+        *bit.byteAddr = value ? (*bit.byteAddr | bit.mask) : (*bit.byteAddr & ~bit.mask);
+        MarkDirty(dirty, bit.byteAddr, 1);
+    }
+}
+
+inline void StoreWord(byte* area, int32_t offset, uint16_t word) {
+    area[offset] = static_cast<byte>(word >> 8);
+    area[offset + 1] = static_cast<byte>(word & 0xFF);
+}
+
+// The kernels below work on flat arrays without branches so the compiler can
+// vectorise them; __restrict tells it the arrays do not overlap.
+
+// Advance all timer states by 'elapsed' ms and compute their Q outputs
+void StepTimers(size_t count, int32_t elapsed, const int32_t* __restrict kind, const int32_t* __restrict preset,
+                const int32_t* __restrict input, int32_t* __restrict remaining, int32_t* __restrict lastInput,
+                int32_t* __restrict output) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t in = input[i];
+        int32_t rise = in & (lastInput[i] ^ 1);
+        int32_t fall = (in ^ 1) & lastInput[i];
+        int32_t isTon = kind[i] == 0, isTof = kind[i] == 1, isTp = kind[i] == 2;
+        
+        int32_t rem = remaining[i] - elapsed;
+        rem = rem < 0 ? 0 : rem;
+        // TON starts on a rising edge, TOF on a falling edge, TP on a rising edge when idle
+        int32_t start = -((isTon & rise) | (isTof & fall) | (isTp & rise & (remaining[i] == 0)));
+        rem = (preset[i] & start) | (rem & ~start);
+        // TON is reset while IN is low, TOF while IN is high
+        int32_t reset = -((isTon & (in ^ 1)) | (isTof & in));
+        rem &= ~reset;
+        
+        int32_t running = rem > 0;
+        output[i] = (isTon & in & (running ^ 1)) | (isTof & (in | running)) | (isTp & running);
+        remaining[i] = rem;
+        lastInput[i] = in;
+    }
+}
+
+// S5TIME encoding of the remaining times. The reciprocal of the time base replaces
+// a division by a per-timer divisor, which has no SIMD form; adding 1 - 1e-6 rounds
+// up exactly because the quotients step by at least 1e-4.
+void EncodeTimers(size_t count, const int32_t* __restrict remaining, const double* __restrict baseInverse,
+                  const uint32_t* __restrict baseBits, uint16_t* __restrict encoded) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t value = static_cast<uint32_t>(remaining[i] * baseInverse[i] + (1.0 - 1e-6));
+        value = value > 999 ? 999 : value;
+        encoded[i] = static_cast<uint16_t>(baseBits[i] | ((value / 100) << 8) | (((value / 10) % 10) << 4) | (value % 10));
+    }
+}
+
+// Count rising edges on the up/down inputs and compute the Q outputs
+void StepCounters(size_t count, const int32_t* __restrict kind, const int32_t* __restrict preset,
+                  const int32_t* __restrict up, const int32_t* __restrict down, int32_t* __restrict value,
+                  int32_t* __restrict lastUp, int32_t* __restrict lastDown, int32_t* __restrict output) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = value[i] + (up[i] & (lastUp[i] ^ 1)) - (down[i] & (lastDown[i] ^ 1));
+        v = v < 0 ? 0 : (v > MAX_COUNTER_VALUE ? MAX_COUNTER_VALUE : v);
+        // CTU/CTUD: Q when the preset is reached; CTD: Q when counted down to zero
+        int32_t isCtd = kind[i] == 1;
+        output[i] = (isCtd & (v == 0)) | ((isCtd ^ 1) & (v >= preset[i]));
+        value[i] = v;
+        lastUp[i] = up[i];
+        lastDown[i] = down[i];
+    }
+}
+
+} // namespace
+
+// Load the timers CSV (type,number,preset,input,output)
+std::vector<TimerConfigEntry> LoadTimerConfig(const std::string& filename) {
+    std::vector<TimerConfigEntry> entries;
+    std::ifstream file(filename);
+    
+    if (!file.is_open()) {
+        std::cerr << "WARNING: Could not open timers file '" << filename << "'. T and C areas stay static." << std::endl;
+        return entries;
+    }
+    
+    std::string line;
+    bool firstLine = true;
+    while (std::getline(file, line)) {
+        // Skip header line
+        if (firstLine) {
+            firstLine = false;
+            continue;
+        }
+        
+        // Skip empty lines
+        if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
+            continue;
+        }
+        
+        std::vector<std::string> fields = ParseCSVLine(line);
+        if (fields.size() < 4) {
+            std::cerr << "WARNING: Timer line needs at least 4 fields: " << line << std::endl;
+            continue;
+        }
+        
+        TimerConfigEntry entry;
+        entry.type = fields[0];
+        entry.input = fields[3];
+        if (fields.size() >= 5) {
+            entry.output = fields[4];
+            entry.output.erase(entry.output.find_last_not_of(" \t\r") + 1);
+        }
+        try {
+            entry.number = std::stoi(fields[1]);
+            entry.preset = std::stoi(fields[2]);
+        } catch (...) {
+            std::cerr << "WARNING: Failed to parse values for timer line: " << line << std::endl;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+    
+    std::cout << "Loaded " << entries.size() << " timers/counters from '" << filename << "'." << std::endl;
+    return entries;
+}
+
+// Bind timers and counters to the T/C areas and their input/output bits
+void InitializeTimers(const std::vector<TimerConfigEntry>& entries, ProcessImage& image,
+                      TimerCounterEngine& engine) {
+    engine = TimerCounterEngine();
+    engine.TArea = image.TArea;
+    engine.CArea = image.CArea;
+    TimerBank& t = engine.timers;
+    CounterBank& c = engine.counters;
+    
+    for (const auto& entry : entries) {
+        bool isTimer = entry.type == "TON" || entry.type == "TOF" || entry.type == "TP";
+        bool isCounter = entry.type == "CTU" || entry.type == "CTD" || entry.type == "CTUD";
+        if (!isTimer && !isCounter) {
+            std::cerr << "WARNING: Unknown timer/counter type '" << entry.type << "'" << std::endl;
+            continue;
+        }
+        int areaSize = isTimer ? image.sizes.timers : image.sizes.counters;
+        int wordOffset = entry.number * TIMER_WORD_SIZE;
+        if (entry.number < 0 || wordOffset + TIMER_WORD_SIZE > areaSize) {
+            std::cerr << "WARNING: " << (isTimer ? "T" : "C") << entry.number << " is outside the "
+                      << areaSize << " byte " << (isTimer ? "Timers" : "Counters") << " area" << std::endl;
+            continue;
+        }
+        
+        BitRef output;
+        if (!BindBit(entry.output, image, output)) {
+            continue;
+        }
+        
+        if (isTimer) {
+            BitRef input;
+            if (entry.input.empty() || !BindBit(entry.input, image, input)) {
+                std::cerr << "WARNING: T" << entry.number << " needs an input bit" << std::endl;
+                continue;
+            }
+            int32_t preset = std::max(0, std::min(entry.preset, MAX_S5TIME_MS));
+            // Finest time base that can represent the preset in three BCD digits
+            int32_t baseMs = 10, baseCode = 0;
+            while (baseCode < 3 && preset > 999 * baseMs) {
+                baseMs *= 10;
+                baseCode++;
+            }
+            t.kind.push_back(entry.type == "TON" ? static_cast<int32_t>(TimerKind::TON)
+                             : entry.type == "TOF" ? static_cast<int32_t>(TimerKind::TOF)
+                             : static_cast<int32_t>(TimerKind::TP));
+            t.preset.push_back(preset);
+            t.remaining.push_back(0);
+            t.input.push_back(0);
+            t.lastInput.push_back(0);  // Input already set at startup counts as a rising edge
+            t.output.push_back(0);
+            t.baseInverse.push_back(1.0 / baseMs);
+            t.baseBits.push_back(static_cast<uint32_t>(baseCode) << 12);
+            t.encoded.push_back(EncodeS5Time(0, baseMs, baseCode));
+            t.word.push_back(t.encoded.back());
+            t.wordOffset.push_back(wordOffset);
+            t.inputBits.push_back(input);
+            t.outputBits.push_back(output);
+            StoreWord(engine.TArea, wordOffset, t.word.back());
+        } else {
+            std::string upAddress = entry.input, downAddress;
+            CounterKind kind = entry.type == "CTU" ? CounterKind::CTU
+                             : entry.type == "CTD" ? CounterKind::CTD : CounterKind::CTUD;
+            if (kind == CounterKind::CTUD) {
+                size_t separator = entry.input.find(';');
+                upAddress = entry.input.substr(0, separator);
+                downAddress = separator == std::string::npos ? "" : entry.input.substr(separator + 1);
+            } else if (kind == CounterKind::CTD) {
+                downAddress = entry.input;
+                upAddress.clear();
+            }
+            BitRef up, down;
+            if (!BindBit(upAddress, image, up) || !BindBit(downAddress, image, down)) {
+                continue;
+            }
+            int32_t preset = std::max(0, std::min(entry.preset, MAX_COUNTER_VALUE));
+            int32_t value = (kind == CounterKind::CTD) ? preset : 0;
+            c.kind.push_back(static_cast<int32_t>(kind));
+            c.preset.push_back(preset);
+            c.value.push_back(value);
+            c.up.push_back(ReadBit(up));
+            c.lastUp.push_back(c.up.back());  // No count for inputs already set at startup
+            c.down.push_back(ReadBit(down));
+            c.lastDown.push_back(c.down.back());
+            c.output.push_back(0);
+            c.word.push_back(EncodeCounterBCD(value));
+            c.wordOffset.push_back(wordOffset);
+            c.upBits.push_back(up);
+            c.downBits.push_back(down);
+            c.outputBits.push_back(output);
+            StoreWord(engine.CArea, wordOffset, c.word.back());
+        }
+    }
+    
+    std::cout << "Timers: " << t.kind.size() << ", Counters: " << c.kind.size() << std::endl;
+}
+
+// Advance every timer and counter by the whole milliseconds elapsed since the last tick
+void TickTimersAndCounters(S7Object server, TimerCounterEngine& engine,
+                           std::chrono::steady_clock::time_point now, DirtyTracker* dirty) {
+    if (!engine.started) {
+        engine.started = true;
+        engine.lastTick = now;
+    }
+    int32_t elapsed = static_cast<int32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - engine.lastTick).count());
+    if (elapsed <= 0) {
+        return;
+    }
+    engine.lastTick += std::chrono::milliseconds(elapsed);  // Keep the sub-millisecond remainder
+    auto passStart = std::chrono::steady_clock::now();
+    
+    // Timers: gather inputs, update all states branch-free, then scatter changes
+    TimerBank& t = engine.timers;
+    const size_t timerCount = t.kind.size();
+    for (size_t i = 0; i < timerCount; i++) {
+        t.input[i] = ReadBit(t.inputBits[i]);
+    }
+    StepTimers(timerCount, elapsed, t.kind.data(), t.preset.data(), t.input.data(),
+               t.remaining.data(), t.lastInput.data(), t.output.data());
+    EncodeTimers(timerCount, t.remaining.data(), t.baseInverse.data(), t.baseBits.data(), t.encoded.data());
+    
+    // Counters: gather inputs, count edges, then scatter changes
+    CounterBank& c = engine.counters;
+    const size_t counterCount = c.kind.size();
+    for (size_t i = 0; i < counterCount; i++) {
+        c.up[i] = ReadBit(c.upBits[i]);
+        c.down[i] = ReadBit(c.downBits[i]);
+    }
+    StepCounters(counterCount, c.kind.data(), c.preset.data(), c.up.data(), c.down.data(),
+                 c.value.data(), c.lastUp.data(), c.lastDown.data(), c.output.data());
+    
+    // Scatter changed words under the area locks, then the output bits
+    if (server) Srv_LockArea(server, srvAreaTM, 0);
+    for (size_t i = 0; i < timerCount; i++) {
+        if (t.encoded[i] != t.word[i]) {
+            t.word[i] = t.encoded[i];
+            StoreWord(engine.TArea, t.wordOffset[i], t.word[i]);
+            MarkDirty(dirty, engine.TArea + t.wordOffset[i], 2);
+        }
+    }
+    if (server) Srv_UnlockArea(server, srvAreaTM, 0);
+    if (server) Srv_LockArea(server, srvAreaCT, 0);
+    for (size_t i = 0; i < counterCount; i++) {
+        uint16_t word = EncodeCounterBCD(c.value[i]);
+        if (word != c.word[i]) {
+            c.word[i] = word;
+            StoreWord(engine.CArea, c.wordOffset[i], word);
+            MarkDirty(dirty, engine.CArea + c.wordOffset[i], 2);
+        }
+    }
+    if (server) Srv_UnlockArea(server, srvAreaCT, 0);
+    for (size_t i = 0; i < timerCount; i++) {
+        WriteBit(t.outputBits[i], t.output[i], dirty);
+    }
+    for (size_t i = 0; i < counterCount; i++) {
+        WriteBit(c.outputBits[i], c.output[i], dirty);
+    }
+    
+    engine.ticks++;
+    engine.tickTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - passStart).count();
+}
+
+// Print timer/counter counts and the average cost of a tick
+void DisplayTimerStats(const TimerCounterEngine& engine) {
+    std::cout << "Timers/Counters: " << engine.timers.kind.size() << " timers, " << engine.counters.kind.size()
+              << " counters, " << engine.ticks << " ticks";
+    if (engine.ticks > 0) {
+        std::cout << ", avg " << (engine.tickTimeNs / engine.ticks / 1000.0) << " us per tick";
+    }
+    std::cout << std::endl;
+}
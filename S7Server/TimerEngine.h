@@ -0,0 +1,131 @@
+/*
+* Timers and Counters
+*
+* IEC-style timers (TON, TOF, TP) in the T area and up/down counters (CTU, CTD,
+* CTUD) in the C area, configured in a timers CSV:
+*   type,number,preset,input,output
+*   TON,0,5000,"A0.0","E20.3"     T0: on-delay 5 s, started by Q0.0, Q bit -> I20.3
+*   CTUD,2,10,"A0.1;A0.2",        C2: counts up on Q0.1, down on Q0.2
+*
+* Timer words hold the remaining time in S5TIME format (time base in bits 12-13,
+* three BCD digits), counter words the count in BCD, as in an S7 CPU. The state
+* of every timer and counter lives in flat arrays that are ticked in one
+* branch-free pass per millisecond, so thousands of them cost a few microseconds.
+*/
+
+#ifndef TIMERENGINE_H
+#define TIMERENGINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TagEngine.h"
+
+// Bytes per timer/counter word in the T and C areas
+const int TIMER_WORD_SIZE = 2;
+
+// Longest preset an S5TIME word can hold (999 x 10 s)
+const int MAX_S5TIME_MS = 9990000;
+
+// Largest count a BCD counter word can hold
+const int MAX_COUNTER_VALUE = 999;
+
+enum class TimerKind { TON = 0, TOF = 1, TP = 2 };
+enum class CounterKind { CTU = 0, CTD = 1, CTUD = 2 };
+
+// One line of the timers CSV
+struct TimerConfigEntry {
+    std::string type;    // TON, TOF, TP, CTU, CTD or CTUD
+    int number;          // Timer/counter number (word offset = number * 2)
+    int preset;          // Timers: milliseconds; counters: preset count
+    std::string input;   // Bit address; CTUD: "<up>;<down>"
+    std::string output;  // Optional bit address receiving the Q output
+};
+
+// Bit in the process image read or written by a timer or counter (byteAddr nullptr = none)
+struct BitRef {
+    byte* byteAddr;
+    uint8_t mask;
+};
+
+// Timer state, one array element per timer
+struct TimerBank {
+    std::vector<int32_t> kind;       // TimerKind
+    std::vector<int32_t> preset;     // ms
+    std::vector<int32_t> remaining;  // ms left
+    std::vector<int32_t> input;      // Current IN
+    std::vector<int32_t> lastInput;  // IN at the previous tick (edge detection)
+    std::vector<int32_t> output;     // Q
+    std::vector<double> baseInverse; // 1 / S5TIME time base in ms
+    std::vector<uint32_t> baseBits;  // S5TIME time base code (0..3) in bits 12-13
+    std::vector<uint16_t> encoded;   // S5TIME word computed this tick
+    std::vector<uint16_t> word;      // S5TIME word last written to the T area
+    std::vector<int32_t> wordOffset; // Byte offset in the T area
+    std::vector<BitRef> inputBits;
+    std::vector<BitRef> outputBits;
+};
+
+// Counter state, one array element per counter
+struct CounterBank {
+    std::vector<int32_t> kind;       // CounterKind
+    std::vector<int32_t> preset;
+    std::vector<int32_t> value;      // Current count (0..999)
+    std::vector<int32_t> up;         // Count-up input
+    std::vector<int32_t> lastUp;
+    std::vector<int32_t> down;       // Count-down input
+    std::vector<int32_t> lastDown;
+    std::vector<int32_t> output;     // Q
+    std::vector<uint16_t> word;      // BCD word last written to the C area
+    std::vector<int32_t> wordOffset; // Byte offset in the C area
+    std::vector<BitRef> upBits;
+    std::vector<BitRef> downBits;
+    std::vector<BitRef> outputBits;
+};
+
+// All timers and counters (owned by the simulation thread)
+struct TimerCounterEngine {
+    TimerBank timers;
+    CounterBank counters;
+    byte* TArea = nullptr;
+    byte* CArea = nullptr;
+    bool started = false;
+    std::chrono::steady_clock::time_point lastTick;
+    uint64_t ticks = 0;       // Passes run
+    uint64_t tickTimeNs = 0;  // Time spent in them
+};
+
+// Encode a remaining time as an S5TIME word with the given time base
+inline uint16_t EncodeS5Time(int32_t remainingMs, int32_t baseMs, int32_t baseCode) {
+    int32_t value = (remainingMs + baseMs - 1) / baseMs;  // Round up: a running timer never shows 0
+    value = value > 999 ? 999 : value;
+    return static_cast<uint16_t>((baseCode << 12) | ((value / 100) << 8) | (((value / 10) % 10) << 4) | (value % 10));
+}
+
+// Encode a count (0..999) as a BCD counter word
+inline uint16_t EncodeCounterBCD(int32_t value) {
+    return static_cast<uint16_t>(((value / 100) << 8) | (((value / 10) % 10) << 4) | (value % 10));
+}
+
+// Load the timers CSV (type,number,preset,input,output)
+std::vector<TimerConfigEntry> LoadTimerConfig(const std::string& filename);
+
+// Bind timers and counters to the T/C areas and their input/output bits. Entries
+// with unknown types, addresses or numbers outside the areas are skipped with a warning.
+void InitializeTimers(const std::vector<TimerConfigEntry>& entries, ProcessImage& image,
+                      TimerCounterEngine& engine);
+
+// Advance every timer and counter by the whole milliseconds elapsed since the last tick.
+// Changed words and output bits are marked in 'dirty' when given.
+void TickTimersAndCounters(S7Object server, TimerCounterEngine& engine,
+                           std::chrono::steady_clock::time_point now, DirtyTracker* dirty = nullptr);
+
+// Time of the next 1 ms tick
+inline std::chrono::steady_clock::time_point NextTimerTick(const TimerCounterEngine& engine) {
+    return engine.lastTick + std::chrono::milliseconds(1);
+}
+
+// Print timer/counter counts and the average cost of a tick
+void DisplayTimerStats(const TimerCounterEngine& engine);
+
+#endif // TIMERENGINE_H
@@ -0,0 +1,417 @@
+/*
+* Columnar Value Export
+* Batch hand-off, column encoding, the writer thread and the decoder.
+*/
+
+#include "ValueExport.h"
+#include "TagEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const uint32_t EXPORT_VERSION = 1;
+const byte FILE_MAGIC[4] = {'S', '7', 'C', 'X'};
+const byte BLOCK_MAGIC[4] = {'S', '7', 'C', 'B'};
+
+// Buffer of the output stream; blocks are written with one fwrite each
+const size_t EXPORT_STREAM_BUFFER = 1 << 20;
+
+void PutU32(std::vector<byte>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<byte>(value >> (8 * i)));
+    }
+}
+
+void PutU64(std::vector<byte>& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<byte>(value >> (8 * i)));
+    }
+}
+
+void PutVarint(std::vector<byte>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<byte>(value));
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Bounds-checked cursor over a file or column being decoded
+struct ExportReader {
+    const byte* data;
+    size_t size;
+    size_t pos;
+
+    bool Has(size_t bytes) const { return bytes <= size - pos; }
+
+    bool GetU32(uint32_t& value) {
+        if (!Has(4)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(data[pos++]) << (8 * i);
+        }
+        return true;
+    }
+
+    bool GetU64(uint64_t& value) {
+        if (!Has(8)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+        }
+        return true;
+    }
+
+    bool GetVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+            byte b = data[pos++];
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Decode one block's columns (the reader positioned after its header) into 'file'
+bool DecodeBlock(ExportReader& in, uint32_t rows, int64_t baseUs, uint32_t timestampBytes, uint32_t tagBytes,
+                 uint32_t valueBytes, std::vector<uint64_t>& lastBits, ValueExportFile& file) {
+    if (!in.Has(static_cast<size_t>(timestampBytes) + tagBytes + valueBytes)) {
+        return false;
+    }
+    ExportReader timestamps = {in.data + in.pos, timestampBytes, 0};
+    ExportReader tags = {timestamps.data + timestampBytes, tagBytes, 0};
+    ExportReader values = {tags.data + tagBytes, valueBytes, 0};
+    in.pos += static_cast<size_t>(timestampBytes) + tagBytes + valueBytes;
+
+    std::fill(lastBits.begin(), lastBits.end(), 0);
+    int64_t timestampUs = baseUs;
+    int64_t tag = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+        uint64_t timestampDelta, tagDelta;
+        if (!timestamps.GetVarint(timestampDelta) || !tags.GetVarint(tagDelta) || !values.Has(1)) {
+            return false;
+        }
+        timestampUs += UnZigZag(timestampDelta);
+        tag += UnZigZag(tagDelta);
+        if (tag < 0 || static_cast<size_t>(tag) >= lastBits.size()) {
+            return false;
+        }
+        byte control = values.data[values.pos++];
+        int leading = control >> 4;
+        int trailing = control & 0x0F;
+        if (leading + trailing > 8 || !values.Has(static_cast<size_t>(8 - leading - trailing))) {
+            return false;
+        }
+        uint64_t x = 0;
+        for (int i = 7 - leading; i >= trailing; i--) {
+            x |= static_cast<uint64_t>(values.data[values.pos++]) << (8 * i);
+        }
+        uint64_t bits = lastBits[tag] ^ x;
+        lastBits[tag] = bits;
+        ExportedRow row;
+        row.timestampUs = timestampUs;
+        row.tag = static_cast<uint32_t>(tag);
+        std::memcpy(&row.value, &bits, sizeof(bits));
+        file.rows.push_back(row);
+    }
+    // Every column must be used up exactly
+    return timestamps.pos == timestamps.size && tags.pos == tags.size && values.pos == values.size;
+}
+
+uint8_t DataTypeCode(DataType dataType) {
+    switch (dataType) {
+        case DataType::REAL: return 0;
+        case DataType::DWORD: return 1;
+        case DataType::INT: return 2;
+        default: return 3;
+    }
+}
+
+void AppendRow(ValueExporter& exporter, int64_t timestampUs, const ExportRecord& record) {
+    if (exporter.blockRows == 0) {
+        exporter.blockBaseUs = timestampUs;
+        exporter.lastTimestampUs = timestampUs;
+        exporter.lastTag = 0;
+    }
+    PutVarint(exporter.timestampColumn, ZigZag(timestampUs - exporter.lastTimestampUs));
+    PutVarint(exporter.tagColumn, ZigZag(static_cast<int64_t>(record.tag) - static_cast<int64_t>(exporter.lastTag)));
+    exporter.lastTimestampUs = timestampUs;
+    exporter.lastTag = record.tag;
+
+    uint64_t bits;
+    std::memcpy(&bits, &record.value, sizeof(bits));
+    uint64_t x = bits ^ exporter.lastBits[record.tag];
+    exporter.lastBits[record.tag] = bits;
+    int leading = 0;
+    while (leading < 8 && ((x >> (56 - 8 * leading)) & 0xFF) == 0) {
+        leading++;
+    }
+    int trailing = 0;
+    while (leading + trailing < 8 && ((x >> (8 * trailing)) & 0xFF) == 0) {
+        trailing++;
+    }
+    exporter.valueColumn.push_back(static_cast<byte>((leading << 4) | trailing));
+    for (int i = 7 - leading; i >= trailing; i--) {
+        exporter.valueColumn.push_back(static_cast<byte>(x >> (8 * i)));
+    }
+    exporter.blockRows++;
+}
+
+void WriteBlock(ValueExporter& exporter) {
+    if (exporter.blockRows == 0) {
+        return;
+    }
+    std::vector<byte>& out = exporter.blockBuffer;
+    out.assign(BLOCK_MAGIC, BLOCK_MAGIC + 4);
+    PutU32(out, static_cast<uint32_t>(exporter.blockRows));
+    PutU64(out, static_cast<uint64_t>(exporter.blockBaseUs));
+    PutU32(out, static_cast<uint32_t>(exporter.timestampColumn.size()));
+    PutU32(out, static_cast<uint32_t>(exporter.tagColumn.size()));
+    PutU32(out, static_cast<uint32_t>(exporter.valueColumn.size()));
+    out.insert(out.end(), exporter.timestampColumn.begin(), exporter.timestampColumn.end());
+    out.insert(out.end(), exporter.tagColumn.begin(), exporter.tagColumn.end());
+    out.insert(out.end(), exporter.valueColumn.begin(), exporter.valueColumn.end());
+
+    if (std::fwrite(out.data(), 1, out.size(), exporter.file) != out.size() || std::fflush(exporter.file) != 0) {
+        if (!exporter.writeFailed.exchange(true)) {
+            std::cerr << "ERROR: Writing to export file '" << exporter.path << "' failed" << std::endl;
+        }
+    } else {
+        exporter.fileBytes += out.size();
+        exporter.blocks++;
+    }
+    exporter.timestampColumn.clear();
+    exporter.tagColumn.clear();
+    exporter.valueColumn.clear();
+    std::fill(exporter.lastBits.begin(), exporter.lastBits.end(), 0);
+    exporter.blockRows = 0;
+}
+
+void WriterLoop(ValueExporter* exporter) {
+    std::deque<ExportBatch> work;
+    auto blockStarted = std::chrono::steady_clock::now();
+    bool stopping = false;
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(exporter->mutex);
+            exporter->wake.wait_for(lock, std::chrono::milliseconds(200),
+                                    [exporter] { return !exporter->running || !exporter->batches.empty(); });
+            stopping = !exporter->running;
+            work.swap(exporter->batches);
+        }
+
+        for (auto& batch : work) {
+            for (size_t i = 0; i < batch.count; i++) {
+                const ExportRecord& record = batch.records[i];
+                if (exporter->blockRows == 0) {
+                    blockStarted = std::chrono::steady_clock::now();
+                }
+                AppendRow(*exporter, batch.timestampUs, record);
+                if (exporter->blockRows >= EXPORT_BLOCK_ROWS) {
+                    WriteBlock(*exporter);
+                }
+            }
+            exporter->rows += batch.count;
+        }
+        {
+            // Return the record buffers for reuse by the simulation thread
+            std::lock_guard<std::mutex> lock(exporter->mutex);
+            for (auto& batch : work) {
+                exporter->spare.push_back(std::move(batch.records));
+            }
+        }
+        work.clear();
+
+        // Keep the file current: a partial block is written once it is a second old
+        if (stopping || std::chrono::steady_clock::now() - blockStarted >= std::chrono::seconds(1)) {
+            WriteBlock(*exporter);
+        }
+    }
+}
+
+} // namespace
+
+void ExportOutOfPassValue(ValueExporter* exporter, size_t tagIndex, double value) {
+    if (!exporter) {
+        return;
+    }
+    ExportBatch& pass = exporter->current;
+    if (pass.records.size() < pass.count + exporter->tagCount + 1) {
+        pass.records.resize(pass.count + exporter->tagCount + 1);
+    }
+    ExportTagValue(exporter, tagIndex, value);
+}
+
+void FinishExportPass(ValueExporter* exporter, int64_t timestampUs) {
+    if (!exporter || exporter->current.count == 0) {
+        return;
+    }
+    exporter->current.timestampUs = timestampUs;
+    {
+        std::lock_guard<std::mutex> lock(exporter->mutex);
+        if (exporter->batches.size() >= EXPORT_MAX_PENDING_BATCHES) {
+            exporter->droppedBatches++;
+            exporter->droppedRows += exporter->current.count;
+            exporter->current.count = 0;
+            return;
+        }
+        exporter->batches.push_back(std::move(exporter->current));
+        exporter->current = ExportBatch();
+        if (!exporter->spare.empty()) {
+            exporter->current.records = std::move(exporter->spare.back());
+            exporter->spare.pop_back();
+        }
+    }
+    if (exporter->current.records.empty()) {
+        exporter->current.records.resize(exporter->tagCount);  // Writer behind: one more buffer
+    }
+    exporter->wake.notify_one();
+}
+
+bool StartValueExport(const std::vector<TagState>& tagStates, const std::string& path, ValueExporter& exporter) {
+    exporter.file = std::fopen(path.c_str(), "wb");
+    if (!exporter.file) {
+        std::cerr << "ERROR: Cannot create export file '" << path << "'" << std::endl;
+        return false;
+    }
+    std::setvbuf(exporter.file, nullptr, _IOFBF, EXPORT_STREAM_BUFFER);
+
+    std::vector<byte> header(FILE_MAGIC, FILE_MAGIC + 4);
+    PutU32(header, EXPORT_VERSION);
+    PutU32(header, static_cast<uint32_t>(tagStates.size()));
+    for (const auto& tag : tagStates) {
+        std::string name = FormatTagAddress(tag.areaType, tag.dbNumber, tag.offset, tag.bitPosition, tag.dataType);
+        header.push_back(DataTypeCode(tag.dataType));
+        header.push_back(static_cast<byte>(name.size()));
+        header.insert(header.end(), name.begin(), name.end());
+    }
+    if (std::fwrite(header.data(), 1, header.size(), exporter.file) != header.size()) {
+        std::cerr << "ERROR: Writing to export file '" << path << "' failed" << std::endl;
+        std::fclose(exporter.file);
+        exporter.file = nullptr;
+        return false;
+    }
+    exporter.fileBytes = header.size();
+    exporter.path = path;
+    exporter.lastBits.assign(tagStates.size(), 0);
+    exporter.tagCount = tagStates.size();
+    exporter.current.records.resize(tagStates.size());
+    exporter.running = true;
+    exporter.writer = std::thread(WriterLoop, &exporter);
+    std::cout << "Value export: every change of " << tagStates.size() << " tags to '" << path << "'" << std::endl;
+    return true;
+}
+
+void StopValueExport(ValueExporter& exporter) {
+    if (!exporter.running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(exporter.mutex);
+        exporter.running = false;
+    }
+    exporter.wake.notify_one();
+    if (exporter.writer.joinable()) {
+        exporter.writer.join();
+    }
+    std::fclose(exporter.file);
+    exporter.file = nullptr;
+}
+
+bool ReadValueExport(const std::string& path, ValueExportFile& file) {
+    file = ValueExportFile();
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "ERROR: Cannot open export file '" << path << "'" << std::endl;
+        return false;
+    }
+    std::vector<byte> data;
+    byte chunk[65536];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    std::fclose(f);
+
+    ExportReader in = {data.data(), data.size(), 0};
+    uint32_t version, tagCount;
+    if (!in.Has(4) || std::memcmp(in.data, FILE_MAGIC, 4) != 0) {
+        std::cerr << "ERROR: '" << path << "' is not a value export file" << std::endl;
+        return false;
+    }
+    in.pos = 4;
+    if (!in.GetU32(version) || version != EXPORT_VERSION || !in.GetU32(tagCount)) {
+        std::cerr << "ERROR: Unsupported export file version in '" << path << "'" << std::endl;
+        return false;
+    }
+    for (uint32_t i = 0; i < tagCount; i++) {
+        if (!in.Has(2) || !in.Has(2 + static_cast<size_t>(in.data[in.pos + 1]))) {
+            std::cerr << "ERROR: Truncated tag dictionary in '" << path << "'" << std::endl;
+            return false;
+        }
+        ExportedTag tag;
+        tag.dataType = in.data[in.pos];
+        size_t length = in.data[in.pos + 1];
+        tag.name.assign(reinterpret_cast<const char*>(in.data + in.pos + 2), length);
+        in.pos += 2 + length;
+        file.tags.push_back(tag);
+    }
+
+    std::vector<uint64_t> lastBits(tagCount, 0);
+    while (in.pos < in.size) {
+        uint32_t rows, timestampBytes, tagBytes, valueBytes;
+        uint64_t baseUs;
+        bool valid = in.Has(4) && std::memcmp(in.data + in.pos, BLOCK_MAGIC, 4) == 0;
+        if (valid) {
+            in.pos += 4;
+            valid = in.GetU32(rows) && in.GetU64(baseUs) && in.GetU32(timestampBytes) && in.GetU32(tagBytes) &&
+                    in.GetU32(valueBytes) &&
+                    DecodeBlock(in, rows, static_cast<int64_t>(baseUs), timestampBytes, tagBytes, valueBytes,
+                                lastBits, file);
+        }
+        if (!valid) {
+            std::cerr << "ERROR: Malformed block " << file.blockRows.size() << " in export file '" << path << "'"
+                      << std::endl;
+            return false;
+        }
+        file.blockRows.push_back(rows);
+    }
+    return true;
+}
+
+void DisplayValueExportStats(ValueExporter& exporter) {
+    uint64_t droppedBatches, droppedRows;
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(exporter.mutex);
+        droppedBatches = exporter.droppedBatches;
+        droppedRows = exporter.droppedRows;
+        pending = exporter.batches.size();
+    }
+    uint64_t rows = exporter.rows;
+    uint64_t fileBytes = exporter.fileBytes;
+    // Uncompressed row: 8-byte timestamp, 4-byte tag id, 8-byte value
+    double ratio = fileBytes > 0 ? rows * 20.0 / fileBytes : 0.0;
+    std::cout << "Value export: " << rows << " rows in " << exporter.blocks << " blocks, "
+              << (fileBytes / 1024) << " KB (" << (rows > 0 ? fileBytes * 8.0 / rows : 0.0) << " bits/row, "
+              << ratio << "x), " << pending << " batches queued, dropped " << droppedBatches << " batches ("
+              << droppedRows << " rows)" << std::endl;
+}
@@ -0,0 +1,144 @@
+/*
+* Columnar Value Export
+*
+* Streams every value change made by UpdateTagValues (sawtooth steps and
+* derived tags) to a local columnar file, as ground truth for historian
+* comparisons (--export). The simulation thread appends each change to the
+* current pass's batch and hands the batch to a writer thread with one
+* queue push per pass; the writer encodes the rows into column blocks and
+* writes each block with a single buffered fwrite.
+*
+* File layout (integers little-endian):
+*   Header:     "S7CX" | version u32 (1) | tag count u32
+*   Dictionary: per tag id 0..n-1: data type u8 (0 REAL, 1 DWORD, 2 INT,
+*               3 BOOL) | name length u8 | address ("DB1,REAL0", "E20.0")
+*   Blocks:     "S7CB" | rows u32 | base timestamp i64 (us since the Unix
+*               epoch) | timestamp bytes u32 | tag bytes u32 | value bytes u32
+*               | timestamp column | tag column | value column
+* Columns, decodable per block without the previous one:
+*   timestamp   zigzag varint of the delta to the previous row (the first
+*               row to the base timestamp)
+*   tag         zigzag varint of the delta to the previous row's tag id
+*   value       IEEE double XOR the previous value of the same tag in this
+*               block (0 for its first row); one control byte (leading zero
+*               bytes << 4 | trailing zero bytes), then the bytes between
+*               them, most significant first
+* ReadValueExport decodes a file back into rows, for checks and tools.
+*/
+
+#ifndef VALUEEXPORT_H
+#define VALUEEXPORT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "snap7.h"
+
+struct TagState;
+
+// Rows per column block (a block is also written once it is a second old)
+const size_t EXPORT_BLOCK_ROWS = 65536;
+
+// Batches waiting for the writer beyond this count are dropped (and counted)
+const size_t EXPORT_MAX_PENDING_BATCHES = 1024;
+
+struct ExportRecord {
+    uint32_t tag;
+    double value;
+};
+
+// Value changes of one update pass
+struct ExportBatch {
+    int64_t timestampUs = 0;
+    std::vector<ExportRecord> records;  // Sized to the tag count: a tag changes at most once per pass
+    size_t count = 0;
+};
+
+struct ValueExporter {
+    size_t tagCount = 0;
+    ExportBatch current;                  // Simulation thread: the running pass
+
+    // Guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<ExportBatch> batches;      // Waiting for the writer
+    std::vector<std::vector<ExportRecord>> spare;  // Recycled record buffers (tagCount each)
+    uint64_t droppedBatches = 0;
+    uint64_t droppedRows = 0;
+
+    // Writer thread
+    std::FILE* file = nullptr;
+    std::vector<uint64_t> lastBits;       // Per tag, reset with every block
+    std::vector<byte> timestampColumn;
+    std::vector<byte> tagColumn;
+    std::vector<byte> valueColumn;
+    std::vector<byte> blockBuffer;
+    size_t blockRows = 0;
+    int64_t blockBaseUs = 0;
+    int64_t lastTimestampUs = 0;
+    uint32_t lastTag = 0;
+
+    std::string path;
+    std::atomic<bool> running{false};
+    std::thread writer;
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> fileBytes{0};
+    std::atomic<bool> writeFailed{false};
+};
+
+// Contents of an export file, as decoded by ReadValueExport
+struct ExportedTag {
+    uint8_t dataType;          // 0 REAL, 1 DWORD, 2 INT, 3 BOOL
+    std::string name;          // Address, e.g. "DB1,REAL0"
+};
+
+struct ExportedRow {
+    int64_t timestampUs;
+    uint32_t tag;
+    double value;
+};
+
+struct ValueExportFile {
+    std::vector<ExportedTag> tags;
+    std::vector<ExportedRow> rows;        // In file order
+    std::vector<size_t> blockRows;        // Rows of each block
+};
+
+// Append one changed value to the running pass (simulation thread; no-op without an exporter)
+inline void ExportTagValue(ValueExporter* exporter, size_t tagIndex, double value) {
+    if (exporter) {
+        ExportRecord& record = exporter->current.records[exporter->current.count++];
+        record.tag = static_cast<uint32_t>(tagIndex);
+        record.value = value;
+    }
+}
+
+// Append a value changed between update passes (control API) to the running pass.
+// The records grow as needed, so the pass can still record every tag once after it.
+void ExportOutOfPassValue(ValueExporter* exporter, size_t tagIndex, double value);
+
+// Hand the running pass, stamped with 'timestampUs', to the writer (one queue push)
+void FinishExportPass(ValueExporter* exporter, int64_t timestampUs);
+
+// Create 'path', write the header and tag dictionary and start the writer thread
+bool StartValueExport(const std::vector<TagState>& tagStates, const std::string& path, ValueExporter& exporter);
+
+// Write everything queued, close the file and stop the writer
+void StopValueExport(ValueExporter& exporter);
+
+// Decode a whole export file. Returns false (with an ERROR message) if it cannot be
+// read or is malformed: bad magic or version, truncated blocks, columns that do not
+// hold the block's rows, or tag ids outside the dictionary.
+bool ReadValueExport(const std::string& path, ValueExportFile& file);
+
+// Print rows, blocks, file size, compression and dropped batches
+void DisplayValueExportStats(ValueExporter& exporter);
+
+#endif // VALUEEXPORT_H
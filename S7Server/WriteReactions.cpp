@@ -0,0 +1,346 @@
+/*
+* Write Reactions
+* Write event queue, reaction configuration and the reaction scheduler.
+*/
+
+#include "WriteReactions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Interval between ramp steps while a ramp is active
+const std::chrono::milliseconds RAMP_STEP_INTERVAL(10);
+
+// Bind a CSV address to the process image and return the S7 area code write events report for it
+bool BindAddress(const std::string& address, ProcessImage& image, TagState& tag, int& areaCode) {
+    if (!BindTagAddress(address, image, tag)) {
+        return false;
+    }
+    areaCode = EventAreaCode(tag.areaType);
+    return true;
+}
+
+// Write the target's current value with its area locked against concurrent client access
+void WriteTarget(S7Object server, const TagState& target, DirtyTracker* dirty) {
+    int srvArea = SrvAreaIndex(target.areaType);
+    if (server) Srv_LockArea(server, srvArea, target.dbNumber);
+    WriteTagValue(target);
+    if (server) Srv_UnlockArea(server, srvArea, target.dbNumber);
+    MarkTagDirty(dirty, target);
+}
+
+uint64_t MicrosecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    if (to <= from) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+} // namespace
+
+WriteEventQueue::WriteEventQueue(size_t capacity)
+    : mask(0), enqueuePos(0), dequeuePos(0), dropped(0), woken(false) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+}
+
+bool WriteEventQueue::TryPush(const WriteEvent& event) {
+    Slot* slot;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);  // Full: the simulation thread is behind
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->event = event;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    
+    // Taking the mutex orders the publish before the consumer's predicate check (no lost wake-up)
+    { std::lock_guard<std::mutex> lock(wakeMutex); }
+    wake.notify_one();
+    return true;
+}
+
+bool WriteEventQueue::TryPop(WriteEvent& event) {
+    Slot& slot = slots[dequeuePos & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+        return false;
+    }
+    event = slot.event;
+    slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+bool WriteEventQueue::HasEvent() const {
+    return slots[dequeuePos & mask].sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+}
+
+void WriteEventQueue::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wake.wait_until(lock, deadline, [this] { return HasEvent() || woken.load(std::memory_order_relaxed); });
+    // Whatever the waker published before Wake() is visible once the loop continues
+    woken.store(false, std::memory_order_relaxed);
+}
+
+void WriteEventQueue::Wake() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        woken.store(true, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+void ReactionLatency::Add(uint64_t us) {
+    int bucket = 0;
+    while (bucket < 31 && (us >> bucket) != 0) {
+        bucket++;
+    }
+    buckets[bucket]++;
+    count++;
+    totalUs += us;
+    maxUs = std::max(maxUs, us);
+}
+
+uint64_t ReactionLatency::PercentileUs(double p) const {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count));
+    uint64_t seen = 0;
+    for (int i = 0; i < 32; i++) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) {
+            return 1ULL << i;
+        }
+    }
+    return 0;
+}
+
+// Load the reactions CSV (trigger,target,action,value,delay_ms)
+std::vector<ReactionConfigEntry> LoadReactionConfig(const std::string& filename) {
+    std::vector<ReactionConfigEntry> entries;
+    std::ifstream file(filename);
+    
+    if (!file.is_open()) {
+        std::cerr << "WARNING: Could not open reactions file '" << filename << "'. Writes will not be simulated." << std::endl;
+        return entries;
+    }
+    
+    std::string line;
+    bool firstLine = true;
+    while (std::getline(file, line)) {
+        // Skip header line
+        if (firstLine) {
+            firstLine = false;
+            continue;
+        }
+        
+        // Skip empty lines
+        if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
+            continue;
+        }
+        
+        std::vector<std::string> fields = ParseCSVLine(line);
+        if (fields.size() < 5) {
+            std::cerr << "WARNING: Reaction line needs 5 fields: " << line << std::endl;
+            continue;
+        }
+        
+        ReactionConfigEntry entry;
+        entry.trigger = fields[0];
+        entry.target = fields[1];
+        if (fields[2] == "follow") entry.action = ReactionAction::FOLLOW;
+        else if (fields[2] == "set") entry.action = ReactionAction::SET;
+        else if (fields[2] == "ramp") entry.action = ReactionAction::RAMP;
+        else {
+            std::cerr << "WARNING: Unknown reaction action '" << fields[2] << "' for trigger " << fields[0] << std::endl;
+            continue;
+        }
+        try {
+            entry.value = std::stod(fields[3]);
+            entry.delayMs = std::stoi(fields[4]);
+        } catch (...) {
+            std::cerr << "WARNING: Failed to parse values for reaction: " << fields[0] << std::endl;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+    
+    std::cout << "Loaded " << entries.size() << " write reactions from '" << filename << "'." << std::endl;
+    return entries;
+}
+
+// Bind reactions to the process image
+size_t InitializeReactions(const std::vector<ReactionConfigEntry>& entries, ProcessImage& image,
+                           ReactionEngine& engine) {
+    engine = ReactionEngine();
+    for (const auto& entry : entries) {
+        Reaction reaction;
+        int targetArea = 0;
+        if (!BindAddress(entry.trigger, image, reaction.trigger, reaction.triggerArea) ||
+            !BindAddress(entry.target, image, reaction.target, targetArea)) {
+            continue;
+        }
+        reaction.action = entry.action;
+        reaction.value = entry.value;
+        reaction.delayMs = std::max(0, entry.delayMs);
+        reaction.lastTriggerValue = reaction.trigger.currentValue;
+        
+        AddAddressRange(engine.triggers, reaction.triggerArea, reaction.trigger.dbNumber, reaction.trigger.offset,
+                        GetTypeSize(reaction.trigger.dataType),
+                        reaction.trigger.dataType == DataType::BOOL ? reaction.trigger.bitPosition : -1,
+                        engine.reactions.size());
+        engine.reactions.push_back(reaction);
+    }
+    FinalizeAddressIndex(engine.triggers);
+    return engine.reactions.size();
+}
+
+// Drain queued write events, schedule matching reactions and apply those that are due
+void ProcessWriteReactions(S7Object server, WriteEventQueue& queue, ReactionEngine& engine,
+                           DirtyTracker* dirty) {
+    WriteEvent event;
+    std::vector<const AddressRange*> hits;
+    std::vector<size_t> matched;
+    while (queue.TryPop(event)) {
+        engine.writesSeen++;
+        hits.clear();
+        FindAddressRanges(engine.triggers, event.area, event.dbNumber, event.start, event.size, hits);
+        // Bit writes report the bit address (byte * 8 + bit)
+        size_t byteHits = hits.size();
+        if (event.size == 1) {
+            FindAddressRanges(engine.triggers, event.area, event.dbNumber, event.start / 8, 1, hits);
+        }
+        matched.clear();
+        for (size_t i = 0; i < hits.size(); i++) {
+            if (i < byteHits || hits[i]->bitPosition == event.start % 8) {
+                matched.push_back(hits[i]->id);
+            }
+        }
+        if (matched.empty()) {
+            continue;
+        }
+        std::sort(matched.begin(), matched.end());
+        matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+
+        for (size_t index : matched) {
+            Reaction& reaction = engine.reactions[index];
+            const TagState& trigger = reaction.trigger;
+            
+            // Rewrites of the same value (or of a neighbouring bit) only matter to 'set'
+            double value = ReadTagValue(trigger);
+            if (reaction.action != ReactionAction::SET && value == reaction.lastTriggerValue) {
+                continue;
+            }
+            reaction.lastTriggerValue = value;
+            
+            ScheduledReaction scheduled;
+            scheduled.due = event.receivedAt + std::chrono::milliseconds(reaction.delayMs);
+            scheduled.receivedAt = event.receivedAt;
+            scheduled.reaction = index;
+            scheduled.triggerValue = value;
+            engine.scheduled.push(scheduled);
+        }
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    while (!engine.scheduled.empty() && engine.scheduled.top().due <= now) {
+        ScheduledReaction scheduled = engine.scheduled.top();
+        engine.scheduled.pop();
+        Reaction& reaction = engine.reactions[scheduled.reaction];
+        
+        if (reaction.action == ReactionAction::RAMP && reaction.value > 0.0) {
+            // Start (or redirect) the ramp; it is stepped below
+            bool found = false;
+            for (auto& ramp : engine.ramps) {
+                if (ramp.reaction == scheduled.reaction) {
+                    ramp.setpoint = scheduled.triggerValue;
+                    found = true;
+                }
+            }
+            if (!found) {
+                ActiveRamp ramp;
+                ramp.reaction = scheduled.reaction;
+                ramp.setpoint = scheduled.triggerValue;
+                ramp.lastStep = now;
+                engine.ramps.push_back(ramp);
+            }
+        } else {
+            // follow, set, and ramps without a rate jump straight to the new value
+            reaction.target.currentValue = (reaction.action == ReactionAction::SET) ? reaction.value
+                                                                                    : scheduled.triggerValue;
+            WriteTarget(server, reaction.target, dirty);
+        }
+        
+        engine.reactionsFired++;
+        engine.latency.Add(MicrosecondsBetween(scheduled.due, std::chrono::steady_clock::now()));
+    }
+    
+    // Step active ramps toward their setpoints
+    for (size_t i = 0; i < engine.ramps.size();) {
+        ActiveRamp& ramp = engine.ramps[i];
+        Reaction& reaction = engine.reactions[ramp.reaction];
+        double seconds = std::chrono::duration<double>(now - ramp.lastStep).count();
+        ramp.lastStep = now;
+        
+        // Start from the stored value so client writes to the target are respected
+        double current = ReadTagValue(reaction.target);
+        double step = reaction.value * seconds;
+        bool reached = std::fabs(ramp.setpoint - current) <= step;
+        reaction.target.currentValue = reached ? ramp.setpoint
+                                               : current + (ramp.setpoint > current ? step : -step);
+        WriteTarget(server, reaction.target, dirty);
+        
+        if (reached) {
+            engine.ramps[i] = engine.ramps.back();
+            engine.ramps.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+// Earliest time the engine needs to run again
+std::chrono::steady_clock::time_point NextReactionDeadline(const ReactionEngine& engine,
+                                                           std::chrono::steady_clock::time_point fallback) {
+    auto deadline = fallback;
+    if (!engine.scheduled.empty()) {
+        deadline = std::min(deadline, engine.scheduled.top().due);
+    }
+    if (!engine.ramps.empty()) {
+        deadline = std::min(deadline, std::chrono::steady_clock::now() + RAMP_STEP_INTERVAL);
+    }
+    return deadline;
+}
+
+// Print reaction counters and write-to-reaction latency
+void DisplayReactionStats(const ReactionEngine& engine, const WriteEventQueue& queue) {
+    std::cout << "Write Reactions: " << engine.writesSeen << " writes, " << engine.reactionsFired
+              << " reactions fired, " << engine.ramps.size() << " ramps active, "
+              << queue.Dropped() << " events dropped" << std::endl;
+    if (engine.latency.count > 0) {
+        std::cout << "Write-to-Reaction Latency (beyond delay): avg "
+                  << (engine.latency.totalUs / engine.latency.count) << " us, p50 <= "
+                  << engine.latency.PercentileUs(50) << " us, p99 <= " << engine.latency.PercentileUs(99)
+                  << " us, max " << engine.latency.maxUs << " us" << std::endl;
+    }
+}
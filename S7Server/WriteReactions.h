@@ -0,0 +1,169 @@
+/*
+* Write Reactions
+*
+* Simulated process responses to client writes, configured in a reactions CSV:
+*   trigger,target,action,value,delay_ms
+*   "A0.0","E20.0",follow,0,30          I20.0 follows Q0.0 after 30 ms
+*   "DB101,REAL0","DB101,REAL4",ramp,10,0  REAL4 ramps toward the setpoint at 10/s
+*
+* The Snap7 event callback pushes every evcDataWrite (area, DB, start, size) into
+* a lock-free queue; the simulation thread drains it, schedules the matching
+* reactions and applies them when due. Write-to-reaction latency is measured
+* from the moment the event was queued, excluding the configured delay.
+*/
+
+#ifndef WRITEREACTIONS_H
+#define WRITEREACTIONS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include "TagEngine.h"
+#include "AddressIndex.h"
+
+// Client write reported by the server event stream
+struct WriteEvent {
+    int area;       // S7 area code (0x81 I, 0x82 Q, 0x83 M, 0x84 DB)
+    int dbNumber;
+    int start;
+    int size;
+    std::chrono::steady_clock::time_point receivedAt;
+};
+
+// Bounded multi-producer / single-consumer queue of write events. Producers are
+// Snap7 worker threads (event callback) and never block on the consumer; the
+// simulation thread sleeps in WaitUntil() until an event, a Wake() or its next
+// deadline.
+class WriteEventQueue {
+public:
+    explicit WriteEventQueue(size_t capacity = 4096);
+
+    WriteEventQueue(const WriteEventQueue&) = delete;
+    WriteEventQueue& operator=(const WriteEventQueue&) = delete;
+
+    // Any thread; returns false (and counts the event as dropped) when the queue is full
+    bool TryPush(const WriteEvent& event);
+
+    // Simulation thread only
+    bool TryPop(WriteEvent& event);
+
+    // Simulation thread only: sleep until an event is queued, Wake() is called or the deadline passes
+    void WaitUntil(std::chrono::steady_clock::time_point deadline);
+
+    // Any thread: end the current (or next) WaitUntil() without an event, e.g. once
+    // control commands are queued
+    void Wake();
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        WriteEvent event;
+    };
+
+    bool HasEvent() const;
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> woken;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+};
+
+// What a reaction does to its target
+enum class ReactionAction {
+    FOLLOW,  // Target takes the trigger's value after the delay
+    SET,     // Target is set to 'value' after the delay, on every write to the trigger
+    RAMP     // Target moves toward the trigger's value at 'value' units per second
+};
+
+// One line of the reactions CSV
+struct ReactionConfigEntry {
+    std::string trigger;
+    std::string target;
+    ReactionAction action;
+    double value;
+    int delayMs;
+};
+
+// Resolved reaction: trigger and target addresses bound to the process image
+struct Reaction {
+    TagState trigger;
+    TagState target;
+    int triggerArea;        // S7 area code matched against write events
+    ReactionAction action;
+    double value;
+    int delayMs;
+    double lastTriggerValue;
+};
+
+// Reaction waiting for its delay to expire
+struct ScheduledReaction {
+    std::chrono::steady_clock::time_point due;
+    std::chrono::steady_clock::time_point receivedAt;
+    size_t reaction;
+    double triggerValue;
+    bool operator>(const ScheduledReaction& other) const { return due > other.due; }
+};
+
+// Ramp in progress toward a setpoint
+struct ActiveRamp {
+    size_t reaction;
+    double setpoint;
+    std::chrono::steady_clock::time_point lastStep;
+};
+
+// Write-to-reaction latency in power-of-two microsecond buckets
+struct ReactionLatency {
+    uint64_t count = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+    uint64_t buckets[32] = {0};  // Bucket i: latency < 2^i microseconds
+
+    void Add(uint64_t us);
+    uint64_t PercentileUs(double p) const;  // Upper bound of the bucket holding the percentile
+};
+
+// All reactions and their runtime state (owned by the simulation thread)
+struct ReactionEngine {
+    std::vector<Reaction> reactions;
+    AddressIndex triggers;             // Trigger addresses, indexed by reaction
+    std::priority_queue<ScheduledReaction, std::vector<ScheduledReaction>,
+                        std::greater<ScheduledReaction>> scheduled;
+    std::vector<ActiveRamp> ramps;
+    uint64_t writesSeen = 0;
+    uint64_t reactionsFired = 0;
+    ReactionLatency latency;
+};
+
+// Load the reactions CSV (trigger,target,action,value,delay_ms)
+std::vector<ReactionConfigEntry> LoadReactionConfig(const std::string& filename);
+
+// Bind reactions to the process image; entries with unknown or out-of-range
+// addresses are skipped with a warning. Returns the number of active reactions.
+size_t InitializeReactions(const std::vector<ReactionConfigEntry>& entries, ProcessImage& image,
+                           ReactionEngine& engine);
+
+// Drain queued write events, schedule matching reactions and apply those that are due.
+// Written targets are marked in 'dirty' when given.
+void ProcessWriteReactions(S7Object server, WriteEventQueue& queue, ReactionEngine& engine,
+                           DirtyTracker* dirty = nullptr);
+
+// Earliest time the engine needs to run again (a scheduled reaction or the next ramp step)
+std::chrono::steady_clock::time_point NextReactionDeadline(const ReactionEngine& engine,
+                                                           std::chrono::steady_clock::time_point fallback);
+
+// Print reaction counters and write-to-reaction latency
+void DisplayReactionStats(const ReactionEngine& engine, const WriteEventQueue& queue);
+
+#endif // WRITEREACTIONS_H
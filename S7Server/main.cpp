@@ -10,95 +10,115 @@
 * - Cycletime-based scheduling for value changes
 * - Sawtooth pattern value generation (min -> max -> min)
 * - Support for REAL, DWORD, INT, and BOOL data types
+* - Overlapping or out-of-range tags rejected at start-up; requests logged with the tags they touch
+* - Derived tags computed from other tags (incremental dependency graph)
+* - Write reactions: client writes drive simulated I and DB responses
+* - TON/TOF/TP timers and up/down counters in the T and C areas
+* - Opt-in real-time scan cycle with CPU pinning, SCHED_FIFO and jitter histogram
+* - Scheduler instrumentation: tag lag per cycletime, loop duration and overruns
+* - Response-time, rejection and disconnect injection per area or DB; connection cap
+* - Per-client request and byte rate limits, connection cap and idle eviction
+* - Simulated process time with N-times time warp and a deterministic seeded mode
+* - Hot-standby replication: dirty ranges shipped as delta frames to a mirror server
+* - Compressed per-tag value history, queryable over a local UNIX socket
+* - Columnar export of every value change for offline historian comparison
+* - Local control socket to set, freeze, reparameterise and pause tags at run time
+* - Optional update engine generated at build time for a fixed tag table
+* - Optional data-age header (cycle counter + timestamp) in every DB
 */
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
-#include <map>
 #include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <atomic>
 #include <csignal>
 #include <thread>
 #include <chrono>
-#include <random>
-#include <algorithm>
 #include "snap7.h"
+#include "TagEngine.h"
+#include "DerivedTags.h"
+#include "WriteReactions.h"
+#include "TimerEngine.h"
+#include "RealTime.h"
+#include "SchedulerStats.h"
+#include "FaultInjection.h"
+#include "SimClock.h"
+#include "Replication.h"
+#include "TagHistory.h"
+#include "AddressIndex.h"
+#include "ClientLimits.h"
+#include "GeneratedEngine.h"
+#include "ControlApi.h"
 
 // Global server instance
 S7Object S7Server = 0;
 bool ServerRunning = true;
 
-// Constants
-const int REAL_SIZE = 4;   // S7 REAL data type size in bytes
-const int DWORD_SIZE = 4;  // S7 DWORD data type size in bytes
-const int INT_SIZE = 2;    // S7 INT data type size in bytes
-const int BOOL_SIZE = 1;   // S7 BOOL data type size in bits (stored in 1 byte)
-
-// Enumeration for memory area types
-enum class AreaType {
-    DB,      // Data Block
-    INPUT,   // Input area (E/I)
-    OUTPUT,  // Output area (A/Q)
-    MERKER,  // Flag/Marker area (M)
-    UNKNOWN
-};
-
-// Enumeration for data types
-enum class DataType {
-    REAL,
-    DWORD,
-    INT,
-    BOOL,
-    UNKNOWN
-};
-
-// Structure to hold CSV configuration entry
-struct CSVConfigEntry {
-    AreaType areaType;  // Memory area type (DB, INPUT, etc.)
-    int dbNumber;       // DB number (only for DB area type)
-    int offset;
-    int bitPosition;  // For BOOL type (0-7), -1 for other types
-    DataType dataType;
-    double minValue;  // Using double to support both float and uint32 ranges
-    double maxValue;
-    double echelon;
-    int cycletime;
-};
-
-// Structure to hold tag state for dynamic updates
-struct TagState {
-    AreaType areaType;  // Memory area type (DB, INPUT, etc.)
-    int dbNumber;       // DB number (only for DB area type)
-    int offset;
-    int bitPosition;  // For BOOL type (0-7), -1 for other types
-    DataType dataType;
-    double currentValue;  // Using double to support both float and uint32 ranges
-    double minValue;
-    double maxValue;
-    double echelon;
-    int cycletime;
-    bool increasing;  // true = increasing, false = decreasing
-    std::chrono::steady_clock::time_point lastUpdateTime;
-    byte* dataPtr;  // Pointer to the memory area
-};
-
-// Structure to hold Data Block information
-struct DataBlock {
-    int number;
-    int size;
-    byte* data;
-};
-
 // Signal handler for graceful shutdown
 void SignalHandler(int signal) {
   std::cout << "\nShutdown signal received. Stopping server..." << std::endl;
     ServerRunning = false;
 }
 
+// State handed to the event callback (usrPtr)
+struct EventContext {
+    WriteEventQueue* writeQueue;  // Receives client writes when reactions are configured
+    WriteEventQueue* replicationQueue;  // Receives client writes when replicating to a standby
+    bool logRequests;             // Log per-request events (PDU incoming, read, write)
+    std::atomic<uint64_t> refusedClients{0};  // Connections refused by the connection cap
+    const AddressIndex* tagIndex = nullptr;   // Configured tags by address, for request logging
+    const std::vector<CSVConfigEntry>* tags = nullptr;
+    ClientLimiter* limiter = nullptr;         // Tracks connections per client address
+};
+
+// Most tag addresses listed per logged request
+const size_t LOG_TAGS_PER_REQUEST = 8;
+
+// Addresses of the configured tags a request touched, e.g. " -> DB101,REAL14 DB101,REAL18"
+std::string DescribeRequestTags(const EventContext* context, int area, int dbNumber, int start, int size) {
+    if (!context || !context->tagIndex) {
+        return "";
+    }
+    std::vector<const AddressRange*> ranges;
+    FindAddressRanges(*context->tagIndex, area, dbNumber, start, size, ranges);
+    if (ranges.empty()) {
+        return "";
+    }
+    std::string text = " ->";
+    for (size_t i = 0; i < ranges.size() && i < LOG_TAGS_PER_REQUEST; i++) {
+        const CSVConfigEntry& tag = (*context->tags)[ranges[i]->id];
+        text += " " + FormatTagAddress(tag.areaType, tag.dbNumber, tag.offset, tag.bitPosition, tag.dataType);
+    }
+    if (ranges.size() > LOG_TAGS_PER_REQUEST) {
+        text += " (+" + std::to_string(ranges.size() - LOG_TAGS_PER_REQUEST) + " more)";
+    }
+    return text;
+}
+
 // Event callback function
 void S7API EventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
+    EventContext* context = static_cast<EventContext*>(usrPtr);
+    
+    // Hand successful client writes to the simulation thread (never blocks)
+    if (PEvent->EvtCode == evcDataWrite && context && PEvent->EvtRetCode == 0 &&
+        (context->writeQueue || context->replicationQueue)) {
+        WriteEvent event;
+        event.area = PEvent->EvtParam1;
+        event.dbNumber = PEvent->EvtParam2;
+        event.start = PEvent->EvtParam3;
+        event.size = PEvent->EvtParam4;
+        event.receivedAt = std::chrono::steady_clock::now();
+        if (context->writeQueue) {
+            context->writeQueue->TryPush(event);
+        }
+        if (context->replicationQueue) {
+            context->replicationQueue->TryPush(event);
+        }
+    }
+    
     // Log server events
     std::string EventText;
     bool shouldLog = true;
@@ -111,11 +131,17 @@ void S7API EventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
 			EventText = "Server stopped";
 			break;
 		case evcClientAdded:
+			if (context && context->limiter) NoteClientConnected(*context->limiter, PEvent->EvtSender);
 			EventText = "Client connected";
 			break;
 		case evcClientDisconnected:
+			if (context && context->limiter) NoteClientDisconnected(*context->limiter, PEvent->EvtSender);
 			EventText = "Client disconnected";
 			break;
+		case evcClientNoRoom:
+			if (context) context->refusedClients++;
+			EventText = "Client refused (connection limit reached)";
+			break;
 		case evcPDUincoming:
 			EventText = "PDU incoming";
 			break;
@@ -125,7 +151,12 @@ void S7API EventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
 			EventText = "Data read";
 			break;
 		case evcDataWrite:
+			shouldLog = !context || context->logRequests;
 			EventText = "Data write";
+			if (shouldLog) {
+				EventText += DescribeRequestTags(context, PEvent->EvtParam1, PEvent->EvtParam2, PEvent->EvtParam3,
+				                                 PEvent->EvtParam4);
+			}
 			break;
 		case evcNegotiatePDU:
 			EventText = "Negotiate PDU - PDU Size: " + std::to_string(PEvent->EvtParam1) + " bytes";
@@ -168,6 +199,7 @@ void S7API EventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
 
 // Read event callback
 void S7API ReadEventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
+    const EventContext* context = static_cast<const EventContext*>(usrPtr);
     // Area codes: PE=0x81, PA=0x82, MK=0x83, DB=0x84, CT=0x1C, TM=0x1D
     const char* areaName = "Unknown";
     if (PEvent->EvtParam1 == 0x84) areaName = "DB";
@@ -188,6 +220,7 @@ void S7API ReadEventCallback(void* usrPtr, PSrvEvent PEvent, int Size) {
     if (PEvent->EvtParam1 == 0x84 && realCount > 0) {
         std::cout << " (" << realCount << " REALs)";
     }
+    std::cout << DescribeRequestTags(context, PEvent->EvtParam1, PEvent->EvtParam2, PEvent->EvtParam3, PEvent->EvtParam4);
     
     std::cout << std::endl;
 }
@@ -207,595 +240,262 @@ int S7API RWAreaCallback(void* usrPtr, int Sender, int Operation, PS7Tag PTag, v
     return 0; // Success
 }
 
-// Helper function to convert float to S7 REAL format (big-endian IEEE 754)
-// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
-// The caller is responsible for ensuring the buffer has sufficient space (offset + 4 bytes).
-void SetReal(byte* buffer, int offset, float value) {
-    // Convert float to bytes
-    byte* floatBytes = reinterpret_cast<byte*>(&value);
-    
-    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
-    // We need to reverse the byte order
-    buffer[offset + 0] = floatBytes[3];  // Most significant byte
-    buffer[offset + 1] = floatBytes[2];
-    buffer[offset + 2] = floatBytes[1];
-    buffer[offset + 3] = floatBytes[0];  // Least significant byte
-}
-
-// Helper function to read float from S7 REAL format (big-endian IEEE 754)
-float GetReal(byte* buffer, int offset) {
-    // S7 uses big-endian byte order, convert to little-endian
-    byte floatBytes[4];
-    floatBytes[3] = buffer[offset + 0];  // Most significant byte
-    floatBytes[2] = buffer[offset + 1];
-    floatBytes[1] = buffer[offset + 2];
-    floatBytes[0] = buffer[offset + 3];  // Least significant byte
-    
-    return *reinterpret_cast<float*>(floatBytes);
-}
-
-// Helper function to convert uint32 to S7 DWORD format (big-endian)
-// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
-// The caller is responsible for ensuring the buffer has sufficient space (offset + 4 bytes).
-void SetDWord(byte* buffer, int offset, uint32_t value) {
-    // Convert uint32 to bytes
-    byte* dwordBytes = reinterpret_cast<byte*>(&value);
+// Display server configuration
+void DisplayConfig(const ProcessImage& image, const ServerOptions& options) {
+    const std::vector<DataBlock>& dataBlocks = image.dataBlocks;
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "S7 Server Configuration:" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Protocol: ISO-on-TCP" << std::endl;
+    std::cout << "Port: " << options.port << std::endl;
+    std::cout << "Data Blocks:" << (options.verbose ? "" : " " + std::to_string(dataBlocks.size())) << std::endl;
     
-    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
-    // We need to reverse the byte order
-    buffer[offset + 0] = dwordBytes[3];  // Most significant byte
-    buffer[offset + 1] = dwordBytes[2];
-    buffer[offset + 2] = dwordBytes[1];
-    buffer[offset + 3] = dwordBytes[0];  // Least significant byte
-}
-
-// Helper function to read uint32 from S7 DWORD format (big-endian)
-uint32_t GetDWord(byte* buffer, int offset) {
-    // S7 uses big-endian byte order, convert to little-endian
-    byte dwordBytes[4];
-    dwordBytes[3] = buffer[offset + 0];  // Most significant byte
-    dwordBytes[2] = buffer[offset + 1];
-    dwordBytes[1] = buffer[offset + 2];
-    dwordBytes[0] = buffer[offset + 3];  // Least significant byte
+    if (options.verbose) {
+        for (const auto& db : dataBlocks) {
+            std::cout << "  - DB" << db.number << ": " << db.size << " bytes" << std::endl;
+        }
+    }
     
-    return *reinterpret_cast<uint32_t*>(dwordBytes);
+    std::cout << "Inputs (I):  " << image.sizes.inputs << " bytes" << std::endl;
+    std::cout << "Outputs (Q): " << image.sizes.outputs << " bytes" << std::endl;
+    std::cout << "Flags (M):   " << image.sizes.flags << " bytes" << std::endl;
+    std::cout << "Timers (T):  " << image.sizes.timers << " bytes" << std::endl;
+    std::cout << "Counters (C): " << image.sizes.counters << " bytes" << std::endl;
+    std::cout << "Process image: " << image.arena.Used() << " of " << image.arena.Capacity()
+              << " bytes in one arena" << (image.arena.UsingHugePages() ? " (huge pages)" : "") << std::endl;
+    std::cout << "========================================\n" << std::endl;
 }
 
-// Helper function to convert int16 to S7 INT format (big-endian)
-// Note: This function assumes the host system uses little-endian byte order (x86/x64 Windows).
-// The caller is responsible for ensuring the buffer has sufficient space (offset + 2 bytes).
-void SetInt(byte* buffer, int offset, int16_t value) {
-    // Convert int16 to bytes
-    byte* intBytes = reinterpret_cast<byte*>(&value);
-    
-    // S7 uses big-endian byte order, but Windows x86/x64 systems use little-endian
-    // We need to reverse the byte order
-    buffer[offset + 0] = intBytes[1];  // Most significant byte
-    buffer[offset + 1] = intBytes[0];  // Least significant byte
-}
+// Display server status
+void DisplayStatus(S7Object Server) {
+	int ServerStatus, CpuStatus, ClientsCount;
+	int Result = Srv_GetStatus(Server, &ServerStatus, &CpuStatus, &ClientsCount);
 
-// Helper function to read int16 from S7 INT format (big-endian)
-int16_t GetInt(byte* buffer, int offset) {
-    // S7 uses big-endian byte order, convert to little-endian
-    byte intBytes[2];
-    intBytes[1] = buffer[offset + 0];  // Most significant byte
-    intBytes[0] = buffer[offset + 1];  // Least significant byte
-    
-    return *reinterpret_cast<int16_t*>(intBytes);
+	if (Result == 0) {
+		std::cout << "Server Status: " << (ServerStatus == 1 ? "RUNNING" : "STOPPED") << std::endl;
+		std::cout << "Connected Clients: " << ClientsCount << std::endl;
+	}
 }
 
-// Helper function to set a single bit in S7 BOOL format
-// bitPosition: 0-7 (0 is LSB, 7 is MSB)
-void SetBool(byte* buffer, int offset, int bitPosition, bool value) {
-    if (value) {
-        // Set bit to 1
-        buffer[offset] |= (1 << bitPosition);
-    } else {
-        // Set bit to 0
-        buffer[offset] &= ~(1 << bitPosition);
+// Diagnostic function to verify DB area accessibility
+bool VerifyDBAreaAccessible(S7Object server, int dbNumber, int size) {
+    // Try to lock the area for verification
+    void* pUsrData = nullptr;
+    int Result = Srv_LockArea(server, srvAreaDB, dbNumber);
+    if (Result == 0) {
+      Srv_UnlockArea(server, srvAreaDB, dbNumber);
+        return true;
     }
+    return false;
 }
 
-// Helper function to read a single bit from S7 BOOL format
-// bitPosition: 0-7 (0 is LSB, 7 is MSB)
-bool GetBool(byte* buffer, int offset, int bitPosition) {
-    return (buffer[offset] & (1 << bitPosition)) != 0;
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --config <file>           CSV tag configuration (default address.csv)" << std::endl;
+    std::cout << "  --port <n>                Listening port (default 102, use e.g. 10102 without admin rights)" << std::endl;
+    std::cout << "  --quiet                   Do not log every allocated DB, initialized tag and read/write request" << std::endl;
+    std::cout << "  --data-age-header         Write a cycle counter and microsecond timestamp into every DB" << std::endl;
+    std::cout << "  --data-age-offset <n>     Byte offset of the 12-byte data-age header (default 0)" << std::endl;
+    std::cout << "  --area-size <A>=<bytes>   Size of area I, Q, M, T or C, up to 65536 (repeatable," << std::endl;
+    std::cout << "                            defaults I=256 Q=256 M=256 T=512 C=512)" << std::endl;
+    std::cout << "  --huge-pages              Back the process image with huge pages if the OS allows it" << std::endl;
+    std::cout << "  --reactions <file>        CSV of write reactions (client writes drive I/DB responses)" << std::endl;
+    std::cout << "  --timers <file>           CSV of timers and counters simulated in the T and C areas" << std::endl;
+    std::cout << "  --realtime <ms>           Run the simulation on a fixed scan cycle (1-10000 ms) with absolute deadlines" << std::endl;
+    std::cout << "  --rt-priority <n>         SCHED_FIFO priority 1-99 of the simulation thread (with --realtime)" << std::endl;
+    std::cout << "  --cpu <n>                 Pin the simulation thread to CPU n, Snap7 threads to the others (with --realtime)" << std::endl;
+    std::cout << "  --mlock                   Lock all process memory to avoid page faults (with --realtime)" << std::endl;
+    std::cout << "  --stats-file <file>       Dump scheduler counters as JSON with every status report and at exit" << std::endl;
+    std::cout << "  --faults <file>           CSV of response-time, rejection and disconnect policies per area or DB" << std::endl;
+    std::cout << "  --max-clients <n>         Refuse connections beyond n simultaneous clients" << std::endl;
+    std::cout << "  --max-clients-per-ip <n>  Drop connections beyond n from one client address" << std::endl;
+    std::cout << "  --client-rate <n>         Reject read/write items beyond n per second per client address" << std::endl;
+    std::cout << "  --client-bandwidth <n>    Reject read/write items beyond n data bytes per second per client address" << std::endl;
+    std::cout << "  --idle-timeout <s>        Drop connections that sent nothing for s seconds" << std::endl;
+    std::cout << "  --time-warp <N>           Run tag phases, derived tags and timers N times faster than real time" << std::endl;
+    std::cout << "  --deterministic <seed>    Advance simulated time by one update interval per pass and seed all" << std::endl;
+    std::cout << "                            randomness, so runs are reproducible" << std::endl;
+    std::cout << "  --replicate-to <[host:]port>  Ship every change of the process image to a hot-standby server" << std::endl;
+    std::cout << "  --standby <[host:]port>   Run as a passive hot-standby mirroring a primary (listen address," << std::endl;
+    std::cout << "                            host defaults to 127.0.0.1)" << std::endl;
+    std::cout << "  --history <bytes>         Keep a compressed history of every tag, <bytes> per tag (e.g. 1024)" << std::endl;
+    std::cout << "  --history-socket <path>   UNIX socket answering history queries (default s7server-history.sock)" << std::endl;
+    std::cout << "  --export <file>           Write every tag value change to a block-compressed columnar file" << std::endl;
+    std::cout << "  --control-socket <path>   UNIX socket accepting runtime tag commands (SET, FREEZE, PARAM, PAUSE, DUMP)" << std::endl;
+    std::cout << "  --generic-engine          Use the generic update engine even if a generated one was built in" << std::endl;
 }
 
-// Parse CSV tag format "DB<number>,REAL<offset>", "DB<number>,DWORD<offset>", 
-// "DB<number>,INT<offset>", "DB<number>,X<offset>.<bit>"
-// or Input area format "E<offset>.<bit>" or "I<offset>.<bit>"
-bool ParseTag(const std::string& tag, AreaType& areaType, int& dbNumber, int& offset, int& bitPosition, DataType& dataType) {
-    // Remove quotes if present
-    std::string cleanTag = tag;
-    cleanTag.erase(std::remove(cleanTag.begin(), cleanTag.end(), '\"'), cleanTag.end());
-    
-    // Check for Input area format (E or I prefix)
-    if (cleanTag[0] == 'E' || cleanTag[0] == 'I') {
-        areaType = AreaType::INPUT;
-        dbNumber = 0;  // Not applicable for input area
-        dataType = DataType::BOOL;  // Input area addresses are always BOOL
-        
-        // Parse format: E<offset>.<bit> or I<offset>.<bit>
-        std::string remainder = cleanTag.substr(1);
-        
-        // Find the dot separator
-        size_t dotPos = remainder.find('.');
-        if (dotPos == std::string::npos) {
-            return false;  // Input area must have bit position
-        }
-        
-        try {
-            std::string offsetStr = remainder.substr(0, dotPos);
-            std::string bitStr = remainder.substr(dotPos + 1);
-            
-            offset = std::stoi(offsetStr);
-            bitPosition = std::stoi(bitStr);
-            
-            // Validate bit position (0-7)
-            if (bitPosition < 0 || bitPosition > 7) {
-                return false;
-            }
-            
-            return true;
-        } catch (...) {
-            return false;
-        }
-    }
-    
-    // Find DB position
-    size_t dbPos = cleanTag.find("DB");
-    if (dbPos == std::string::npos) {
+// Parse an --area-size value such as "M=4096" into the matching area size
+bool ParseAreaSize(const std::string& value, AreaSizes& sizes) {
+    size_t eq = value.find('=');
+    if (eq != 1) {
         return false;
     }
-    
-    areaType = AreaType::DB;
-    
-    // Extract DB number (between "DB" and ",")
-    size_t commaPos = cleanTag.find(',');
-    if (commaPos == std::string::npos) {
+    int size = std::stoi(value.substr(2));
+    if (size <= 0 || size > MAX_AREA_SIZE) {
+        std::cerr << "ERROR: Area size must be between 1 and " << MAX_AREA_SIZE << " bytes" << std::endl;
         return false;
     }
-    
-    try {
-        std::string dbNumStr = cleanTag.substr(dbPos + 2, commaPos - dbPos - 2);
-        dbNumber = std::stoi(dbNumStr);
-        
-        // Get the part after the comma
-        std::string typeAndOffset = cleanTag.substr(commaPos + 1);
-        
-        // Check for data type and extract offset
-        size_t realPos = typeAndOffset.find("REAL");
-        size_t dwordPos = typeAndOffset.find("DWORD");
-        size_t intPos = typeAndOffset.find("INT");
-        size_t xPos = typeAndOffset.find("X");
-        
-        bitPosition = -1;  // Default: not a BOOL
-        
-        if (realPos == 0) {
-            // REAL data type
-            dataType = DataType::REAL;
-            std::string offsetStr = typeAndOffset.substr(4);
-            offset = std::stoi(offsetStr);
-            return true;
-        } else if (dwordPos == 0) {
-            // DWORD data type
-            dataType = DataType::DWORD;
-            std::string offsetStr = typeAndOffset.substr(5);
-            offset = std::stoi(offsetStr);
-            return true;
-        } else if (intPos == 0) {
-            // INT data type
-            dataType = DataType::INT;
-            std::string offsetStr = typeAndOffset.substr(3);
-            offset = std::stoi(offsetStr);
-            return true;
-        } else if (xPos == 0) {
-            // BOOL data type (X format: X<offset>.<bit>)
-            dataType = DataType::BOOL;
-            std::string remainder = typeAndOffset.substr(1);
-            
-            // Find the dot separator
-            size_t dotPos = remainder.find('.');
-            if (dotPos == std::string::npos) {
-                return false;  // BOOL must have bit position
-            }
-            
-            std::string offsetStr = remainder.substr(0, dotPos);
-            std::string bitStr = remainder.substr(dotPos + 1);
-            
-            offset = std::stoi(offsetStr);
-            bitPosition = std::stoi(bitStr);
-            
-            // Validate bit position (0-7)
-            if (bitPosition < 0 || bitPosition > 7) {
-                return false;
-            }
-            
-            return true;
-        } else {
-            // Unknown data type
-            dataType = DataType::UNKNOWN;
-            return false;
-        }
-    } catch (...) {
-        return false;
+    switch (toupper(static_cast<unsigned char>(value[0]))) {
+        case 'I': case 'E': sizes.inputs = size; break;
+        case 'Q': case 'A': sizes.outputs = size; break;
+        case 'M': sizes.flags = size; break;
+        case 'T': sizes.timers = size; break;
+        case 'C': case 'Z': sizes.counters = size; break;
+        default: return false;
     }
+    return true;
 }
 
-// Helper function to parse CSV line with quoted fields
-std::vector<std::string> ParseCSVLine(const std::string& line) {
-    std::vector<std::string> fields;
-    std::string field;
-    bool inQuotes = false;
-    
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
-        
-        if (c == '\"') {
-            inQuotes = !inQuotes;
-        } else if (c == ',' && !inQuotes) {
-            fields.push_back(field);
-            field.clear();
-        } else {
-            field += c;
+// Parse command line options; returns false on invalid input
+bool ParseCommandLine(int argc, char* argv[], ServerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            return false;
         }
-    }
-    
-    // Add the last field
-    fields.push_back(field);
-    
-    return fields;
-}
-
-// Load CSV configuration file
-std::vector<CSVConfigEntry> LoadCSVConfig(const std::string& filename) {
-    std::vector<CSVConfigEntry> entries;
-    std::ifstream file(filename);
-    
-    if (!file.is_open()) {
-        std::cerr << "WARNING: Could not open CSV file '" << filename << "'. Using default configuration." << std::endl;
-        return entries;
-    }
-    
-    std::string line;
-    bool firstLine = true;
-    
-    while (std::getline(file, line)) {
-        // Skip header line
-        if (firstLine) {
-            firstLine = false;
+        if (arg == "--data-age-header") {
+            options.dataAgeHeader = true;
             continue;
         }
-        
-        // Skip empty lines
-        if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
+        if (arg == "--quiet") {
+            options.verbose = false;
             continue;
         }
-        
-        // Parse CSV line with proper quote handling
-        std::vector<std::string> fields = ParseCSVLine(line);
-        
-        if (fields.size() >= 5) {
-            CSVConfigEntry entry;
-            
-            // Parse tag to get area type, DB number, offset, bit position, and data type
-            if (!ParseTag(fields[0], entry.areaType, entry.dbNumber, entry.offset, entry.bitPosition, entry.dataType)) {
-                std::cerr << "WARNING: Failed to parse tag: " << fields[0] << std::endl;
-                continue;
-            }
-            
-            try {
-                entry.minValue = std::stod(fields[1]);
-                entry.maxValue = std::stod(fields[2]);
-                entry.echelon = std::stod(fields[3]);
-                entry.cycletime = std::stoi(fields[4]);
-                
-                entries.push_back(entry);
-            } catch (...) {
-                std::cerr << "WARNING: Failed to parse values for tag: " << fields[0] << std::endl;
-                continue;
-            }
-        }
-    }
-    
-    file.close();
-    std::cout << "Loaded " << entries.size() << " entries from CSV configuration." << std::endl;
-    return entries;
-}
-
-// Generate random float value within range
-float GenerateRandomValue(float minValue, float maxValue) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(minValue, maxValue);
-    return dis(gen);
-}
-
-// Create and initialize Data Blocks from CSV configuration
-std::vector<DataBlock> CreateDataBlocksFromCSV(const std::vector<CSVConfigEntry>& entries) {
-    std::map<int, int> dbSizes; // DB number -> required size
-    std::vector<DataBlock> dataBlocks;
-    
-    // First pass: determine required size for each DB (skip non-DB entries)
-    for (const auto& entry : entries) {
-        // Only process DB area entries for this function
-        if (entry.areaType != AreaType::DB) {
+        if (arg == "--huge-pages") {
+            options.hugePages = true;
             continue;
         }
-        
-        int typeSize;
-        switch (entry.dataType) {
-            case DataType::REAL:
-                typeSize = REAL_SIZE;
-                break;
-            case DataType::DWORD:
-                typeSize = DWORD_SIZE;
-                break;
-            case DataType::INT:
-                typeSize = INT_SIZE;
-                break;
-            case DataType::BOOL:
-                typeSize = 1;  // BOOL occupies at least 1 byte
-                break;
-            default:
-                typeSize = REAL_SIZE;  // Default fallback
-                break;
-        }
-        int requiredSize = entry.offset + typeSize;
-        if (dbSizes.find(entry.dbNumber) == dbSizes.end()) {
-            dbSizes[entry.dbNumber] = requiredSize;
-        } else {
-            dbSizes[entry.dbNumber] = std::max(dbSizes[entry.dbNumber], requiredSize);
+        if (arg == "--mlock") {
+            options.realTime.lockMemory = true;
+            continue;
         }
-    }
-    
-    // Second pass: allocate Data Blocks and reserve capacity to prevent reallocation
-    dataBlocks.reserve(dbSizes.size());  // Reserve capacity to prevent pointer invalidation
-    for (const auto& pair : dbSizes) {
-        DataBlock db;
-        db.number = pair.first;
-        db.size = pair.second;
-        db.data = new byte[db.size]();
-        
-        std::cout << "Allocated DB" << db.number << ": " << db.size << " bytes" << std::endl;
-        dataBlocks.push_back(db);
-    }
-    
-    // Build map for fast lookup (safe now that vector won't reallocate)
-    std::map<int, DataBlock*> dbMap;
-    for (auto& db : dataBlocks) {
-        dbMap[db.number] = &db;
-    }
-    
-    // Third pass: initialize values from CSV using map for fast lookup
-    // Start values at minimum to begin the increasing cycle
-    for (const auto& entry : entries) {
-        // Only process DB area entries for initialization
-        if (entry.areaType != AreaType::DB) {
+        if (arg == "--generic-engine") {
+            options.genericEngine = true;
             continue;
         }
-        
-        auto it = dbMap.find(entry.dbNumber);
-        if (it != dbMap.end()) {
-			DataBlock* db = it->second;
-
-            if (entry.dataType == DataType::REAL) {
-                float value = static_cast<float>(entry.minValue);  // Start at minimum value
-                SetReal(db->data, entry.offset, value);
-                std::cout << "  DB" << db->number << ".REAL" << entry.offset << " = " << value 
-                          << " (range: " << entry.minValue << " to " << entry.maxValue << ")" << std::endl;
-            } else if (entry.dataType == DataType::DWORD) {
-                uint32_t value = static_cast<uint32_t>(entry.minValue);  // Start at minimum value
-                SetDWord(db->data, entry.offset, value);
-                std::cout << "  DB" << db->number << ".DWORD" << entry.offset << " = " << value 
-                          << " (range: " << static_cast<uint32_t>(entry.minValue) 
-                          << " to " << static_cast<uint32_t>(entry.maxValue) << ")" << std::endl;
-            } else if (entry.dataType == DataType::INT) {
-                int16_t value = static_cast<int16_t>(entry.minValue);  // Start at minimum value
-                SetInt(db->data, entry.offset, value);
-                std::cout << "  DB" << db->number << ".INT" << entry.offset << " = " << value 
-                          << " (range: " << static_cast<int16_t>(entry.minValue) 
-                          << " to " << static_cast<int16_t>(entry.maxValue) << ")" << std::endl;
-            } else if (entry.dataType == DataType::BOOL) {
-                bool value = (entry.minValue != 0);  // Start at minimum value (0 or 1)
-                SetBool(db->data, entry.offset, entry.bitPosition, value);
-                std::cout << "  DB" << db->number << ".X" << entry.offset << "." << entry.bitPosition 
-                          << " = " << (value ? "true" : "false") 
-                          << " (range: " << static_cast<int>(entry.minValue) 
-                          << " to " << static_cast<int>(entry.maxValue) << ")" << std::endl;
-            }
+        if (i + 1 >= argc) {
+            std::cerr << "ERROR: Missing value for " << arg << std::endl;
+            return false;
         }
-    }
-    
-    // Summary: Show all created Data Blocks
-    std::cout << "\nData Block Summary:" << std::endl;
-    std::cout << "===================" << std::endl;
-    for (const auto& db : dataBlocks) {
-   std::cout << "  DB" << db.number << ": " << db.size << " bytes" << std::endl;
-    }
- std::cout << "Total Data Blocks: " << dataBlocks.size() << std::endl;
-    std::cout << "===================" << std::endl;
-    
-    return dataBlocks;
-}
-
-// Display server configuration
-void DisplayConfig(const std::vector<DataBlock>& dataBlocks) {
-    std::cout << "\n========================================" << std::endl;
-    std::cout << "S7 Server Configuration:" << std::endl;
-    std::cout << "========================================" << std::endl;
-    std::cout << "Protocol: ISO-on-TCP" << std::endl;
-    std::cout << "Port: 102" << std::endl;
-    std::cout << "Data Blocks:" << std::endl;
-    
-    for (const auto& db : dataBlocks) {
-        std::cout << "  - DB" << db.number << ": " << db.size << " bytes" << std::endl;
-    }
-    
-    std::cout << "Inputs (I):  256 bytes" << std::endl;
-    std::cout << "Outputs (Q): 256 bytes" << std::endl;
-    std::cout << "Flags (M):   256 bytes" << std::endl;
-    std::cout << "Timers (T):  512 bytes" << std::endl;
-    std::cout << "Counters (C): 512 bytes" << std::endl;
-    std::cout << "========================================\n" << std::endl;
-}
-
-// Display server status
-void DisplayStatus(S7Object Server) {
-	int ServerStatus, CpuStatus, ClientsCount;
-	int Result = Srv_GetStatus(Server, &ServerStatus, &CpuStatus, &ClientsCount);
-
-	if (Result == 0) {
-		std::cout << "Server Status: " << (ServerStatus == 1 ? "RUNNING" : "STOPPED") << std::endl;
-		std::cout << "Connected Clients: " << ClientsCount << std::endl;
-	}
-}
-
-// Initialize tag states from CSV configuration, data blocks, and memory areas
-std::vector<TagState> InitializeTagStates(const std::vector<CSVConfigEntry>& entries, 
-                                          const std::vector<DataBlock>& dataBlocks,
-                                          byte* IArea, byte* QArea, byte* MArea) {
-    std::vector<TagState> tagStates;
-    
-    // Build map for fast DB lookup
-    std::map<int, const DataBlock*> dbMap;
-    for (const auto& db : dataBlocks) {
-        dbMap[db.number] = &db;
-    }
-    
-    // Create tag state for each CSV entry
-    for (const auto& entry : entries) {
-        TagState state;
-        state.areaType = entry.areaType;
-        state.dbNumber = entry.dbNumber;
-        state.offset = entry.offset;
-        state.bitPosition = entry.bitPosition;
-        state.dataType = entry.dataType;
-        state.currentValue = entry.minValue;  // Start at minimum
-        state.minValue = entry.minValue;
-        state.maxValue = entry.maxValue;
-        state.echelon = entry.echelon;
-        state.cycletime = entry.cycletime;
-        state.increasing = true;  // Start by increasing
-        state.lastUpdateTime = std::chrono::steady_clock::now();
-        
-        // Set data pointer based on area type
-        if (entry.areaType == AreaType::DB) {
-            auto it = dbMap.find(entry.dbNumber);
-            if (it != dbMap.end()) {
-                state.dataPtr = it->second->data;
-            } else {
-                std::cerr << "WARNING: DB" << entry.dbNumber << " not found for tag state" << std::endl;
-                continue;
-            }
-        } else if (entry.areaType == AreaType::INPUT) {
-            state.dataPtr = IArea;
-            // Initialize the input area value
-            if (entry.dataType == DataType::BOOL) {
-                bool value = (entry.minValue != 0);
-                SetBool(IArea, entry.offset, entry.bitPosition, value);
-                std::cout << "  E" << entry.offset << "." << entry.bitPosition 
-                          << " = " << (value ? "true" : "false")
-                          << " (range: " << static_cast<int>(entry.minValue)
-                          << " to " << static_cast<int>(entry.maxValue) << ")" << std::endl;
+        std::string value = argv[++i];
+        try {
+            if (arg == "--data-age-offset") options.dataAgeOffset = std::stoi(value);
+            else if (arg == "--config") options.configFile = value;
+            else if (arg == "--port") options.port = std::stoi(value);
+            else if (arg == "--reactions") options.reactionsFile = value;
+            else if (arg == "--timers") options.timersFile = value;
+            else if (arg == "--realtime") options.realTime.cycleMs = std::stoi(value);
+            else if (arg == "--rt-priority") options.realTime.priority = std::stoi(value);
+            else if (arg == "--cpu") options.realTime.cpu = std::stoi(value);
+            else if (arg == "--stats-file") options.statsFile = value;
+            else if (arg == "--faults") options.faultsFile = value;
+            else if (arg == "--max-clients") options.maxClients = std::stoi(value);
+            else if (arg == "--max-clients-per-ip") options.maxClientsPerIp = std::stoi(value);
+            else if (arg == "--client-rate") options.clientRequestRate = std::stod(value);
+            else if (arg == "--client-bandwidth") options.clientByteRate = std::stod(value);
+            else if (arg == "--idle-timeout") options.idleTimeoutSec = std::stoi(value);
+            else if (arg == "--time-warp") options.timeWarp = std::stod(value);
+            else if (arg == "--deterministic") {
+                options.seed = static_cast<uint32_t>(std::stoul(value));
+                options.deterministic = true;
             }
-        } else if (entry.areaType == AreaType::OUTPUT) {
-            state.dataPtr = QArea;
-        } else if (entry.areaType == AreaType::MERKER) {
-            state.dataPtr = MArea;
-        } else {
-            std::cerr << "WARNING: Unknown area type for tag state" << std::endl;
-            continue;
-        }
-        
-        tagStates.push_back(state);
-    }
-    
-    std::cout << "\nInitialized " << tagStates.size() << " tag states for dynamic updates." << std::endl;
-    return tagStates;
-}
-
-// Update tag values based on cycletime and echelon
-void UpdateTagValues(std::vector<TagState>& tagStates) {
-    auto currentTime = std::chrono::steady_clock::now();
-    
-    for (auto& tag : tagStates) {
-        // Calculate elapsed time since last update in milliseconds
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            currentTime - tag.lastUpdateTime).count();
-        
-        // Check if it's time to update this tag based on cycletime
-        if (elapsed >= tag.cycletime) {
-            // Update the value based on direction and echelon
-            if (tag.increasing) {
-                tag.currentValue += tag.echelon;
-                
-                // Check if we've reached or exceeded the max value
-                if (tag.currentValue >= tag.maxValue) {
-                    tag.currentValue = tag.maxValue;
-                    tag.increasing = false;  // Switch to decreasing
+            else if (arg == "--history") options.historyBytesPerTag = std::stoi(value);
+            else if (arg == "--history-socket") options.historySocket = value;
+            else if (arg == "--control-socket") options.controlSocket = value;
+            else if (arg == "--export") options.exportFile = value;
+            else if (arg == "--replicate-to" || arg == "--standby") {
+                bool standby = arg == "--standby";
+                if (!ParseEndpoint(value, standby ? options.standbyHost : options.replicateHost,
+                                   standby ? options.standbyPort : options.replicatePort)) {
+                    std::cerr << "ERROR: Invalid value for " << arg << " (expected [host:]port): " << value << std::endl;
+                    return false;
                 }
-            } else {
-                tag.currentValue -= tag.echelon;
-                
-                // Check if we've reached or gone below the min value
-                if (tag.currentValue <= tag.minValue) {
-                    tag.currentValue = tag.minValue;
-                    tag.increasing = true;  // Switch to increasing
+            }
+            else if (arg == "--area-size") {
+                if (!ParseAreaSize(value, options.areaSizes)) {
+                    std::cerr << "ERROR: Invalid value for --area-size: " << value << std::endl;
+                    return false;
                 }
             }
-            
-            // Write the new value to the data block based on data type
-            if (tag.dataType == DataType::REAL) {
-                SetReal(tag.dataPtr, tag.offset, static_cast<float>(tag.currentValue));
-            } else if (tag.dataType == DataType::DWORD) {
-                SetDWord(tag.dataPtr, tag.offset, static_cast<uint32_t>(tag.currentValue));
-            } else if (tag.dataType == DataType::INT) {
-                SetInt(tag.dataPtr, tag.offset, static_cast<int16_t>(tag.currentValue));
-            } else if (tag.dataType == DataType::BOOL) {
-                // For BOOL, toggle between 0 and 1
-                bool boolValue = (static_cast<int>(tag.currentValue) != 0);
-                SetBool(tag.dataPtr, tag.offset, tag.bitPosition, boolValue);
+            else {
+                std::cerr << "ERROR: Unknown option " << arg << std::endl;
+                return false;
             }
-            
-            // Update last update time
-            tag.lastUpdateTime = currentTime;
+        } catch (...) {
+            std::cerr << "ERROR: Invalid value for " << arg << ": " << value << std::endl;
+            return false;
         }
     }
-}
-
-// Helper function to cleanup allocated memory
-void CleanupResources(std::vector<DataBlock>& dataBlocks, byte* IArea, byte* QArea, 
-                     byte* MArea, byte* TArea, byte* CArea) {
-    for (auto& db : dataBlocks) {
-        delete[] db.data;
-    }
-    delete[] IArea;
-    delete[] QArea;
-    delete[] MArea;
-    delete[] TArea;
- delete[] CArea;
-}
-
-// Diagnostic function to verify DB area accessibility
-bool VerifyDBAreaAccessible(S7Object server, int dbNumber, int size) {
-    // Try to lock the area for verification
-    void* pUsrData = nullptr;
-    int Result = Srv_LockArea(server, srvAreaDB, dbNumber);
-    if (Result == 0) {
-      Srv_UnlockArea(server, srvAreaDB, dbNumber);
-        return true;
+    if (options.port <= 0 || options.port > 65535) {
+        std::cerr << "ERROR: --port must be between 1 and 65535" << std::endl;
+        return false;
     }
-    return false;
+    if (options.dataAgeOffset < 0) {
+        std::cerr << "ERROR: --data-age-offset must not be negative" << std::endl;
+        return false;
+    }
+    const RealTimeOptions& rt = options.realTime;
+    if (rt.cycleMs < 0 || rt.cycleMs > 10000) {
+        std::cerr << "ERROR: --realtime must be 0 (off) or 1-10000 ms" << std::endl;
+        return false;
+    }
+    if (rt.priority < 0 || rt.priority > 99) {
+        std::cerr << "ERROR: --rt-priority must be 0 (off) or 1-99" << std::endl;
+        return false;
+    }
+    if (rt.cycleMs == 0 && (rt.priority > 0 || rt.cpu >= 0 || rt.lockMemory)) {
+        std::cerr << "ERROR: --rt-priority, --cpu and --mlock require --realtime" << std::endl;
+        return false;
+    }
+    if (options.maxClients < 0 || options.maxClientsPerIp < 0) {
+        std::cerr << "ERROR: --max-clients and --max-clients-per-ip must not be negative" << std::endl;
+        return false;
+    }
+    if (!(options.clientRequestRate >= 0) || !(options.clientByteRate >= 0)) {
+        std::cerr << "ERROR: --client-rate and --client-bandwidth must not be negative" << std::endl;
+        return false;
+    }
+    if (options.idleTimeoutSec < 0 || options.idleTimeoutSec > 86400) {
+        std::cerr << "ERROR: --idle-timeout must be 0 (off) or 1-86400 seconds" << std::endl;
+        return false;
+    }
+    if (!(options.timeWarp >= 1.0 && options.timeWarp <= 1000000.0)) {
+        std::cerr << "ERROR: --time-warp must be between 1 and 1000000" << std::endl;
+        return false;
+    }
+    if (options.historyBytesPerTag != 0 &&
+        (options.historyBytesPerTag < HISTORY_MIN_BYTES_PER_TAG || options.historyBytesPerTag > HISTORY_MAX_BYTES_PER_TAG)) {
+        std::cerr << "ERROR: --history must be between " << HISTORY_MIN_BYTES_PER_TAG << " and "
+                  << HISTORY_MAX_BYTES_PER_TAG << " bytes per tag" << std::endl;
+        return false;
+    }
+    if (!options.replicateHost.empty() && !options.standbyHost.empty()) {
+        std::cerr << "ERROR: --replicate-to and --standby cannot be combined" << std::endl;
+        return false;
+    }
+    if (!options.standbyHost.empty() &&
+        (!options.reactionsFile.empty() || !options.timersFile.empty() || options.dataAgeHeader ||
+         options.historyBytesPerTag > 0 || !options.exportFile.empty() || !options.controlSocket.empty())) {
+        std::cerr << "ERROR: A standby only mirrors its primary; --reactions, --timers, --data-age-header, "
+                  << "--history, --export and --control-socket belong on the primary" << std::endl;
+        return false;
+    }
+    return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "========================================" << std::endl;
 	std::cout << "S7 Server ISO-on-TCP (Snap7)" << std::endl;
     std::cout << "For Node-RED Testing" << std::endl;
     std::cout << "========================================\n" << std::endl;
 
+    ServerOptions options;
+    if (!ParseCommandLine(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
     // Set up signal handler for Ctrl+C
     signal(SIGINT, SignalHandler);
     signal(SIGTERM, SignalHandler);
@@ -808,10 +508,11 @@ int main() {
     }
 
     // Configure server port (optional: use non-privileged port for testing)
-    // Uncomment the following lines to use port 10102 instead of 102 (no admin required)
-    // int customPort = 10102;
-    // Srv_SetParam(S7Server, p_u16_LocalPort, &customPort);
-    // std::cout << "NOTE: Using custom port 10102 (no admin privileges required)" << std::endl;
+    // Use --port 10102 instead of 102 when running without admin privileges
+    if (options.port != 102) {
+        Srv_SetParam(S7Server, p_u16_LocalPort, &options.port);
+        std::cout << "NOTE: Using custom port " << options.port << " (no admin privileges required)" << std::endl;
+    }
 
     // Configure PDU size (default is 480 bytes)
     // Increase to 960 bytes to allow more variables in MultiRead operations
@@ -821,22 +522,41 @@ int main() {
     std::cout << "Server PDU size configured: " << pduSize << " bytes" << std::endl;
     std::cout << "NOTE: Larger PDU allows more variables per MultiRead/MultiWrite" << std::endl;
 
+    // Connection cap: Snap7 refuses further clients (evcClientNoRoom)
+    if (options.maxClients > 0) {
+        Srv_SetParam(S7Server, p_i32_MaxClients, &options.maxClients);
+        std::cout << "Connection limit: " << options.maxClients << " clients" << std::endl;
+    }
+
     // Load CSV configuration
-    std::cout << "Loading CSV configuration from 'address.csv'..." << std::endl;
-    std::vector<CSVConfigEntry> csvConfig = LoadCSVConfig("address.csv");
+    std::cout << "Loading CSV configuration from '" << options.configFile << "'..." << std::endl;
+    std::vector<CSVConfigEntry> csvConfig = LoadCSVConfig(options.configFile);
+
+    // Tags sharing bytes or lying outside their area would corrupt each other: refuse to start.
+    // The index also maps logged requests back to the tags they touch.
+    AddressIndex tagIndex;
+    if (!BuildTagAddressIndex(csvConfig, options.areaSizes, tagIndex)) {
+        std::cerr << "ERROR: Fix the address conflicts in '" << options.configFile << "' and restart" << std::endl;
+        Srv_Destroy(&S7Server);
+        return 1;
+    }
     
-    // Create and initialize Data Blocks from CSV
-    std::vector<DataBlock> dataBlocks;
+    // Create and initialize Data Blocks from CSV; the standard memory areas for
+    // PLC simulation are carved from the same arena
+    ProcessImage image;
     if (!csvConfig.empty()) {
         std::cout << "\nInitializing Data Blocks from CSV configuration..." << std::endl;
-        dataBlocks = CreateDataBlocksFromCSV(csvConfig);
     } else {
         std::cerr << "WARNING: No CSV configuration loaded. Server will start with minimal configuration." << std::endl;
     }
+    if (!CreateDataBlocksFromCSV(csvConfig, options, image)) {
+        Srv_Destroy(&S7Server);
+        return 1;
+    }
+    const std::vector<DataBlock>& dataBlocks = image.dataBlocks;
     
-    // Allocate standard memory areas for PLC simulation
-    // Inputs (256 bytes)
-    byte* IArea = new byte[256]();
+    // Inputs
+    byte* IArea = image.IArea;
     
     // Initialize some test values in Input area for testing
     // E20.0 (I20.0) - BOOL bits
@@ -864,18 +584,6 @@ int main() {
     std::cout << "  E12 (DWORD) = 567890" << std::endl;
     std::cout << "  E16 (REAL) = 123.45" << std::endl;
     
-    // Outputs (256 bytes)
-    byte* QArea = new byte[256]();
-    
-    // Flags/Merkers (256 bytes)
-    byte* MArea = new byte[256]();
-    
-	// Timers (512 bytes)
-    byte* TArea = new byte[512]();
-    
-    // Counters (512 bytes)
-    byte* CArea = new byte[512]();
-  
     std::cout << "Initializing memory areas..." << std::endl;
 
     // Register memory areas with the server
@@ -894,7 +602,7 @@ int main() {
 			registrationFailed = true;
 			break;
         }
-  		else 
+  		else if (options.verbose)
         {
 			std::cout << "  Registered DB" << db.number << " (" << db.size << " bytes) at address " << static_cast<void*>(db.data) << std::endl;
 
@@ -908,13 +616,13 @@ int main() {
         if (!VerifyDBAreaAccessible(S7Server, db.number, db.size)) {
             std::cerr << "ERROR: DB" << db.number << " not accessible!" << std::endl;
         }
-        else {
+        else if (options.verbose) {
             std::cout << "  ? DB" << db.number << " verified accessible" << std::endl;
         }
     }
 
     if (!registrationFailed) {
-        Result = Srv_RegisterArea(S7Server, srvAreaPE, 0, IArea, 256);
+        Result = Srv_RegisterArea(S7Server, srvAreaPE, 0, image.IArea, image.sizes.inputs);
         if (Result != 0) {
 			std::cerr << "ERROR: Failed to register Input area!" << std::endl;
 			registrationFailed = true;
@@ -922,7 +630,7 @@ int main() {
     }
     
     if (!registrationFailed) {
-		Result = Srv_RegisterArea(S7Server, srvAreaPA, 0, QArea, 256);
+		Result = Srv_RegisterArea(S7Server, srvAreaPA, 0, image.QArea, image.sizes.outputs);
         if (Result != 0) {
 			std::cerr << "ERROR: Failed to register Output area!" << std::endl;
             registrationFailed = true;
@@ -930,7 +638,7 @@ int main() {
     }
     
     if (!registrationFailed) {
-		Result = Srv_RegisterArea(S7Server, srvAreaMK, 0, MArea, 256);
+		Result = Srv_RegisterArea(S7Server, srvAreaMK, 0, image.MArea, image.sizes.flags);
         if (Result != 0) {
 			std::cerr << "ERROR: Failed to register Flags area!" << std::endl;
 			registrationFailed = true;
@@ -938,7 +646,7 @@ int main() {
     }
     
     if (!registrationFailed) {
-        Result = Srv_RegisterArea(S7Server, srvAreaTM, 0, TArea, 512);
+        Result = Srv_RegisterArea(S7Server, srvAreaTM, 0, image.TArea, image.sizes.timers);
         if (Result != 0) {
             std::cerr << "ERROR: Failed to register Timers area!" << std::endl;
 			registrationFailed = true;
@@ -946,7 +654,7 @@ int main() {
     }
     
     if (!registrationFailed) {
-		Result = Srv_RegisterArea(S7Server, srvAreaCT, 0, CArea, 512);
+		Result = Srv_RegisterArea(S7Server, srvAreaCT, 0, image.CArea, image.sizes.counters);
         if (Result != 0) {
 			std::cerr << "ERROR: Failed to register Counters area!" << std::endl;
             registrationFailed = true;
@@ -956,15 +664,82 @@ int main() {
     if (registrationFailed) {
         // Cleanup on failure
 		Srv_Destroy(&S7Server);
-		CleanupResources(dataBlocks, IArea, QArea, MArea, TArea, CArea);
+		ReleaseProcessImage(image);
 		return 1;
     }
 
     std::cout << "Memory areas registered successfully." << std::endl;
 
+    // Write reactions: client writes are queued by the event callback and
+    // applied by the simulation loop below
+    WriteEventQueue writeQueue;
+    ReactionEngine reactions;
+    if (!options.reactionsFile.empty()) {
+        size_t active = InitializeReactions(LoadReactionConfig(options.reactionsFile), image, reactions);
+        std::cout << "Write reactions active: " << active << std::endl;
+    }
+    // Timers and counters in the T and C areas, ticked every millisecond
+    TimerCounterEngine timerEngine;
+    if (!options.timersFile.empty()) {
+        InitializeTimers(LoadTimerConfig(options.timersFile), image, timerEngine);
+    }
+    const bool timersActive = !timerEngine.timers.kind.empty() || !timerEngine.counters.kind.empty();
+    // Response-time and fault injection on the request path
+    FaultInjector faults;
+    if (!options.faultsFile.empty()) {
+        size_t active = InitializeFaultInjection(LoadFaultConfig(options.faultsFile), image, S7Server,
+                                                 options.port, faults);
+        std::cout << "Fault policies active: " << active << std::endl;
+    }
+    const bool faultsActive = !faults.policies.empty();
+    // Per-client admission control: rates are checked on the request path (the
+    // fault injection hook, without policies if none are configured)
+    ClientLimiter limiter;
+    StartClientLimits(options, limiter);
+    const bool clientLimitsActive = options.maxClientsPerIp > 0 || options.idleTimeoutSec > 0 ||
+                                    ClientRatesLimited(options);
+    if (ClientRatesLimited(options)) {
+        if (options.faultsFile.empty()) {
+            InitializeFaultInjection(std::vector<FaultConfigEntry>(), image, S7Server, options.port, faults);
+        }
+        faults.limiter = &limiter;
+    }
+    if (options.deterministic) {
+        faults.rng.seed(options.seed);
+    }
+
+    // Hot-standby replication: this server either ships its changes or mirrors a primary
+    Replicator replicator;
+    StandbyReceiver standby;
+    const bool replicating = !options.replicateHost.empty();
+    const bool standbyMode = !options.standbyHost.empty();
+    if (replicating && !StartReplication(S7Server, image, options.replicateHost, options.replicatePort, replicator)) {
+        StopClientLimits(limiter);
+        Srv_Destroy(&S7Server);
+        ReleaseProcessImage(image);
+        return 1;
+    }
+    if (standbyMode && !StartStandby(S7Server, image, options.standbyHost, options.standbyPort, standby)) {
+        StopClientLimits(limiter);
+        Srv_Destroy(&S7Server);
+        ReleaseProcessImage(image);
+        return 1;
+    }
+    DirtyTracker* dirty = replicating ? &replicator.dirty : nullptr;
+
+    EventContext eventContext;
+    eventContext.writeQueue = reactions.reactions.empty() ? nullptr : &writeQueue;
+    eventContext.replicationQueue = replicating ? &replicator.clientWrites : nullptr;
+    eventContext.logRequests = options.verbose;
+    eventContext.tagIndex = &tagIndex;
+    eventContext.tags = &csvConfig;
+    eventContext.limiter = clientLimitsActive ? &limiter : nullptr;
+
     // Set event callbacks
-    Srv_SetEventsCallback(S7Server, EventCallback, nullptr);
-    Srv_SetReadEventsCallback(S7Server, ReadEventCallback, nullptr);
+    Srv_SetEventsCallback(S7Server, EventCallback, &eventContext);
+    if (options.verbose) {
+        Srv_SetReadEventsCallback(S7Server, ReadEventCallback, &eventContext);
+    }
     
     // IMPORTANT: RWAreaCallback is intentionally NOT registered here.
     // When a RWAreaCallback is registered, Snap7 delegates ALL read/write operations
@@ -979,15 +754,36 @@ int main() {
     // If you need custom read/write logic or logging in the future, implement
     // complete data transfer in RWAreaCallback before re-enabling this line:
     // Srv_SetRWAreaCallback(S7Server, RWAreaCallback, nullptr);
+    //
+    // Fault injection is the exception: its callback applies the configured delays,
+    // faults and per-client rates and then performs the complete transfer to the process image.
+    if (faultsActive || faults.limiter) {
+        Srv_SetRWAreaCallback(S7Server, FaultInjectionCallback, &faults);
+    }
 
     // Set event mask to capture important events
-    Srv_SetMask(S7Server, mkEvent, 0xFFFFFFFF);
+    // In quiet mode per-request events are masked out so logging does not throttle the server
+    // (writes stay enabled when reactions or replication need them; the callback does not log them)
+    longword eventMask = 0xFFFFFFFF;
+    if (!options.verbose) {
+        eventMask &= ~(evcPDUincoming | evcDataRead);
+        if (!eventContext.writeQueue && !eventContext.replicationQueue) {
+            eventMask &= ~evcDataWrite;
+        }
+    }
+    Srv_SetMask(S7Server, mkEvent, eventMask);
     Srv_SetMask(S7Server, mkLog, 0x00000000); // Disable excessive logging
 
     // Get the configured port
     int serverPort = 102;
     Srv_GetParam(S7Server, p_u16_LocalPort, &serverPort);
   
+    // Snap7 threads created by Srv_Start inherit this thread's affinity, so the
+    // simulation CPU is excluded before starting and claimed afterwards
+    if (options.realTime.cycleMs > 0 && options.realTime.cpu >= 0) {
+        ReserveSimulationCpu(options.realTime.cpu);
+    }
+
     // Start the server
     std::cout << "Starting server on port " << serverPort << "..." << std::endl;
     if (serverPort == 102) {
@@ -1003,19 +799,110 @@ int main() {
       std::cerr << "      Run this application as Administrator." << std::endl;
         
         // Cleanup
+        StopReplication(replicator);
+        StopStandby(standby);
+        StopClientLimits(limiter);
     Srv_Destroy(&S7Server);
-		CleanupResources(dataBlocks, IArea, QArea, MArea, TArea, CArea);
+		ReleaseProcessImage(image);
 		return 1;
     }
 
 	std::cout << "\n*** Server started successfully! ***\n" << std::endl;
-	DisplayConfig(dataBlocks);
+	DisplayConfig(image, options);
+    
+    // Simulated process time for tag phases, derived tags and timers
+    SimClock simClock;
+    simClock.Configure(options.timeWarp, options.deterministic);
+    if (options.deterministic) {
+        SeedRandomValues(options.seed);
+    }
+    if (options.timeWarp != 1.0 || options.deterministic) {
+        std::cout << "Simulated time: " << options.timeWarp << "x real time"
+                  << (options.deterministic ? ", deterministic steps (seed " + std::to_string(options.seed) + ")" : "")
+                  << std::endl;
+    }
     
     // Initialize tag states for dynamic value updates
     std::vector<TagState> tagStates;
-    if (!csvConfig.empty()) {
-        tagStates = InitializeTagStates(csvConfig, dataBlocks, IArea, QArea, MArea);
-        std::cout << "Dynamic tag value updates enabled with 100ms update interval." << std::endl;
+    DerivedTagGraph derivedTags;
+    if (standbyMode) {
+        std::cout << "Standby mode: tag values come from the primary only." << std::endl;
+    } else if (!csvConfig.empty()) {
+        tagStates = InitializeTagStates(csvConfig, image, simClock.Now());
+        BuildDerivedTagGraph(csvConfig, tagStates, derivedTags);
+        std::cout << "Dynamic tag value updates enabled with "
+                  << (options.realTime.cycleMs > 0 ? options.realTime.cycleMs : 100) << "ms update interval." << std::endl;
+    }
+    // Update engine: the one generated for this tag table when the build has one
+    // (S7SIM_GENERATED_ENGINE), otherwise the generic engine
+    TagUpdateFunction updateTags = UpdateTagValues;
+#ifdef S7SIM_GENERATED_ENGINE
+    if (!tagStates.empty() && !options.genericEngine) {
+        if (TagTableFingerprint(tagStates) == GeneratedTagEngine.fingerprint) {
+            updateTags = GeneratedTagEngine.update;
+            std::cout << "Update engine: generated for " << GeneratedTagEngine.configFile << " ("
+                      << GeneratedTagEngine.groupCount << " cycletime groups)" << std::endl;
+        } else {
+            std::cerr << "WARNING: The generated update engine was built for a different tag table ("
+                      << GeneratedTagEngine.configFile << "); using the generic engine" << std::endl;
+        }
+    }
+#endif
+    if (options.dataAgeHeader) {
+        std::cout << "Data-age header enabled at DB offset " << options.dataAgeOffset
+                  << " (cycle counter + microsecond timestamp, " << DATA_AGE_HEADER_SIZE << " bytes)." << std::endl;
+    }
+    // Compressed history of every tag's published value
+    TagHistory history;
+    if (options.historyBytesPerTag > 0 && !tagStates.empty() &&
+        !StartTagHistory(tagStates, options.historyBytesPerTag, options.historySocket, history)) {
+        Srv_Stop(S7Server);
+        StopReplication(replicator);
+        StopClientLimits(limiter);
+        Srv_Destroy(&S7Server);
+        ReleaseProcessImage(image);
+        return 1;
+    }
+    const bool historyActive = history.running;
+    // Ground-truth export of every value change
+    ValueExporter exporter;
+    if (!options.exportFile.empty() && !tagStates.empty() &&
+        !StartValueExport(tagStates, options.exportFile, exporter)) {
+        Srv_Stop(S7Server);
+        StopReplication(replicator);
+        StopTagHistory(history);
+        StopClientLimits(limiter);
+        Srv_Destroy(&S7Server);
+        ReleaseProcessImage(image);
+        return 1;
+    }
+    const bool exportActive = exporter.running;
+    // Runtime control of the tags from a local socket
+    ControlApi control;
+    if (!options.controlSocket.empty() && !tagStates.empty() &&
+        !StartControlApi(tagStates, image.dataBlocks, options.controlSocket, &writeQueue, control)) {
+        Srv_Stop(S7Server);
+        StopReplication(replicator);
+        StopTagHistory(history);
+        StopValueExport(exporter);
+        StopClientLimits(limiter);
+        Srv_Destroy(&S7Server);
+        ReleaseProcessImage(image);
+        return 1;
+    }
+    const bool controlActive = control.running;
+    
+
+    // Real-time mode: every pass of the loop is one scan cycle on absolute deadlines
+    const bool realTime = options.realTime.cycleMs > 0;
+    ScanCycle scanCycle;
+    if (realTime) {
+        std::cout << "Real-time mode: " << options.realTime.cycleMs << " ms scan cycle";
+        if (options.realTime.priority > 0) std::cout << ", SCHED_FIFO " << options.realTime.priority;
+        if (options.realTime.cpu >= 0) std::cout << ", CPU " << options.realTime.cpu;
+        if (options.realTime.lockMemory) std::cout << ", memory locked";
+        std::cout << std::endl;
+        EnterRealTimeMode(options.realTime);
     }
     
     std::cout << "Server is running. Press Ctrl+C to stop.\n" << std::endl;
@@ -1023,33 +910,167 @@ int main() {
     // Main server loop with time-based status updates and tag value updates
     auto lastStatusTime = std::chrono::steady_clock::now();
     const auto statusInterval = std::chrono::seconds(30);
+    const auto updateInterval = std::chrono::milliseconds(100);
+    const auto passInterval = realTime ? std::chrono::milliseconds(options.realTime.cycleMs) : updateInterval;
+    auto nextTagUpdate = std::chrono::steady_clock::now();
+    if (realTime) {
+        StartScanCycle(scanCycle, options.realTime.cycleMs, nextTagUpdate);
+    }
+    SchedulerStats schedulerStats;
+    InitializeSchedulerStats(tagStates, passInterval, schedulerStats);
     
     while (ServerRunning) {
-        // Update tag values every 100ms
-        if (!tagStates.empty()) {
-            UpdateTagValues(tagStates);
+        // Update tag values every 100ms (every scan cycle in real-time mode)
+        auto currentTime = std::chrono::steady_clock::now();
+        BeginLoopPass(schedulerStats);
+        // Apply the control commands queued since the last pass; a generated engine
+        // does not know about held or reparameterised tags
+        if (controlActive &&
+            ApplyControlCommands(S7Server, control, tagStates, image.dataBlocks, &derivedTags, simClock.Now(),
+                                 dirty, exportActive ? &exporter : nullptr) &&
+            updateTags != UpdateTagValues) {
+            updateTags = UpdateTagValues;
+            std::cout << "NOTE: Tags changed through the control API; switched to the generic update engine" << std::endl;
+        }
+        const bool updatePass = realTime || currentTime >= nextTagUpdate;
+        if (updatePass) {
+            simClock.Advance(passInterval);
+            if (!tagStates.empty() || options.dataAgeHeader) {
+                updateTags(S7Server, tagStates, image.dataBlocks, options, &derivedTags, &schedulerStats,
+                           simClock.Now(), dirty, exportActive ? &exporter : nullptr);
+            }
+            nextTagUpdate = currentTime + updateInterval;
+        }
+        
+        // React to client writes queued since the last pass
+        if (!reactions.reactions.empty()) {
+            ProcessWriteReactions(S7Server, writeQueue, reactions, dirty);
+        }
+        if (timersActive) {
+            TickTimersAndCounters(S7Server, timerEngine, simClock.Now(), dirty);
+        }
+        // Record what this update cycle published
+        if (historyActive && updatePass) {
+            RecordTagHistory(history);
         }
+        // Ship everything this pass changed to the standby
+        if (replicating) {
+            ShipDirtyRanges(replicator);
+        }
+        EndLoopPass(schedulerStats);
         
         // Display status every 30 seconds
-		auto currentTime = std::chrono::steady_clock::now();
 		if (currentTime - lastStatusTime >= statusInterval) {
 		DisplayStatus(S7Server);
+		    if (!reactions.reactions.empty()) {
+		        DisplayReactionStats(reactions, writeQueue);
+		    }
+		    if (timersActive) {
+		        DisplayTimerStats(timerEngine);
+		    }
+		    if (realTime) {
+		        DisplayScanCycleStats(scanCycle);
+		    }
+		    if (faultsActive) {
+		        DisplayFaultStats(faults);
+		    }
+		    if (replicating) {
+		        DisplayReplicationStats(replicator);
+		    }
+		    if (standbyMode) {
+		        DisplayStandbyStats(standby);
+		    }
+		    if (historyActive) {
+		        DisplayTagHistoryStats(history);
+		    }
+		    if (exportActive) {
+		        DisplayValueExportStats(exporter);
+		    }
+		    if (controlActive) {
+		        DisplayControlStats(control);
+		    }
+		    if (options.maxClients > 0) {
+		        std::cout << "Connections refused (limit " << options.maxClients << "): "
+		                  << eventContext.refusedClients << std::endl;
+		    }
+		    if (clientLimitsActive) {
+		        DisplayClientLimitStats(limiter);
+		    }
+		    DisplaySchedulerStats(schedulerStats);
+		    if (!options.statsFile.empty()) {
+		        WriteSchedulerStats(schedulerStats, options.statsFile);
+		    }
 		    lastStatusTime = currentTime;
 		}
         
-        // Sleep for 100ms (threshold as specified in requirements)
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (realTime) {
+            WaitForNextCycle(scanCycle);
+            continue;
+        }
+        
+        // Sleep until the next 100ms update (threshold as specified in requirements);
+        // timers need a 1ms tick (at most every real millisecond under time warp), and
+        // with reactions configured queued writes and due reactions wake the loop early,
+        // as do published control batches with the control API
+        auto deadline = nextTagUpdate;
+        if (timersActive) {
+            deadline = std::min(deadline, std::max(simClock.ToReal(NextTimerTick(timerEngine)),
+                                                   currentTime + std::chrono::milliseconds(1)));
+        }
+        if (reactions.reactions.empty() && !controlActive) {
+            std::this_thread::sleep_until(deadline);
+        } else {
+            writeQueue.WaitUntil(NextReactionDeadline(reactions, deadline));
+        }
     }
 
     // Shutdown
     std::cout << "\nStopping server..." << std::endl;
 	Srv_Stop(S7Server);
+    StopReplication(replicator);
+    StopStandby(standby);
+    StopTagHistory(history);
+    StopValueExport(exporter);
+    StopControlApi(control);
+    StopClientLimits(limiter);
+    
+    if (historyActive) {
+        DisplayTagHistoryStats(history);
+    }
+    if (exportActive) {
+        DisplayValueExportStats(exporter);
+    }
+    if (controlActive) {
+        DisplayControlStats(control);
+    }
+    if (replicating) {
+        DisplayReplicationStats(replicator);
+    }
+    if (standbyMode) {
+        DisplayStandbyStats(standby);
+    }
+    if (!reactions.reactions.empty()) {
+        DisplayReactionStats(reactions, writeQueue);
+    }
+    if (realTime) {
+        DisplayScanCycleStats(scanCycle);
+    }
+    if (faultsActive) {
+        DisplayFaultStats(faults);
+    }
+    if (clientLimitsActive) {
+        DisplayClientLimitStats(limiter);
+    }
+    DisplaySchedulerStats(schedulerStats);
+    if (!options.statsFile.empty()) {
+        WriteSchedulerStats(schedulerStats, options.statsFile);
+    }
     
     std::cout << "Cleaning up resources..." << std::endl;
     Srv_Destroy(&S7Server);
     
-    // Free allocated memory
-    CleanupResources(dataBlocks, IArea, QArea, MArea, TArea, CArea);
+    // Free the whole process image at once
+    ReleaseProcessImage(image);
 
 	std::cout << "Server stopped successfully. Goodbye!" << std::endl;
     return 0;
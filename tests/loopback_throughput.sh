@@ -0,0 +1,132 @@
+#!/bin/bash
+
+# Loopback end-to-end throughput test for S7Server
+#
+# Starts S7Server on an unprivileged port with a generated large configuration,
+# runs a fixed-duration S7Client read load against it and compares throughput
+# and p99 latency with the stored baseline.
+#
+# Usage: loopback_throughput.sh <S7Server> <S7Client> <baseline file> <work dir>
+#
+# Environment overrides:
+#   LOOPBACK_PORT      Server port (default 11102)
+#   LOOPBACK_DURATION  Load duration in seconds (default 10)
+#   LOOPBACK_THREADS   Concurrent client connections (default 4)
+#   LOOPBACK_DBS       Generated Data Blocks, 50 REALs each (default 200)
+#   UPDATE_BASELINE=1  Store the measured values as the new baseline
+#
+# Exit codes: 0 pass, 1 regression or failure, 77 skipped (no Snap7 library or port not available)
+
+set -u
+
+if [ $# -ne 4 ]; then
+    echo "Usage: $0 <S7Server> <S7Client> <baseline file> <work dir>"
+    exit 1
+fi
+
+SERVER="$1"
+CLIENT="$2"
+BASELINE="$3"
+WORKDIR="$4"
+PORT="${LOOPBACK_PORT:-11102}"
+DURATION="${LOOPBACK_DURATION:-10}"
+THREADS="${LOOPBACK_THREADS:-4}"
+DBS="${LOOPBACK_DBS:-200}"
+BLOCK_SIZE=200
+
+mkdir -p "$WORKDIR"
+cd "$WORKDIR" || exit 1
+
+# Generate the configuration: DB1..DB<n>, 50 REALs per DB, all changing every 100 ms
+CONFIG="loopback_config.csv"
+awk -v dbs="$DBS" 'BEGIN {
+    print "tag,min,max,echelon,cycletime"
+    for (db = 1; db <= dbs; db++)
+        for (offset = 0; offset < 200; offset += 4)
+            printf "\"DB%d,REAL%d\",0,1800,0.5,100\n", db, offset
+}' > "$CONFIG"
+echo "Generated $CONFIG: $DBS DBs, $((DBS * 50)) tags"
+
+# Start the server and wait until it reports a successful start
+"$SERVER" --config "$CONFIG" --port "$PORT" --quiet > server.log 2>&1 &
+SERVER_PID=$!
+trap 'kill "$SERVER_PID" 2>/dev/null; wait "$SERVER_PID" 2>/dev/null' EXIT
+
+for i in $(seq 1 100); do
+    if grep -q "Server started successfully" server.log; then
+        break
+    fi
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        break
+    fi
+    sleep 0.1
+done
+
+# Skip only when this machine cannot run a server: libsnap7 missing (or a placeholder
+# build whose calls all fail with "stub") or the port cannot be bound. A crash, an abort
+# or a rejected configuration is a failure.
+if ! grep -q "Server started successfully" server.log; then
+    if grep -qE "error while loading shared libraries: .*snap7|Error: stub$" server.log; then
+        echo "SKIP: the Snap7 library is not available"
+        tail -n 5 server.log
+        exit 77
+    fi
+    if grep -qiE "Failed to start server: .*(address already in use|bind|permission denied|access denied)" server.log; then
+        echo "SKIP: S7Server could not listen on port $PORT"
+        tail -n 5 server.log
+        exit 77
+    fi
+    echo "FAIL: S7Server did not start"
+    tail -n 10 server.log
+    exit 1
+fi
+
+# Run the load
+echo "Running $DURATION s load with $THREADS connections..."
+"$CLIENT" 127.0.0.1 0 0 "$PORT" --load "$DURATION" --threads "$THREADS" \
+    --first-db 1 --db-count "$DBS" --block-size "$BLOCK_SIZE" > client.log 2>&1
+CLIENT_STATUS=$?
+
+RESULT=$(grep "^LOAD_RESULT" client.log)
+if [ $CLIENT_STATUS -ne 0 ] || [ -z "$RESULT" ]; then
+    echo "FAIL: client load run failed (exit code $CLIENT_STATUS)"
+    tail -n 10 client.log
+    exit 1
+fi
+echo "$RESULT"
+
+value() {
+    echo "$1" | tr ' ' '\n' | grep "^$2=" | cut -d= -f2
+}
+READS_PER_SEC=$(value "$RESULT" reads_per_sec)
+P99_MS=$(value "$RESULT" p99_ms)
+
+if [ "${UPDATE_BASELINE:-0}" = "1" ]; then
+    TOLERANCE=$(grep "^tolerance_percent=" "$BASELINE" 2>/dev/null | cut -d= -f2)
+    {
+        echo "# Loopback throughput baseline (tests/loopback_throughput.sh)"
+        echo "# Regenerate on the reference machine with: UPDATE_BASELINE=1 ctest -R loopback_throughput"
+        echo "reads_per_sec=$READS_PER_SEC"
+        echo "p99_ms=$P99_MS"
+        echo "tolerance_percent=${TOLERANCE:-25}"
+    } > "$BASELINE"
+    echo "Baseline updated: $BASELINE"
+    exit 0
+fi
+
+BASE_READS=$(grep "^reads_per_sec=" "$BASELINE" | cut -d= -f2)
+BASE_P99=$(grep "^p99_ms=" "$BASELINE" | cut -d= -f2)
+TOLERANCE=$(grep "^tolerance_percent=" "$BASELINE" | cut -d= -f2)
+
+awk -v reads="$READS_PER_SEC" -v p99="$P99_MS" \
+    -v baseReads="$BASE_READS" -v baseP99="$BASE_P99" -v tol="$TOLERANCE" 'BEGIN {
+    minReads = baseReads * (1 - tol / 100.0)
+    maxP99 = baseP99 * (1 + tol / 100.0)
+    printf "Throughput: %.1f reads/s (baseline %.1f, minimum %.1f)\n", reads, baseReads, minReads
+    printf "p99 latency: %.3f ms (baseline %.3f, maximum %.3f)\n", p99, baseP99, maxP99
+    failed = 0
+    if (reads < minReads) { print "FAIL: throughput regression"; failed = 1 }
+    if (p99 > maxP99) { print "FAIL: p99 latency regression"; failed = 1 }
+    if (!failed) print "PASS"
+    exit failed
+}'
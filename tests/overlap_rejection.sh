@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# Overlap rejection test for S7Server
+#
+# Generates a configuration with S7ConfigGen --overlap, whose tags share bytes
+# with their predecessors, and checks that S7Server refuses to start on it with
+# the address conflicts reported. The check runs before the server listens, so
+# no port is opened.
+#
+# Usage: overlap_rejection.sh <S7ConfigGen> <S7Server> <work dir>
+#
+# Exit codes: 0 pass, 1 failure, 77 skipped (no Snap7 library)
+
+set -u
+
+if [ $# -ne 3 ]; then
+    echo "Usage: $0 <S7ConfigGen> <S7Server> <work dir>"
+    exit 1
+fi
+
+GENERATOR="$1"
+SERVER="$2"
+WORKDIR="$3"
+
+mkdir -p "$WORKDIR"
+cd "$WORKDIR" || exit 1
+
+CONFIG="overlap_config.csv"
+if ! "$GENERATOR" --dbs 5 --tags-per-db 100 --overlap 0.05 --seed 3 --output "$CONFIG"; then
+    echo "FAIL: S7ConfigGen could not write $CONFIG"
+    exit 1
+fi
+
+# A server that accepted the configuration would keep running: the timeout ends it
+timeout 30 "$SERVER" --config "$CONFIG" --port 11103 --quiet > server.log 2>&1
+STATUS=$?
+
+if grep -q "error while loading shared libraries: .*snap7" server.log; then
+    echo "SKIP: Snap7 library not available"
+    exit 77
+fi
+if [ "$STATUS" -eq 0 ] || [ "$STATUS" -eq 124 ]; then
+    echo "FAIL: S7Server accepted the overlapping configuration (exit $STATUS)"
+    exit 1
+fi
+if ! grep -q "^ERROR: Tags .* overlap$" server.log || ! grep -q "Fix the address conflicts" server.log; then
+    echo "FAIL: S7Server exited ($STATUS) without reporting the overlapping tags:"
+    tail -5 server.log
+    exit 1
+fi
+echo "PASS: $(grep -c ' overlap$' server.log) overlaps reported, start-up refused"
+exit 0
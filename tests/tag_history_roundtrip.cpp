@@ -0,0 +1,180 @@
+/*
+ * Tag history encode/decode round-trip test
+ *
+ * Feeds known sample sequences through the Gorilla encoder of TagHistory and
+ * checks that QueryTagHistory returns exactly the samples appended (timestamps
+ * and value bits):
+ * - Timestamps whose delta-of-delta sits on and next to every bucket edge
+ *   (64, 256, 2048, both signs) and beyond it (the 32-bit escape)
+ * - Values whose XOR with the previous one is zero, fits the previous window,
+ *   needs a new window, or has more than 31 leading zeros (clamped to 31)
+ * - A ring small enough to roll over: the query returns the newest samples as
+ *   one contiguous run ending with the last sample appended
+ *
+ * Usage: tag_history_roundtrip    (exit code 1 on the first mismatch)
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "TagHistory.h"
+
+namespace {
+
+uint64_t Bits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double FromBits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Two REAL tags in one image, as InitializeTagHistory expects them
+std::vector<TagState> MakeTags(byte* image) {
+    std::vector<TagState> tags(2);
+    for (size_t i = 0; i < tags.size(); i++) {
+        TagState& tag = tags[i];
+        tag.areaType = AreaType::DB;
+        tag.dbNumber = 1;
+        tag.offset = static_cast<int>(i * 4);
+        tag.bitPosition = -1;
+        tag.dataType = DataType::REAL;
+        tag.dataPtr = image;
+    }
+    return tags;
+}
+
+std::vector<HistorySample> QueryAll(TagHistory& history, size_t index) {
+    return QueryTagHistory(history, index, std::numeric_limits<int64_t>::min(),
+                           std::numeric_limits<int64_t>::max());
+}
+
+bool SameSample(const HistorySample& a, const HistorySample& b) {
+    return a.timestampMs == b.timestampMs && Bits(a.value) == Bits(b.value);
+}
+
+// Compare 'decoded' with 'expected[first...]'
+bool Check(const char* name, const std::vector<HistorySample>& expected, size_t first,
+           const std::vector<HistorySample>& decoded) {
+    if (decoded.size() != expected.size() - first) {
+        std::cout << "FAIL " << name << ": " << decoded.size() << " samples decoded, "
+                  << expected.size() - first << " expected" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < decoded.size(); i++) {
+        const HistorySample& want = expected[first + i];
+        if (!SameSample(decoded[i], want)) {
+            std::cout << "FAIL " << name << ": sample " << first + i << " decoded as ("
+                      << decoded[i].timestampMs << ", 0x" << std::hex << Bits(decoded[i].value)
+                      << "), expected (" << std::dec << want.timestampMs << ", 0x" << std::hex
+                      << Bits(want.value) << ")" << std::dec << std::endl;
+            return false;
+        }
+    }
+    std::cout << "PASS " << name << ": " << decoded.size() << " samples" << std::endl;
+    return true;
+}
+
+// Delta-of-delta on both sides of every bucket edge, then the 32-bit escape
+bool TestTimestampBuckets() {
+    byte image[8] = {0};
+    TagHistory history;
+    InitializeTagHistory(MakeTags(image), 4096, history);
+
+    const int64_t dods[] = {
+        0, 63, 64, 65, -63, -64, -65,
+        255, 256, 257, -255, -256, -257,
+        2047, 2048, 2049, -2047, -2048, -2049,
+        100000, -100000, 0
+    };
+    std::vector<HistorySample> expected;
+    int64_t ms = 1000000;
+    int64_t delta = 200000;  // Large enough that no dod below makes a delta negative
+    expected.push_back({ms, 1.0});
+    ms += delta;
+    expected.push_back({ms, 2.0});
+    for (int64_t dod : dods) {
+        delta += dod;
+        ms += delta;
+        expected.push_back({ms, static_cast<double>(expected.size() + 1)});
+    }
+    for (const HistorySample& sample : expected) {
+        AppendTagHistorySample(history, 0, sample.timestampMs, sample.value);
+    }
+    return Check("delta-of-delta buckets", expected, 0, QueryAll(history, 0));
+}
+
+// Zero XOR, window reuse, new windows and leading-zero counts above 31
+bool TestValueXor() {
+    byte image[8] = {0};
+    TagHistory history;
+    InitializeTagHistory(MakeTags(image), 4096, history);
+
+    const uint64_t base = Bits(1.0);
+    const double values[] = {
+        1.0,
+        1.0,                               // XOR 0
+        FromBits(base ^ 1),                // 63 leading zeros, clamped to 31
+        1.0,                               // Same window again
+        FromBits(base ^ 0x80000000ULL),    // 32 leading zeros, clamped to 31
+        FromBits(base ^ 0x100000000ULL),   // 31 leading zeros, the largest stored as is
+        -1.0,                              // Sign bit only: no leading zeros
+        3.141592653589793,
+        0.0,
+        -0.0,
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::infinity(),
+        123456.789,
+        123456.789
+    };
+    std::vector<HistorySample> expected;
+    int64_t ms = 5000;
+    for (double value : values) {
+        expected.push_back({ms, value});
+        ms += 100;
+    }
+    for (const HistorySample& sample : expected) {
+        AppendTagHistorySample(history, 1, sample.timestampMs, sample.value);
+    }
+    return Check("value XOR windows", expected, 0, QueryAll(history, 1));
+}
+
+// A 128-byte ring rolls over many times: the newest samples come back contiguous
+bool TestRollover() {
+    byte image[8] = {0};
+    TagHistory history;
+    InitializeTagHistory(MakeTags(image), HISTORY_MIN_BYTES_PER_TAG, history);
+
+    std::vector<HistorySample> expected;
+    int64_t ms = 0;
+    for (int i = 0; i < 500; i++) {
+        ms += 100 + (i % 7) * 37;
+        expected.push_back({ms, (i % 3 == 0) ? -0.5 * i : 1000.0 + i * 0.25});
+    }
+    for (const HistorySample& sample : expected) {
+        AppendTagHistorySample(history, 0, sample.timestampMs, sample.value);
+    }
+    std::vector<HistorySample> decoded = QueryAll(history, 0);
+    if (decoded.empty() || decoded.size() >= expected.size()) {
+        std::cout << "FAIL ring rollover: " << decoded.size() << " samples decoded of "
+                  << expected.size() << " appended" << std::endl;
+        return false;
+    }
+    return Check("ring rollover", expected, expected.size() - decoded.size(), decoded);
+}
+
+} // namespace
+
+int main() {
+    bool ok = TestTimestampBuckets();
+    ok = TestValueXor() && ok;
+    ok = TestRollover() && ok;
+    return ok ? 0 : 1;
+}
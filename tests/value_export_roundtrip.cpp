@@ -0,0 +1,164 @@
+/*
+ * Value export encode/decode round-trip test
+ *
+ * Writes known update passes through the columnar value exporter and checks
+ * that ReadValueExport returns exactly the rows exported (timestamps, tag ids
+ * and value bits):
+ * - Enough rows for two full blocks of EXPORT_BLOCK_ROWS and a partial one,
+ *   with block boundaries falling inside a pass
+ * - Timestamps that go back between passes and tag ids in descending order
+ *   (negative zigzag deltas)
+ * - Values XOR-ed with zero as the first value of a tag in a block (0.0,
+ *   -0.0, NaN and infinity among them) and repeated values (XOR zero)
+ * - A truncated file, which must be rejected
+ *
+ * Usage: value_export_roundtrip [directory]    (exit code 1 on the first mismatch)
+ */
+
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "TagEngine.h"
+#include "ValueExport.h"
+
+namespace {
+
+const size_t TAG_COUNT = 1000;
+const int PASSES = 200;
+
+uint64_t Bits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+std::vector<TagState> MakeTags() {
+    const DataType types[] = {DataType::REAL, DataType::DWORD, DataType::INT, DataType::BOOL};
+    std::vector<TagState> tags(TAG_COUNT);
+    for (size_t i = 0; i < tags.size(); i++) {
+        TagState& tag = tags[i];
+        tag.areaType = AreaType::DB;
+        tag.dbNumber = 1;
+        tag.offset = static_cast<int>(i * 4);
+        tag.dataType = types[i % 4];
+        tag.bitPosition = tag.dataType == DataType::BOOL ? 0 : -1;
+    }
+    return tags;
+}
+
+double PassValue(int pass, size_t tag) {
+    switch (tag % 5) {
+        case 0: return 0.0;                                        // XOR with zero is zero
+        case 1: return pass % 2 ? -0.0 : 1.0;                      // Sign bit alone
+        case 2: return pass * 0.5 - static_cast<double>(tag);
+        case 3: return 1234.5678;                                  // Repeated within a block
+        default: {
+            const double special[] = {std::numeric_limits<double>::quiet_NaN(),
+                                      std::numeric_limits<double>::infinity(),
+                                      -std::numeric_limits<double>::max(),
+                                      std::numeric_limits<double>::denorm_min()};
+            return special[(pass + tag) % 4];
+        }
+    }
+}
+
+// Timestamps advance 100 ms per pass, but every seventh pass is stamped earlier than the one before
+int64_t PassTimestamp(int pass) {
+    return 1700000000000000LL + pass * 100000LL - (pass % 7 == 3 ? 250000 : 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = std::string(argc > 1 ? argv[1] : ".") + "/value_export_roundtrip.s7cx";
+    std::vector<TagState> tags = MakeTags();
+
+    ValueExporter exporter;
+    if (!StartValueExport(tags, path, exporter)) {
+        return 1;
+    }
+    std::vector<ExportedRow> expected;
+    for (int pass = 0; pass < PASSES; pass++) {
+        // Descending tag ids, a third of the tags left out in turn
+        for (size_t t = TAG_COUNT; t-- > 0;) {
+            if (static_cast<int>(t % 3) == pass % 3) {
+                continue;
+            }
+            double value = PassValue(pass, t);
+            ExportTagValue(&exporter, t, value);
+            expected.push_back({PassTimestamp(pass), static_cast<uint32_t>(t), value});
+        }
+        FinishExportPass(&exporter, PassTimestamp(pass));
+    }
+    StopValueExport(exporter);
+    if (exporter.droppedBatches != 0 || exporter.writeFailed) {
+        std::cout << "FAIL export: " << exporter.droppedBatches << " batches dropped" << std::endl;
+        return 1;
+    }
+
+    ValueExportFile file;
+    if (!ReadValueExport(path, file)) {
+        std::cout << "FAIL read: the export file does not decode" << std::endl;
+        return 1;
+    }
+    bool ok = true;
+    if (file.tags.size() != TAG_COUNT || file.tags[1].dataType != 1 || file.tags[1].name != "DB1,DWORD4") {
+        std::cout << "FAIL dictionary: " << file.tags.size() << " tags" << std::endl;
+        ok = false;
+    }
+    if (file.blockRows.size() < 3 || file.blockRows[0] != EXPORT_BLOCK_ROWS || file.blockRows[1] != EXPORT_BLOCK_ROWS) {
+        std::cout << "FAIL blocks: expected two full blocks of " << EXPORT_BLOCK_ROWS << " rows and a partial one, got "
+                  << file.blockRows.size() << " blocks" << std::endl;
+        ok = false;
+    }
+    if (file.rows.size() != expected.size()) {
+        std::cout << "FAIL rows: " << file.rows.size() << " decoded, " << expected.size() << " expected" << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        const ExportedRow& got = file.rows[i];
+        const ExportedRow& want = expected[i];
+        if (got.timestampUs != want.timestampUs || got.tag != want.tag || Bits(got.value) != Bits(want.value)) {
+            std::cout << "FAIL row " << i << ": decoded (" << got.timestampUs << ", " << got.tag << ", 0x" << std::hex
+                      << Bits(got.value) << "), expected (" << std::dec << want.timestampUs << ", " << want.tag
+                      << ", 0x" << std::hex << Bits(want.value) << ")" << std::dec << std::endl;
+            return 1;
+        }
+    }
+    if (ok) {
+        std::cout << "PASS round trip: " << file.rows.size() << " rows in " << file.blockRows.size() << " blocks"
+                  << std::endl;
+    }
+
+    // Cut the last block short: the decoder must notice
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    std::vector<char> data;
+    char chunk[65536];
+    size_t got;
+    while (f && (got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    if (f) {
+        std::fclose(f);
+    }
+    std::string truncated = path + ".truncated";
+    f = std::fopen(truncated.c_str(), "wb");
+    if (f) {
+        std::fwrite(data.data(), 1, data.size() - 3, f);
+        std::fclose(f);
+    }
+    ValueExportFile broken;
+    if (ReadValueExport(truncated, broken)) {
+        std::cout << "FAIL truncated file decoded without an error" << std::endl;
+        ok = false;
+    } else {
+        std::cout << "PASS truncated file rejected" << std::endl;
+    }
+    std::remove(truncated.c_str());
+    std::remove(path.c_str());
+    return ok ? 0 : 1;
+}